@@ -1,16 +1,67 @@
 package net.kdt.pojavlaunch;
 
-import java.io.File;
-import java.io.IOException;
+import java.io.*;
+import java.lang.reflect.Constructor;
 import java.net.*;
+import java.nio.charset.StandardCharsets;
+import java.security.CodeSigner;
+import java.security.CodeSource;
+import java.util.*;
+import java.util.jar.*;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipFile;
 
 /**
  * This class loader is used as system class loader
  * as a workaround to modded libraries for Java 8
  * compatibility that safety casting to URLClassLoader:
  * ((URLClassLoader) ClassLoader.getSystemClassLoader())
+ *
+ * Lookups don't scan the URL list: every jar's directories are indexed from its
+ * central directory, so a class or resource only probes the jars that contain
+ * its package. Indexes are cached in $POJAV_HOME/cache/classpath_index.bin,
+ * keyed by path, size and modification time.
  */
 public class PojavClassLoader extends URLClassLoader {
+    private static final int INDEX_MAGIC = 0x504a4958;
+    private static final int INDEX_VERSION = 1;
+    // Cached jars beyond the current class path, e.g. from other instances
+    private static final int INDEX_MAX_JARS = 4096;
+    // How stale lastUsed may get before a cache hit rewrites the index
+    private static final long INDEX_TOUCH_INTERVAL = 24 * 60 * 60 * 1000L;
+    private static final Entry[] NO_ENTRIES = new Entry[0];
+
+    // Runtime-versioned JarFile constructor of Java 9+, to honour multi-release jars
+    private static final Constructor<JarFile> VERSIONED_JAR_FILE;
+    private static final Object RUNTIME_VERSION;
+    static {
+        Constructor<JarFile> constructor = null;
+        Object version = null;
+        try {
+            Class<?> versionClass = Class.forName("java.lang.Runtime$Version");
+            constructor = JarFile.class.getConstructor(File.class, boolean.class, int.class, versionClass);
+            version = Runtime.class.getMethod("version").invoke(null);
+        } catch (Throwable e) {
+            constructor = null;
+        }
+        VERSIONED_JAR_FILE = constructor;
+        RUNTIME_VERSION = version;
+    }
+
+    private final Object indexLock = new Object();
+    private final Set<String> knownPaths = new HashSet<>();
+    // Added but not indexed yet, indexing waits for the first lookup
+    private final List<Entry> pending = new ArrayList<>();
+    // Directory inside a jar ("" for the root) -> jars containing it, in class path order
+    private final Map<String, Entry[]> packageIndex = new HashMap<>();
+    // Directories and unreadable jars, probed on every lookup
+    private Entry[] unindexed = NO_ENTRIES;
+    private Map<String, CachedJar> cachedJars;
+    private boolean cacheDirty;
+    private int entryCount;
+    // Non-file URLs are left to URLClassLoader
+    private volatile boolean hasForeignURLs;
+
     public PojavClassLoader(ClassLoader parent) {
         super(new URL[0], parent);
     }
@@ -18,13 +69,27 @@ public class PojavClassLoader extends URLClassLoader {
     @Override
     public void addURL(URL url) {
         super.addURL(url);
-        try {
-            System.setProperty("java.class.path", System.getProperty("java.class.path") + ":" + new File(url.toURI()).getAbsolutePath());
-        } catch (URISyntaxException e) {
-            e.printStackTrace();
+        File file = addEntry(url);
+        if (file != null) {
+            System.setProperty("java.class.path", System.getProperty("java.class.path") + File.pathSeparator + file.getAbsolutePath());
         }
     }
 
+    /**
+     * Adds every URL, then updates java.class.path once
+     */
+    public void addURLs(List<URL> urls) {
+        StringBuilder classPath = new StringBuilder(System.getProperty("java.class.path"));
+        for (URL url : urls) {
+            super.addURL(url);
+            File file = addEntry(url);
+            if (file != null) {
+                classPath.append(File.pathSeparatorChar).append(file.getAbsolutePath());
+            }
+        }
+        System.setProperty("java.class.path", classPath.toString());
+    }
+
     static URL getFileURL(File file) {
         try {
             file = file.getCanonicalFile();
@@ -48,6 +113,459 @@ public class PojavClassLoader extends URLClassLoader {
         assert(Thread.holdsLock(this));
 
         // addURL is a no-op if path already contains the URL
-        super.addURL(getFileURL(new File(path)));
+        URL url = getFileURL(new File(path));
+        super.addURL(url);
+        addEntry(url);
+    }
+
+    private File addEntry(URL url) {
+        if (!"file".equals(url.getProtocol())) {
+            hasForeignURLs = true;
+            return null;
+        }
+        File file;
+        try {
+            file = new File(url.toURI());
+        } catch (URISyntaxException | IllegalArgumentException e) {
+            hasForeignURLs = true;
+            return null;
+        }
+        synchronized (indexLock) {
+            if (knownPaths.add(file.getAbsolutePath())) {
+                pending.add(new Entry(entryCount++, url, file));
+            }
+        }
+        return file;
+    }
+
+    /**
+     * Indexes everything added so far and persists new jar indexes
+     */
+    public void saveIndex() {
+        synchronized (indexLock) {
+            indexPending();
+            if (!cacheDirty) {
+                return;
+            }
+            File indexFile = getIndexFile();
+            if (indexFile == null) {
+                return;
+            }
+            indexFile.getParentFile().mkdirs();
+            File tmpFile = new File(indexFile.getPath() + ".tmp");
+            try (DataOutputStream out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(tmpFile)))) {
+                List<CachedJar> jars = new ArrayList<>(cachedJars.values());
+                // Most recently used first, so trimming drops stale ones
+                Collections.sort(jars, (a, b) -> Long.compare(b.lastUsed, a.lastUsed));
+                int count = Math.min(jars.size(), INDEX_MAX_JARS);
+                out.writeInt(INDEX_MAGIC);
+                out.writeInt(INDEX_VERSION);
+                out.writeInt(count);
+                for (int i = 0; i < count; i++) {
+                    jars.get(i).write(out);
+                }
+            } catch (IOException e) {
+                System.err.println("Unable to save class path index: " + e);
+                tmpFile.delete();
+                return;
+            }
+            if (!tmpFile.renameTo(indexFile)) {
+                tmpFile.delete();
+            }
+            cacheDirty = false;
+        }
+    }
+
+    private static File getIndexFile() {
+        String home = System.getenv("POJAV_HOME");
+        return home == null ? null : new File(home, "cache/classpath_index.bin");
+    }
+
+    // Called with indexLock held
+    private void loadCache() {
+        cachedJars = new HashMap<>();
+        File indexFile = getIndexFile();
+        if (indexFile == null || !indexFile.isFile()) {
+            return;
+        }
+        try (DataInputStream in = new DataInputStream(new BufferedInputStream(new FileInputStream(indexFile)))) {
+            if (in.readInt() != INDEX_MAGIC || in.readInt() != INDEX_VERSION) {
+                return;
+            }
+            for (int count = in.readInt(); count > 0; count--) {
+                CachedJar jar = CachedJar.read(in);
+                cachedJars.put(jar.path, jar);
+            }
+        } catch (IOException e) {
+            System.err.println("Ignoring unreadable class path index: " + e);
+        }
+    }
+
+    // Called with indexLock held
+    private void indexPending() {
+        if (pending.isEmpty()) {
+            return;
+        }
+        if (cachedJars == null) {
+            loadCache();
+        }
+        List<Entry> newUnindexed = new ArrayList<>(Arrays.asList(unindexed));
+        for (Entry entry : pending) {
+            String[] dirs = entry.file.isFile() ? indexJar(entry.file) : null;
+            if (dirs == null) {
+                newUnindexed.add(entry);
+                continue;
+            }
+            for (String dir : dirs) {
+                Entry[] jars = packageIndex.get(dir);
+                if (jars == null) {
+                    jars = new Entry[]{entry};
+                } else {
+                    jars = Arrays.copyOf(jars, jars.length + 1);
+                    jars[jars.length - 1] = entry;
+                }
+                packageIndex.put(dir, jars);
+            }
+        }
+        pending.clear();
+        unindexed = newUnindexed.toArray(NO_ENTRIES);
+    }
+
+    // Called with indexLock held, returns null if the file can't be read as a zip
+    private String[] indexJar(File file) {
+        String path = file.getAbsolutePath();
+        long length = file.length();
+        long lastModified = file.lastModified();
+        CachedJar cached = cachedJars.get(path);
+        if (cached != null && cached.length == length && cached.lastModified == lastModified) {
+            long now = System.currentTimeMillis();
+            if (now - cached.lastUsed > INDEX_TOUCH_INTERVAL) {
+                cached.lastUsed = now;
+                cacheDirty = true;
+            }
+            return cached.dirs;
+        }
+
+        Set<String> dirs = new HashSet<>();
+        dirs.add("");
+        try (ZipFile zip = new ZipFile(file)) {
+            Enumeration<? extends ZipEntry> zipEntries = zip.entries();
+            while (zipEntries.hasMoreElements()) {
+                String name = zipEntries.nextElement().getName();
+                addParentDirs(dirs, name);
+                // Multi-release jars also provide the class under its unversioned name
+                if (name.startsWith("META-INF/versions/")) {
+                    int slash = name.indexOf('/', "META-INF/versions/".length());
+                    if (slash != -1) {
+                        addParentDirs(dirs, name.substring(slash + 1));
+                    }
+                }
+            }
+        } catch (IOException e) {
+            return null;
+        }
+        cached = new CachedJar(path, length, lastModified, dirs.toArray(new String[0]));
+        cached.lastUsed = System.currentTimeMillis();
+        cachedJars.put(path, cached);
+        cacheDirty = true;
+        return cached.dirs;
+    }
+
+    // "a/b/c.class" adds "a/b" and "a", directory lookups like "a/b/" need the ancestors too
+    private static void addParentDirs(Set<String> dirs, String name) {
+        int end = name.endsWith("/") ? name.length() - 1 : name.length();
+        int slash = name.lastIndexOf('/', end - 1);
+        while (slash > 0 && dirs.add(name.substring(0, slash))) {
+            slash = name.lastIndexOf('/', slash - 1);
+        }
+    }
+
+    private static String parentDir(String path) {
+        int end = path.endsWith("/") ? path.length() - 1 : path.length();
+        int slash = path.lastIndexOf('/', end - 1);
+        return slash > 0 ? path.substring(0, slash) : "";
+    }
+
+    /**
+     * Class path entries that may contain path, in class path order
+     */
+    private Entry[] candidatesFor(String path) {
+        Entry[] jars, dirs;
+        synchronized (indexLock) {
+            indexPending();
+            jars = packageIndex.get(parentDir(path));
+            dirs = unindexed;
+        }
+        if (jars == null) {
+            return dirs;
+        } else if (dirs.length == 0) {
+            return jars;
+        }
+        Entry[] merged = new Entry[jars.length + dirs.length];
+        int i = 0, j = 0, k = 0;
+        while (i < jars.length || j < dirs.length) {
+            if (j == dirs.length || (i < jars.length && jars[i].order < dirs[j].order)) {
+                merged[k++] = jars[i++];
+            } else {
+                merged[k++] = dirs[j++];
+            }
+        }
+        return merged;
+    }
+
+    @Override
+    protected Class<?> findClass(String name) throws ClassNotFoundException {
+        String path = name.replace('.', '/').concat(".class");
+        for (Entry entry : candidatesFor(path)) {
+            try {
+                Class<?> clazz = entry.defineClass(this, name, path);
+                if (clazz != null) {
+                    return clazz;
+                }
+            } catch (IOException e) {
+                throw new ClassNotFoundException(name, e);
+            }
+        }
+        if (hasForeignURLs) {
+            return super.findClass(name);
+        }
+        throw new ClassNotFoundException(name);
+    }
+
+    @Override
+    public URL findResource(String name) {
+        for (Entry entry : candidatesFor(name)) {
+            URL url = entry.findResource(name);
+            if (url != null) {
+                return url;
+            }
+        }
+        return hasForeignURLs ? super.findResource(name) : null;
+    }
+
+    @Override
+    public Enumeration<URL> findResources(String name) throws IOException {
+        List<URL> urls = new ArrayList<>();
+        for (Entry entry : candidatesFor(name)) {
+            URL url = entry.findResource(name);
+            if (url != null) {
+                urls.add(url);
+            }
+        }
+        if (hasForeignURLs) {
+            // Also returns file: URLs found above, skip those
+            Enumeration<URL> foreign = super.findResources(name);
+            while (foreign.hasMoreElements()) {
+                URL url = foreign.nextElement();
+                if (!"file".equals(url.getProtocol()) && !"jar".equals(url.getProtocol())) {
+                    urls.add(url);
+                }
+            }
+        }
+        return Collections.enumeration(urls);
+    }
+
+    @Override
+    public void close() throws IOException {
+        synchronized (indexLock) {
+            for (Entry[] jars : packageIndex.values()) {
+                for (Entry entry : jars) {
+                    entry.close();
+                }
+            }
+        }
+        super.close();
+    }
+
+    // Used by defineClass, which is protected in SecureClassLoader
+    private Class<?> define(String name, byte[] bytes, CodeSource codeSource) {
+        return defineClass(name, bytes, 0, bytes.length, codeSource);
+    }
+
+    private void definePackageFor(String className, Entry entry) throws IOException {
+        int dot = className.lastIndexOf('.');
+        if (dot == -1) {
+            return;
+        }
+        String packageName = className.substring(0, dot);
+        if (getPackage(packageName) != null) {
+            return;
+        }
+        try {
+            Manifest manifest = entry.getManifest();
+            if (manifest != null) {
+                definePackage(packageName, manifest, entry.url);
+            } else {
+                definePackage(packageName, null, null, null, null, null, null, null);
+            }
+        } catch (IllegalArgumentException e) {
+            // Defined concurrently
+        }
+    }
+
+    private static class Entry {
+        final int order;
+        final URL url;
+        final File file;
+        final CodeSource codeSource;
+        private JarFile jar;
+        private URL jarBase;
+        private Manifest manifest;
+        private boolean manifestLoaded;
+
+        Entry(int order, URL url, File file) {
+            this.order = order;
+            this.url = url;
+            this.file = file;
+            this.codeSource = new CodeSource(url, (CodeSigner[]) null);
+        }
+
+        synchronized JarFile getJar() throws IOException {
+            if (jar == null) {
+                if (VERSIONED_JAR_FILE != null) {
+                    try {
+                        jar = VERSIONED_JAR_FILE.newInstance(file, true, ZipFile.OPEN_READ, RUNTIME_VERSION);
+                    } catch (ReflectiveOperationException e) {
+                        jar = new JarFile(file);
+                    }
+                } else {
+                    jar = new JarFile(file);
+                }
+                jarBase = new URL("jar:" + url + "!/");
+            }
+            return jar;
+        }
+
+        synchronized Manifest getManifest() throws IOException {
+            if (!manifestLoaded) {
+                manifestLoaded = true;
+                manifest = file.isFile() ? getJar().getManifest() : null;
+            }
+            return manifest;
+        }
+
+        Class<?> defineClass(PojavClassLoader loader, String name, String path) throws IOException {
+            byte[] bytes;
+            CodeSigner[] signers = null;
+            if (file.isDirectory()) {
+                File classFile = new File(file, path);
+                if (!classFile.isFile()) {
+                    return null;
+                }
+                bytes = readFully(new FileInputStream(classFile), classFile.length());
+            } else {
+                JarFile jar = getJar();
+                JarEntry jarEntry = jar.getJarEntry(path);
+                if (jarEntry == null) {
+                    return null;
+                }
+                bytes = readFully(jar.getInputStream(jarEntry), jarEntry.getSize());
+                // Only available once the entry was read
+                signers = jarEntry.getCodeSigners();
+            }
+            loader.definePackageFor(name, this);
+            return loader.define(name, bytes, signers == null ? codeSource : new CodeSource(url, signers));
+        }
+
+        URL findResource(String name) {
+            try {
+                if (file.isDirectory()) {
+                    File resource = new File(file, name);
+                    return resource.exists() ? resource.toURI().toURL() : null;
+                }
+                JarFile jar = getJar();
+                return jar.getJarEntry(name) != null ? new URL(jarBase, encodePath(name)) : null;
+            } catch (IOException e) {
+                return null;
+            }
+        }
+
+        synchronized void close() {
+            if (jar != null) {
+                try {
+                    jar.close();
+                } catch (IOException e) {}
+                jar = null;
+            }
+        }
+    }
+
+    private static class CachedJar {
+        final String path;
+        final long length;
+        final long lastModified;
+        final String[] dirs;
+        long lastUsed;
+
+        CachedJar(String path, long length, long lastModified, String[] dirs) {
+            this.path = path;
+            this.length = length;
+            this.lastModified = lastModified;
+            this.dirs = dirs;
+        }
+
+        static CachedJar read(DataInputStream in) throws IOException {
+            String path = in.readUTF();
+            long length = in.readLong();
+            long lastModified = in.readLong();
+            long lastUsed = in.readLong();
+            String[] dirs = new String[in.readInt()];
+            for (int i = 0; i < dirs.length; i++) {
+                dirs[i] = in.readUTF();
+            }
+            CachedJar jar = new CachedJar(path, length, lastModified, dirs);
+            jar.lastUsed = lastUsed;
+            return jar;
+        }
+
+        void write(DataOutputStream out) throws IOException {
+            out.writeUTF(path);
+            out.writeLong(length);
+            out.writeLong(lastModified);
+            out.writeLong(lastUsed);
+            out.writeInt(dirs.length);
+            for (String dir : dirs) {
+                out.writeUTF(dir);
+            }
+        }
+    }
+
+    private static byte[] readFully(InputStream in, long size) throws IOException {
+        try {
+            ByteArrayOutputStream out = new ByteArrayOutputStream(size > 0 ? (int) size : 8192);
+            byte[] buffer = new byte[8192];
+            int read;
+            while ((read = in.read(buffer)) != -1) {
+                out.write(buffer, 0, read);
+            }
+            return out.toByteArray();
+        } finally {
+            in.close();
+        }
+    }
+
+    // Same escaping URLClassLoader applies to resource names in jar: URLs
+    private static String encodePath(String path) {
+        StringBuilder encoded = null;
+        for (int i = 0; i < path.length(); ) {
+            int c = path.codePointAt(i);
+            int next = i + Character.charCount(c);
+            boolean safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                || (c < 0x80 && "/-_.!~*'()$&+,;=:@".indexOf(c) != -1);
+            if (safe) {
+                if (encoded != null) encoded.append((char) c);
+                i = next;
+                continue;
+            }
+            if (encoded == null) {
+                encoded = new StringBuilder(path.length() + 16).append(path, 0, i);
+            }
+            for (byte b : path.substring(i, next).getBytes(StandardCharsets.UTF_8)) {
+                encoded.append('%').append(Character.toUpperCase(Character.forDigit((b >> 4) & 0xF, 16)))
+                    .append(Character.toUpperCase(Character.forDigit(b & 0xF, 16)));
+            }
+            i = next;
+        }
+        return encoded == null ? path : encoded.toString();
     }
-}
\ No newline at end of file
+}
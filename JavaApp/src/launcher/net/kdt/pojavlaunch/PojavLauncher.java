@@ -17,6 +17,7 @@ public class PojavLauncher {
     private static float currProgress, maxProgress;
 
     public static void main(String[] args) throws Throwable {
+        UIKit.timelineEnd("JVM startup");
         // Skip calling to com.apple.eawt.Application.nativeInitializeApplicationDelegate()
         Beans.setDesignTime(true);
         try {
@@ -87,7 +88,10 @@ public class PojavLauncher {
         System.setProperty("org.lwjgl.vulkan.libname", "libMoltenVK.dylib");
 
         MinecraftAccount account = MinecraftAccount.load(args[0]);
-        JMinecraftVersionList.Version version = Tools.getVersionInfo(args[1]);
+        UIKit.timelineBegin("Launch plan");
+        LaunchPlan plan = LaunchPlan.resolve(args[1]);
+        UIKit.timelineEnd("Launch plan");
+        JMinecraftVersionList.Version version = plan.jvm.version;
         System.out.println("Launching Minecraft " + version.id);
         String configPath;
         if (version.logging != null) {
@@ -101,6 +105,6 @@ public class PojavLauncher {
             System.setProperty("log4j.configurationFile", configPath);
         }
 
-        Tools.launchMinecraft(account, version);
+        Tools.launchMinecraft(account, version, plan.jvm.classpath);
     }
 }
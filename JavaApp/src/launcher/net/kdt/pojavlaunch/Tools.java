@@ -6,6 +6,7 @@ import com.google.gson.GsonBuilder;
 import java.io.BufferedInputStream;
 import java.io.BufferedOutputStream;
 import java.io.BufferedWriter;
+import java.io.ByteArrayOutputStream;
 import java.io.File;
 import java.io.FileFilter;
 import java.io.FileInputStream;
@@ -53,26 +54,39 @@ public final class Tools {
     public static final String OBSOLETE_RESOURCES_PATH=DIR_GAME_NEW + "/resources";
 
     public static void launchMinecraft(MinecraftAccount profile, final JMinecraftVersionList.Version versionInfo) throws Throwable {
+        launchMinecraft(profile, versionInfo, generateLaunchClassPathList(versionInfo));
+    }
+
+    public static void launchMinecraft(MinecraftAccount profile, final JMinecraftVersionList.Version versionInfo, String[] launchClassPath) throws Throwable {
         String[] launchArgs = getMinecraftArgs(profile, versionInfo);
         // System.out.println("Minecraft Args: " + Arrays.toString(launchArgs));
 
-        final String launchClassPath = generateLaunchClassPath(versionInfo);
-
         System.out.println("Args init finished. Now starting game");
 
+        UIKit.timelineBegin("Class path setup");
         PojavClassLoader loader = (PojavClassLoader) ClassLoader.getSystemClassLoader();
         // add launcher.jar itself
         for (String s : System.getProperty("java.class.path").split(":")) {
             loader.appendToClassPathForInstrumentation(s);
         }
-        for (String s : launchClassPath.split(":")) {
-            if (!s.isEmpty()) {
-                loader.addURL(new File(s).toURI().toURL());
+        List<URL> urls = new ArrayList<>(launchClassPath.length);
+        for (String s : launchClassPath) {
+            File file = new File(s);
+            if (!file.exists()) {
+                System.out.println("Ignored non-exists file: " + s);
+                continue;
             }
+            urls.add(file.toURI().toURL());
         }
-            
+        loader.addURLs(urls);
+        loader.saveIndex();
+        UIKit.timelineEnd("Class path setup");
+
+        UIKit.timelineBegin("Main class loading");
         Class<?> clazz = loader.loadClass(versionInfo.mainClass);
         Method method = clazz.getMethod("main", String[].class);
+        UIKit.timelineEnd("Main class loading");
+        UIKit.timelineMark("Minecraft main");
         method.invoke(null, new Object[]{launchArgs});
     }
 
@@ -225,6 +239,13 @@ public final class Tools {
 
         return libStr.toString();
     }
+
+    // Same entries as generateLaunchClassPath, without checking that they exist
+    public static String[] generateLaunchClassPathList(JMinecraftVersionList.Version info) {
+        List<String> classpath = new ArrayList<>(Arrays.asList(generateLibClasspath(info)));
+        classpath.add(DIR_HOME_VERSION + "/" + info.id + "/" + info.id + ".jar");
+        return classpath.toArray(new String[0]);
+    }
     
     public static void moveInside(String from, String to) {
         File fromFile = new File(from);
@@ -456,17 +477,16 @@ createLibraryInfo(libItem);
     }
 
     public static String read(InputStream is) throws IOException {
-        String out = "";
-        int len;
-        byte[] buf = new byte[512];
-        while((len = is.read(buf))!=-1) {
-            out += new String(buf,0,len);
-        }
-        return out;
+        // Decode once at the end, version jsons are read on every launch
+        ByteArrayOutputStream out = new ByteArrayOutputStream();
+        copy(is, out);
+        return out.toString();
     }
 
     public static String read(String path) throws IOException {
-        return read(new FileInputStream(path));
+        try (FileInputStream is = new FileInputStream(path)) {
+            return read(is);
+        }
     }
 
     public static void write(String path, byte[] content) throws IOException
@@ -0,0 +1,47 @@
+package net.kdt.pojavlaunch.uikit;
+
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+
+/**
+ * Drains the native AWT input queue filled by JavaGUIViewController. Input is taken
+ * in batches by one daemon thread, so the UI threads never call into the JVM and a
+ * burst of touches costs a single JNI transition.
+ */
+public class AWTInputQueue {
+    // type, i1, i2, i3, i4 per event
+    private static final int EVENT_INTS = 5;
+    private static final int BATCH_SIZE = 64;
+
+    public static void start() throws ReflectiveOperationException {
+        Class<?> inputClass;
+        try {
+            inputClass = Class.forName("com.github.caciocavallosilano.cacio.ctc.CTCAndroidInput");
+        } catch (ClassNotFoundException e) {
+            inputClass = Class.forName("net.java.openjdk.cacio.ctc.CTCAndroidInput");
+        }
+        final MethodHandle receiveData = MethodHandles.publicLookup().findStatic(inputClass, "receiveData",
+            MethodType.methodType(void.class, int.class, int.class, int.class, int.class, int.class));
+
+        Thread thread = new Thread(() -> {
+            int[] batch = new int[BATCH_SIZE * EVENT_INTS];
+            while (true) {
+                int count = nativeWaitForEvents(batch);
+                for (int i = 0; i < count * EVENT_INTS; i += EVENT_INTS) {
+                    try {
+                        receiveData.invokeExact(batch[i], batch[i + 1], batch[i + 2], batch[i + 3], batch[i + 4]);
+                    } catch (Throwable th) {
+                        th.printStackTrace();
+                    }
+                }
+            }
+        }, "AWT input queue");
+        thread.setDaemon(true);
+        thread.start();
+    }
+
+    // Blocks until there is input, returns the number of events written to batch.
+    // Resolved from the library UIKit loads
+    private static native int nativeWaitForEvents(int[] batch);
+}
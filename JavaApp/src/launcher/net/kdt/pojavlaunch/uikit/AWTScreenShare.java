@@ -0,0 +1,144 @@
+package net.kdt.pojavlaunch.uikit;
+
+import java.awt.AWTEvent;
+import java.awt.EventQueue;
+import java.awt.Toolkit;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.lang.reflect.Field;
+import java.lang.reflect.Method;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+
+/**
+ * Shares the Caciocavallo screen with JavaGUIViewController through a direct buffer.
+ * The screen is only compared against the shared copy after the event queue was busy
+ * (all AWT and Swing painting happens while dispatching events) and, for anything
+ * drawing from other threads, every IDLE_SCAN_MS. Changed pixels are copied over
+ * and their bounding box is added to the dirty rectangle in the header, which the
+ * native side resets once it has taken them. Both sides hold the monitor of this
+ * class while touching the buffer.
+ */
+public class AWTScreenShare {
+    // Header layout, in ints: width, height, dirty rectangle as x0, y0, x1, y1 (exclusive)
+    public static final int HEADER_BYTES = 64;
+    private static final int FRAME_MS = 16;
+    private static final int IDLE_SCAN_MS = 500;
+
+    private static ByteBuffer buffer;
+    private static IntBuffer header, pixels;
+    private static volatile boolean eventsDispatched = true;
+
+    // Called by the native side on every display link tick until the screen exists
+    public static synchronized ByteBuffer getBuffer() {
+        return buffer;
+    }
+
+    public static void start() {
+        Toolkit.getDefaultToolkit().getSystemEventQueue().push(new EventQueue() {
+            @Override
+            protected void dispatchEvent(AWTEvent event) {
+                try {
+                    super.dispatchEvent(event);
+                } finally {
+                    eventsDispatched = true;
+                }
+            }
+        });
+        Thread thread = new Thread(AWTScreenShare::run, "AWT screen share");
+        thread.setDaemon(true);
+        thread.start();
+    }
+
+    private static void run() {
+        try {
+            Class<?> screenClass;
+            try {
+                screenClass = Class.forName("com.github.caciocavallosilano.cacio.ctc.CTCScreen");
+            } catch (ClassNotFoundException e) {
+                screenClass = Class.forName("net.java.openjdk.cacio.ctc.CTCScreen");
+            }
+            Field instanceField = screenClass.getDeclaredField("instance");
+            Field bufferField = screenClass.getDeclaredField("screenBuffer");
+            Method getRGB = screenClass.getMethod("getCurrentScreenRGB");
+            instanceField.setAccessible(true);
+            bufferField.setAccessible(true);
+            getRGB.setAccessible(true);
+
+            Object screen;
+            while ((screen = instanceField.get(null)) == null) {
+                Thread.sleep(FRAME_MS);
+            }
+            BufferedImage image = (BufferedImage) bufferField.get(screen);
+            int width = image.getWidth(), height = image.getHeight();
+            // Read the screen in place where possible, getRGB() converts every pixel into a new array
+            int[] data = null;
+            if (image.getRaster().getDataBuffer() instanceof DataBufferInt && image.getRaster().getNumDataElements() == 1) {
+                data = ((DataBufferInt) image.getRaster().getDataBuffer()).getData();
+            } else {
+                System.out.println("AWTScreenShare: screen is not int packed, falling back to getCurrentScreenRGB()");
+            }
+
+            ByteBuffer shared = ByteBuffer.allocateDirect(HEADER_BYTES + width * height * 4).order(ByteOrder.nativeOrder());
+            synchronized (AWTScreenShare.class) {
+                header = shared.asIntBuffer();
+                shared.position(HEADER_BYTES);
+                pixels = shared.slice().order(ByteOrder.nativeOrder()).asIntBuffer();
+                header.put(0, width).put(1, height);
+                buffer = shared;
+            }
+
+            long lastScan = 0;
+            while (true) {
+                Thread.sleep(FRAME_MS);
+                long now = System.currentTimeMillis();
+                if (!eventsDispatched && now - lastScan < IDLE_SCAN_MS) {
+                    continue;
+                }
+                eventsDispatched = false;
+                lastScan = now;
+                share(data != null ? data : (int[]) getRGB.invoke(null), width, height);
+            }
+        } catch (Throwable th) {
+            System.out.println("AWTScreenShare: failed to share the screen");
+            th.printStackTrace();
+        }
+    }
+
+    // Only this thread writes pixels, so they can be compared without the lock
+    private static void share(int[] frame, int width, int height) {
+        int x0 = width, y0 = height, x1 = 0, y1 = 0;
+        for (int y = 0; y < height; y++) {
+            int row = y * width;
+            int left = 0;
+            while (left < width && frame[row + left] == pixels.get(row + left)) {
+                left++;
+            }
+            if (left == width) continue;
+            int right = width - 1;
+            while (frame[row + right] == pixels.get(row + right)) {
+                right--;
+            }
+            x0 = Math.min(x0, left);
+            x1 = Math.max(x1, right + 1);
+            if (y0 == height) y0 = y;
+            y1 = y + 1;
+        }
+        if (x0 >= x1) return;
+
+        synchronized (AWTScreenShare.class) {
+            for (int y = y0; y < y1; y++) {
+                pixels.position(y * width + x0);
+                pixels.put(frame, y * width + x0, x1 - x0);
+            }
+            if (header.get(2) < header.get(4)) {
+                x0 = Math.min(x0, header.get(2));
+                y0 = Math.min(y0, header.get(3));
+                x1 = Math.max(x1, header.get(4));
+                y1 = Math.max(y1, header.get(5));
+            }
+            header.put(2, x0).put(3, y0).put(4, x1).put(5, y1);
+        }
+    }
+}
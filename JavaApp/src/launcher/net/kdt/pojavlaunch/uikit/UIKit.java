@@ -43,6 +43,9 @@ public class UIKit {
         // LabyMod Installer uses FlatLAF which has some macOS-specific codes, so we make it think it's running on Linux.
         patch_FlatLAF_setLinux();
 
+        AWTScreenShare.start();
+        AWTInputQueue.start();
+
         Class<?> clazz = ClassLoader.getSystemClassLoader().loadClass(mainClass);
         Method method = clazz.getMethod("main", String[].class);
         method.invoke(null, new Object[]{args});
@@ -67,6 +70,21 @@ public class UIKit {
 
     // public static native void runOnUIThread(UIKitCallback callback);
 
+    // Startup timeline shared with the native side, written out after the first frame
+    public static void timelineBegin(String name) {
+        timelineEvent('B', name);
+    }
+
+    public static void timelineEnd(String name) {
+        timelineEvent('E', name);
+    }
+
+    public static void timelineMark(String name) {
+        timelineEvent('i', name);
+    }
+
+    private static native void timelineEvent(char phase, String name);
+
     public static native void showError(String title, String message, boolean exitIfOk);
 
     private static native void updateMCGuiScale(int scale);
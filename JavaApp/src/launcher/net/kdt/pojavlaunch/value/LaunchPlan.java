@@ -0,0 +1,133 @@
+package net.kdt.pojavlaunch.value;
+
+import com.google.gson.Gson;
+import com.google.gson.JsonElement;
+import com.google.gson.annotations.SerializedName;
+import java.io.File;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import net.kdt.pojavlaunch.JMinecraftVersionList;
+import net.kdt.pojavlaunch.Tools;
+
+/**
+ * Resolved launch data in versions/<id>/launch_plan.json, shared with the native launcher.
+ * It is keyed by the SHA-1 of every version json it was derived from and by the game
+ * directory its paths were resolved against; the native side owns
+ * the "native" section and this class owns the "jvm" section.
+ */
+public class LaunchPlan {
+    // Must match LAUNCH_PLAN_FORMAT_VERSION in PLLaunchPlan.m
+    public static final int FORMAT_VERSION = 2;
+
+    public int formatVersion;
+    // Game directory the classpath and native paths are absolute in
+    public String root;
+    public Map<String, String> inputs;
+    @SerializedName("native")
+    public JsonElement nativeMetadata;
+    public JvmPlan jvm;
+
+    public static class JvmPlan {
+        public JMinecraftVersionList.Version version;
+        // Unfiltered, missing jars are skipped at launch time
+        public String[] classpath;
+    }
+
+    public static LaunchPlan resolve(String versionName) throws IOException {
+        LaunchPlan plan = load(versionName);
+        if (plan != null && plan.jvm != null && plan.jvm.version != null && plan.jvm.classpath != null
+                && plan.jvm.classpath.length > 0 && new File(plan.jvm.classpath[0]).exists()) {
+            System.out.println("Using cached launch plan for " + versionName);
+            return plan;
+        }
+
+        JvmPlan jvm = new JvmPlan();
+        jvm.version = Tools.getVersionInfo(versionName);
+        jvm.classpath = Tools.generateLaunchClassPathList(jvm.version);
+
+        List<String> inputIds = new ArrayList<>();
+        inputIds.add(versionName);
+        if (jvm.version.inheritsFrom != null && !jvm.version.inheritsFrom.equals(versionName)) {
+            inputIds.add(jvm.version.inheritsFrom);
+        }
+        Map<String, String> inputs = new TreeMap<>();
+        for (String inputId : inputIds) {
+            inputs.put(inputId, hashOfVersionJson(inputId));
+        }
+        if (plan == null || !inputs.equals(plan.inputs)) {
+            // The native section was derived from other inputs
+            plan = new LaunchPlan();
+            plan.formatVersion = FORMAT_VERSION;
+            plan.root = Tools.DIR_GAME_NEW;
+            plan.inputs = inputs;
+        }
+        plan.jvm = jvm;
+        try {
+            plan.save(versionName);
+        } catch (IOException e) {
+            System.err.println("Unable to save launch plan: " + e);
+        }
+        return plan;
+    }
+
+    public static LaunchPlan load(String versionName) {
+        File file = getPlanFile(versionName);
+        if (!file.exists()) {
+            return null;
+        }
+        try {
+            LaunchPlan plan = Tools.GLOBAL_GSON.fromJson(Tools.read(file.getAbsolutePath()), LaunchPlan.class);
+            if (plan == null || plan.formatVersion != FORMAT_VERSION || plan.inputs == null || plan.inputs.isEmpty()) {
+                return null;
+            }
+            // Paths were resolved in another container, e.g. before a reinstall
+            if (!Tools.DIR_GAME_NEW.equals(plan.root)) {
+                return null;
+            }
+            for (Map.Entry<String, String> input : plan.inputs.entrySet()) {
+                if (!input.getValue().equals(hashOfVersionJson(input.getKey()))) {
+                    return null;
+                }
+            }
+            return plan;
+        } catch (Exception e) {
+            System.err.println("Ignoring unreadable launch plan: " + e);
+            return null;
+        }
+    }
+
+    public void save(String versionName) throws IOException {
+        File file = getPlanFile(versionName);
+        File tmpFile = new File(file.getPath() + ".tmp");
+        // Compact output, this file is read on every launch
+        Tools.write(tmpFile.getAbsolutePath(), new Gson().toJson(this));
+        if (!tmpFile.renameTo(file)) {
+            tmpFile.delete();
+            throw new IOException("Unable to replace " + file);
+        }
+    }
+
+    private static File getPlanFile(String versionName) {
+        return new File(Tools.DIR_HOME_VERSION + "/" + versionName + "/launch_plan.json");
+    }
+
+    private static String hashOfVersionJson(String versionName) throws IOException {
+        byte[] content = Files.readAllBytes(new File(Tools.DIR_HOME_VERSION + "/" + versionName + "/" + versionName + ".json").toPath());
+        try {
+            byte[] digest = MessageDigest.getInstance("SHA-1").digest(content);
+            StringBuilder hash = new StringBuilder(digest.length * 2);
+            for (byte b : digest) {
+                hash.append(String.format("%02x", b & 0xFF));
+            }
+            return hash.toString();
+        } catch (NoSuchAlgorithmException e) {
+            throw new IOException(e);
+        }
+    }
+}
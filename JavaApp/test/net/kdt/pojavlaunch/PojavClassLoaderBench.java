@@ -0,0 +1,75 @@
+package net.kdt.pojavlaunch;
+
+import java.io.*;
+import java.net.URL;
+import java.net.URLClassLoader;
+import java.util.*;
+import java.util.jar.*;
+
+/**
+ * Resource lookups over a modpack-sized class path, PojavClassLoader against
+ * a plain URLClassLoader. Run through "make bench".
+ */
+public class PojavClassLoaderBench {
+    private static final int JARS = 300;
+    private static final int PACKAGES_PER_JAR = 10;
+    private static final int FILES_PER_PACKAGE = 10;
+    private static final int LOOKUPS = 20000;
+
+    private static long time(URLClassLoader loader, String[] names) {
+        long start = System.nanoTime();
+        int found = 0;
+        for (int i = 0; i < LOOKUPS; i++) {
+            if (loader.findResource(names[i % names.length]) != null) {
+                found++;
+            }
+        }
+        if (found != LOOKUPS / 2) {
+            throw new IllegalStateException("found " + found);
+        }
+        return System.nanoTime() - start;
+    }
+
+    public static void main(String[] args) throws Exception {
+        File dir = new File(System.getenv("POJAV_HOME"), "bench");
+        dir.mkdirs();
+        List<URL> urls = new ArrayList<>();
+        byte[] content = new byte[64];
+        for (int jar = 0; jar < JARS; jar++) {
+            File file = new File(dir, "mod" + jar + ".jar");
+            try (JarOutputStream out = new JarOutputStream(new FileOutputStream(file))) {
+                for (int pkg = 0; pkg < PACKAGES_PER_JAR; pkg++) {
+                    for (int f = 0; f < FILES_PER_PACKAGE; f++) {
+                        out.putNextEntry(new JarEntry("mod" + jar + "/pkg" + pkg + "/File" + f + ".class"));
+                        out.write(content);
+                        out.closeEntry();
+                    }
+                }
+            }
+            urls.add(PojavClassLoader.getFileURL(file));
+        }
+
+        // Alternating hits spread over the class path and misses in known packages
+        Random random = new Random(1);
+        String[] names = new String[1000];
+        for (int i = 0; i < names.length; i++) {
+            String pkg = "mod" + random.nextInt(JARS) + "/pkg" + random.nextInt(PACKAGES_PER_JAR);
+            names[i] = pkg + (i % 2 == 0 ? "/File" + random.nextInt(FILES_PER_PACKAGE) : "/Missing") + ".class";
+        }
+
+        for (int run = 0; run < 3; run++) {
+            long indexStart = System.nanoTime();
+            PojavClassLoader pojav = new PojavClassLoader(null);
+            pojav.addURLs(urls);
+            pojav.saveIndex();
+            long indexTime = System.nanoTime() - indexStart;
+            URLClassLoader plain = new URLClassLoader(urls.toArray(new URL[0]), null);
+            long pojavTime = time(pojav, names);
+            long plainTime = time(plain, names);
+            System.out.printf("run %d: index %.1f ms, %d lookups: PojavClassLoader %.1f ms, URLClassLoader %.1f ms%n",
+                run, indexTime / 1e6, LOOKUPS, pojavTime / 1e6, plainTime / 1e6);
+            pojav.close();
+            plain.close();
+        }
+    }
+}
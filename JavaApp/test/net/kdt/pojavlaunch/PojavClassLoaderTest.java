@@ -0,0 +1,184 @@
+package net.kdt.pojavlaunch;
+
+import java.io.*;
+import java.net.URL;
+import java.nio.charset.StandardCharsets;
+import java.util.*;
+import java.util.jar.*;
+
+/**
+ * Host test of PojavClassLoader's package index. Run through "make test",
+ * which points POJAV_HOME at a temporary directory for the index cache.
+ */
+public class PojavClassLoaderTest {
+    private static final String GREETER = "net/kdt/pojavlaunch/testdata/Greeter.class";
+    private static int failures;
+
+    private static void check(boolean condition, String what) {
+        if (!condition) {
+            System.err.println("check failed: " + what);
+            failures++;
+        }
+    }
+
+    private static byte[] greeterBytes() throws IOException {
+        try (InputStream in = PojavClassLoaderTest.class.getClassLoader().getResourceAsStream(GREETER)) {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            byte[] buffer = new byte[8192];
+            int read;
+            while ((read = in.read(buffer)) != -1) {
+                out.write(buffer, 0, read);
+            }
+            return out.toByteArray();
+        }
+    }
+
+    // name -> contents, a null content writes a directory entry
+    private static File writeJar(File file, Manifest manifest, Map<String, byte[]> entries) throws IOException {
+        try (JarOutputStream out = manifest == null ? new JarOutputStream(new FileOutputStream(file))
+                : new JarOutputStream(new FileOutputStream(file), manifest)) {
+            for (Map.Entry<String, byte[]> entry : entries.entrySet()) {
+                out.putNextEntry(new JarEntry(entry.getKey()));
+                if (entry.getValue() != null) {
+                    out.write(entry.getValue());
+                }
+                out.closeEntry();
+            }
+        }
+        return file;
+    }
+
+    private static Map<String, byte[]> entries(Object... namesAndContents) {
+        Map<String, byte[]> entries = new LinkedHashMap<>();
+        for (int i = 0; i < namesAndContents.length; i += 2) {
+            Object content = namesAndContents[i + 1];
+            entries.put((String) namesAndContents[i], content instanceof String
+                ? ((String) content).getBytes(StandardCharsets.UTF_8) : (byte[]) content);
+        }
+        return entries;
+    }
+
+    private static String read(URL url) throws IOException {
+        try (InputStream in = url.openStream()) {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            byte[] buffer = new byte[256];
+            int read;
+            while ((read = in.read(buffer)) != -1) {
+                out.write(buffer, 0, read);
+            }
+            return new String(out.toByteArray(), StandardCharsets.UTF_8);
+        }
+    }
+
+    private static List<URL> urls(File... files) {
+        List<URL> urls = new ArrayList<>();
+        for (File file : files) {
+            urls.add(PojavClassLoader.getFileURL(file));
+        }
+        return urls;
+    }
+
+    public static void main(String[] args) throws Exception {
+        File dir = new File(System.getenv("POJAV_HOME"), "classpath");
+        dir.mkdirs();
+        byte[] greeter = greeterBytes();
+
+        Manifest manifest = new Manifest();
+        manifest.getMainAttributes().put(Attributes.Name.MANIFEST_VERSION, "1.0");
+        manifest.getMainAttributes().put(Attributes.Name.IMPLEMENTATION_TITLE, "first");
+        File first = writeJar(new File(dir, "first.jar"), manifest, entries(
+            GREETER, greeter,
+            "data/", null,
+            "data/shared.txt", "first",
+            "data/a b\u00e9.txt", "escaped"));
+        File resources = new File(dir, "resources");
+        new File(resources, "data").mkdirs();
+        try (FileOutputStream out = new FileOutputStream(new File(resources, "data/shared.txt"))) {
+            out.write("directory".getBytes(StandardCharsets.UTF_8));
+        }
+        File second = writeJar(new File(dir, "second.jar"), null, entries(
+            GREETER, greeter,
+            "data/shared.txt", "second",
+            "other/only.txt", "only"));
+
+        // The parent can't see the test classes, Greeter has to come from the jars
+        PojavClassLoader loader = new PojavClassLoader(null);
+        String classPath = System.getProperty("java.class.path");
+        loader.addURLs(urls(first, resources, second));
+        check(System.getProperty("java.class.path").equals(classPath + File.pathSeparator + first.getCanonicalPath()
+            + File.pathSeparator + resources.getCanonicalPath() + File.pathSeparator + second.getCanonicalPath()),
+            "addURLs appends every entry to java.class.path");
+
+        // Classes: the first jar in class path order wins, with its manifest and code source
+        Class<?> clazz = loader.loadClass("net.kdt.pojavlaunch.testdata.Greeter");
+        check(clazz.getClassLoader() == loader, "Greeter is defined by the loader");
+        check("greeter".equals(clazz.getConstructor().newInstance().toString()), "Greeter runs");
+        check(clazz.getProtectionDomain().getCodeSource().getLocation().equals(urls(first).get(0)), "Greeter comes from first.jar");
+        check("first".equals(clazz.getPackage().getImplementationTitle()), "the package takes first.jar's manifest");
+        try {
+            loader.loadClass("net.kdt.pojavlaunch.testdata.Missing");
+            check(false, "a missing class throws");
+        } catch (ClassNotFoundException e) {
+            // Expected
+        }
+        try {
+            loader.loadClass("nowhere.Missing");
+            check(false, "a class of an unknown package throws");
+        } catch (ClassNotFoundException e) {
+            // Expected
+        }
+
+        // Resources: indexed jars and unindexed directories merged in class path order
+        List<String> shared = new ArrayList<>();
+        for (URL url : Collections.list(loader.getResources("data/shared.txt"))) {
+            shared.add(read(url));
+        }
+        check(shared.equals(Arrays.asList("first", "directory", "second")), "getResources keeps class path order: " + shared);
+        check("first".equals(read(loader.getResource("data/shared.txt"))), "getResource takes the first");
+        check("only".equals(read(loader.getResource("other/only.txt"))), "a package of the second jar only");
+        check("escaped".equals(read(loader.getResource("data/a b\u00e9.txt"))), "resource names are escaped in jar URLs");
+        check(loader.getResource("data/") != null, "directory lookups");
+        check(loader.getResource("nowhere/file.txt") == null, "unknown packages have no resources");
+
+        // Added later, and added again
+        File late = writeJar(new File(dir, "late.jar"), null, entries("late/file.txt", "late"));
+        loader.addURL(urls(late).get(0));
+        loader.addURL(urls(late).get(0));
+        check("late".equals(read(loader.getResource("late/file.txt"))), "URLs added after lookups are indexed");
+        check(System.getProperty("java.class.path").endsWith(File.pathSeparator + late.getCanonicalPath()), "addURL updates java.class.path");
+
+        // The index cache, and jars changed since it was written
+        loader.saveIndex();
+        loader.close();
+        File indexFile = new File(System.getenv("POJAV_HOME"), "cache/classpath_index.bin");
+        check(indexFile.isFile(), "saveIndex writes " + indexFile);
+        writeJar(second, null, entries("other/only.txt", "only", "changed/new.txt", "new"));
+        second.setLastModified(second.lastModified() + 2000);
+        PojavClassLoader reloaded = new PojavClassLoader(null);
+        reloaded.addURLs(urls(first, second));
+        check(reloaded.getResource("changed/new.txt") != null, "a changed jar is indexed again");
+        check("first".equals(read(reloaded.getResource("data/shared.txt"))), "cached jars are still found");
+        reloaded.close();
+
+        // Multi-release jars are indexed under their unversioned names, and opened
+        // runtime-versioned on Java 9 and later only
+        Manifest multiRelease = new Manifest();
+        multiRelease.getMainAttributes().put(Attributes.Name.MANIFEST_VERSION, "1.0");
+        multiRelease.getMainAttributes().putValue("Multi-Release", "true");
+        File versioned = writeJar(new File(dir, "versioned.jar"), multiRelease, entries(
+            "mr/file.txt", "base",
+            "META-INF/versions/9/mr9/only.txt", "nine"));
+        PojavClassLoader mrLoader = new PojavClassLoader(null);
+        mrLoader.addURLs(urls(versioned));
+        boolean java8 = System.getProperty("java.specification.version").startsWith("1.");
+        check(mrLoader.getResource("mr/file.txt") != null, "unversioned entries of a multi-release jar");
+        check((mrLoader.getResource("mr9/only.txt") != null) != java8, "versioned-only entries follow the runtime");
+        mrLoader.close();
+
+        if (failures > 0) {
+            System.err.println(failures + " checks failed");
+            System.exit(1);
+        }
+        System.out.println("PojavClassLoaderTest passed");
+    }
+}
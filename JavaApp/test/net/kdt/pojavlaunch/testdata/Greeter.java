@@ -0,0 +1,11 @@
+package net.kdt.pojavlaunch.testdata;
+
+/**
+ * Copied into the test jars, so PojavClassLoader defines it from there
+ */
+public class Greeter {
+    @Override
+    public String toString() {
+        return "greeter";
+    }
+}
@@ -7,6 +7,7 @@
 #import "TrackedTextField.h"
 #import "UnzipKit.h"
 #import "ios_uikit_bridge.h"
+#include "awt_input_queue.h"
 #include "glfw_keycodes.h"
 #include "utils.h"
 
@@ -15,31 +16,27 @@
 static BOOL shouldHitEnterAfterWindowShown;
 static SurfaceView* surfaceView;
 
-static jclass class_CTCAndroidInput;
-static jmethodID method_ReceiveInput;
+static awt_input_queue_t *AWTInputBridge_queue() {
+    static awt_input_queue_t queue;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        awt_input_queue_init(&queue, 1024);
+    });
+    return &queue;
+}
 
 void AWTInputBridge_nativeSendData(int type, int i1, int i2, int i3, int i4) {
-    if (!runtimeJNIEnvPtr) {
-        return;
-    }
-
-    if (!method_ReceiveInput) {
-        class_CTCAndroidInput = (*runtimeJNIEnvPtr)->FindClass(runtimeJNIEnvPtr, "net/java/openjdk/cacio/ctc/CTCAndroidInput");
-        if ((*runtimeJNIEnvPtr)->ExceptionCheck(runtimeJNIEnvPtr) == JNI_TRUE) {
-            (*runtimeJNIEnvPtr)->ExceptionClear(runtimeJNIEnvPtr);
-            class_CTCAndroidInput = (*runtimeJNIEnvPtr)->FindClass(runtimeJNIEnvPtr, "com/github/caciocavallosilano/cacio/ctc/CTCAndroidInput");
-        }
-        assert(class_CTCAndroidInput != NULL);
-        method_ReceiveInput = (*runtimeJNIEnvPtr)->GetStaticMethodID(runtimeJNIEnvPtr, class_CTCAndroidInput, "receiveData", "(IIIII)V");
-        assert(method_ReceiveInput != NULL);
-    }
+    // Drained by AWTInputQueue on its own Java thread, only the latest cursor position matters
+    awt_input_event_t event = {type, i1, i2, i3, i4};
+    awt_input_queue_push(AWTInputBridge_queue(), &event, type == EVENT_TYPE_CURSOR_POS);
+}
 
-    (*runtimeJNIEnvPtr)->CallStaticVoidMethod(
-        runtimeJNIEnvPtr,
-        class_CTCAndroidInput,
-        method_ReceiveInput,
-        type, i1, i2, i3, i4
-    );
+JNIEXPORT jint JNICALL Java_net_kdt_pojavlaunch_uikit_AWTInputQueue_nativeWaitForEvents(JNIEnv *env, jclass clazz, jintArray batch) {
+    awt_input_event_t events[64];
+    size_t max = MIN(64, (*env)->GetArrayLength(env, batch) / 5);
+    size_t count = awt_input_queue_wait(AWTInputBridge_queue(), events, max);
+    (*env)->SetIntArrayRegion(env, batch, 0, (jsize)(count * 5), (jint *)events);
+    return (jint)count;
 }
 
 void AWTInputBridge_sendChar(jchar keychar) {
@@ -54,8 +51,10 @@ void AWTInputBridge_sendKey(int keycode) {
 
 @interface SurfaceView() {
     JNIEnv *surfaceJNIEnv;
-    jclass class_CTCScreen;
-    jmethodID method_GetRGB;
+    jclass class_AWTScreenShare;
+    jmethodID method_GetBuffer;
+    // Shared with AWTScreenShare, guarded by the monitor of its class
+    int *sharedHeader, *sharedPixels;
     int *rgbArray; 
 }
 @property(nonatomic) CGColorSpaceRef colorSpace;
@@ -75,35 +74,44 @@ void AWTInputBridge_sendKey(int keycode) {
             assert(runtimeJNIEnvPtr);
         });
 
-        // Obtain CTCScreen.getCurrentScreenRGB()
-        class_CTCScreen = (*surfaceJNIEnv)->FindClass(surfaceJNIEnv, "net/java/openjdk/cacio/ctc/CTCScreen");
-        if ((*surfaceJNIEnv)->ExceptionCheck(surfaceJNIEnv) == JNI_TRUE) {
-            (*surfaceJNIEnv)->ExceptionClear(surfaceJNIEnv);
-            class_CTCScreen = (*surfaceJNIEnv)->FindClass(surfaceJNIEnv, "com/github/caciocavallosilano/cacio/ctc/CTCScreen");
-        }
-        assert(class_CTCScreen != NULL);
-        method_GetRGB = (*surfaceJNIEnv)->GetStaticMethodID(surfaceJNIEnv, class_CTCScreen, "getCurrentScreenRGB", "()[I");
-        assert(method_GetRGB != NULL);
+        class_AWTScreenShare = (*surfaceJNIEnv)->FindClass(surfaceJNIEnv, "net/kdt/pojavlaunch/uikit/AWTScreenShare");
+        assert(class_AWTScreenShare != NULL);
+        method_GetBuffer = (*surfaceJNIEnv)->GetStaticMethodID(surfaceJNIEnv, class_AWTScreenShare, "getBuffer", "()Ljava/nio/ByteBuffer;");
+        assert(method_GetBuffer != NULL);
         rgbArray = calloc(4, (size_t) (windowWidth * windowHeight));
     }
 
-    jintArray jreRgbArray = (jintArray) (*surfaceJNIEnv)->CallStaticObjectMethod(
-        surfaceJNIEnv,
-        class_CTCScreen,
-        method_GetRGB
-    );
-    if (!jreRgbArray) {
+    if (!sharedHeader) {
+        // Null until the AWT screen exists
+        jobject buffer = (*surfaceJNIEnv)->CallStaticObjectMethod(surfaceJNIEnv, class_AWTScreenShare, method_GetBuffer);
+        if (!buffer) {
+            return;
+        }
+        sharedHeader = (*surfaceJNIEnv)->GetDirectBufferAddress(surfaceJNIEnv, buffer);
+        sharedPixels = sharedHeader + 64 / sizeof(int); // AWTScreenShare.HEADER_BYTES
+        (*surfaceJNIEnv)->DeleteLocalRef(surfaceJNIEnv, buffer);
+    }
+
+    // Copy only what changed since the last tick, and nothing at all while idle
+    (*surfaceJNIEnv)->MonitorEnter(surfaceJNIEnv, class_AWTScreenShare);
+    int sharedWidth = sharedHeader[0];
+    int x0 = sharedHeader[2], y0 = sharedHeader[3];
+    int x1 = MIN(sharedHeader[4], windowWidth), y1 = MIN(sharedHeader[5], windowHeight);
+    BOOL changed = x0 < x1 && y0 < y1;
+    for (int y = y0; changed && y < y1; y++) {
+        memcpy(rgbArray + y * windowWidth + x0, sharedPixels + y * sharedWidth + x0, (x1 - x0) * 4);
+    }
+    memset(sharedHeader + 2, 0, 4 * sizeof(int));
+    (*surfaceJNIEnv)->MonitorExit(surfaceJNIEnv, class_AWTScreenShare);
+    if (!changed) {
         return;
     }
-    int *tmpArray = (*surfaceJNIEnv)->GetIntArrayElements(surfaceJNIEnv, jreRgbArray, 0);
-    memcpy(rgbArray, tmpArray, windowWidth * windowHeight * 4);
-    (*surfaceJNIEnv)->ReleaseIntArrayElements(surfaceJNIEnv, jreRgbArray, tmpArray, JNI_ABORT);
     dispatch_async(dispatch_get_main_queue(), ^{
         [surfaceView displayLayer];
     });
 
-    // Wait until something renders at the middle
-    if (shouldHitEnterAfterWindowShown && rgbArray[windowWidth/2 + windowWidth*windowHeight/2] != 0) {
+    // Wait until something renders at the middle, the alpha byte may be unset
+    if (shouldHitEnterAfterWindowShown && (rgbArray[windowWidth/2 + windowWidth*windowHeight/2] & 0xFFFFFF) != 0) {
         shouldHitEnterAfterWindowShown = NO;
         dispatch_after(dispatch_time(DISPATCH_TIME_NOW, 200 * NSEC_PER_MSEC), dispatch_get_main_queue(), ^(void){
             // Auto hit Enter to install immediately
@@ -114,7 +122,7 @@ void AWTInputBridge_sendKey(int keycode) {
 
 - (void)displayLayer {
     CGDataProviderRef bitmapProvider = CGDataProviderCreateWithData(NULL, rgbArray, windowWidth * windowHeight * 4, NULL);
-    CGImageRef bitmap = CGImageCreate(windowWidth, windowHeight, 8, 32, 4 * windowWidth, _colorSpace, kCGImageAlphaFirst | kCGBitmapByteOrder32Little, bitmapProvider, NULL, FALSE, kCGRenderingIntentDefault);
+    CGImageRef bitmap = CGImageCreate(windowWidth, windowHeight, 8, 32, 4 * windowWidth, _colorSpace, kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little, bitmapProvider, NULL, FALSE, kCGRenderingIntentDefault);
 
     self.layer.contents = (__bridge id) bitmap;
     CGImageRelease(bitmap);
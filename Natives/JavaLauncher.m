@@ -8,16 +8,26 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <CommonCrypto/CommonDigest.h>
 
+#include "asset_root.h"
+#include "jvm_tuning.h"
+#include "launch_timeline.h"
 #include "utils.h"
 
 #import "ios_uikit_bridge.h"
 #import "JavaLauncher.h"
 #import "LauncherPreferences.h"
+#import "PLLaunchPlan.h"
 #import "PLProfiles.h"
 
 #define fm NSFileManager.defaultManager
 
+// Dynamic archives are a few dozen MB each, keep the most recently used ones
+#define CDS_MAX_ARCHIVES 4
+// CDS_DYNAMIC_ARCHIVE_MAGIC in HotSpot's cds/filemap.hpp
+#define CDS_DYNAMIC_ARCHIVE_MAGIC 0xf00baba8
+
 extern char **environ;
 
 void init_loadDefaultEnv() {
@@ -88,8 +98,300 @@ void init_loadCustomJvmFlags(int* argc, const char** argv) {
     }
 }
 
+void init_servePackedAssets() {
+    NSString *assetsDir = [NSString stringWithFormat:@"%s/assets", getenv("POJAV_GAME_DIR")];
+    // The game reads packed objects through the open/stat hooks, nothing is written out
+    int err = asset_root_serve(assetsDir.fileSystemRepresentation, NSTemporaryDirectory().fileSystemRepresentation);
+    if (err && err != ENOENT) {
+        NSLog(@"[JavaLauncher] Failed to serve packed assets: %s", strerror(err));
+    }
+}
+
+int init_getJavaMajorVersion(NSString *javaHome) {
+    NSString *release = [NSString stringWithContentsOfFile:[javaHome stringByAppendingPathComponent:@"release"] encoding:NSUTF8StringEncoding error:nil];
+    NSRange range = [release rangeOfString:@"JAVA_VERSION=\""];
+    if (range.location == NSNotFound) return 0;
+    NSString *version = [release substringFromIndex:NSMaxRange(range)];
+    if ([version hasPrefix:@"1."]) {
+        version = [version substringFromIndex:2];
+    }
+    return version.intValue;
+}
+
+NSString *init_sha1String(NSString *string) {
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [hash appendFormat:@"%02x", digest[i]];
+    }
+    return hash;
+}
+
+void init_pruneClassDataArchives(NSString *cdsDir) {
+    NSArray<NSURL *> *files = [fm contentsOfDirectoryAtURL:[NSURL fileURLWithPath:cdsDir]
+        includingPropertiesForKeys:@[NSURLContentModificationDateKey] options:0 error:nil];
+    files = [files filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"pathExtension == 'key'"]];
+    files = [files sortedArrayUsingComparator:^NSComparisonResult(NSURL *a, NSURL *b) {
+        NSDate *dateA, *dateB;
+        [a getResourceValue:&dateA forKey:NSURLContentModificationDateKey error:nil];
+        [b getResourceValue:&dateB forKey:NSURLContentModificationDateKey error:nil];
+        return [dateB compare:dateA];
+    }];
+    for (NSUInteger i = CDS_MAX_ARCHIVES; i < files.count; i++) {
+        [fm removeItemAtURL:files[i] error:nil];
+        [fm removeItemAtURL:[files[i].URLByDeletingPathExtension URLByAppendingPathExtension:@"jsa"] error:nil];
+    }
+}
+
+// Reuses the AppCDS archive of this runtime and version while everything that
+// went into it is unchanged, otherwise has the JVM dump a new one at exit.
+// Only classes of the application class loader are archived, so the game class
+// path of the launch plan is put on it, like the official launcher does; the
+// launcher class loader then finds them through its parent. The JVM validates
+// the archive against the classpath itself and runs without it on a mismatch,
+// the key only avoids dumping or mapping a stale one.
+// Returns the class path to launch with.
+NSString *init_setupClassDataSharing(NSString *javaHome, NSString *versionId, NSString *classpath, int* argc, const char** argv) {
+    if (!getPrefBool(@"java.class_data_sharing")) {
+        NSLog(@"[JavaLauncher] AppCDS is turned off");
+        return classpath;
+    }
+    int javaVersion = init_getJavaMajorVersion(javaHome);
+    if (javaVersion < 17) {
+        NSLog(@"[JavaLauncher] Skipping AppCDS on Java %d", javaVersion);
+        return classpath;
+    }
+    // Dynamic archives are layered on top of the runtime's default archive
+    if (![fm fileExistsAtPath:[javaHome stringByAppendingPathComponent:@"lib/server/classes.jsa"]]) {
+        NSLog(@"[JavaLauncher] Runtime has no default CDS archive, skipping AppCDS");
+        return classpath;
+    }
+    NSDictionary *inputs = [PLLaunchPlan inputsForVersion:versionId];
+    if (!inputs) {
+        NSLog(@"[JavaLauncher] No launch plan for %@, skipping AppCDS", versionId);
+        return classpath;
+    }
+    // Written by the Java side at the first launch of the plan, until then only the launcher is archived
+    NSArray *gameClasspath = [PLLaunchPlan classpathForVersion:versionId];
+    if (!gameClasspath) {
+        NSLog(@"[JavaLauncher] Launch plan for %@ has no class path yet, archiving launcher classes only", versionId);
+    }
+
+    NSDictionary *modules = [fm attributesOfItemAtPath:[javaHome stringByAppendingPathComponent:@"lib/modules"] error:nil];
+    NSMutableArray *key = @[
+        javaHome,
+        [NSString stringWithContentsOfFile:[javaHome stringByAppendingPathComponent:@"release"] encoding:NSUTF8StringEncoding error:nil] ?: @"",
+        [NSString stringWithFormat:@"modules %llu %f", modules.fileSize, modules.fileModificationDate.timeIntervalSince1970],
+        versionId
+    ].mutableCopy;
+    for (NSString *inputId in [inputs.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        [key addObject:[NSString stringWithFormat:@"%@ %@", inputId, inputs[inputId]]];
+    }
+    // Only options that change which classes get loaded, and from where
+    NSArray *keyPrefixes = @[@"-Xbootclasspath", @"-javaagent", @"-Djava.system.class.loader", @"--add-", @"-XX:"];
+    for (int i = 1; i <= *argc; i++) {
+        NSString *arg = @(argv[i]);
+        if ([arg hasPrefix:@"-Xshare"] || [arg containsString:@"SharedArchiveFile"] || [arg containsString:@"ArchiveClassesAtExit"]) {
+            NSLog(@"[JavaLauncher] Custom CDS flags present, skipping AppCDS");
+            return classpath;
+        } else if ([arg isEqualToString:@"-XX:-UseCompressedClassPointers"]) {
+            // CDS needs compressed class pointers on Java 17. They are turned off
+            // without the extended virtual addressing entitlement
+            NSLog(@"[JavaLauncher] Compressed class pointers are disabled, skipping AppCDS");
+            return classpath;
+        }
+        for (NSString *prefix in keyPrefixes) {
+            if ([arg hasPrefix:prefix]) {
+                [key addObject:arg];
+                break;
+            }
+        }
+    }
+    // Jars changed in place make the JVM reject the archive, they need a new one
+    for (NSString *path in gameClasspath) {
+        NSDictionary *attributes = [path isKindOfClass:NSString.class] ? [fm attributesOfItemAtPath:path error:nil] : nil;
+        if (![attributes.fileType isEqualToString:NSFileTypeRegular]) {
+            // Skipped at launch as well
+            continue;
+        }
+        classpath = [classpath stringByAppendingFormat:@":%@", path];
+        [key addObject:[NSString stringWithFormat:@"%@ %llu %f", path, attributes.fileSize, attributes.fileModificationDate.timeIntervalSince1970]];
+    }
+    [key addObject:classpath];
+    NSString *keyString = [key componentsJoinedByString:@"\n"];
+
+    NSString *cdsDir = [NSString stringWithFormat:@"%s/cache/cds", getenv("POJAV_HOME")];
+    [fm createDirectoryAtPath:cdsDir withIntermediateDirectories:YES attributes:nil error:nil];
+    NSString *name = init_sha1String([NSString stringWithFormat:@"%@\n%@", javaHome, versionId]);
+    NSString *keyPath = [cdsDir stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"key"]];
+    NSString *archivePath = [cdsDir stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"jsa"]];
+
+    // A dump cut short by the app being killed leaves no archive or a broken header
+    uint32_t magic = 0;
+    FILE *archive = fopen(archivePath.fileSystemRepresentation, "rb");
+    if (archive) {
+        fread(&magic, sizeof(magic), 1, archive);
+        fclose(archive);
+    }
+    NSString *savedKey = [NSString stringWithContentsOfFile:keyPath encoding:NSUTF8StringEncoding error:nil];
+    if (magic == CDS_DYNAMIC_ARCHIVE_MAGIC && [savedKey isEqualToString:keyString]) {
+        NSLog(@"[JavaLauncher] Using AppCDS archive %@", archivePath.lastPathComponent);
+        ++*argc;
+        argv[*argc] = [NSString stringWithFormat:@"-XX:SharedArchiveFile=%@", archivePath].UTF8String;
+        // Keeps it among the most recently used
+        [fm setAttributes:@{NSFileModificationDate: NSDate.date} ofItemAtPath:keyPath error:nil];
+    } else {
+        NSLog(@"[JavaLauncher] Creating AppCDS archive %@ at exit", archivePath.lastPathComponent);
+        [fm removeItemAtPath:archivePath error:nil];
+        [keyString writeToFile:keyPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+        ++*argc;
+        argv[*argc] = [NSString stringWithFormat:@"-XX:ArchiveClassesAtExit=%@", archivePath].UTF8String;
+    }
+    init_pruneClassDataArchives(cdsDir);
+    return classpath;
+}
+
+int init_countMods(NSString *gameDir) {
+    int count = 0;
+    for (NSString *file in [fm contentsOfDirectoryAtPath:[gameDir stringByAppendingPathComponent:@"mods"] error:nil]) {
+        if ([file.pathExtension isEqualToString:@"jar"]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Tuning state of a game directory and version lives in $POJAV_HOME/cache/tuning:
+// <name>.log is the GC log of the latest session and <name>.plist holds the heap
+// it was started with, plus the stats of the last session long enough to learn from.
+// Returns the path without extension.
+NSString *init_jvmTuningPath(NSString *gameDir, NSString *versionId) {
+    NSString *tuningDir = [NSString stringWithFormat:@"%s/cache/tuning", getenv("POJAV_HOME")];
+    [fm createDirectoryAtPath:tuningDir withIntermediateDirectories:YES attributes:nil error:nil];
+    return [tuningDir stringByAppendingPathComponent:init_sha1String([NSString stringWithFormat:@"%@\n%@", gameDir, versionId])];
+}
+
+// Folds the GC log of the previous session into the saved state, then picks
+// this session's profile with jvm_tuning.c. fixedHeap overrides the picked
+// heap when the user set one, maxHeap bounds it otherwise.
+void init_setupJvmTuning(NSString *tuningPath, int javaVersion, int modCount, int maxHeap, int fixedHeap, jvm_tuning_profile_t *profile) {
+    NSString *statePath = [tuningPath stringByAppendingPathExtension:@"plist"];
+    NSString *logPath = [tuningPath stringByAppendingPathExtension:@"log"];
+    NSMutableDictionary *state = [NSMutableDictionary dictionaryWithContentsOfFile:statePath] ?: [NSMutableDictionary new];
+
+    jvm_gc_stats_t stats;
+    if ([fm fileExistsAtPath:logPath] && state[@"session"]) {
+        int err = jvm_gc_log_parse(logPath.fileSystemRepresentation, &stats);
+        if (err) {
+            NSLog(@"[JavaLauncher] Failed to read GC log: %s", strerror(err));
+        } else if (stats.pauses > 0) {
+            NSLog(@"[JavaLauncher] Last session: %u GC pauses (%u full) over %.0fs, p95 %.1fms, max %.1fms, live set up to %u MB",
+                stats.pauses, stats.full_pauses, stats.uptime_s, stats.p95_pause_ms, stats.max_pause_ms, stats.max_after_mb);
+            NSMutableDictionary *history = [state[@"session"] mutableCopy];
+            [history addEntriesFromDictionary:@{
+                @"pauses": @(stats.pauses),
+                @"fullPauses": @(stats.full_pauses),
+                @"totalPauseMs": @(stats.total_pause_ms),
+                @"maxPauseMs": @(stats.max_pause_ms),
+                @"p95PauseMs": @(stats.p95_pause_ms),
+                @"maxAfterMB": @(stats.max_after_mb),
+                @"maxCommittedMB": @(stats.max_committed_mb),
+                @"maxMetaspaceMB": @(stats.max_metaspace_mb),
+                @"uptime": @(stats.uptime_s)
+            }];
+            // A session that quit at the title screen says little about the game
+            if (stats.pauses >= [state[@"history"][@"pauses"] unsignedIntValue] / 4) {
+                state[@"history"] = history;
+            }
+        }
+    }
+    // The JVM appends to an existing log. Also drop rotated <name>.log.<n>
+    // files of sessions started before rotation was turned off
+    [fm removeItemAtPath:logPath error:nil];
+    NSString *tuningDir = logPath.stringByDeletingLastPathComponent;
+    NSString *rotatedPrefix = [logPath.lastPathComponent stringByAppendingString:@"."];
+    for (NSString *file in [fm contentsOfDirectoryAtPath:tuningDir error:nil]) {
+        if ([file hasPrefix:rotatedPrefix]) {
+            [fm removeItemAtPath:[tuningDir stringByAppendingPathComponent:file] error:nil];
+        }
+    }
+
+    jvm_tuning_input_t input = {
+        .physical_mb = (uint32_t)(NSProcessInfo.processInfo.physicalMemory / 1048576),
+        .max_heap_mb = maxHeap,
+        .cores = (int)NSProcessInfo.processInfo.activeProcessorCount,
+        .java_version = javaVersion,
+        .mod_count = modCount
+    };
+    // Stats from another mod set or runtime don't describe this workload
+    NSDictionary *history = state[@"history"];
+    if ([history[@"mods"] intValue] == modCount && [history[@"java"] intValue] == javaVersion) {
+        input.last_heap_mb = [history[@"heap"] unsignedIntValue];
+        input.last = (jvm_gc_stats_t){
+            .pauses = [history[@"pauses"] unsignedIntValue],
+            .full_pauses = [history[@"fullPauses"] unsignedIntValue],
+            .total_pause_ms = [history[@"totalPauseMs"] doubleValue],
+            .max_pause_ms = [history[@"maxPauseMs"] doubleValue],
+            .p95_pause_ms = [history[@"p95PauseMs"] doubleValue],
+            .max_after_mb = [history[@"maxAfterMB"] unsignedIntValue],
+            .max_committed_mb = [history[@"maxCommittedMB"] unsignedIntValue],
+            .max_metaspace_mb = [history[@"maxMetaspaceMB"] unsignedIntValue],
+            .uptime_s = [history[@"uptime"] doubleValue]
+        };
+    }
+    jvm_tuning_decide(&input, profile);
+    if (fixedHeap > 0) {
+        profile->heap_mb = fixedHeap;
+        profile->initial_heap_mb = MIN(profile->initial_heap_mb, fixedHeap);
+    }
+    NSLog(@"[JavaLauncher] Tuning for %d mods on Java %d, %u MB heap%s", modCount, javaVersion,
+        profile->heap_mb, input.last_heap_mb ? " from last session" : "");
+
+    state[@"session"] = @{
+        @"heap": @(profile->heap_mb),
+        @"mods": @(modCount),
+        @"java": @(javaVersion)
+    };
+    [state writeToFile:statePath atomically:YES];
+}
+
+void init_addJvmTuningFlags(const jvm_tuning_profile_t *profile, NSString *logPath, BOOL customGC, int* argc, const char** argv) {
+    if (!customGC && profile->gc == JVM_GC_G1) {
+        argv[++*argc] = "-XX:+UseG1GC";
+        argv[++*argc] = [NSString stringWithFormat:@"-XX:MaxGCPauseMillis=%d", profile->max_gc_pause_ms].UTF8String;
+    } else if (!customGC && profile->gc == JVM_GC_SERIAL) {
+        argv[++*argc] = "-XX:+UseSerialGC";
+    }
+    if (profile->parallel_gc_threads > 0) {
+        argv[++*argc] = [NSString stringWithFormat:@"-XX:ParallelGCThreads=%d", profile->parallel_gc_threads].UTF8String;
+    }
+    if (profile->conc_gc_threads > 0) {
+        argv[++*argc] = [NSString stringWithFormat:@"-XX:ConcGCThreads=%d", profile->conc_gc_threads].UTF8String;
+    }
+    if (profile->thread_stack_kb > 0) {
+        argv[++*argc] = [NSString stringWithFormat:@"-Xss%dK", profile->thread_stack_kb].UTF8String;
+    }
+    if (profile->reserved_code_cache_mb > 0) {
+        argv[++*argc] = [NSString stringWithFormat:@"-XX:ReservedCodeCacheSize=%dM", profile->reserved_code_cache_mb].UTF8String;
+    }
+    if (profile->max_metaspace_mb > 0) {
+        argv[++*argc] = [NSString stringWithFormat:@"-XX:MaxMetaspaceSize=%dM", profile->max_metaspace_mb].UTF8String;
+    }
+    // Unified logging only exists since Java 9, Java 8 sessions run without feedback.
+    // filecount=0 keeps a single file, the JVM would otherwise leave rotated
+    // <name>.log.<n> files behind
+    if (logPath) {
+        argv[++*argc] = [NSString stringWithFormat:@"-Xlog:gc,gc+metaspace:file=\"%@\":uptime,level,tags:filecount=0", logPath].UTF8String;
+    }
+}
+
 int launchJVM(NSString *username, id launchTarget, int width, int height, int minVersion) {
+    redactLogUsername(username);
     NSLog(@"[JavaLauncher] Beginning JVM launch");
+    launch_timeline_begin("launchJVM");
+    launch_timeline_begin("Environment setup");
 
     if (NSBundle.mainBundle.infoDictionary[@"LCDataUUID"]) {
         NSDebugLog(@"[JavaLauncher] Running in LiveContainer, skipping dyld patch");
@@ -101,6 +403,7 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
 
     init_loadDefaultEnv();
     init_loadCustomEnv();
+    launch_timeline_end("Environment setup");
 
     BOOL launchJar = NO;
     NSString *gameDir;
@@ -131,13 +434,17 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
             getenv("POJAV_HOME"), getPrefObject(@"general.game_directory"),
             [PLProfiles resolveKeyForCurrentProfile:@"gameDir"]]
             .stringByStandardizingPath;
+        // Also with packing turned off, until the pack was exported again
+        init_servePackedAssets();
     } else {
         defaultJRETag = @"execute_jar";
         gameDir = @(getenv("POJAV_GAME_DIR"));
         launchJar = YES;
     }
     NSLog(@"[JavaLauncher] Looking for Java %d or later", minVersion);
+    launch_timeline_begin("Runtime lookup");
     NSString *javaHome = getSelectedJavaHome(defaultJRETag, minVersion);
+    launch_timeline_end("Runtime lookup");
 
     if (javaHome == nil) {
         UIKit_returnToSplitView();
@@ -160,12 +467,24 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
     NSLog(@"[JavaLauncher] JAVA_HOME has been set to %@", javaHome);
 
     int allocmem;
+    CGFloat autoRatio = getEntitlementValue(@"com.apple.private.memorystatus") ? 0.4 : 0.25;
+    int automem = roundf((NSProcessInfo.processInfo.physicalMemory / 1048576) * autoRatio);
     if (getPrefBool(@"java.auto_ram")) {
-        CGFloat autoRatio = getEntitlementValue(@"com.apple.private.memorystatus") ? 0.4 : 0.25;
-        allocmem = roundf((NSProcessInfo.processInfo.physicalMemory / 1048576) * autoRatio);
+        allocmem = automem;
     } else {
         allocmem = getPrefInt(@"java.allocated_memory");
     }
+    int initmem = 128;
+    int javaVersion = init_getJavaMajorVersion(javaHome);
+    NSString *tuningPath;
+    jvm_tuning_profile_t tuning;
+    if (!launchJar && getPrefBool(@"java.adaptive_tuning")) {
+        tuningPath = init_jvmTuningPath(gameDir, launchTarget[@"id"]);
+        init_setupJvmTuning(tuningPath, javaVersion, init_countMods(gameDir), automem,
+            getPrefBool(@"java.auto_ram") ? 0 : allocmem, &tuning);
+        allocmem = tuning.heap_mb;
+        initmem = tuning.initial_heap_mb;
+    }
     NSLog(@"[JavaLauncher] Max RAM allocation is set to %d MB", allocmem);
 
     int margc = -1;
@@ -176,7 +495,7 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
     if (!launchJar) {
         margv[++margc] = "-Djava.system.class.loader=net.kdt.pojavlaunch.PojavClassLoader";
     }
-    margv[++margc] = "-Xms128M";
+    margv[++margc] = [NSString stringWithFormat:@"-Xms%dM", initmem].UTF8String;
     margv[++margc] = [NSString stringWithFormat:@"-Xmx%dM", allocmem].UTF8String;
     margv[++margc] = [NSString stringWithFormat:@"-Djava.library.path=%@/Frameworks", NSBundle.mainBundle.bundlePath].UTF8String;
     margv[++margc] = [NSString stringWithFormat:@"-Duser.dir=%@", gameDir].UTF8String;
@@ -216,7 +535,9 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
     NSString *libjlipath11 = [NSString stringWithFormat:@"%@/lib/libjli.dylib", javaHome]; // java 11+
     BOOL isJava8 = [fm fileExistsAtPath:libjlipath8];
     setenv("INTERNAL_JLI_PATH", (isJava8 ? libjlipath8 : libjlipath11).UTF8String, 1);
+    launch_timeline_begin("Load libjli");
     void* libjli = dlopen(getenv("INTERNAL_JLI_PATH"), RTLD_GLOBAL);
+    launch_timeline_end("Load libjli");
 
     if (!libjli) {
         const char *error = dlerror();
@@ -289,12 +610,24 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
         }
     }
 
+    if (tuningPath) {
+        // Two collectors selected at once make the JVM refuse to start
+        NSString *customArgs = [NSString stringWithFormat:@"%@ %@",
+            [PLProfiles resolveKeyForCurrentProfile:@"javaArgs"] ?: @"",
+            [launchTarget[@"arguments"][@"jvm_processed"] componentsJoinedByString:@" "] ?: @""];
+        BOOL customGC = [customArgs rangeOfString:@"-XX:\\+Use\\w+GC\\b" options:NSRegularExpressionSearch].location != NSNotFound;
+        init_addJvmTuningFlags(&tuning, javaVersion >= 9 ? [tuningPath stringByAppendingPathExtension:@"log"] : nil,
+            customGC, &margc, (const char **)margv);
+    }
+
     init_loadCustomJvmFlags(&margc, (const char **)margv);
     NSLog(@"[Init] Found JLI lib");
 
     NSString *classpath = [NSString stringWithFormat:@"%@/*", librariesPath];
     if (launchJar) {
         classpath = [classpath stringByAppendingFormat:@":%@", launchTarget];
+    } else {
+        classpath = init_setupClassDataSharing(javaHome, launchTarget[@"id"], classpath, &margc, (const char **)margv);
     }
     margv[++margc] = "-cp";
     margv[++margc] = classpath.UTF8String;
@@ -333,6 +666,10 @@ int launchJVM(NSString *username, id launchTarget, int width, int height, int mi
     // Free split VC
     tmpRootVC = nil;
 
+    launch_timeline_end("launchJVM");
+    // Ended by PojavLauncher.main
+    launch_timeline_begin("JVM startup");
+
     return pJLI_Launch(++margc, margv,
                    0, NULL, // sizeof(const_jargs) / sizeof(char *), const_jargs,
                    0, NULL, // sizeof(const_appclasspath) / sizeof(char *), const_appclasspath,
@@ -10,6 +10,8 @@
 #import "LauncherPreferences.h"
 #import "MinecraftResourceDownloadTask.h"
 #import "MinecraftResourceUtils.h"
+#import "PLContentStore.h"
+#import "PLMetadataCache.h"
 #import "PickTextField.h"
 #import "PLPickerView.h"
 #import "PLProfiles.h"
@@ -19,6 +21,7 @@
 #import "utils.h"
 
 #include <sys/time.h>
+#include "launch_timeline.h"
 
 #define AUTORESIZE_MASKS UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleLeftMargin | UIViewAutoresizingFlexibleRightMargin
 
@@ -98,6 +101,10 @@ static void *ProgressObserverContext = &ProgressObserverContext;
     [targetToolbar addSubview:self.progressText];
 
     [self fetchRemoteVersionList];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        // Drop blobs left behind by deleted instances
+        [PLContentStore.sharedStore collectGarbage];
+    });
     [NSNotificationCenter.defaultCenter addObserver:self
         selector:@selector(receiveNotification:) 
         name:@"InstallModpack"
@@ -150,17 +157,17 @@ static void *ProgressObserverContext = &ProgressObserverContext;
         @{@"id": @"latest-snapshot", @"type": @"snapshot"}
     ].mutableCopy;
 
-    AFHTTPSessionManager *manager = [AFHTTPSessionManager manager];
-    [manager GET:@"https://piston-meta.mojang.com/mc/game/version_manifest_v2.json" parameters:nil headers:nil progress:^(NSProgress * _Nonnull progress) {
-        self.progressViewMain.progress = progress.fractionCompleted;
-    } success:^(NSURLSessionTask *task, NSDictionary *responseObject) {
-        [remoteVersionList addObjectsFromArray:responseObject[@"versions"]];
-        NSDebugLog(@"[VersionList] Got %d versions", remoteVersionList.count);
-        setPrefObject(@"internal.latest_version", responseObject[@"latest"]);
-        self.buttonInstall.enabled = YES;
-    } failure:^(NSURLSessionTask *operation, NSError *error) {
-        NSDebugLog(@"[VersionList] Warning: Unable to fetch version list: %@", error.localizedDescription);
+    // Called again if the cached manifest turns out to be outdated
+    [PLMetadataCache.sharedCache fetchJSONFromURL:@"https://piston-meta.mojang.com/mc/game/version_manifest_v2.json" handler:^(NSDictionary *response, NSError *error) {
         self.buttonInstall.enabled = YES;
+        if (error) {
+            NSDebugLog(@"[VersionList] Warning: Unable to fetch version list: %@", error.localizedDescription);
+            return;
+        }
+        [remoteVersionList removeObjectsInRange:NSMakeRange(2, remoteVersionList.count - 2)];
+        [remoteVersionList addObjectsFromArray:response[@"versions"]];
+        NSDebugLog(@"[VersionList] Got %d versions", remoteVersionList.count);
+        setPrefObject(@"internal.latest_version", response[@"latest"]);
     }];
 }
 
@@ -253,6 +260,8 @@ static void *ProgressObserverContext = &ProgressObserverContext;
     }
 
     [self setInteractionEnabled:NO forDownloading:YES];
+    launch_timeline_mark("Play pressed");
+    launch_timeline_begin("Version download");
 
     NSString *versionId = PLProfiles.current.profiles[self.versionTextField.text][@"lastVersionId"];
     NSDictionary *object = [remoteVersionList filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"(id == %@)", versionId]].firstObject;
@@ -329,8 +338,11 @@ static void *ProgressObserverContext = &ProgressObserverContext;
         [self.progressVC dismissModalViewControllerAnimated:NO];
 
         self.progressViewMain.observedProgress = nil;
+        launch_timeline_end("Version download");
         if (self.task.metadata) {
+            launch_timeline_begin("Wait for JIT");
             [self invokeAfterJITEnabled:^{
+                launch_timeline_end("Wait for JIT");
                 UIKit_launchMinecraftSurfaceVC(self.view.window, self.task.metadata);
             }];
         } else {
@@ -9,25 +9,18 @@
 #import "utils.h"
 
 #include <dlfcn.h>
-#include <lzma.h>
 #include <objc/runtime.h>
+#include "tar_xz.h"
 
 // 0 is reserved for default pickers
 // INT_MAX is reserved for invalid runtimes
 #define DEFAULT_JRE 0
 #define INVALID_JRE INT_MAX
 
-// https://www.gnu.org/software/tar/manual/html_node/Standard.html
 typedef struct {
-    char name[100];
-    char mode[8];
-    char unused1[8+8];
-    char size[12];
-    char unused2[12+8];
-    char typeflag;
-    char linkname[100];
-    char unused3[6+2+32+32+8+8+155+12];
-} TarHeader;
+    __unsafe_unretained BOOL(^progress)(uint64_t inBytes, uint64_t outBytes, NSString *name);
+    __unsafe_unretained BOOL(^fileWritten)(NSString *name);
+} RuntimeUnpackCallbacks;
 
 static WFWorkflowProgressView* currentProgressView;
 
@@ -112,8 +105,7 @@ static WFWorkflowProgressView* currentProgressView;
         to:outPath progress:totalProgress fileProgress:fileProgress
         fileCallback:^(NSString* name) {
             NSString *completedSize = [NSByteCountFormatter stringFromByteCount:fileProgress.completedUnitCount countStyle:NSByteCountFormatterCountStyleMemory];
-            NSString *totalSize = [NSByteCountFormatter stringFromByteCount:fileProgress.totalUnitCount countStyle:NSByteCountFormatterCountStyleMemory];
-            nav.progressText.text = [NSString stringWithFormat:@"(%@ / %@) %@", completedSize, totalSize, name];
+            nav.progressText.text = [NSString stringWithFormat:@"(%@) %@", completedSize, name];
             currentProgressView.fractionCompleted = totalProgress.fractionCompleted;
         }];
         [url stopAccessingSecurityScopedResource];
@@ -499,157 +491,70 @@ styleForMenuWithConfiguration:(UIContextMenuConfiguration *)configuration
     return nil;
 }
 
-+ (NSString *)lzmaErrorDescriptionForCode:(int)code {
-    switch (code) {
-        case LZMA_MEM_ERROR:
-            return @"Memory allocation failed";
-        case LZMA_FORMAT_ERROR:
-            return @"The input is not in the .xz format";
-        case LZMA_OPTIONS_ERROR:
-            return @"Unsupported compression options";
-        case LZMA_DATA_ERROR:
-            return @"Compressed file is corrupt";
-        case LZMA_BUF_ERROR:
-            return @"Compressed file is truncated or otherwise corrupt";
-        default:
-            return @"Unknown error, possibly a bug";
+static bool extractTarXZ_progress(uint64_t in_bytes, uint64_t out_bytes, const char *name, void *ctx) {
+    RuntimeUnpackCallbacks *callbacks = ctx;
+    @autoreleasepool {
+        return callbacks->progress(in_bytes, out_bytes, name ? @(name) : nil);
     }
 }
 
-// Reference: https://github.com/xz-mirror/xz/blob/master/doc/examples/02_decompress.c
+static bool extractTarXZ_fileWritten(const char *name, void *ctx) {
+    RuntimeUnpackCallbacks *callbacks = ctx;
+    // Runs on a plain pthread without a pool of its own
+    @autoreleasepool {
+        return callbacks->fileWritten(@(name));
+    }
+}
+
+// fileProgress counts the unpacked bytes, the total is unknown until the end
 + (NSString *)extractTarXZ:(NSString *)inPath to:(NSString *)outPath progress:(NSProgress *)progress fileProgress:(NSProgress *)fileProgress fileCallback:(void(^)(NSString* name))fileCallback {
     NSString *installingDir = [outPath stringByAppendingPathComponent:@".installing"];
     [NSFileManager.defaultManager createDirectoryAtPath:installingDir withIntermediateDirectories:YES attributes:nil error:nil];
 
-    NSInputStream *inFile = [NSInputStream inputStreamWithFileAtPath:inPath];
-    [inFile open];
-
-    NSString *msg = nil;
-    lzma_stream strm = LZMA_STREAM_INIT;
-    lzma_action action = LZMA_RUN;
-    uint8_t inbuf[BUFSIZ], outbuf[512];
-
-    lzma_ret ret = lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED);
-    if (ret != LZMA_OK) {
-        return [self lzmaErrorDescriptionForCode:ret];
-    }
-
-    strm.next_in = NULL;
-    strm.avail_in = 0;
-    strm.next_out = outbuf;
-    strm.avail_out = sizeof(outbuf);
-
-    TarHeader currFileHeader;
-    NSString *currFileName;
-    NSOutputStream *currFileOut;
-    NSUInteger currFileOff, currFileSize;
-
-    while (!progress.cancelled) {
-        if (strm.avail_in == 0 && inFile.hasBytesAvailable) {
-            strm.next_in = inbuf;
-            strm.avail_in = [inFile read:inbuf maxLength:sizeof(inbuf)];
-
-            if (strm.avail_in == -1) {
-                msg = inFile.streamError.localizedDescription;
-                break;
-            }
-
-            if (!inFile.hasBytesAvailable) {
-                action = LZMA_FINISH;
-            }
-        }
-
-        ret = lzma_code(&strm, action);
-        if (strm.avail_out == 0 || ret == LZMA_STREAM_END) {
-            if (currFileOut) {
-                size_t remaining = currFileSize - currFileOff;
-                size_t write_size = MIN(sizeof(outbuf), remaining);
-                currFileOff += write_size;
-                // Avoid overloading the main queue
-                if (currFileOff % 102400 == 0) {
-                    dispatch_async(dispatch_get_main_queue(), ^{
-                        fileProgress.completedUnitCount = currFileOff;
-                        fileCallback(currFileName);
-                    });
-                }
-                if ([currFileOut write:outbuf maxLength:write_size] != write_size) {
-                    msg = [NSString stringWithFormat:@"%s: %@", currFileHeader.name, currFileOut.streamError];
-                    break;
-                } else if (currFileOff >= currFileSize) {
-                    [currFileOut close];
-                    currFileOut = nil;
-                    if ([currFileName isEqualToString:@"./release"]) {
-                        msg = [LauncherPrefManageJREViewController validateRuntimeInfo:outPath];
-                        if (msg) goto cleanup;
-                    }
-                }
-            } else {
-                memcpy(&currFileHeader, outbuf, sizeof(outbuf));
-                if (currFileHeader.name[0] == '\0') {
-                    // EOF
-                    break;
-                }
-                NSString *absPath = [NSString stringWithFormat:@"%@/%s", outPath, currFileHeader.name];
-                NSError *error = nil;
-                switch (currFileHeader.typeflag) {
-                    case '0':
-                    case '\0': { // File
-                        currFileName = @(currFileHeader.name);
-                        currFileOff = fileProgress.completedUnitCount = 0;
-                        currFileSize = fileProgress.totalUnitCount = strtol(currFileHeader.size, NULL, 8);
-                        NSLog(@"[RuntimeUnpack] Extracting %@", currFileName);
-                        dispatch_async(dispatch_get_main_queue(), ^{
-                            fileCallback(currFileName);
-                        });
-
-                        currFileOut = [NSOutputStream outputStreamToFileAtPath:absPath append:NO];
-                        [currFileOut open];
-                    } break;
-                    case '2': { // Symlink
-                        symlink(currFileHeader.linkname, currFileHeader.name);
-                        //NSLog(@"%s -> %s", currFileHeader.name, currFileHeader.linkname);
-                    } break;
-                    case '5': { // Folder
-                        [NSFileManager.defaultManager createDirectoryAtPath:absPath withIntermediateDirectories:YES attributes:nil error:&error];
-                        if (error) {
-                            msg = [NSString stringWithFormat:@"%s: %@", currFileHeader.name, error];
-                            goto cleanup;
-                        }
-                    } break;
-                    default: // Ignore everything else
-                        if (currFileHeader.typeflag < '0' && currFileHeader.typeflag > '7'
-                        && (currFileHeader.typeflag != 'x' && currFileHeader.typeflag != 'g')) {
-                            msg = [NSString stringWithFormat:@"Invalid typeflag %c", currFileHeader.typeflag];
-                            goto cleanup;
-                        }
-                        NSLog(@"[RuntimeUnpack] Skipped %s (typeflag %c)", currFileHeader.name, currFileHeader.typeflag);
-                        break;
-                }
-            }
-
-            strm.next_out = outbuf;
-            strm.avail_out = sizeof(outbuf);
-
-            progress.completedUnitCount = strm.total_in;
+    __block NSString *msg = nil;
+    __block CFAbsoluteTime lastUpdate = 0;
+    // Called on the decoding thread
+    BOOL(^progressBlock)(uint64_t, uint64_t, NSString *) = ^BOOL(uint64_t inBytes, uint64_t outBytes, NSString *name) {
+        progress.completedUnitCount = inBytes;
+        fileProgress.completedUnitCount = outBytes;
+        // Avoid overloading the main queue
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        if (name && now - lastUpdate >= 0.1) {
+            lastUpdate = now;
+            dispatch_async(dispatch_get_main_queue(), ^{
+                fileCallback(name);
+            });
         }
-
-        if (ret == LZMA_STREAM_END) {
-            break;
-        } else if (ret != LZMA_OK) {
-            msg = [self lzmaErrorDescriptionForCode:ret];
-            break;
+        return !progress.cancelled;
+    };
+    // Called on the writer thread once a file is complete
+    BOOL(^fileWrittenBlock)(NSString *) = ^BOOL(NSString *name) {
+        if ([name isEqualToString:@"release"]) {
+            msg = [LauncherPrefManageJREViewController validateRuntimeInfo:outPath];
         }
+        return msg == nil;
+    };
+    RuntimeUnpackCallbacks callbacks = {progressBlock, fileWrittenBlock};
+    tar_xz_options_t options = {
+        .progress = extractTarXZ_progress,
+        .file_written = extractTarXZ_fileWritten,
+        .ctx = &callbacks
+    };
+
+    char errbuf[PATH_MAX + 64];
+    tar_xz_stats_t stats;
+    NSDate *start = NSDate.date;
+    int err = tar_xz_extract(inPath.fileSystemRepresentation, outPath.fileSystemRepresentation, &options, &stats, errbuf, sizeof(errbuf));
+    if (err && err != ECANCELED) {
+        msg = @(errbuf);
     }
 
-cleanup:
     if (msg || progress.cancelled) {
         [NSFileManager.defaultManager removeItemAtPath:outPath error:nil];
     } else {
+        NSLog(@"[RuntimeUnpack] Extracted %zu files (%llu bytes) in %.2fs", stats.files, stats.bytes, -start.timeIntervalSinceNow);
         [NSFileManager.defaultManager removeItemAtPath:installingDir error:nil];
     }
-    lzma_end(&strm);
-    [inFile close];
-    [currFileOut close];
     return msg;
 }
 
@@ -10,6 +10,7 @@
 #import "LauncherPrefManageJREViewController.h"
 #import "UIKit+hook.h"
 
+#import "asset_pack.h"
 #import "config.h"
 #import "ios_uikit_bridge.h"
 #import "utils.h"
@@ -18,6 +19,45 @@
 @property(nonatomic) NSArray<NSString*> *rendererKeys, *rendererList;
 @end
 
+// Moves the assets of every game directory into its pack, or back out of it
+static void LauncherPreferencesViewController_migrateAssets(BOOL packed) {
+    NSString *home = @(getenv("POJAV_HOME"));
+    NSString *instancesDir = [home stringByAppendingPathComponent:@"instances"];
+    NSMutableArray<NSString *> *gameDirs = [NSMutableArray arrayWithObject:[home stringByAppendingPathComponent:@".demo"]];
+    for (NSString *name in [NSFileManager.defaultManager contentsOfDirectoryAtPath:instancesDir error:nil]) {
+        [gameDirs addObject:[instancesDir stringByAppendingPathComponent:name]];
+    }
+    for (NSString *gameDir in gameDirs) {
+        NSString *assetsDir = [gameDir stringByAppendingPathComponent:@"assets"];
+        NSString *objectsDir = [assetsDir stringByAppendingPathComponent:@"objects"];
+        NSString *packPath = [assetsDir stringByAppendingPathComponent:@ASSET_PACK_DATA_NAME];
+        size_t count = 0;
+        int err = 0;
+        if (packed) {
+            if (![NSFileManager.defaultManager fileExistsAtPath:objectsDir]) continue;
+            err = asset_pack_import_loose(assetsDir.fileSystemRepresentation, objectsDir.fileSystemRepresentation, YES, &count);
+        } else {
+            if (![NSFileManager.defaultManager fileExistsAtPath:packPath]) continue;
+            asset_pack_t pack;
+            err = asset_pack_open(assetsDir.fileSystemRepresentation, &pack);
+            if (!err) {
+                err = asset_pack_export(&pack, objectsDir.fileSystemRepresentation, YES, &count);
+                asset_pack_close(&pack);
+            }
+            if (!err) {
+                // Every object is loose again, the pack would only be a second copy
+                unlink(packPath.fileSystemRepresentation);
+                unlink([assetsDir stringByAppendingPathComponent:@ASSET_PACK_INDEX_NAME].fileSystemRepresentation);
+                asset_pack_invalidate_export(objectsDir.fileSystemRepresentation);
+            }
+        }
+        if (err) {
+            NSLog(@"[Preferences] Asset migration in %@ stopped: %s", gameDir.lastPathComponent, strerror(err));
+        }
+        NSLog(@"[Preferences] %@ %zu assets in %@", packed ? @"Packed" : @"Unpacked", count, gameDir.lastPathComponent);
+    }
+}
+
 @implementation LauncherPreferencesViewController
 
 - (id)init {
@@ -62,6 +102,25 @@
               @"type": self.typeSwitch,
               @"enableCondition": whenNotInGame
             },
+            @{@"key": @"packed_assets",
+              @"hasDetail": @YES,
+              @"icon": @"shippingbox",
+              @"type": self.typeSwitch,
+              @"enableCondition": whenNotInGame,
+              @"action": ^(BOOL enabled){
+                  // The pack becomes the only copy of migrated objects, and turning
+                  // it off writes them out again
+                  dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+                      LauncherPreferencesViewController_migrateAssets(enabled);
+                  });
+              }
+            },
+            @{@"key": @"download_mirrors",
+              @"hasDetail": @YES,
+              @"icon": @"arrow.triangle.branch",
+              @"type": self.typeSwitch,
+              @"enableCondition": whenNotInGame
+            },
             @{@"key": @"cosmetica",
               @"hasDetail": @YES,
               @"icon": @"eyeglasses",
@@ -337,6 +396,18 @@
                 @"type": self.typeTextField,
                 @"enableCondition": whenNotInGame
             },
+            @{@"key": @"class_data_sharing",
+                @"hasDetail": @YES,
+                @"icon": @"archivebox",
+                @"type": self.typeSwitch,
+                @"enableCondition": whenNotInGame
+            },
+            @{@"key": @"adaptive_tuning",
+                @"hasDetail": @YES,
+                @"icon": @"gauge",
+                @"type": self.typeSwitch,
+                @"enableCondition": whenNotInGame
+            },
             @{@"key": @"auto_ram",
                 @"hasDetail": @YES,
                 @"icon": @"slider.horizontal.3",
@@ -1,4 +1,6 @@
 #include <CommonCrypto/CommonDigest.h>
+#include "asset_index.h"
+#include "asset_pack.h"
 
 #import "authenticator/BaseAuthenticator.h"
 #import "installer/modpack/ModpackAPI.h"
@@ -7,6 +9,9 @@
 #import "LauncherPreferences.h"
 #import "MinecraftResourceDownloadTask.h"
 #import "MinecraftResourceUtils.h"
+#import "PLContentStore.h"
+#import "PLLaunchPlan.h"
+#import "PLMirrorSelector.h"
 #import "ios_uikit_bridge.h"
 #import "utils.h"
 
@@ -29,10 +34,21 @@
 }
 
 // Add file to the queue
-- (NSURLSessionDownloadTask *)createDownloadTask:(NSString *)url size:(NSUInteger)size sha:(NSString *)sha altName:(NSString *)altName toPath:(NSString *)path success:(void (^)())success {
+- (NSURLSessionDownloadTask *)createDownloadTaskWithURLs:(NSArray<NSString *> *)urls size:(NSUInteger)size sha:(NSString *)sha altName:(NSString *)altName toPath:(NSString *)path success:(void (^)())success {
     BOOL fileExists = [NSFileManager.defaultManager fileExistsAtPath:path];
+    if (!fileExists && [PLContentStore.sharedStore materializeHash:sha toPath:path]) {
+        // Satisfied from the shared store without touching the network
+        fileExists = YES;
+        if (![self checkSHA:sha forFile:path altName:altName]) {
+            NSLog(@"[MCDL] Dropping corrupted store entry for %@", altName ?: path.lastPathComponent);
+            [PLContentStore.sharedStore removeHash:sha];
+            [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+            fileExists = NO;
+        }
+    }
     // logSuccess?
     if (fileExists && [self checkSHA:sha forFile:path altName:altName]) {
+        [self storeFile:path sha:sha];
         if (success) success();
         return nil;
     } else if (![self checkAccessWithDialog:YES]) {
@@ -40,38 +56,161 @@
     }
 
     NSString *name = altName ?: path.lastPathComponent;
-    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:url]];
+    PLMirrorSelector *selector = PLMirrorSelector.sharedSelector;
+    // Only files that are verified are raced, a mirror serving something else must never win
+    NSArray<NSString *> *candidates = sha.length > 0 && getPrefBool(@"general.check_sha") ?
+        [selector candidatesForURLs:urls] : urls;
+    if (candidates.count == 0) {
+        [self finishDownloadWithErrorString:[NSString stringWithFormat:@"No download source for %@", name]];
+        return nil;
+    }
+
+    // Attempts in flight. Also the lock for the race state below.
+    NSMutableArray<NSURLSessionDownloadTask *> *attempts = [NSMutableArray new];
+    __block NSURLSessionDownloadTask *primary, *winner;
     __block NSProgress *progress;
-    __block NSURLSessionDownloadTask *task = [self.manager downloadTaskWithRequest:request progress:nil
-    destination:^NSURL * _Nonnull(NSURL * _Nonnull targetPath, NSURLResponse * _Nonnull response) {
-        NSLog(@"[MCDL] Downloading %@", name);
-        progress = [self.manager downloadProgressForTask:task];
-        if (!size && task) {
-            [self addDownloadTaskToProgress:task size:response.expectedContentLength];
-            [self.fileList addObject:name];
-        }
-        [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
-        [NSFileManager.defaultManager removeItemAtPath:path error:nil];
-        return [NSURL fileURLWithPath:path];
-    } completionHandler:^(NSURLResponse * _Nonnull response, NSURL * _Nullable filePath, NSError * _Nullable error) {
-        if (self.progress.cancelled) {
-            // Ignore any further errors
-        } else if (error != nil) {
-            [self finishDownloadWithError:error file:name];
-        } else if (![self checkSHA:sha forFile:path altName:altName]) {
-            [self finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to verify file %@: SHA1 mismatch", path.lastPathComponent]];
-        } else {
-            progress.totalUnitCount = progress.completedUnitCount;
-            if (success) success();
+    __block NSUInteger nextCandidate = 0;
+    __block BOOL hedged = NO;
+    // Must be called with attempts locked. Released once the download settles.
+    __block NSURLSessionDownloadTask *(^startAttempt)(void);
+    // Must be called with attempts locked, once the first source was resumed
+    void(^armHedge)(void) = ^{
+        if (candidates.count < 2) return;
+        NSTimeInterval delay = [selector hedgeDelayForURL:candidates.firstObject];
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            @synchronized (attempts) {
+                // Still no byte from the first source, race the next one
+                if (winner || !startAttempt || attempts.count != 1 || nextCandidate >= candidates.count ||
+                    self.progress.cancelled || ![selector beginHedge]) {
+                    return;
+                }
+                hedged = YES;
+                [startAttempt() resume];
+            }
+        });
+    };
+    startAttempt = ^NSURLSessionDownloadTask *{
+        NSString *url = candidates[nextCandidate++];
+        NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:url]];
+        // Set on resume, callers create whole batches of tasks and resume them later
+        __block NSDate *start;
+        __block id resumeObserver;
+        __block BOOL receivedData = NO;
+        __block NSURLSessionDownloadTask *task = [self.manager downloadTaskWithRequest:request
+        progress:^(NSProgress *taskProgress) {
+            @synchronized (attempts) {
+                if (!receivedData) {
+                    receivedData = YES;
+                    if (start) {
+                        [selector recordLatency:-start.timeIntervalSinceNow forURL:url];
+                    }
+                }
+                if (!winner) {
+                    // First byte wins, the other attempt would only waste bandwidth
+                    winner = task;
+                    for (NSURLSessionDownloadTask *other in attempts) {
+                        if (other != task) [other cancel];
+                    }
+                    if (task != primary) {
+                        NSLog(@"[MCDL] Using %@ for %@", request.URL.host, name);
+                    }
+                }
+                if (task == winner && task != primary && progress) {
+                    progress.completedUnitCount = taskProgress.completedUnitCount;
+                }
+            }
         }
-    }];
+        destination:^NSURL * _Nonnull(NSURL * _Nonnull targetPath, NSURLResponse * _Nonnull response) {
+            @synchronized (attempts) {
+                if (winner && winner != task) {
+                    // Finished while being cancelled, discarded in the completion handler
+                    return [targetPath URLByAppendingPathExtension:@"discard"];
+                }
+                NSLog(@"[MCDL] Downloading %@", name);
+                if (!progress) {
+                    progress = [self.manager downloadProgressForTask:task];
+                    [self addDownloadTaskToProgress:task size:response.expectedContentLength];
+                    [self.fileList addObject:name];
+                }
+            }
+            [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+            [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+            return [NSURL fileURLWithPath:path];
+        } completionHandler:^(NSURLResponse * _Nonnull response, NSURL * _Nullable filePath, NSError * _Nullable error) {
+            BOOL verified = NO;
+            @synchronized (attempts) {
+                if (resumeObserver) {
+                    [NSNotificationCenter.defaultCenter removeObserver:resumeObserver];
+                    resumeObserver = nil;
+                }
+                [attempts removeObject:task];
+                if (filePath && ![filePath.path isEqualToString:path]) {
+                    [NSFileManager.defaultManager removeItemAtURL:filePath error:nil];
+                }
+                if (self.progress.cancelled) {
+                    // Ignore any further errors
+                    if (attempts.count == 0) {
+                        startAttempt = nil;
+                        if (hedged) [selector endHedge];
+                        hedged = NO;
+                    }
+                    return;
+                } else if (winner && winner != task) {
+                    // Lost the race
+                    return;
+                }
+                verified = !error && [self checkSHA:sha forFile:path altName:altName];
+                if (!verified && (attempts.count > 0 || nextCandidate < candidates.count)) {
+                    // Let the remaining sources have a go before failing the whole download
+                    NSLog(@"[MCDL] %@ failed from %@, trying another source", name, request.URL.host);
+                    [selector recordFailureForURL:url];
+                    winner = nil;
+                    if (attempts.count == 0) {
+                        [startAttempt() resume];
+                    }
+                    return;
+                }
+                startAttempt = nil;
+                if (hedged) [selector endHedge];
+                hedged = NO;
+            }
+            if (error != nil) {
+                [self finishDownloadWithError:error file:name];
+            } else if (!verified) {
+                [self finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to verify file %@: SHA1 mismatch", path.lastPathComponent]];
+            } else {
+                progress.totalUnitCount = progress.completedUnitCount;
+                [self storeFile:path sha:sha];
+                if (success) success();
+            }
+        }];
+        resumeObserver = [NSNotificationCenter.defaultCenter addObserverForName:AFNetworkingTaskDidResumeNotification object:task queue:nil usingBlock:^(NSNotification *notification) {
+            @synchronized (attempts) {
+                if (!resumeObserver) return;
+                [NSNotificationCenter.defaultCenter removeObserver:resumeObserver];
+                resumeObserver = nil;
+                start = NSDate.date;
+                if (task == primary) armHedge();
+            }
+        }];
+        [attempts addObject:task];
+        return task;
+    };
 
-    if (size && task) {
-        [self addDownloadTaskToProgress:task size:size];
-        [self.fileList addObject:name];
+    @synchronized (attempts) {
+        primary = startAttempt();
+        if (size && primary) {
+            progress = [self.manager downloadProgressForTask:primary];
+            [self addDownloadTaskToProgress:primary size:size];
+            [self.fileList addObject:name];
+        }
     }
 
-    return task;
+    return primary;
+}
+
+- (NSURLSessionDownloadTask *)createDownloadTask:(NSString *)url size:(NSUInteger)size sha:(NSString *)sha altName:(NSString *)altName toPath:(NSString *)path success:(void (^)())success {
+    return [self createDownloadTaskWithURLs:url ? @[url] : @[] size:size sha:sha altName:altName toPath:path success:success];
 }
 
 - (NSURLSessionDownloadTask *)createDownloadTask:(NSString *)url size:(NSUInteger)size sha:(NSString *)sha altName:(NSString *)altName toPath:(NSString *)path {
@@ -105,19 +244,29 @@
     version = (id)[MinecraftResourceUtils findVersion:versionStr inList:remoteVersionList];
 
     void(^completionBlock)(void) = ^{
+        NSString *versionId = path.stringByDeletingLastPathComponent.lastPathComponent;
+        self.metadata = [PLLaunchPlan loadMetadataForVersion:versionId];
+        if (self.metadata) {
+            success();
+            return;
+        }
+
         self.metadata = parseJSONFromFile(path);
         if (self.metadata[@"NSErrorObject"]) {
             [self finishDownloadWithErrorString:[self.metadata[@"NSErrorObject"] localizedDescription]];
             return;
         }
+        NSMutableArray *inputs = @[versionId].mutableCopy;
         if (self.metadata[@"inheritsFrom"]) {
             NSMutableDictionary *inheritsFromDict = parseJSONFromFile([NSString stringWithFormat:@"%1$s/versions/%2$@/%2$@.json", getenv("POJAV_GAME_DIR"), self.metadata[@"inheritsFrom"]]);
             if (inheritsFromDict) {
+                [inputs addObject:self.metadata[@"inheritsFrom"]];
                 [MinecraftResourceUtils processVersion:self.metadata inheritsFrom:inheritsFromDict];
                 self.metadata = inheritsFromDict;
             }
         }
         [MinecraftResourceUtils tweakVersionJson:self.metadata];
+        [PLLaunchPlan saveMetadata:self.metadata forVersion:versionId inputs:inputs];
         success();
     };
 
@@ -159,7 +308,7 @@
     NSString *sha = url.stringByDeletingLastPathComponent.lastPathComponent;
     NSUInteger size = [assetIndex[@"size"] unsignedLongLongValue];
     NSURLSessionDownloadTask *task = [self createDownloadTask:url size:size sha:sha altName:name toPath:path success:^{
-        self.metadata[@"assetIndexObj"] = parseJSONFromFile(path);
+        self.metadata[@"assetIndexPath"] = path;
         success();
     }];
     [task resume];
@@ -202,18 +351,33 @@
 
 - (NSArray *)downloadClientAssets {
     NSMutableArray *tasks = [NSMutableArray new];
-    NSDictionary *assets = self.metadata[@"assetIndexObj"];
-    if (!assets) {
+    NSString *indexPath = self.metadata[@"assetIndexPath"];
+    if (!indexPath) {
         return @[];
     }
-    for (NSString *name in assets[@"objects"]) {
-        NSDictionary *object = assets[@"objects"][name];
-        NSString *hash = object[@"hash"];
-        NSString *pathname = [NSString stringWithFormat:@"%@/%@", [hash substringToIndex:2], hash];
-        NSUInteger size = [object[@"size"] unsignedLongLongValue];
+    asset_index_t assets;
+    int err = asset_index_load(indexPath.UTF8String, &assets);
+    if (err) {
+        [self finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to parse %@: %s", indexPath.lastPathComponent, strerror(err)]];
+        return nil;
+    }
+    // Packed objects are served to the game from the pack, they have no loose copy
+    asset_pack_t pack = {0};
+    NSString *packDir = [NSString stringWithFormat:@"%s/assets", getenv("POJAV_GAME_DIR")];
+    BOOL usePack = getPrefBool(@"general.packed_assets") && !assets.map_to_resources &&
+        [NSFileManager.defaultManager createDirectoryAtPath:packDir withIntermediateDirectories:YES attributes:nil error:nil] &&
+        asset_pack_open(packDir.UTF8String, &pack) == 0;
+    NSString *incomingDir = [packDir stringByAppendingPathComponent:@"incoming"];
+    char hash[41];
+    for (size_t i = 0; i < assets.count; i++) {
+        asset_object_t *object = &assets.objects[i];
+        NSString *name = @(asset_object_name(&assets, object));
+        asset_object_hash_hex(object, hash);
+        NSString *pathname = [NSString stringWithFormat:@"%.2s/%s", hash, hash];
+        NSUInteger size = object->size;
 
         NSString *path;
-        if ([assets[@"map_to_resources"] boolValue]) {
+        if (assets.map_to_resources) {
             path = [NSString stringWithFormat:@"%s/resources/%@", getenv("POJAV_GAME_DIR"), name];
         } else {
             path = [NSString stringWithFormat:@"%s/assets/objects/%@", getenv("POJAV_GAME_DIR"), pathname];
@@ -228,14 +392,52 @@
             continue;
         }
 
+        void (^success)() = nil;
+        if (usePack) {
+            uint64_t packedSize;
+            if (asset_pack_find(&pack, object->hash, &packedSize) && packedSize == size) {
+                // Verified in the mapped pack, without opening a file per object
+                if (!getPrefBool(@"general.check_sha") || asset_pack_verify(&pack, object->hash)) {
+                    continue;
+                }
+                NSLog(@"[MCDL] Packed copy of %@ is damaged, downloading it again", name);
+            } else {
+                // Left loose by the migration since it is shared, see asset_pack_import_loose
+                struct stat st;
+                if (stat(path.fileSystemRepresentation, &st) == 0 && (NSUInteger)st.st_size == size &&
+                    [self checkSHA:@(hash) forFile:path altName:name]) {
+                    continue;
+                }
+            }
+            // Downloaded next to the pack and appended, the copy in the pack is the only one
+            NSString *incomingPath = [incomingDir stringByAppendingPathComponent:@(hash)];
+            NSData *objectHash = [NSData dataWithBytes:object->hash length:sizeof(object->hash)];
+            success = ^{
+                int packErr = asset_pack_append_file(packDir.UTF8String, objectHash.bytes, incomingPath.UTF8String);
+                if (packErr) {
+                    NSLog(@"[MCDL] Failed to pack %@: %s", name, strerror(packErr));
+                    // Still playable as a loose object
+                    [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+                    rename(incomingPath.fileSystemRepresentation, path.fileSystemRepresentation);
+                    return;
+                }
+                unlink(incomingPath.fileSystemRepresentation);
+            };
+            path = incomingPath;
+        }
+
         NSString *url = [NSString stringWithFormat:@"https://resources.download.minecraft.net/%@", pathname];
-        NSURLSessionDownloadTask *task = [self createDownloadTask:url size:size sha:hash altName:name toPath:path success:nil];
+        NSURLSessionDownloadTask *task = [self createDownloadTask:url size:size sha:@(hash) altName:name toPath:path success:success];
         if (task) {
             [tasks addObject:task];
         } else if (self.progress.cancelled) {
+            asset_pack_close(&pack);
+            asset_index_free(&assets);
             return nil;
         }
     }
+    asset_pack_close(&pack);
+    asset_index_free(&assets);
     return tasks;
 }
 
@@ -258,7 +460,7 @@
             }
             [libTasks makeObjectsPerformSelector:@selector(resume)];
             [assetTasks makeObjectsPerformSelector:@selector(resume)];
-            [self.metadata removeObjectForKey:@"assetIndexObj"];
+            [self.metadata removeObjectForKey:@"assetIndexPath"];
         }];
     }];
 }
@@ -267,6 +469,8 @@
 
 - (void)downloadModpackFromAPI:(ModpackAPI *)api detail:(NSDictionary *)modDetail atIndex:(NSUInteger)selectedVersion {
     [self prepareForDownload];
+    // Held until the install pipeline has written the profile
+    self.progress.totalUnitCount = 1;
 
     NSString *url = modDetail[@"versionUrls"][selectedVersion];
     NSUInteger size = [modDetail[@"versionSizes"][selectedVersion] unsignedLongLongValue];
@@ -312,6 +516,14 @@
     [self finishDownloadWithErrorString:errorStr];
 }
 
+// Share a verified file with other instances
+- (void)storeFile:(NSString *)path sha:(NSString *)sha {
+    // Unverified content must never be keyed by its expected hash
+    if (sha.length > 0 && getPrefBool(@"general.check_sha")) {
+        [PLContentStore.sharedStore ingestFile:path hash:sha];
+    }
+}
+
 // Check if the account has permission to download
 - (BOOL)checkAccessWithDialog:(BOOL)show {
     // for now
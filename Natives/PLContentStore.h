@@ -0,0 +1,30 @@
+#import <Foundation/Foundation.h>
+
+// Content-addressed blob store shared by every instance and modpack.
+// Blobs live under $POJAV_HOME/store/sha1/<xx>/<hash> and are materialised
+// into instances as hardlinks, so the link count doubles as a reference count.
+// Only files nothing edits in place are stored, jars and asset objects, as
+// an edit through one link would change the blob for every instance.
+@interface PLContentStore : NSObject
+
+@property(nonatomic, readonly) NSString *rootPath;
+
++ (PLContentStore *)sharedStore;
+
+// Returns nil if the hash is not a SHA-1 hex digest
+- (NSString *)pathForHash:(NSString *)hash;
+// Whether files at path can be shared through the store
+- (BOOL)canStorePath:(NSString *)path;
+- (BOOL)containsHash:(NSString *)hash;
+
+// Places the blob at path, replacing any existing file. Returns NO for paths
+// that can't be stored
+- (BOOL)materializeHash:(NSString *)hash toPath:(NSString *)path;
+// Adopts an already verified file, deduplicating it against an existing blob
+- (BOOL)ingestFile:(NSString *)path hash:(NSString *)hash;
+- (void)removeHash:(NSString *)hash;
+
+// Removes blobs which are no longer linked into any instance
+- (void)collectGarbage;
+
+@end
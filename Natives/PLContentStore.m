@@ -0,0 +1,121 @@
+#include <errno.h>
+#include <stdio.h>
+#include <sys/clonefile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#import "PLContentStore.h"
+#import "utils.h"
+
+#define fm NSFileManager.defaultManager
+
+@interface PLContentStore()
+@property(nonatomic) NSString *rootPath;
+@end
+
+@implementation PLContentStore
+
++ (PLContentStore *)sharedStore {
+    static PLContentStore *store;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        store = [PLContentStore new];
+        store.rootPath = [@(getenv("POJAV_HOME")) stringByAppendingPathComponent:@"store"];
+    });
+    return store;
+}
+
+- (NSString *)pathForHash:(NSString *)hash {
+    if (hash.length != 40) {
+        return nil;
+    }
+    hash = hash.lowercaseString;
+    NSCharacterSet *nonHex = [NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdef"].invertedSet;
+    if ([hash rangeOfCharacterFromSet:nonHex].location != NSNotFound) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@/sha1/%@/%@", self.rootPath, [hash substringToIndex:2], hash];
+}
+
+- (BOOL)canStorePath:(NSString *)path {
+    // Configs, version jsons and the like get edited, and hardlinks share the edit
+    return [path.pathExtension isEqualToString:@"jar"] ||
+        [path.stringByDeletingLastPathComponent.stringByDeletingLastPathComponent hasSuffix:@"/assets/objects"];
+}
+
+- (BOOL)containsHash:(NSString *)hash {
+    NSString *blobPath = [self pathForHash:hash];
+    return blobPath && access(blobPath.UTF8String, F_OK) == 0;
+}
+
+- (BOOL)materializeHash:(NSString *)hash toPath:(NSString *)path {
+    NSString *blobPath = [self pathForHash:hash];
+    if (!blobPath || ![self canStorePath:path] || access(blobPath.UTF8String, F_OK) != 0) {
+        return NO;
+    }
+
+    [fm createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+    // Link next to the destination first, so the final replacement is a single rename
+    NSString *tmpPath = [path stringByAppendingFormat:@".%@.tmp", NSUUID.UUID.UUIDString];
+    if (link(blobPath.UTF8String, tmpPath.UTF8String) != 0 &&
+        clonefile(blobPath.UTF8String, tmpPath.UTF8String, 0) != 0 &&
+        ![fm copyItemAtPath:blobPath toPath:tmpPath error:nil]) {
+        NSLog(@"[ContentStore] Failed to materialize %@: %s", path.lastPathComponent, strerror(errno));
+        return NO;
+    }
+    if (rename(tmpPath.UTF8String, path.UTF8String) != 0) {
+        unlink(tmpPath.UTF8String);
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)ingestFile:(NSString *)path hash:(NSString *)hash {
+    NSString *blobPath = [self pathForHash:hash];
+    struct stat fileStat, blobStat;
+    if (!blobPath || ![self canStorePath:path] || stat(path.UTF8String, &fileStat) != 0) {
+        return NO;
+    }
+
+    if (stat(blobPath.UTF8String, &blobStat) == 0) {
+        if (fileStat.st_dev == blobStat.st_dev && fileStat.st_ino == blobStat.st_ino) {
+            // Already linked
+            return YES;
+        }
+        // Another instance stored the same content, drop our copy in favor of it
+        return [self materializeHash:hash toPath:path];
+    }
+
+    [fm createDirectoryAtPath:blobPath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+    return link(path.UTF8String, blobPath.UTF8String) == 0 || errno == EEXIST;
+}
+
+- (void)removeHash:(NSString *)hash {
+    NSString *blobPath = [self pathForHash:hash];
+    if (blobPath) {
+        unlink(blobPath.UTF8String);
+    }
+}
+
+- (void)collectGarbage {
+    NSDirectoryEnumerator *enumerator = [fm enumeratorAtPath:self.rootPath];
+    NSUInteger removedCount = 0;
+    unsigned long long removedSize = 0;
+    for (NSString *relPath in enumerator) {
+        NSString *blobPath = [self.rootPath stringByAppendingPathComponent:relPath];
+        struct stat blobStat;
+        if (lstat(blobPath.UTF8String, &blobStat) != 0 || !S_ISREG(blobStat.st_mode)) {
+            continue;
+        }
+        // The store itself holds one link, anything above that is an instance file
+        if (blobStat.st_nlink <= 1 && unlink(blobPath.UTF8String) == 0) {
+            removedCount++;
+            removedSize += blobStat.st_size;
+        }
+    }
+    if (removedCount > 0) {
+        NSLog(@"[ContentStore] Removed %lu unreferenced blobs (%llu bytes)", (unsigned long)removedCount, removedSize);
+    }
+}
+
+@end
@@ -0,0 +1,14 @@
+#import <Foundation/Foundation.h>
+
+// Size-bounded key/value store under $POJAV_HOME/cache/<name>. Reads refresh
+// an entry's access time, writes evict the least recently used entries once
+// the cache grows past its capacity. Safe to use from any thread.
+@interface PLDiskCache : NSObject
+
+- (instancetype)initWithName:(NSString *)name capacity:(NSUInteger)capacity;
+
+// Returns nil if there is no entry or it was written more than maxAge ago, 0 never expires
+- (NSData *)dataForKey:(NSString *)key maxAge:(NSTimeInterval)maxAge;
+- (void)setData:(NSData *)data forKey:(NSString *)key;
+
+@end
@@ -0,0 +1,117 @@
+#include <CommonCrypto/CommonDigest.h>
+
+#import "PLDiskCache.h"
+
+#define fm NSFileManager.defaultManager
+
+// Evict down to this fraction of the capacity, so a full cache doesn't trim on every write
+static const double kDiskCacheTrimRatio = 0.8;
+
+@interface PLDiskCache()
+@property(nonatomic) NSString *rootPath;
+@property(nonatomic) NSUInteger capacity;
+@property(nonatomic) dispatch_queue_t queue;
+// file name -> {size, accessedAt}, built from the directory on first use
+@property(nonatomic) NSMutableDictionary<NSString *, NSMutableDictionary *> *entries;
+@property(nonatomic) NSUInteger totalSize;
+@end
+
+@implementation PLDiskCache
+
+- (instancetype)initWithName:(NSString *)name capacity:(NSUInteger)capacity {
+    self = [super init];
+    self.rootPath = [NSString stringWithFormat:@"%s/cache/%@", getenv("POJAV_HOME"), name];
+    self.capacity = capacity;
+    self.queue = dispatch_queue_create("net.kdt.pojavlauncher.diskcache", DISPATCH_QUEUE_SERIAL);
+    [fm createDirectoryAtPath:self.rootPath withIntermediateDirectories:YES attributes:nil error:nil];
+    return self;
+}
+
+- (NSString *)fileNameForKey:(NSString *)key {
+    NSData *data = [key dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *name = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [name appendFormat:@"%02x", digest[i]];
+    }
+    return name;
+}
+
+// Called on queue
+- (void)loadEntries {
+    if (self.entries) {
+        return;
+    }
+    self.entries = [NSMutableDictionary new];
+    NSArray<NSURL *> *files = [fm contentsOfDirectoryAtURL:[NSURL fileURLWithPath:self.rootPath]
+        includingPropertiesForKeys:@[NSURLFileSizeKey, NSURLContentAccessDateKey] options:0 error:nil];
+    for (NSURL *file in files) {
+        NSDictionary *values = [file resourceValuesForKeys:@[NSURLFileSizeKey, NSURLContentAccessDateKey] error:nil];
+        NSUInteger size = [values[NSURLFileSizeKey] unsignedLongValue];
+        self.entries[file.lastPathComponent] = @{
+            @"size": @(size),
+            @"accessedAt": @([values[NSURLContentAccessDateKey] timeIntervalSince1970])
+        }.mutableCopy;
+        self.totalSize += size;
+    }
+}
+
+- (NSData *)dataForKey:(NSString *)key maxAge:(NSTimeInterval)maxAge {
+    NSString *name = [self fileNameForKey:key];
+    NSString *path = [self.rootPath stringByAppendingPathComponent:name];
+    __block NSData *data;
+    dispatch_sync(self.queue, ^{
+        [self loadEntries];
+        if (!self.entries[name]) {
+            return;
+        }
+        NSDate *modified = [fm attributesOfItemAtPath:path error:nil].fileModificationDate;
+        if (maxAge > 0 && (!modified || -modified.timeIntervalSinceNow > maxAge)) {
+            return;
+        }
+        data = [NSData dataWithContentsOfFile:path];
+        NSDate *now = NSDate.date;
+        self.entries[name][@"accessedAt"] = @(now.timeIntervalSince1970);
+        // Keeps the order across launches, the filesystem may not track access times itself
+        [[NSURL fileURLWithPath:path] setResourceValue:now forKey:NSURLContentAccessDateKey error:nil];
+    });
+    return data;
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key {
+    NSString *name = [self fileNameForKey:key];
+    dispatch_async(self.queue, ^{
+        [self loadEntries];
+        if (![data writeToFile:[self.rootPath stringByAppendingPathComponent:name] atomically:YES]) {
+            return;
+        }
+        self.totalSize -= [self.entries[name][@"size"] unsignedLongValue];
+        self.totalSize += data.length;
+        self.entries[name] = @{
+            @"size": @(data.length),
+            @"accessedAt": @(NSDate.date.timeIntervalSince1970)
+        }.mutableCopy;
+        if (self.totalSize > self.capacity) {
+            [self trim];
+        }
+    });
+}
+
+// Called on queue
+- (void)trim {
+    NSArray<NSString *> *names = [self.entries keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *a, NSDictionary *b) {
+        return [a[@"accessedAt"] compare:b[@"accessedAt"]];
+    }];
+    NSUInteger target = self.capacity * kDiskCacheTrimRatio;
+    for (NSString *name in names) {
+        if (self.totalSize <= target) {
+            break;
+        }
+        [fm removeItemAtPath:[self.rootPath stringByAppendingPathComponent:name] error:nil];
+        self.totalSize -= [self.entries[name][@"size"] unsignedLongValue];
+        [self.entries removeObjectForKey:name];
+    }
+}
+
+@end
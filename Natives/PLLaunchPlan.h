@@ -0,0 +1,18 @@
+#import <Foundation/Foundation.h>
+
+// Resolved launch data stored in versions/<id>/launch_plan.json, keyed by the
+// SHA-1 of every version json it was derived from and the game directory its
+// paths were resolved against. The "native" section holds
+// the merged and tweaked metadata, the "jvm" section is owned by the Java side.
+@interface PLLaunchPlan : NSObject
+
+// Returns nil if there is no plan, any of its input files changed or the game directory moved
++ (NSMutableDictionary *)loadMetadataForVersion:(NSString *)versionId;
+// version id -> SHA-1 of its json, nil if there is no plan or any of its input files changed
++ (NSDictionary<NSString *, NSString *> *)inputsForVersion:(NSString *)versionId;
+// Game class path resolved by the Java side, nil until the game was launched with this plan
++ (NSArray<NSString *> *)classpathForVersion:(NSString *)versionId;
+// inputs lists the version ids whose json files were read to build metadata
++ (void)saveMetadata:(NSDictionary *)metadata forVersion:(NSString *)versionId inputs:(NSArray<NSString *> *)inputs;
+
+@end
@@ -0,0 +1,104 @@
+#include <CommonCrypto/CommonDigest.h>
+
+#import "PLLaunchPlan.h"
+#import "utils.h"
+
+// Bump whenever processVersion/tweakVersionJson change their output
+#define LAUNCH_PLAN_FORMAT_VERSION 2
+
+@implementation PLLaunchPlan
+
++ (NSString *)pathForVersion:(NSString *)versionId file:(NSString *)name {
+    return [NSString stringWithFormat:@"%s/versions/%@/%@", getenv("POJAV_GAME_DIR"), versionId, name];
+}
+
++ (NSString *)hashOfVersionJson:(NSString *)versionId {
+    NSString *path = [self pathForVersion:versionId file:[versionId stringByAppendingPathExtension:@"json"]];
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        return nil;
+    }
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [hash appendFormat:@"%02x", digest[i]];
+    }
+    return hash;
+}
+
++ (NSString *)gameDirectory {
+    return @(getenv("POJAV_GAME_DIR"));
+}
+
++ (NSMutableDictionary *)loadPlanForVersion:(NSString *)versionId {
+    NSData *data = [NSData dataWithContentsOfFile:[self pathForVersion:versionId file:@"launch_plan.json"]];
+    if (!data) {
+        return nil;
+    }
+    NSMutableDictionary *plan = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingMutableContainers error:nil];
+    if (![plan isKindOfClass:NSDictionary.class] || [plan[@"formatVersion"] intValue] != LAUNCH_PLAN_FORMAT_VERSION) {
+        return nil;
+    }
+    // Resolved paths point into the game directory, which moves when the
+    // app is reinstalled or another directory is selected
+    if (![plan[@"root"] isEqual:self.gameDirectory]) {
+        return nil;
+    }
+    NSDictionary *inputs = plan[@"inputs"];
+    if (![inputs isKindOfClass:NSDictionary.class] || inputs.count == 0) {
+        return nil;
+    }
+    for (NSString *inputId in inputs) {
+        if (![inputs[inputId] isEqualToString:[self hashOfVersionJson:inputId]]) {
+            return nil;
+        }
+    }
+    return plan;
+}
+
++ (NSMutableDictionary *)loadMetadataForVersion:(NSString *)versionId {
+    NSMutableDictionary *plan = [self loadPlanForVersion:versionId];
+    if ([plan[@"native"] isKindOfClass:NSMutableDictionary.class]) {
+        NSDebugLog(@"[LaunchPlan] Using cached launch plan for %@", versionId);
+        return plan[@"native"];
+    }
+    return nil;
+}
+
++ (NSDictionary<NSString *, NSString *> *)inputsForVersion:(NSString *)versionId {
+    return [self loadPlanForVersion:versionId][@"inputs"];
+}
+
++ (NSArray<NSString *> *)classpathForVersion:(NSString *)versionId {
+    NSDictionary *jvm = [self loadPlanForVersion:versionId][@"jvm"];
+    NSArray *classpath = [jvm isKindOfClass:NSDictionary.class] ? jvm[@"classpath"] : nil;
+    return [classpath isKindOfClass:NSArray.class] ? classpath : nil;
+}
+
++ (void)saveMetadata:(NSDictionary *)metadata forVersion:(NSString *)versionId inputs:(NSArray<NSString *> *)inputs {
+    NSMutableDictionary *inputHashes = [NSMutableDictionary new];
+    for (NSString *inputId in inputs) {
+        NSString *hash = [self hashOfVersionJson:inputId];
+        if (!hash) return;
+        inputHashes[inputId] = hash;
+    }
+
+    NSMutableDictionary *plan = [self loadPlanForVersion:versionId];
+    if (![plan[@"inputs"] isEqualToDictionary:inputHashes]) {
+        // The JVM section was derived from other inputs, drop it
+        plan = [NSMutableDictionary new];
+    }
+    plan[@"formatVersion"] = @(LAUNCH_PLAN_FORMAT_VERSION);
+    plan[@"root"] = self.gameDirectory;
+    plan[@"inputs"] = inputHashes;
+    plan[@"native"] = metadata;
+
+    NSError *error;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:plan options:0 error:&error];
+    if (!data || ![data writeToFile:[self pathForVersion:versionId file:@"launch_plan.json"] options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"[LaunchPlan] Failed to save launch plan for %@: %@", versionId, error.localizedDescription);
+    }
+}
+
+@end
@@ -3,6 +3,8 @@
 @interface PLLogOutputView : UIView
 - (void)actionStartStopLogOutput;
 - (void)actionToggleLogOutput;
+// Safe to call from any thread, chunks don't need to end at a line break
++ (void)appendBytes:(const char *)bytes length:(size_t)length;
 + (void)appendToLog:(NSString *)line;
 + (void)handleExitCode:(int)code;
 @end
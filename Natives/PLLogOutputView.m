@@ -1,23 +1,50 @@
+#include <stdatomic.h>
+
 #import "PLLogOutputView.h"
 #import "SurfaceViewController.h"
 #import "utils.h"
 
-@interface PLLogOutputView()<UITableViewDataSource, UITableViewDelegate>
+#include "log_lines.h"
+
+// Lines kept for the console, latestlog.txt has the full log
+#define LOG_VIEW_MAX_LINES 10000
+#define LOG_VIEW_ARENA_SIZE (2 * 1024 * 1024)
+
+@interface PLLogOutputView()<UISearchBarDelegate, UITableViewDataSource, UITableViewDelegate>
 @property(nonatomic) UITableView* logTableView;
 @property(nonatomic) UINavigationBar* navigationBar;
+@property(nonatomic) CADisplayLink* displayLink;
+// Rows map to line ids, or to match indices while filtering, starting at rowFirst.
+// Both are only updated once per frame so the table stays consistent in between
+@property(nonatomic) uint64_t rowFirst;
+@property(nonatomic) NSInteger rowCount;
 @end
 
 @implementation PLLogOutputView
 static BOOL fatalErrorOccurred;
-static NSMutableArray* logLines;
+static log_lines_t logStore;
 static PLLogOutputView* current;
+// Set while a refresh is scheduled for the next frame
+static atomic_bool refreshPending;
+// The filter shown by the table, only touched on the main thread
+static log_filter_t *displayedFilter;
+// The filter being scanned, only touched on filterQueue
+static log_filter_t *scanningFilter;
+static atomic_bool filterUpdatePending;
+static dispatch_queue_t filterQueue;
+
++ (void)initialize {
+    if (self != PLLogOutputView.class) return;
+    log_lines_init(&logStore, LOG_VIEW_MAX_LINES, LOG_VIEW_ARENA_SIZE);
+    filterQueue = dispatch_queue_create("net.kdt.pojavlauncher.logfilter", DISPATCH_QUEUE_SERIAL);
+}
 
 - (instancetype)initWithFrame:(CGRect)frame {
     frame.origin.y = frame.size.height;
     self = [super initWithFrame:frame];
     frame.origin.y = 0;
 
-    logLines = [NSMutableArray new];
+    log_lines_clear(&logStore);
     self.backgroundColor = [UIColor colorWithWhite:0 alpha:0.5];
     self.hidden = YES;
 
@@ -45,9 +72,23 @@ static PLLogOutputView* current;
     self.logTableView.rowHeight = 20;
     self.logTableView.separatorInset = UIEdgeInsetsZero;
     self.logTableView.separatorStyle = UITableViewCellSeparatorStyleNone;
+    UISearchBar *searchBar = [[UISearchBar alloc] initWithFrame:CGRectMake(0, 0, frame.size.width, 44)];
+    searchBar.delegate = self;
+    searchBar.placeholder = localize(@"game.log.filter", nil);
+    searchBar.searchBarStyle = UISearchBarStyleMinimal;
+    self.logTableView.tableHeaderView = searchBar;
     [self addSubview:self.logTableView];
     [self addSubview:self.navigationBar];
 
+    // Table updates are coalesced to one per frame, the link only runs while one is pending
+    __weak PLLogOutputView *weakSelf = self;
+    id refresh = ^{
+        [weakSelf refreshFromDisplayLink];
+    };
+    self.displayLink = [CADisplayLink displayLinkWithTarget:refresh selector:@selector(invoke)];
+    self.displayLink.paused = YES;
+    [self.displayLink addToRunLoop:NSRunLoop.mainRunLoop forMode:NSRunLoopCommonModes];
+
     canAppendToLog = YES;
     [self actionStartStopLogOutput];
 
@@ -55,8 +96,113 @@ static PLLogOutputView* current;
     return self;
 }
 
+- (void)removeFromSuperview {
+    [super removeFromSuperview];
+    [self.displayLink invalidate];
+}
+
+- (void)refreshFromDisplayLink {
+    atomic_store(&refreshPending, false);
+    self.displayLink.paused = YES;
+    if (!self.hidden) {
+        [self refreshLogRows];
+    }
+}
+
+// Only the visible rows are configured: the count changes go through
+// reloadData, which with a fixed row height only touches visible cells
+- (void)refreshLogRows {
+    uint64_t first, next;
+    if (displayedFilter) {
+        log_filter_range(displayedFilter, &first, &next);
+    } else {
+        log_lines_range(&logStore, &first, &next);
+    }
+    UITableView *tableView = self.logTableView;
+    CGFloat rowHeight = tableView.rowHeight;
+    CGFloat maxOffset = tableView.contentSize.height + tableView.adjustedContentInset.bottom - tableView.bounds.size.height;
+    BOOL atBottom = tableView.contentOffset.y >= maxOffset - rowHeight;
+    uint64_t evicted = first - self.rowFirst;
+    BOOL changed = first != self.rowFirst || next - first != self.rowCount;
+    self.rowFirst = first;
+    self.rowCount = next - first;
+
+    UIView.animationsEnabled = NO;
+    if (changed) {
+        CGPoint offset = tableView.contentOffset;
+        [tableView reloadData];
+        if (!atBottom && evicted > 0) {
+            // Keep the lines being read in place while older ones drop off
+            offset.y = MAX(offset.y - evicted * rowHeight, -tableView.adjustedContentInset.top);
+            tableView.contentOffset = offset;
+        }
+    } else {
+        // Only the incomplete last line can change in place
+        [tableView reloadRowsAtIndexPaths:tableView.indexPathsForVisibleRows withRowAnimation:UITableViewRowAnimationNone];
+    }
+    UIView.animationsEnabled = YES;
+
+    if (atBottom && self.rowCount > 0) {
+        [tableView
+            scrollToRowAtIndexPath:[NSIndexPath indexPathForRow:self.rowCount - 1 inSection:0]
+            atScrollPosition:UITableViewScrollPositionBottom animated:NO];
+    }
+}
+
++ (void)scheduleRefresh {
+    if (atomic_exchange(&refreshPending, true)) return;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        current.displayLink.paused = NO;
+    });
+}
+
++ (void)scheduleFilterUpdate {
+    if (atomic_exchange(&filterUpdatePending, true)) return;
+    dispatch_async(filterQueue, ^{
+        atomic_store(&filterUpdatePending, false);
+        if (!scanningFilter) return;
+        BOOL scanned = NO;
+        while (log_filter_update(scanningFilter, &logStore, 256) > 0) {
+            scanned = YES;
+        }
+        if (scanned) {
+            [self scheduleRefresh];
+        }
+    });
+}
+
+- (void)searchBar:(UISearchBar *)searchBar textDidChange:(NSString *)searchText {
+    log_filter_t *filter = NULL;
+    if (searchText.length > 0) {
+        filter = malloc(sizeof(log_filter_t));
+        if (log_filter_init(filter, searchText.UTF8String, LOG_VIEW_MAX_LINES) != 0) {
+            free(filter);
+            filter = NULL;
+        }
+    }
+    displayedFilter = filter;
+    dispatch_async(filterQueue, ^{
+        // The table has moved on to the new filter by now
+        if (scanningFilter) {
+            log_filter_free(scanningFilter);
+            free(scanningFilter);
+        }
+        scanningFilter = filter;
+    });
+    [PLLogOutputView scheduleFilterUpdate];
+    // Shows the empty result right away, matches follow as they are found
+    self.rowFirst = 0;
+    self.rowCount = 0;
+    [self.logTableView reloadData];
+    [PLLogOutputView scheduleRefresh];
+}
+
+- (void)searchBarSearchButtonClicked:(UISearchBar *)searchBar {
+    [searchBar resignFirstResponder];
+}
+
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
-    return logLines.count;
+    return self.rowCount;
 }
 
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath {
@@ -69,7 +215,14 @@ static PLLogOutputView* current;
         cell.textLabel.font = [UIFont fontWithName:@"Menlo-Regular" size:16];
         cell.textLabel.textColor = UIColor.whiteColor;
     }
-    cell.textLabel.text = logLines[indexPath.row];
+    uint64_t lineId = self.rowFirst + indexPath.row;
+    char line[LOG_LINES_MAX_LINE + 1];
+    if ((displayedFilter && !log_filter_get(displayedFilter, lineId, &lineId)) ||
+        !log_lines_get(&logStore, lineId, line, sizeof(line))) {
+        // Dropped since the last refresh
+        line[0] = '\0';
+    }
+    cell.textLabel.text = @(line) ?: [NSString stringWithCString:line encoding:NSISOLatin1StringEncoding];
 
     return cell;
 }
@@ -99,8 +252,9 @@ static PLLogOutputView* current;
 }
 
 - (void)actionClearLogOutput {
-    [logLines removeAllObjects];
-    [self.logTableView reloadData];
+    log_lines_clear(&logStore);
+    [PLLogOutputView scheduleFilterUpdate];
+    [self refreshLogRows];
 }
 
 - (void)actionShareLatestlog {
@@ -132,41 +286,26 @@ static PLLogOutputView* current;
     [UIView transitionWithView:self duration:0.4 options:UIViewAnimationOptionCurveEaseOut animations:^(void){
         CGRect frame = self.frame;
         frame.origin.y = self.hidden ? 0 : frame.size.height;
-        self.hidden = NO;
+        if (self.hidden) {
+            // Frames are skipped while hidden
+            self.hidden = NO;
+            [self refreshLogRows];
+        }
         self.frame = frame;
     } completion: ^(BOOL finished) {
         self.hidden = self.frame.origin.y != 0;
     }];
 }
 
-+ (void)_appendToLog:(NSString *)line {
-    if (line.length == 0) {
-        return;
-    }
-
-    NSIndexPath *indexPath = [NSIndexPath indexPathForRow:logLines.count inSection:0];
-    [logLines addObject:line];
-    UIView.animationsEnabled = NO;
-    [current.logTableView beginUpdates];
-    [current.logTableView
-        insertRowsAtIndexPaths:@[indexPath]
-        withRowAnimation:UITableViewRowAnimationNone];
-    [current.logTableView endUpdates];
-    UIView.animationsEnabled = YES;
-
-    [current.logTableView 
-        scrollToRowAtIndexPath:indexPath
-        atScrollPosition:UITableViewScrollPositionBottom animated:NO];
++ (void)appendBytes:(const char *)bytes length:(size_t)length {
+    log_lines_append(&logStore, bytes, length);
+    [self scheduleFilterUpdate];
+    [self scheduleRefresh];
 }
 
 + (void)appendToLog:(NSString *)string {
-    dispatch_async(dispatch_get_main_queue(), ^(void){
-        NSArray *lines = [string componentsSeparatedByCharactersInSet:
-            NSCharacterSet.newlineCharacterSet];
-        for (NSString *line in lines) {
-            [self _appendToLog:line];
-        }
-    });
+    const char *bytes = string.UTF8String;
+    [self appendBytes:bytes length:strlen(bytes)];
 }
 
 + (void)handleExitCode:(int)code {
@@ -192,7 +331,7 @@ static PLLogOutputView* current;
             return;
         }
         [current actionClearLogOutput];
-        [self _appendToLog:@"... (latestlog.txt)"];
+        [self appendToLog:@"... (latestlog.txt)\n"];
         NSString *latestlogPath = [NSString stringWithFormat:@"%s/latestlog.txt", getenv("POJAV_HOME")];
         NSString *linesStr = [NSString stringWithContentsOfFile:latestlogPath
             encoding:NSUTF8StringEncoding error:nil];
@@ -200,9 +339,9 @@ static PLLogOutputView* current;
             NSCharacterSet.newlineCharacterSet];
 
         // Print last 100 lines from latestlog.txt
-        for (int i = MAX(lines.count-100, 0); i < lines.count; i++) {
-            [self _appendToLog:lines[i]];
-        }
+        NSRange range = NSMakeRange(MAX((NSInteger)lines.count - 100, 0), 0);
+        range.length = lines.count - range.location;
+        [self appendToLog:[[lines subarrayWithRange:range] componentsJoinedByString:@"\n"]];
 
         fatalErrorOccurred = YES;
     });
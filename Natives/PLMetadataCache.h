@@ -0,0 +1,19 @@
+#import <Foundation/Foundation.h>
+
+// On-disk cache for small metadata documents (version manifests, loader
+// lists, maven-metadata.xml). Cached bodies are served immediately and
+// revalidated in the background with If-None-Match/If-Modified-Since, so
+// the launcher stays usable offline.
+@interface PLMetadataCache : NSObject
+
+@property(nonatomic, readonly) NSString *rootPath;
+
++ (PLMetadataCache *)sharedCache;
+
+// The handler is called on the main queue: once with the cached body, if any,
+// and again only when the server returns different content. An error is
+// passed only when there is nothing to serve at all.
+- (void)fetchURL:(NSString *)url handler:(void (^)(NSData *data, NSError *error))handler;
+- (void)fetchJSONFromURL:(NSString *)url handler:(void (^)(id response, NSError *error))handler;
+
+@end
@@ -0,0 +1,129 @@
+#include <CommonCrypto/CommonDigest.h>
+
+#import "PLMetadataCache.h"
+
+#define fm NSFileManager.defaultManager
+
+// Entries revalidated within this interval are served without a request
+static const NSTimeInterval kMetadataFreshInterval = 300;
+
+@interface PLMetadataCache()
+@property(nonatomic) NSString *rootPath;
+@property(nonatomic) NSURLSession *session;
+@property(nonatomic) dispatch_queue_t queue;
+@end
+
+@implementation PLMetadataCache
+
++ (PLMetadataCache *)sharedCache {
+    static PLMetadataCache *cache;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        cache = [PLMetadataCache new];
+        cache.rootPath = [@(getenv("POJAV_HOME")) stringByAppendingPathComponent:@"cache/http"];
+        [fm createDirectoryAtPath:cache.rootPath withIntermediateDirectories:YES attributes:nil error:nil];
+        // Revalidation is done by hand, keep NSURLCache from answering for us
+        NSURLSessionConfiguration *config = NSURLSessionConfiguration.defaultSessionConfiguration;
+        config.URLCache = nil;
+        config.requestCachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        cache.session = [NSURLSession sessionWithConfiguration:config];
+        cache.queue = dispatch_queue_create("net.kdt.pojavlauncher.metadatacache", DISPATCH_QUEUE_SERIAL);
+    });
+    return cache;
+}
+
+- (NSString *)basePathForURL:(NSString *)url {
+    NSData *data = [url dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *key = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [key appendFormat:@"%02x", digest[i]];
+    }
+    return [self.rootPath stringByAppendingPathComponent:key];
+}
+
+- (void)writeMetadata:(NSDictionary *)metadata toPath:(NSString *)basePath {
+    NSData *data = [NSJSONSerialization dataWithJSONObject:metadata options:0 error:nil];
+    [data writeToFile:[basePath stringByAppendingPathExtension:@"json"] atomically:YES];
+}
+
+- (void)fetchURL:(NSString *)url handler:(void (^)(NSData *data, NSError *error))handler {
+    dispatch_async(self.queue, ^{
+        NSString *basePath = [self basePathForURL:url];
+        NSString *bodyPath = [basePath stringByAppendingPathExtension:@"body"];
+        NSData *metadataData = [NSData dataWithContentsOfFile:[basePath stringByAppendingPathExtension:@"json"]];
+        NSDictionary *metadata = metadataData ? [NSJSONSerialization JSONObjectWithData:metadataData options:0 error:nil] : nil;
+        NSData *cached = metadata ? [NSData dataWithContentsOfFile:bodyPath] : nil;
+        if (cached) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                handler(cached, nil);
+            });
+            if (NSDate.date.timeIntervalSince1970 - [metadata[@"fetchedAt"] doubleValue] < kMetadataFreshInterval) {
+                return;
+            }
+        }
+
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:url]];
+        if (cached && metadata[@"etag"]) {
+            [request setValue:metadata[@"etag"] forHTTPHeaderField:@"If-None-Match"];
+        }
+        if (cached && metadata[@"lastModified"]) {
+            [request setValue:metadata[@"lastModified"] forHTTPHeaderField:@"If-Modified-Since"];
+        }
+        [[self.session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+            NSInteger status = httpResponse.statusCode;
+            if (!error && (status == 304 || (status >= 200 && status < 300))) {
+                dispatch_async(self.queue, ^{
+                    NSMutableDictionary *newMetadata = [NSMutableDictionary new];
+                    newMetadata[@"url"] = url;
+                    newMetadata[@"fetchedAt"] = @(NSDate.date.timeIntervalSince1970);
+                    if (status == 304) {
+                        newMetadata[@"etag"] = metadata[@"etag"];
+                        newMetadata[@"lastModified"] = metadata[@"lastModified"];
+                        [self writeMetadata:newMetadata toPath:basePath];
+                        return;
+                    }
+                    newMetadata[@"etag"] = httpResponse.allHeaderFields[@"ETag"];
+                    newMetadata[@"lastModified"] = httpResponse.allHeaderFields[@"Last-Modified"];
+                    // Body first, so the metadata never describes a body we do not have
+                    [data writeToFile:bodyPath atomically:YES];
+                    [self writeMetadata:newMetadata toPath:basePath];
+                    if (![data isEqualToData:cached]) {
+                        dispatch_async(dispatch_get_main_queue(), ^{
+                            handler(data, nil);
+                        });
+                    }
+                });
+                return;
+            }
+
+            if (!error) {
+                error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:@{
+                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"%@: HTTP %ld %@", url, (long)status,
+                        [NSHTTPURLResponse localizedStringForStatusCode:status]]
+                }];
+            }
+            if (cached) {
+                NSLog(@"[MetadataCache] Serving cached %@: %@", url.lastPathComponent, error.localizedDescription);
+                return;
+            }
+            dispatch_async(dispatch_get_main_queue(), ^{
+                handler(nil, error);
+            });
+        }] resume];
+    });
+}
+
+- (void)fetchJSONFromURL:(NSString *)url handler:(void (^)(id response, NSError *error))handler {
+    [self fetchURL:url handler:^(NSData *data, NSError *error) {
+        id response = nil;
+        if (data) {
+            response = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+        }
+        handler(response, error);
+    }];
+}
+
+@end
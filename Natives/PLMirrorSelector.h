@@ -0,0 +1,23 @@
+#import <Foundation/Foundation.h>
+
+// Keeps time-to-first-byte samples per host so downloads can start from the
+// fastest source and fire a hedged request to the next one when the first
+// is slower than that host usually is.
+@interface PLMirrorSelector : NSObject
+
++ (PLMirrorSelector *)sharedSelector;
+
+// The given urls plus known mirrors of their hosts, fastest first. Hosts seen
+// for the first time are probed in the background for the next lookup.
+- (NSArray<NSString *> *)candidatesForURLs:(NSArray<NSString *> *)urls;
+
+- (void)recordLatency:(NSTimeInterval)latency forURL:(NSString *)url;
+- (void)recordFailureForURL:(NSString *)url;
+
+// How long to wait for the first byte before hedging, from the host's p90
+- (NSTimeInterval)hedgeDelayForURL:(NSString *)url;
+// Hedged requests in flight are capped so queued downloads can't fan out
+- (BOOL)beginHedge;
+- (void)endHedge;
+
+@end
@@ -0,0 +1,150 @@
+#import "LauncherPreferences.h"
+#import "PLMirrorSelector.h"
+
+// Samples kept per host
+#define MIRROR_SAMPLE_COUNT 32
+// Latency assumed for hosts without samples, and recorded for failed requests
+static const NSTimeInterval kMirrorUnknownLatency = 1.0;
+static const NSTimeInterval kMirrorFailureLatency = 10.0;
+// Used until a host has enough samples for a percentile
+static const NSTimeInterval kMirrorDefaultHedgeDelay = 2.0;
+static const NSUInteger kMirrorMaxHedges = 4;
+
+@interface PLMirrorSelector()
+// host -> recent time-to-first-byte samples, oldest first
+@property(nonatomic) NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *samples;
+@property(nonatomic) NSMutableSet<NSString *> *probedHosts;
+@property(nonatomic) NSURLSession *probeSession;
+@property(nonatomic) NSUInteger activeHedges;
+@end
+
+@implementation PLMirrorSelector
+
++ (PLMirrorSelector *)sharedSelector {
+    static PLMirrorSelector *selector;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        selector = [PLMirrorSelector new];
+        selector.samples = [NSMutableDictionary new];
+        selector.probedHosts = [NSMutableSet new];
+        NSURLSessionConfiguration *config = NSURLSessionConfiguration.ephemeralSessionConfiguration;
+        config.timeoutIntervalForRequest = kMirrorFailureLatency;
+        selector.probeSession = [NSURLSession sessionWithConfiguration:config];
+    });
+    return selector;
+}
+
+// Mirrors serving the same paths as Mojang's hosts, only used when enabled
++ (NSDictionary<NSString *, NSString *> *)mojangMirrors {
+    return @{
+        @"https://libraries.minecraft.net/": @"https://bmclapi2.bangbang93.com/maven/",
+        @"https://resources.download.minecraft.net/": @"https://bmclapi2.bangbang93.com/assets/"
+    };
+}
+
+- (NSArray<NSString *> *)candidatesForURLs:(NSArray<NSString *> *)urls {
+    NSMutableOrderedSet<NSString *> *candidates = [NSMutableOrderedSet orderedSetWithArray:urls];
+    if (getPrefBool(@"general.download_mirrors")) {
+        NSDictionary *mirrors = PLMirrorSelector.mojangMirrors;
+        for (NSString *url in urls) {
+            for (NSString *prefix in mirrors) {
+                if ([url hasPrefix:prefix]) {
+                    [candidates addObject:[mirrors[prefix] stringByAppendingString:[url substringFromIndex:prefix.length]]];
+                }
+            }
+        }
+    }
+    if (candidates.count < 2) {
+        return candidates.array;
+    }
+
+    NSMutableDictionary<NSString *, NSNumber *> *latencies = [NSMutableDictionary new];
+    for (NSString *url in candidates) {
+        latencies[url] = @([self estimatedLatencyForURL:url]);
+    }
+    // Stable, so unprobed hosts keep the order the source listed them in
+    return [candidates.array sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSString *a, NSString *b) {
+        return [latencies[a] compare:latencies[b]];
+    }];
+}
+
+- (NSTimeInterval)estimatedLatencyForURL:(NSString *)url {
+    NSString *host = [NSURL URLWithString:url].host;
+    if (!host) {
+        return kMirrorFailureLatency;
+    }
+    NSArray<NSNumber *> *sorted;
+    @synchronized (self) {
+        sorted = [self.samples[host] sortedArrayUsingSelector:@selector(compare:)];
+        if (sorted.count == 0 && ![self.probedHosts containsObject:host]) {
+            [self.probedHosts addObject:host];
+            [self probeURL:url];
+        }
+    }
+    return sorted.count ? sorted[sorted.count / 2].doubleValue : kMirrorUnknownLatency;
+}
+
+- (void)probeURL:(NSString *)url {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:url]];
+    request.HTTPMethod = @"HEAD";
+    NSDate *start = NSDate.date;
+    [[self.probeSession dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        if (error) {
+            [self recordFailureForURL:url];
+        } else {
+            [self recordLatency:-start.timeIntervalSinceNow forURL:url];
+        }
+    }] resume];
+}
+
+- (void)recordLatency:(NSTimeInterval)latency forURL:(NSString *)url {
+    NSString *host = [NSURL URLWithString:url].host;
+    if (!host) {
+        return;
+    }
+    @synchronized (self) {
+        NSMutableArray *hostSamples = self.samples[host];
+        if (!hostSamples) {
+            hostSamples = self.samples[host] = [NSMutableArray new];
+        }
+        [hostSamples addObject:@(latency)];
+        if (hostSamples.count > MIRROR_SAMPLE_COUNT) {
+            [hostSamples removeObjectAtIndex:0];
+        }
+    }
+}
+
+- (void)recordFailureForURL:(NSString *)url {
+    [self recordLatency:kMirrorFailureLatency forURL:url];
+}
+
+- (NSTimeInterval)hedgeDelayForURL:(NSString *)url {
+    NSString *host = [NSURL URLWithString:url].host;
+    NSArray<NSNumber *> *sorted;
+    @synchronized (self) {
+        sorted = host ? [self.samples[host] sortedArrayUsingSelector:@selector(compare:)] : nil;
+    }
+    if (sorted.count < 8) {
+        return kMirrorDefaultHedgeDelay;
+    }
+    NSTimeInterval p90 = sorted[sorted.count * 9 / 10].doubleValue;
+    return MIN(MAX(p90, 0.25), 5.0);
+}
+
+- (BOOL)beginHedge {
+    @synchronized (self) {
+        if (self.activeHedges >= kMirrorMaxHedges) {
+            return NO;
+        }
+        self.activeHedges++;
+        return YES;
+    }
+}
+
+- (void)endHedge {
+    @synchronized (self) {
+        self.activeHedges--;
+    }
+}
+
+@end
@@ -14,6 +14,8 @@
     NSMutableDictionary<NSString *, NSMutableDictionary *> *defaults = @{
         @"general": @{
             @"check_sha": @YES,
+            @"packed_assets": @NO,
+            @"download_mirrors": @NO,
             @"cosmetica": @YES,
             @"debug_logging": @(!CONFIG_RELEASE),
         }.mutableCopy,
@@ -59,6 +61,8 @@
             }.mutableCopy,
             @"java_args": @"",
             @"env_variables": @"",
+            @"class_data_sharing": @YES,
+            @"adaptive_tuning": @YES,
             @"auto_ram": @(!getEntitlementValue(@"com.apple.private.memorystatus")),
             @"allocated_memory": [NSNumber numberWithFloat:roundf((NSProcessInfo.processInfo.physicalMemory / 1048576) * 0.25)]
         }.mutableCopy,
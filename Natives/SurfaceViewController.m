@@ -89,10 +89,10 @@ static GameSurfaceView* pojavWindow;
         [self setNeedsUpdateOfHomeIndicatorAutoHidden];
     }
 
-    // Perform Gamepad joystick ticking, while also controlling frame rate?
+    // Send the gyroscope movement of the last frame, while also controlling frame rate?
+    // Gamepad sticks move the mouse from a timer of their own
     id tickInput = ^{
         [GyroInput tick];
-        [ControllerInput tick];
     };
     CADisplayLink *displayLink = [CADisplayLink displayLinkWithTarget:tickInput selector:@selector(invoke)];
     if (@available(iOS 15.0, tvOS 15.0, *)) {
@@ -396,6 +396,7 @@ static GameSurfaceView* pojavWindow;
         --windowHeight;
     }
     CallbackBridge_nativeSendScreenSize(windowWidth, windowHeight);
+    [GyroInput updateWindow];
 }
 
 - (void)updateControlHiddenState:(BOOL)hide {
@@ -430,6 +431,7 @@ static GameSurfaceView* pojavWindow;
 
     // Update buttons visibility
     [self updateControlHiddenState:NO];
+    [GyroInput updateWindow];
 }
 
 - (void)launchMinecraft {
@@ -938,13 +940,13 @@ static GameSurfaceView* pojavWindow;
         return;
     }
     CGPoint location = [sender locationInView:self.ctrlView];
-    for (ControlButton *button in self.swipeableButtons) {
-        if (CGRectContainsPoint(button.frame, location) && (ControlButton *)self.swipingButton != button) {
-            [self executebtn_up:self.swipingButton isOutside:NO];
-            self.swipingButton = (ControlButton *)button;
-            [self executebtn:self.swipingButton withAction:ACTION_DOWN];
-            break;
-        }
+    ControlButton *button = [self.ctrlView controlAtPoint:location passingTest:^BOOL(ControlButton *button) {
+        return [button.properties[@"isSwipeable"] boolValue];
+    }];
+    if (button && (ControlButton *)self.swipingButton != button) {
+        [self executebtn_up:self.swipingButton isOutside:NO];
+        self.swipingButton = button;
+        [self executebtn:self.swipingButton withAction:ACTION_DOWN];
     }
 }
 
@@ -0,0 +1,162 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "asset_index.h"
+#include "json_pull.h"
+
+static int asset_index_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool asset_index_decode_hash(const json_pull_t *p, uint8_t *hash) {
+    if (p->type != JSON_TOKEN_STRING || p->value_len != 40) {
+        return false;
+    }
+    for (int i = 0; i < 20; i++) {
+        int hi = asset_index_hex_digit(p->value[i * 2]);
+        int lo = asset_index_hex_digit(p->value[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        hash[i] = hi << 4 | lo;
+    }
+    return true;
+}
+
+static int asset_index_reserve(asset_index_t *index, size_t *objectCap, size_t *namesCap, size_t nameLen) {
+    if (index->count == *objectCap) {
+        size_t newCap = *objectCap ? *objectCap * 2 : 1024;
+        asset_object_t *objects = realloc(index->objects, newCap * sizeof(asset_object_t));
+        if (!objects) return ENOMEM;
+        index->objects = objects;
+        *objectCap = newCap;
+    }
+    // Names are at most as long as their raw JSON form
+    if (index->names_len + nameLen + 1 > *namesCap) {
+        size_t newCap = *namesCap ? *namesCap : 32768;
+        while (index->names_len + nameLen + 1 > newCap) newCap *= 2;
+        char *names = realloc(index->names, newCap);
+        if (!names) return ENOMEM;
+        index->names = names;
+        *namesCap = newCap;
+    }
+    return 0;
+}
+
+static int asset_index_parse_objects(json_pull_t *p, asset_index_t *index) {
+    size_t objectCap = 0, namesCap = 0;
+    if (json_pull_next(p) != JSON_TOKEN_OBJECT_START) {
+        return EINVAL;
+    }
+    while (json_pull_next(p) == JSON_TOKEN_KEY) {
+        int err = asset_index_reserve(index, &objectCap, &namesCap, p->value_len);
+        if (err) return err;
+        asset_object_t *object = &index->objects[index->count];
+        memset(object, 0, sizeof(*object));
+        object->name_offset = (uint32_t)index->names_len;
+        long nameLen = json_pull_copy_string(p, index->names + index->names_len, namesCap - index->names_len);
+        if (nameLen < 0) return EINVAL;
+
+        if (json_pull_next(p) != JSON_TOKEN_OBJECT_START) {
+            return EINVAL;
+        }
+        bool hasHash = false;
+        while (json_pull_next(p) == JSON_TOKEN_KEY) {
+            if (json_pull_token_equals(p, "hash")) {
+                json_pull_next(p);
+                hasHash = asset_index_decode_hash(p, object->hash);
+            } else if (json_pull_token_equals(p, "size")) {
+                json_pull_next(p);
+                object->size = json_pull_token_uint64(p);
+            } else {
+                json_pull_next(p);
+                json_pull_skip(p);
+            }
+        }
+        if (p->type != JSON_TOKEN_OBJECT_END || !hasHash) {
+            return EINVAL;
+        }
+        index->names_len += nameLen + 1;
+        index->count++;
+    }
+    return p->type == JSON_TOKEN_OBJECT_END ? 0 : EINVAL;
+}
+
+int asset_index_parse(const char *buf, size_t len, asset_index_t *index) {
+    memset(index, 0, sizeof(*index));
+    json_pull_t p;
+    json_pull_init(&p, buf, len);
+    if (json_pull_next(&p) != JSON_TOKEN_OBJECT_START) {
+        return EINVAL;
+    }
+
+    int err = 0;
+    while (!err && json_pull_next(&p) == JSON_TOKEN_KEY) {
+        if (json_pull_token_equals(&p, "objects")) {
+            err = asset_index_parse_objects(&p, index);
+        } else if (json_pull_token_equals(&p, "map_to_resources")) {
+            index->map_to_resources = json_pull_next(&p) == JSON_TOKEN_TRUE;
+        } else if (json_pull_token_equals(&p, "virtual")) {
+            index->is_virtual = json_pull_next(&p) == JSON_TOKEN_TRUE;
+        } else {
+            json_pull_next(&p);
+            json_pull_skip(&p);
+        }
+    }
+    if (!err && p.type != JSON_TOKEN_OBJECT_END) {
+        err = EINVAL;
+    }
+    if (err) {
+        asset_index_free(index);
+    }
+    return err;
+}
+
+int asset_index_load(const char *path, asset_index_t *index) {
+    memset(index, 0, sizeof(*index));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return EINVAL;
+    }
+    // Map the file instead of reading it, the parser only touches each byte once
+    void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) {
+        return errno;
+    }
+    madvise(buf, st.st_size, MADV_SEQUENTIAL);
+    int err = asset_index_parse(buf, st.st_size, index);
+    munmap(buf, st.st_size);
+    return err;
+}
+
+void asset_index_free(asset_index_t *index) {
+    free(index->objects);
+    free(index->names);
+    memset(index, 0, sizeof(*index));
+}
+
+void asset_object_hash_hex(const asset_object_t *object, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 20; i++) {
+        out[i * 2] = digits[object->hash[i] >> 4];
+        out[i * 2 + 1] = digits[object->hash[i] & 0xF];
+    }
+    out[40] = '\0';
+}
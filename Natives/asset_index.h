@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact representation of assets/indexes/<id>.json, filled straight from
+// the file by json_pull without building an object tree.
+
+typedef struct {
+    uint32_t name_offset; // into asset_index_t.names, NUL-terminated
+    uint8_t hash[20];
+    uint64_t size;
+} asset_object_t;
+
+typedef struct {
+    asset_object_t *objects;
+    size_t count;
+    char *names;
+    size_t names_len;
+    bool map_to_resources;
+    bool is_virtual;
+} asset_index_t;
+
+// Returns 0 on success, otherwise an errno-style error code
+int asset_index_load(const char *path, asset_index_t *index);
+int asset_index_parse(const char *buf, size_t len, asset_index_t *index);
+void asset_index_free(asset_index_t *index);
+
+static inline const char *asset_object_name(const asset_index_t *index, const asset_object_t *object) {
+    return index->names + object->name_offset;
+}
+// out must hold 41 bytes
+void asset_object_hash_hex(const asset_object_t *object, char *out);
@@ -0,0 +1,563 @@
+#include <CommonCrypto/CommonDigest.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "asset_pack.h"
+
+#define ASSET_PACK_RECORD_MAGIC 0x52414C50 // "PLAR"
+#define ASSET_PACK_INDEX_MAGIC 0x58414C50 // "PLAX"
+#define ASSET_PACK_INDEX_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint8_t hash[20];
+    uint32_t pad;
+    uint64_t size;
+} asset_pack_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    // Length of objects.pack covered by this index
+    uint64_t covered;
+} asset_pack_index_header_t;
+
+// Pack contents the loose layout was last completely exported from
+typedef struct {
+    uint64_t data_len;
+    uint64_t count;
+} asset_pack_export_marker_t;
+
+static pthread_mutex_t asset_pack_append_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void asset_pack_path(char *out, const char *dir, const char *name) {
+    snprintf(out, PATH_MAX, "%s/%s", dir, name);
+}
+
+static int asset_pack_compare(const void *a, const void *b) {
+    return memcmp(((const asset_pack_entry_t *)a)->hash, ((const asset_pack_entry_t *)b)->hash, 20);
+}
+
+// Copies of the same object in the order they were appended
+static int asset_pack_compare_offset(const void *a, const void *b) {
+    int order = asset_pack_compare(a, b);
+    if (order != 0) {
+        return order;
+    }
+    uint64_t offsetA = ((const asset_pack_entry_t *)a)->offset, offsetB = ((const asset_pack_entry_t *)b)->offset;
+    return offsetA < offsetB ? -1 : offsetA > offsetB;
+}
+
+bool asset_pack_parse_hash(const char *hex, uint8_t *hash) {
+    for (int i = 0; i < 40; i++) {
+        char c = hex[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        if (i % 2 == 0) hash[i / 2] = digit << 4;
+        else hash[i / 2] |= digit;
+    }
+    return hex[40] == '\0';
+}
+
+static void asset_pack_format_hash(const uint8_t *hash, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 20; i++) {
+        out[i * 2] = digits[hash[i] >> 4];
+        out[i * 2 + 1] = digits[hash[i] & 0xF];
+    }
+    out[40] = '\0';
+}
+
+static int asset_pack_write_index(const char *dir, const asset_pack_entry_t *entries, size_t count, uint64_t covered) {
+    char path[PATH_MAX], tmpPath[PATH_MAX];
+    asset_pack_path(path, dir, ASSET_PACK_INDEX_NAME);
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)) {
+        return ENAMETOOLONG;
+    }
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    asset_pack_index_header_t header = {
+        .magic = ASSET_PACK_INDEX_MAGIC,
+        .version = ASSET_PACK_INDEX_VERSION,
+        .count = count,
+        .covered = covered
+    };
+    struct iovec iov[2] = {
+        {&header, sizeof(header)},
+        {(void *)entries, count * sizeof(asset_pack_entry_t)}
+    };
+    ssize_t expected = iov[0].iov_len + iov[1].iov_len;
+    int err = writev(fd, iov, 2) == expected ? 0 : (errno ? errno : EIO);
+    close(fd);
+    if (!err && rename(tmpPath, path) != 0) {
+        err = errno;
+    }
+    if (err) {
+        unlink(tmpPath);
+    }
+    return err;
+}
+
+// Indexes records past the covered offset, truncating a torn tail record so later appends stay aligned
+static int asset_pack_index_tail(asset_pack_t *pack, int dataFd, uint64_t covered, const asset_pack_entry_t *indexed, size_t indexedCount, const char *dir) {
+    size_t cap = indexedCount + 256;
+    asset_pack_entry_t *entries = malloc(cap * sizeof(asset_pack_entry_t));
+    if (!entries) {
+        return ENOMEM;
+    }
+    memcpy(entries, indexed, indexedCount * sizeof(asset_pack_entry_t));
+    size_t count = indexedCount;
+
+    uint64_t offset = covered;
+    while (offset + sizeof(asset_pack_record_t) <= pack->data_len) {
+        asset_pack_record_t record;
+        memcpy(&record, pack->data + offset, sizeof(record));
+        uint64_t dataOffset = offset + sizeof(record);
+        if (record.magic != ASSET_PACK_RECORD_MAGIC || record.size > pack->data_len - dataOffset) {
+            break;
+        }
+        if (count == cap) {
+            cap *= 2;
+            asset_pack_entry_t *grown = realloc(entries, cap * sizeof(asset_pack_entry_t));
+            if (!grown) {
+                free(entries);
+                return ENOMEM;
+            }
+            entries = grown;
+        }
+        asset_pack_entry_t *entry = &entries[count++];
+        memcpy(entry->hash, record.hash, 20);
+        entry->reserved = 0;
+        entry->offset = dataOffset;
+        entry->size = record.size;
+        offset = dataOffset + record.size;
+    }
+    if (offset < pack->data_len) {
+        // Interrupted append
+        ftruncate(dataFd, offset);
+        pack->data_len = offset;
+    }
+
+    qsort(entries, count, sizeof(asset_pack_entry_t), asset_pack_compare_offset);
+    // Keep the last copy of duplicated objects, an object is only appended
+    // again after its packed copy failed verification
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique > 0 && memcmp(entries[unique - 1].hash, entries[i].hash, 20) == 0) {
+            entries[unique - 1] = entries[i];
+        } else {
+            entries[unique++] = entries[i];
+        }
+    }
+
+    pack->entries = entries;
+    pack->count = unique;
+    pack->entries_owned = true;
+    asset_pack_write_index(dir, entries, unique, offset);
+    return 0;
+}
+
+// Called with asset_pack_append_lock held, so a record still being appended
+// is never taken for an interrupted one and truncated
+static int asset_pack_open_locked(const char *dir, asset_pack_t *pack) {
+    char path[PATH_MAX];
+    asset_pack_path(path, dir, ASSET_PACK_DATA_NAME);
+    int dataFd = open(path, O_RDWR | O_CREAT, 0644);
+    if (dataFd < 0) {
+        return errno;
+    }
+    struct stat st;
+    fstat(dataFd, &st);
+    pack->data_len = st.st_size;
+    if (pack->data_len > 0) {
+        void *data = mmap(NULL, pack->data_len, PROT_READ, MAP_SHARED, dataFd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            close(dataFd);
+            return err;
+        }
+        pack->data = data;
+    }
+
+    const asset_pack_entry_t *indexed = NULL;
+    size_t indexedCount = 0;
+    uint64_t covered = 0;
+    asset_pack_path(path, dir, ASSET_PACK_INDEX_NAME);
+    int indexFd = open(path, O_RDONLY);
+    if (indexFd >= 0 && fstat(indexFd, &st) == 0 && st.st_size >= (off_t)sizeof(asset_pack_index_header_t)) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, indexFd, 0);
+        if (map != MAP_FAILED) {
+            const asset_pack_index_header_t *header = map;
+            if (header->magic == ASSET_PACK_INDEX_MAGIC && header->version == ASSET_PACK_INDEX_VERSION &&
+                header->covered <= pack->data_len &&
+                sizeof(*header) + header->count * sizeof(asset_pack_entry_t) <= (uint64_t)st.st_size) {
+                pack->index_map = map;
+                pack->index_map_len = st.st_size;
+                indexed = (const asset_pack_entry_t *)(header + 1);
+                indexedCount = header->count;
+                covered = header->covered;
+            } else {
+                // Stale or foreign index, rebuild it from scratch
+                munmap(map, st.st_size);
+            }
+        }
+    }
+    if (indexFd >= 0) {
+        close(indexFd);
+    }
+
+    int err = 0;
+    if (covered == pack->data_len) {
+        pack->entries = (asset_pack_entry_t *)indexed;
+        pack->count = indexedCount;
+    } else {
+        err = asset_pack_index_tail(pack, dataFd, covered, indexed, indexedCount, dir);
+    }
+    close(dataFd);
+    return err;
+}
+
+int asset_pack_open(const char *dir, asset_pack_t *pack) {
+    memset(pack, 0, sizeof(*pack));
+    pthread_mutex_lock(&asset_pack_append_lock);
+    int err = asset_pack_open_locked(dir, pack);
+    pthread_mutex_unlock(&asset_pack_append_lock);
+    if (err) {
+        asset_pack_close(pack);
+    }
+    return err;
+}
+
+void asset_pack_close(asset_pack_t *pack) {
+    if (pack->data) {
+        munmap((void *)pack->data, pack->data_len);
+    }
+    if (pack->index_map) {
+        munmap(pack->index_map, pack->index_map_len);
+    }
+    if (pack->entries_owned) {
+        free(pack->entries);
+    }
+    memset(pack, 0, sizeof(*pack));
+}
+
+const void *asset_pack_find(const asset_pack_t *pack, const uint8_t *hash, uint64_t *size) {
+    asset_pack_entry_t key;
+    memcpy(key.hash, hash, 20);
+    const asset_pack_entry_t *entry = bsearch(&key, pack->entries, pack->count, sizeof(asset_pack_entry_t), asset_pack_compare);
+    if (!entry || entry->offset + entry->size > pack->data_len) {
+        return NULL;
+    }
+    if (size) {
+        *size = entry->size;
+    }
+    return pack->data + entry->offset;
+}
+
+bool asset_pack_verify(const asset_pack_t *pack, const uint8_t *hash) {
+    uint64_t size;
+    const void *data = asset_pack_find(pack, hash, &size);
+    if (!data) {
+        return false;
+    }
+    uint8_t digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data, (CC_LONG)size, digest);
+    return memcmp(digest, hash, sizeof(digest)) == 0;
+}
+
+static int asset_pack_append_locked(int fd, const uint8_t *hash, int srcFd, const void *data, uint64_t size) {
+    asset_pack_record_t record = {
+        .magic = ASSET_PACK_RECORD_MAGIC,
+        .size = size
+    };
+    memcpy(record.hash, hash, 20);
+    if (write(fd, &record, sizeof(record)) != sizeof(record)) {
+        return errno ? errno : EIO;
+    }
+    if (data) {
+        return write(fd, data, size) == (ssize_t)size ? 0 : (errno ? errno : EIO);
+    }
+    char buf[65536];
+    uint64_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = read(srcFd, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (n <= 0 || write(fd, buf, n) != n) {
+            return errno ? errno : EIO;
+        }
+        remaining -= n;
+    }
+    return 0;
+}
+
+static int asset_pack_append_impl(const char *dir, const uint8_t *hash, int srcFd, const void *data, uint64_t size) {
+    char path[PATH_MAX];
+    asset_pack_path(path, dir, ASSET_PACK_DATA_NAME);
+    pthread_mutex_lock(&asset_pack_append_lock);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    int err = fd < 0 ? errno : 0;
+    if (!err) {
+        off_t start = lseek(fd, 0, SEEK_END);
+        err = asset_pack_append_locked(fd, hash, srcFd, data, size);
+        if (err) {
+            // Do not leave a torn record behind
+            ftruncate(fd, start);
+        }
+        close(fd);
+    }
+    pthread_mutex_unlock(&asset_pack_append_lock);
+    return err;
+}
+
+int asset_pack_append(const char *dir, const uint8_t *hash, const void *data, uint64_t size) {
+    return asset_pack_append_impl(dir, hash, -1, data, size);
+}
+
+int asset_pack_append_file(const char *dir, const uint8_t *hash, const char *path) {
+    int srcFd = open(path, O_RDONLY);
+    if (srcFd < 0) {
+        return errno;
+    }
+    struct stat st;
+    int err = fstat(srcFd, &st) == 0 ? asset_pack_append_impl(dir, hash, srcFd, NULL, st.st_size) : errno;
+    close(srcFd);
+    return err;
+}
+
+static bool asset_pack_export_current(const asset_pack_t *pack, const char *objects_dir) {
+    char path[PATH_MAX];
+    asset_pack_path(path, objects_dir, ASSET_PACK_EXPORTED_NAME);
+    asset_pack_export_marker_t marker;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool current = read(fd, &marker, sizeof(marker)) == sizeof(marker) &&
+        marker.data_len == pack->data_len && marker.count == pack->count;
+    close(fd);
+    return current;
+}
+
+static void asset_pack_mark_exported(const asset_pack_t *pack, const char *objects_dir) {
+    char path[PATH_MAX];
+    asset_pack_path(path, objects_dir, ASSET_PACK_EXPORTED_NAME);
+    asset_pack_export_marker_t marker = {
+        .data_len = pack->data_len,
+        .count = pack->count
+    };
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    // A short marker never matches, which only costs a scan
+    if (write(fd, &marker, sizeof(marker)) != sizeof(marker)) {
+        ftruncate(fd, 0);
+    }
+    close(fd);
+}
+
+void asset_pack_invalidate_export(const char *objects_dir) {
+    char path[PATH_MAX];
+    asset_pack_path(path, objects_dir, ASSET_PACK_EXPORTED_NAME);
+    unlink(path);
+}
+
+// Flags entries with a loose copy of the right size, one directory read per prefix
+static void asset_pack_scan_loose(const asset_pack_t *pack, const char *objects_dir, bool *present) {
+    DIR *objectsDir = opendir(objects_dir);
+    if (!objectsDir) {
+        return;
+    }
+    char path[PATH_MAX];
+    asset_pack_entry_t key;
+    struct dirent *prefixEntry;
+    while ((prefixEntry = readdir(objectsDir))) {
+        if (strlen(prefixEntry->d_name) != 2 || prefixEntry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", objects_dir, prefixEntry->d_name);
+        DIR *prefixDir = opendir(path);
+        if (!prefixDir) continue;
+        struct dirent *objectEntry;
+        while ((objectEntry = readdir(prefixDir))) {
+            if (!asset_pack_parse_hash(objectEntry->d_name, key.hash)) continue;
+            const asset_pack_entry_t *entry = bsearch(&key, pack->entries, pack->count, sizeof(asset_pack_entry_t), asset_pack_compare);
+            struct stat st;
+            if (entry && fstatat(dirfd(prefixDir), objectEntry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                S_ISREG(st.st_mode) && (uint64_t)st.st_size == entry->size) {
+                present[entry - pack->entries] = true;
+            }
+        }
+        closedir(prefixDir);
+    }
+    closedir(objectsDir);
+}
+
+static int asset_pack_export_entry(const asset_pack_t *pack, const asset_pack_entry_t *entry, const char *path) {
+    char tmpPath[PATH_MAX];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)) {
+        return ENAMETOOLONG;
+    }
+    // Written aside and renamed over, a damaged copy is replaced as a whole
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    ssize_t written = write(fd, pack->data + entry->offset, entry->size);
+    int err = written == (ssize_t)entry->size ? 0 : (errno ? errno : EIO);
+    close(fd);
+    if (!err && rename(tmpPath, path) != 0) {
+        err = errno;
+    }
+    if (err) {
+        unlink(tmpPath);
+    }
+    return err;
+}
+
+int asset_pack_export(const asset_pack_t *pack, const char *objects_dir, bool only_missing, size_t *exported) {
+    if (exported) {
+        *exported = 0;
+    }
+    if (only_missing && asset_pack_export_current(pack, objects_dir)) {
+        return 0;
+    }
+    bool *present = calloc(pack->count ? pack->count : 1, sizeof(bool));
+    if (!present) {
+        return ENOMEM;
+    }
+    mkdir(objects_dir, 0755);
+    if (only_missing) {
+        asset_pack_scan_loose(pack, objects_dir, present);
+    }
+
+    bool createdDirs[256] = {0};
+    char path[PATH_MAX], hex[41];
+    size_t count = 0;
+    int err = 0;
+    for (size_t i = 0; i < pack->count && !err; i++) {
+        const asset_pack_entry_t *entry = &pack->entries[i];
+        if (present[i] || entry->offset + entry->size > pack->data_len) {
+            continue;
+        }
+        asset_pack_format_hash(entry->hash, hex);
+        if (!createdDirs[entry->hash[0]]) {
+            snprintf(path, sizeof(path), "%s/%.2s", objects_dir, hex);
+            mkdir(path, 0755);
+            createdDirs[entry->hash[0]] = true;
+        }
+        snprintf(path, sizeof(path), "%s/%.2s/%s", objects_dir, hex, hex);
+        err = asset_pack_export_entry(pack, entry, path);
+        if (!err) {
+            count++;
+        }
+    }
+    free(present);
+    if (!err) {
+        asset_pack_mark_exported(pack, objects_dir);
+    }
+    if (exported) {
+        *exported = count;
+    }
+    return err;
+}
+
+// Appends a loose object if its contents match its name
+static int asset_pack_import_file(const char *dir, const uint8_t *hash, const char *path, bool *verified) {
+    *verified = false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    void *data = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return errno;
+    }
+    uint8_t digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data, (CC_LONG)st.st_size, digest);
+    int err = 0;
+    if (memcmp(digest, hash, sizeof(digest)) == 0) {
+        *verified = true;
+        err = asset_pack_append(dir, hash, data, st.st_size);
+    }
+    if (data) {
+        munmap(data, st.st_size);
+    }
+    return err;
+}
+
+int asset_pack_import_loose(const char *dir, const char *objects_dir, bool remove_loose, size_t *imported) {
+    asset_pack_t pack;
+    int err = asset_pack_open(dir, &pack);
+    if (err) {
+        return err;
+    }
+    DIR *objectsDir = opendir(objects_dir);
+    if (!objectsDir) {
+        asset_pack_close(&pack);
+        return errno;
+    }
+    if (remove_loose) {
+        asset_pack_invalidate_export(objects_dir);
+    }
+
+    size_t count = 0;
+    char path[PATH_MAX];
+    uint8_t hash[20];
+    struct dirent *prefixEntry;
+    while (!err && (prefixEntry = readdir(objectsDir))) {
+        if (strlen(prefixEntry->d_name) != 2 || prefixEntry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", objects_dir, prefixEntry->d_name);
+        DIR *prefixDir = opendir(path);
+        if (!prefixDir) continue;
+        struct dirent *objectEntry;
+        while (!err && (objectEntry = readdir(prefixDir))) {
+            if (!asset_pack_parse_hash(objectEntry->d_name, hash)) continue;
+            snprintf(path, sizeof(path), "%s/%s/%s", objects_dir, prefixEntry->d_name, objectEntry->d_name);
+            struct stat st;
+            if (remove_loose && lstat(path, &st) == 0 && st.st_nlink > 1) {
+                // Also linked from the content store or another instance,
+                // packing it would only add a second copy
+                continue;
+            }
+            // Corrupt objects are left out, they are downloaded again
+            bool verified = true;
+            if (!asset_pack_find(&pack, hash, NULL)) {
+                err = asset_pack_import_file(dir, hash, path, &verified);
+                if (!err && verified) count++;
+            }
+            if (!err && remove_loose) {
+                unlink(path);
+            }
+        }
+        closedir(prefixDir);
+    }
+    closedir(objectsDir);
+    asset_pack_close(&pack);
+    if (imported) {
+        *imported = count;
+    }
+    return err;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Packed asset objects: assets/objects.pack is an append-only sequence of
+// {record header, data} and assets/objects.idx is a sorted hash index
+// derived from it. Appends never touch the index; asset_pack_open() indexes
+// any records appended since the index was last written. When an object is
+// appended more than once, the last copy is the one indexed.
+
+#define ASSET_PACK_DATA_NAME "objects.pack"
+#define ASSET_PACK_INDEX_NAME "objects.idx"
+// Kept in the loose objects folder, records what it was exported from
+#define ASSET_PACK_EXPORTED_NAME ".exported"
+
+typedef struct {
+    uint8_t hash[20];
+    uint32_t reserved;
+    uint64_t offset; // data offset in objects.pack
+    uint64_t size;
+} asset_pack_entry_t;
+
+typedef struct {
+    const uint8_t *data;
+    size_t data_len;
+    asset_pack_entry_t *entries;
+    size_t count;
+
+    // Backing storage of entries: the mapped index, or a heap copy after a merge
+    void *index_map;
+    size_t index_map_len;
+    bool entries_owned;
+} asset_pack_t;
+
+// Returns 0 on success, otherwise an errno-style error code
+int asset_pack_open(const char *dir, asset_pack_t *pack);
+void asset_pack_close(asset_pack_t *pack);
+const void *asset_pack_find(const asset_pack_t *pack, const uint8_t *hash, uint64_t *size);
+// Checks the packed copy of hash against its SHA-1, false if it isn't packed
+bool asset_pack_verify(const asset_pack_t *pack, const uint8_t *hash);
+
+// Safe to call from multiple threads
+int asset_pack_append(const char *dir, const uint8_t *hash, const void *data, uint64_t size);
+int asset_pack_append_file(const char *dir, const uint8_t *hash, const char *path);
+
+// Writes pack entries into the loose assets/objects/xx/hash layout. With
+// only_missing, nothing is done if the layout was completely exported from
+// this pack before, otherwise one directory scan finds the objects that are
+// missing or have the wrong size, and only those are written
+int asset_pack_export(const asset_pack_t *pack, const char *objects_dir, bool only_missing, size_t *exported);
+// Makes the next export scan again, e.g. after a loose object was found damaged
+void asset_pack_invalidate_export(const char *objects_dir);
+// Migrates an existing loose layout into the pack. Objects whose SHA-1
+// doesn't match their name are not imported. With remove_loose, objects
+// with more than one link are left loose, their data is shared anyway
+int asset_pack_import_loose(const char *dir, const char *objects_dir, bool remove_loose, size_t *imported);
+
+bool asset_pack_parse_hash(const char *hex, uint8_t *hash);
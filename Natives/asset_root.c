@@ -0,0 +1,130 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asset_pack.h"
+#include "asset_root.h"
+
+// Set up once before the game starts, only read afterwards
+static bool serving;
+static asset_pack_t pack;
+static struct stat packStat;
+// The objects folder as the game is told about it, and with links resolved
+static char objectsPrefix[2][PATH_MAX];
+static size_t objectsPrefixLen[2];
+static char tmpTemplate[PATH_MAX];
+
+int asset_root_serve(const char *assets_dir, const char *tmp_dir) {
+    if (serving) {
+        return EBUSY;
+    }
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", assets_dir, ASSET_PACK_DATA_NAME) >= (int)sizeof(path) ||
+        snprintf(tmpTemplate, sizeof(tmpTemplate), "%s/asset.XXXXXX", tmp_dir) >= (int)sizeof(tmpTemplate)) {
+        return ENAMETOOLONG;
+    }
+    if (stat(path, &packStat) != 0) {
+        return errno;
+    }
+    int err = asset_pack_open(assets_dir, &pack);
+    if (err) {
+        return err;
+    }
+
+    char resolved[PATH_MAX];
+    const char *roots[2] = {assets_dir, realpath(assets_dir, resolved)};
+    for (int i = 0; i < 2; i++) {
+        // A prefix that doesn't fit matches nothing
+        if (roots[i] && snprintf(objectsPrefix[i], PATH_MAX, "%s/objects/", roots[i]) < PATH_MAX) {
+            objectsPrefixLen[i] = strlen(objectsPrefix[i]);
+        }
+    }
+    serving = true;
+    return 0;
+}
+
+// Packed data of "<objects>/xx/<hash>", NULL for any other path
+static const void *asset_root_lookup(const char *path, uint64_t *size) {
+    if (!serving || !path) {
+        return NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        size_t len = objectsPrefixLen[i];
+        if (len == 0 || strncmp(path, objectsPrefix[i], len) != 0) continue;
+        const char *name = path + len;
+        uint8_t hash[20];
+        if (name[0] == '\0' || name[1] == '\0' || name[2] != '/' ||
+            strncmp(name, name + 3, 2) != 0 || !asset_pack_parse_hash(name + 3, hash)) {
+            return NULL;
+        }
+        return asset_pack_find(&pack, hash, size);
+    }
+    return NULL;
+}
+
+bool asset_root_open(const char *path, int oflag, int *fd) {
+    uint64_t size;
+    const char *data = asset_root_lookup(path, &size);
+    // Anything that writes gets the real file system
+    if (!data || (oflag & (O_ACCMODE | O_CREAT | O_TRUNC)) != O_RDONLY) {
+        return false;
+    }
+    char tmpPath[PATH_MAX];
+    memcpy(tmpPath, tmpTemplate, sizeof(tmpPath));
+    *fd = mkstemp(tmpPath);
+    if (*fd < 0) {
+        return true;
+    }
+    unlink(tmpPath);
+    uint64_t written = 0;
+    while (written < size) {
+        ssize_t n = write(*fd, data + written, size - written);
+        if (n <= 0) {
+            int err = n < 0 ? errno : EIO;
+            close(*fd);
+            *fd = -1;
+            errno = err;
+            return true;
+        }
+        written += n;
+    }
+    lseek(*fd, 0, SEEK_SET);
+    if (oflag & O_CLOEXEC) {
+        fcntl(*fd, F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+bool asset_root_stat(const char *path, struct stat *st, int *result) {
+    uint64_t size;
+    const char *data = asset_root_lookup(path, &size);
+    if (!data) {
+        return false;
+    }
+    // A read-only file dated like the pack, the data offset makes a stable inode number
+    *st = packStat;
+    st->st_mode = S_IFREG | 0444;
+    st->st_nlink = 1;
+    st->st_ino = (ino_t)(data - (const char *)pack.data);
+    st->st_size = size;
+    st->st_blocks = (size + 511) / 512;
+    *result = 0;
+    return true;
+}
+
+bool asset_root_access(const char *path, int mode, int *result) {
+    if (!asset_root_lookup(path, NULL)) {
+        return false;
+    }
+    if (mode & (W_OK | X_OK)) {
+        errno = EACCES;
+        *result = -1;
+    } else {
+        *result = 0;
+    }
+    return true;
+}
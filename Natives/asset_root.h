@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+// Virtual asset root: once serving, assets/objects/xx/<hash> paths of packed
+// objects are answered from the asset pack instead of the file system. The
+// game stats and opens them like loose files, but no loose copy is written:
+// an open gets an already unlinked temporary file holding the object. Paths
+// of objects that aren't packed fall through to the file system.
+
+// Starts serving the pack in assets_dir, temporary files go to tmp_dir.
+// Returns 0 on success, otherwise an errno-style error code
+int asset_root_serve(const char *assets_dir, const char *tmp_dir);
+
+// Each returns false when path isn't a packed object, so the caller does the
+// real call. Otherwise the result of the call is stored, with errno set on failure
+bool asset_root_open(const char *path, int oflag, int *fd);
+bool asset_root_stat(const char *path, struct stat *st, int *result);
+bool asset_root_access(const char *path, int mode, int *result);
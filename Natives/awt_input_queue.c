@@ -0,0 +1,56 @@
+#include <errno.h>
+#include <stdlib.h>
+
+#include "awt_input_queue.h"
+
+int awt_input_queue_init(awt_input_queue_t *queue, size_t capacity) {
+    queue->events = malloc(capacity * sizeof(awt_input_event_t));
+    if (!queue->events || capacity == 0) {
+        free(queue->events);
+        return ENOMEM;
+    }
+    queue->capacity = capacity;
+    queue->first = queue->next = 0;
+    queue->last_coalescable = false;
+    queue->dropped = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    return 0;
+}
+
+void awt_input_queue_push(awt_input_queue_t *queue, const awt_input_event_t *event, bool coalesce) {
+    pthread_mutex_lock(&queue->lock);
+    awt_input_event_t *last = &queue->events[(queue->next - 1) % queue->capacity];
+    if (coalesce && queue->last_coalescable && queue->next > queue->first && last->type == event->type) {
+        *last = *event;
+    } else {
+        if (queue->next - queue->first == queue->capacity) {
+            queue->first++;
+            queue->dropped++;
+        }
+        queue->events[queue->next++ % queue->capacity] = *event;
+        // Only the waiter needs waking, and only when it may be asleep
+        if (queue->next - queue->first == 1) {
+            pthread_cond_signal(&queue->cond);
+        }
+    }
+    queue->last_coalescable = coalesce;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+size_t awt_input_queue_wait(awt_input_queue_t *queue, awt_input_event_t *events, size_t max) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->next == queue->first) {
+        pthread_cond_wait(&queue->cond, &queue->lock);
+    }
+    size_t count = 0;
+    while (count < max && queue->first < queue->next) {
+        events[count++] = queue->events[queue->first++ % queue->capacity];
+    }
+    // A taken event can't be replaced anymore
+    if (queue->first == queue->next) {
+        queue->last_coalescable = false;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
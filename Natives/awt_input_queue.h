@@ -0,0 +1,34 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded queue of AWT input events: any thread pushes without touching
+// JNI, and one Java thread takes them out in batches, so a burst of input
+// costs one JNI transition instead of one upcall per event.
+
+typedef struct {
+    int type, i1, i2, i3, i4;
+} awt_input_event_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    awt_input_event_t *events;
+    size_t capacity;
+    // Monotonic indices of the oldest queued event and of the next one
+    size_t first, next;
+    // The newest event may still be replaced by one of the same type
+    bool last_coalescable;
+    size_t dropped;
+} awt_input_queue_t;
+
+// Returns 0 on success, otherwise an errno-style error code
+int awt_input_queue_init(awt_input_queue_t *queue, size_t capacity);
+// With coalesce set, replaces the newest queued event if it has the same type
+// and was pushed with coalesce too, for events like cursor moves where only the
+// latest matters. Once full, the oldest event is dropped
+void awt_input_queue_push(awt_input_queue_t *queue, const awt_input_event_t *event, bool coalesce);
+// Blocks until there are events, then moves up to max of them to events
+size_t awt_input_queue_wait(awt_input_queue_t *queue, awt_input_event_t *events, size_t max);
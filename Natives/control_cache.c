@@ -0,0 +1,250 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "control_cache.h"
+
+#define CONTROL_CACHE_MAGIC 0x4C434C50 // "PLCL"
+#define CONTROL_CACHE_VERSION 1
+
+_Static_assert(sizeof(control_cache_header_t) == 48, "control_cache_header_t layout changed");
+_Static_assert(sizeof(control_cache_record_t) == 88, "control_cache_record_t layout changed");
+
+// FNV-1a
+uint64_t control_cache_hash(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#pragma mark - Reading
+
+static bool control_cache_check_string(const control_cache_header_t *header, uint32_t offset) {
+    return offset < header->string_size;
+}
+
+static bool control_cache_check(const control_cache_t *cache) {
+    const control_cache_header_t *header = cache->header;
+    // The table must end with a terminator so no string runs past the map
+    if (header->string_size == 0 || cache->strings[header->string_size - 1] != '\0') {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const control_cache_record_t *record = &cache->records[i];
+        if (record->kind > CONTROL_KIND_JOYSTICK ||
+            !control_cache_check_string(header, record->name) ||
+            !control_cache_check_string(header, record->dynamic_x) ||
+            !control_cache_check_string(header, record->dynamic_y) ||
+            !control_cache_check_string(header, record->orientation)) {
+            return false;
+        }
+        // Drawers come before their buttons
+        if (record->kind == CONTROL_KIND_SUB_BUTTON) {
+            if (record->parent < 0 || (uint32_t)record->parent >= i ||
+                cache->records[record->parent].kind != CONTROL_KIND_DRAWER) {
+                return false;
+            }
+        } else if (record->parent != -1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int control_cache_open(control_cache_t *cache, const char *path, uint64_t source_hash) {
+    memset(cache, 0, sizeof(*cache));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    if ((size_t)st.st_size < sizeof(control_cache_header_t)) {
+        close(fd);
+        return EINVAL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return errno;
+    }
+    cache->map = map;
+    cache->map_len = st.st_size;
+    cache->header = map;
+
+    const control_cache_header_t *header = cache->header;
+    if (header->magic != CONTROL_CACHE_MAGIC || header->version != CONTROL_CACHE_VERSION ||
+        header->source_hash != source_hash) {
+        control_cache_close(cache);
+        return ESTALE;
+    }
+    size_t records_len = (size_t)header->record_count * sizeof(control_cache_record_t);
+    if (cache->map_len != sizeof(*header) + records_len + header->string_size) {
+        control_cache_close(cache);
+        return EINVAL;
+    }
+    cache->records = (const control_cache_record_t *)(header + 1);
+    cache->strings = (const char *)(cache->records + header->record_count);
+    if (!control_cache_check(cache)) {
+        control_cache_close(cache);
+        return EINVAL;
+    }
+    return 0;
+}
+
+void control_cache_close(control_cache_t *cache) {
+    if (cache->map) {
+        munmap(cache->map, cache->map_len);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+#pragma mark - Compiling
+
+int control_cache_builder_init(control_cache_builder_t *builder) {
+    memset(builder, 0, sizeof(*builder));
+    builder->slot_count = 64;
+    builder->slots = calloc(builder->slot_count, sizeof(uint32_t));
+    builder->string_capacity = 1024;
+    builder->strings = malloc(builder->string_capacity);
+    if (!builder->slots || !builder->strings) {
+        control_cache_builder_free(builder);
+        return ENOMEM;
+    }
+    // Offset 0, for missing strings
+    builder->strings[0] = '\0';
+    builder->string_size = 1;
+    return 0;
+}
+
+void control_cache_builder_free(control_cache_builder_t *builder) {
+    free(builder->records);
+    free(builder->strings);
+    free(builder->slots);
+    memset(builder, 0, sizeof(*builder));
+}
+
+static bool control_cache_grow_slots(control_cache_builder_t *builder) {
+    size_t slot_count = builder->slot_count * 2;
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    for (size_t i = 0; i < builder->slot_count; i++) {
+        uint32_t entry = builder->slots[i];
+        if (!entry) continue;
+        const char *str = builder->strings + entry - 1;
+        size_t slot = control_cache_hash(str, strlen(str)) & (slot_count - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = entry;
+    }
+    free(builder->slots);
+    builder->slots = slots;
+    builder->slot_count = slot_count;
+    return true;
+}
+
+uint32_t control_cache_intern(control_cache_builder_t *builder, const char *str) {
+    size_t len = strlen(str);
+    if (len == 0) {
+        return 0;
+    }
+    // Keep the table at most half full
+    if ((builder->interned + 1) * 2 > builder->slot_count && !control_cache_grow_slots(builder)) {
+        return UINT32_MAX;
+    }
+    size_t slot = control_cache_hash(str, len) & (builder->slot_count - 1);
+    while (builder->slots[slot]) {
+        const char *existing = builder->strings + builder->slots[slot] - 1;
+        if (strcmp(existing, str) == 0) {
+            return builder->slots[slot] - 1;
+        }
+        slot = (slot + 1) & (builder->slot_count - 1);
+    }
+
+    if (builder->string_size + len + 1 >= UINT32_MAX) {
+        return UINT32_MAX;
+    }
+    if (builder->string_size + len + 1 > builder->string_capacity) {
+        size_t capacity = builder->string_capacity;
+        while (builder->string_size + len + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *strings = realloc(builder->strings, capacity);
+        if (!strings) {
+            return UINT32_MAX;
+        }
+        builder->strings = strings;
+        builder->string_capacity = capacity;
+    }
+    uint32_t offset = (uint32_t)builder->string_size;
+    memcpy(builder->strings + offset, str, len + 1);
+    builder->string_size += len + 1;
+    builder->slots[slot] = offset + 1;
+    builder->interned++;
+    return offset;
+}
+
+int control_cache_add(control_cache_builder_t *builder, const control_cache_record_t *record) {
+    if (builder->count == builder->capacity) {
+        size_t capacity = builder->capacity ? builder->capacity * 2 : 32;
+        control_cache_record_t *records = realloc(builder->records, capacity * sizeof(control_cache_record_t));
+        if (!records) {
+            return ENOMEM;
+        }
+        builder->records = records;
+        builder->capacity = capacity;
+    }
+    if (builder->count >= UINT32_MAX) {
+        return EINVAL;
+    }
+    builder->records[builder->count++] = *record;
+    return 0;
+}
+
+int control_cache_write(const control_cache_builder_t *builder, control_cache_header_t *header, const char *path) {
+    char tmpPath[PATH_MAX];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)) {
+        return ENAMETOOLONG;
+    }
+    header->magic = CONTROL_CACHE_MAGIC;
+    header->version = CONTROL_CACHE_VERSION;
+    header->record_count = (uint32_t)builder->count;
+    header->string_size = (uint32_t)builder->string_size;
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    struct iovec iov[3] = {
+        {header, sizeof(*header)},
+        {builder->records, builder->count * sizeof(control_cache_record_t)},
+        {builder->strings, builder->string_size}
+    };
+    ssize_t expected = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+    int err = writev(fd, iov, 3) == expected ? 0 : (errno ? errno : EIO);
+    close(fd);
+    if (!err && rename(tmpPath, path) != 0) {
+        err = errno;
+    }
+    if (err) {
+        unlink(tmpPath);
+    }
+    return err;
+}
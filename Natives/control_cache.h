@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compiled form of a custom controls layout, cached as <name>.json.cache
+// in a private cache folder: a header, one fixed-size record per control
+// and an interned string table, loaded with a single mmap. The header keeps the
+// hash of the JSON it was compiled from, so an edited layout is recompiled,
+// and the screen its positions were resolved for, so dynamic positions
+// don't have to be evaluated again on the same screen.
+
+#define CONTROL_CACHE_SUFFIX ".cache"
+
+typedef enum {
+    CONTROL_KIND_BUTTON,
+    CONTROL_KIND_DRAWER,
+    CONTROL_KIND_SUB_BUTTON,
+    CONTROL_KIND_JOYSTICK
+} control_kind_t;
+
+enum {
+    CONTROL_FLAG_DISPLAY_IN_GAME = 1 << 0,
+    CONTROL_FLAG_DISPLAY_IN_MENU = 1 << 1,
+    CONTROL_FLAG_TOGGLE = 1 << 2,
+    CONTROL_FLAG_PASS_THRU = 1 << 3,
+    CONTROL_FLAG_SWIPEABLE = 1 << 4,
+    CONTROL_FLAG_FORWARD_LOCK = 1 << 5
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_hash;
+    // Screen the record positions were resolved for
+    float screen_width, screen_height, screen_scale, button_scale;
+    // Layout properties
+    uint32_t layout_version;
+    float scaled_at;
+    uint32_t record_count;
+    uint32_t string_size;
+} control_cache_header_t;
+
+typedef struct {
+    // Frame origin resolved from dynamic_x and dynamic_y
+    double x, y;
+    uint8_t kind;
+    uint8_t unused;
+    uint16_t flags;
+    // Record index of the drawer of a sub button, otherwise -1
+    int32_t parent;
+    int32_t keycodes[4];
+    float width, height, opacity, corner_radius, stroke_width;
+    uint32_t bg_color, stroke_color;
+    // Offsets into the string table, 0 is the empty string
+    uint32_t name, dynamic_x, dynamic_y, orientation;
+    uint32_t reserved;
+} control_cache_record_t;
+
+typedef struct {
+    void *map;
+    size_t map_len;
+    const control_cache_header_t *header;
+    const control_cache_record_t *records;
+    const char *strings;
+} control_cache_t;
+
+typedef struct {
+    control_cache_record_t *records;
+    size_t count, capacity;
+    char *strings;
+    size_t string_size, string_capacity;
+    // Open addressing table of string offsets + 1, 0 marks a free slot
+    uint32_t *slots;
+    size_t slot_count, interned;
+} control_cache_builder_t;
+
+uint64_t control_cache_hash(const void *data, size_t len);
+
+// Returns 0 on success, otherwise an errno-style error code. ESTALE means the
+// cache was compiled from another version of the layout or by another build
+int control_cache_open(control_cache_t *cache, const char *path, uint64_t source_hash);
+void control_cache_close(control_cache_t *cache);
+// Offsets of opened caches are already checked
+static inline const char *control_cache_string(const control_cache_t *cache, uint32_t offset) {
+    return cache->strings + offset;
+}
+
+// Returns 0 on success, otherwise an errno-style error code
+int control_cache_builder_init(control_cache_builder_t *builder);
+void control_cache_builder_free(control_cache_builder_t *builder);
+// Offset of str in the string table, each distinct string is stored once.
+// Returns UINT32_MAX when out of memory
+uint32_t control_cache_intern(control_cache_builder_t *builder, const char *str);
+// Records are written in the order they are added
+int control_cache_add(control_cache_builder_t *builder, const control_cache_record_t *record);
+// Fills in the magic, version and counts of header, then replaces path
+int control_cache_write(const control_cache_builder_t *builder, control_cache_header_t *header, const char *path);
@@ -0,0 +1,128 @@
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "control_grid.h"
+
+// Cells are about the size of an average control, within these bounds
+#define MIN_CELL_SIZE 16.0f
+#define MAX_CELLS 4096
+
+static inline int clamp_cell(float value, float cell_size, int cells) {
+    int cell = (int)floorf(value / cell_size);
+    return cell < 0 ? 0 : (cell >= cells ? cells - 1 : cell);
+}
+
+static inline bool rect_is_empty(const control_rect_t *rect) {
+    return !(rect->width > 0 && rect->height > 0);
+}
+
+int control_grid_build(control_grid_t *grid, const control_rect_t *rects, size_t count, float width, float height) {
+    memset(grid, 0, sizeof(*grid));
+    if (!(width > 0 && height > 0) || count > UINT32_MAX) return EINVAL;
+
+    float sum_width = 0, sum_height = 0;
+    size_t sized = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (rect_is_empty(&rects[i])) continue;
+        sum_width += rects[i].width;
+        sum_height += rects[i].height;
+        sized++;
+    }
+    float cell_width = sized ? fmaxf(sum_width / sized, MIN_CELL_SIZE) : width;
+    float cell_height = sized ? fmaxf(sum_height / sized, MIN_CELL_SIZE) : height;
+    int cols = (int)ceilf(width / cell_width), rows = (int)ceilf(height / cell_height);
+    while ((size_t)cols * rows > MAX_CELLS) {
+        cell_width *= 2;
+        cell_height *= 2;
+        cols = (int)ceilf(width / cell_width);
+        rows = (int)ceilf(height / cell_height);
+    }
+    size_t cells = (size_t)cols * rows;
+
+    grid->rects = malloc((count ? count : 1) * sizeof(control_rect_t));
+    grid->cell_start = calloc(cells + 1, sizeof(uint32_t));
+    if (!grid->rects || !grid->cell_start) {
+        control_grid_free(grid);
+        return ENOMEM;
+    }
+    memcpy(grid->rects, rects, count * sizeof(control_rect_t));
+    grid->count = count;
+    grid->cols = cols;
+    grid->rows = rows;
+    grid->cell_width = cell_width;
+    grid->cell_height = cell_height;
+
+    // Count, then place: cell_start[c + 1] first holds the size of cell c
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        const control_rect_t *rect = &rects[i];
+        if (rect_is_empty(rect)) continue;
+        int x0 = clamp_cell(rect->x, cell_width, cols), x1 = clamp_cell(rect->x + rect->width, cell_width, cols);
+        int y0 = clamp_cell(rect->y, cell_height, rows), y1 = clamp_cell(rect->y + rect->height, cell_height, rows);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                grid->cell_start[y * cols + x + 1]++;
+            }
+        }
+        total += (size_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    }
+    if (total > UINT32_MAX) {
+        control_grid_free(grid);
+        return EINVAL;
+    }
+    for (size_t c = 0; c < cells; c++) {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+    grid->entries = malloc((total ? total : 1) * sizeof(uint32_t));
+    uint32_t *fill = malloc(cells * sizeof(uint32_t));
+    if (!grid->entries || !fill) {
+        free(fill);
+        control_grid_free(grid);
+        return ENOMEM;
+    }
+    memcpy(fill, grid->cell_start, cells * sizeof(uint32_t));
+    // Topmost first
+    for (size_t i = count; i-- > 0;) {
+        const control_rect_t *rect = &rects[i];
+        if (rect_is_empty(rect)) continue;
+        int x0 = clamp_cell(rect->x, cell_width, cols), x1 = clamp_cell(rect->x + rect->width, cell_width, cols);
+        int y0 = clamp_cell(rect->y, cell_height, rows), y1 = clamp_cell(rect->y + rect->height, cell_height, rows);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                grid->entries[fill[y * cols + x]++] = (uint32_t)i;
+            }
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+void control_grid_free(control_grid_t *grid) {
+    free(grid->rects);
+    free(grid->cell_start);
+    free(grid->entries);
+    memset(grid, 0, sizeof(*grid));
+}
+
+int control_grid_hit(const control_grid_t *grid, float x, float y, control_grid_filter_t filter, void *ctx) {
+    if (!grid->cell_start) return -1;
+    size_t cell = (size_t)clamp_cell(y, grid->cell_height, grid->rows) * grid->cols + clamp_cell(x, grid->cell_width, grid->cols);
+    for (uint32_t i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; i++) {
+        uint32_t index = grid->entries[i];
+        const control_rect_t *rect = &grid->rects[index];
+        // Half open like CGRectContainsPoint
+        if (x < rect->x || y < rect->y || x >= rect->x + rect->width || y >= rect->y + rect->height) continue;
+        if (filter && !filter(index, ctx)) continue;
+        return (int)index;
+    }
+    return -1;
+}
+
+void control_grid_hit_many(const control_grid_t *grid, const float *points, size_t count, int *results,
+    control_grid_filter_t filter, void *ctx) {
+    for (size_t i = 0; i < count; i++) {
+        results[i] = control_grid_hit(grid, points[i * 2], points[i * 2 + 1], filter, ctx);
+    }
+}
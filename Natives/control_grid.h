@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Uniform grid over the control rectangles of a layout, built once per
+// layout and screen size. A touch only looks at the few controls sharing
+// its cell instead of every control on screen. Controls are in z order,
+// later ones are on top, and each cell lists its controls topmost first.
+
+typedef struct {
+    float x, y, width, height;
+} control_rect_t;
+
+typedef struct {
+    control_rect_t *rects;
+    size_t count;
+    int cols, rows;
+    float cell_width, cell_height;
+    // Controls of cell i are entries[cell_start[i]] up to entries[cell_start[i + 1]]
+    uint32_t *cell_start;
+    uint32_t *entries;
+} control_grid_t;
+
+// Called for each control under a point, topmost first, to skip hidden or
+// otherwise unsuitable ones
+typedef bool (*control_grid_filter_t)(size_t index, void *ctx);
+
+// Returns 0 on success, otherwise an errno-style error code
+int control_grid_build(control_grid_t *grid, const control_rect_t *rects, size_t count, float width, float height);
+void control_grid_free(control_grid_t *grid);
+// Topmost control containing the point that filter accepts (NULL accepts all), or -1
+int control_grid_hit(const control_grid_t *grid, float x, float y, control_grid_filter_t filter, void *ctx);
+// Same for count points at once, points holds x and y pairs
+void control_grid_hit_many(const control_grid_t *grid, const float *points, size_t count, int *results,
+    control_grid_filter_t filter, void *ctx);
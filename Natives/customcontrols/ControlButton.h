@@ -24,5 +24,7 @@
 - (void)snapAndAlignX:(CGFloat)x Y:(CGFloat)y;
 - (void)preProcessProperties;
 - (void)update;
+// Same as update, at a position already resolved for this screen
+- (void)updateAtOrigin:(CGPoint)origin;
 
 @end
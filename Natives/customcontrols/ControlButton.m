@@ -122,6 +122,15 @@
     CGFloat width = [self.properties[@"width"] floatValue];
     CGFloat height = [self.properties[@"height"] floatValue];
 
+    // Evaluating is slow, and the same expression on the same screen gives the same result
+    NSMutableDictionary *positions = [self.superview isKindOfClass:ControlLayout.class] ?
+        [(ControlLayout *)self.superview dynamicPositions] : nil;
+    NSString *positionKey = ControlLayout_dynamicPositionKey(string, width, height);
+    NSNumber *position = positions[positionKey];
+    if (position) {
+        return position.doubleValue;
+    }
+
     // Insert value to ${variable}
     INSERT_VALUE("top", @"0");
     INSERT_VALUE("left", @"0");
@@ -140,7 +149,9 @@
     // Calculate, since the dynamic position contains some math equations
     NSExpression *expression = [NSExpression expressionWithFormat:string];
     NSDictionary<NSString*, NSNumber*> *variables = @{@"pi": @(M_PI)};
-    return [[expression expressionValueWithObject:variables context:nil] floatValue] / screenScale;
+    CGFloat result = [[expression expressionValueWithObject:variables context:nil] floatValue] / screenScale;
+    positions[positionKey] = @(result);
+    return result;
 }
 
 // NOTE: Unlike Android's impl, this method uses dp instead of px (no call to dpToPx)
@@ -165,18 +176,41 @@
     }
 }
 
+- (void)setFrame:(CGRect)frame {
+    [super setFrame:frame];
+    if ([self.superview isKindOfClass:ControlLayout.class]) {
+        [(ControlLayout *)self.superview setNeedsHitTestUpdate];
+    }
+}
+
+- (void)setCenter:(CGPoint)center {
+    [super setCenter:center];
+    if ([self.superview isKindOfClass:ControlLayout.class]) {
+        [(ControlLayout *)self.superview setNeedsHitTestUpdate];
+    }
+}
+
 - (void)update {
     NSAssert(self.superview != nil, @"should not be nil");
 
-    self.displayInGame = [self.properties[@"displayInGame"] boolValue];
-    self.displayInMenu = [self.properties[@"displayInMenu"] boolValue];
-
     // net/kdt/pojavlaunch/customcontrols/ControlData.update()
     [self preProcessProperties];
 
     NSString *propDynamicX = (NSString *) self.properties[@"dynamicX"];
     NSString *propDynamicY = (NSString *) self.properties[@"dynamicY"];
 
+    // Calculate dynamic position
+    CGFloat propX = [self calculateDynamicPos:propDynamicX];
+    CGFloat propY = [self calculateDynamicPos:propDynamicY];
+    [self updateAtOrigin:CGPointMake(propX, propY)];
+}
+
+- (void)updateAtOrigin:(CGPoint)origin {
+    NSAssert(self.superview != nil, @"should not be nil");
+
+    self.displayInGame = [self.properties[@"displayInGame"] boolValue];
+    self.displayInMenu = [self.properties[@"displayInMenu"] boolValue];
+
     CGFloat propW = [self.properties[@"width"] floatValue];
     CGFloat propH = [self.properties[@"height"] floatValue];
     float propCornerRadius = [self.properties[@"cornerRadius"] floatValue];
@@ -184,12 +218,8 @@
     int propBackgroundColor = [self.properties[@"bgColor"] intValue];
     int propStrokeColor = [self.properties[@"strokeColor"] intValue];
 
-    // Calculate dynamic position
-    CGFloat propX = [self calculateDynamicPos:propDynamicX];
-    CGFloat propY = [self calculateDynamicPos:propDynamicY];
-
     // Update other properties
-    self.frame = CGRectMake(propX, propY, propW, propH);
+    self.frame = CGRectMake(origin.x, origin.y, propW, propH);
     self.alpha = [self.properties[@"opacity"] floatValue];
     self.alpha = MAX(self.alpha, isControlModifiable ? 0.1 : 0.01);
     self.backgroundColor = convertARGB2UIColor(propBackgroundColor);
@@ -17,9 +17,6 @@
 
 extern BOOL leftShiftHeld;
 
-extern CGFloat lastXValue; // lastHorizontalValue
-extern CGFloat lastYValue; // lastVerticalValue
-
 // From CustomControlsUtils
 NSMutableDictionary* createButton(NSString* name, int* keycodes, NSString* dynamicX, NSString* dynamicY, CGFloat width, CGFloat height);
 
@@ -102,7 +99,7 @@ NSMutableDictionary* createButton(NSString* name, int* keycodes, NSString* dynam
 - (void)touchesEnded:(NSSet *)touches withEvent:(UIEvent *)event {
     if (isControlModifiable) return;
 
-    lastXValue = lastYValue = 0;
+    [ControllerInput setMouseAxisX:0 Y:0];
     if (isGrabbing && self.fwdLockView && CGRectContainsPoint(self.fwdLockView.frame, [touches.anyObject locationInView:self])) {
         self.fwdLockView.center = self.thumb.center;
     } else {
@@ -125,8 +122,7 @@ NSMutableDictionary* createButton(NSString* name, int* keycodes, NSString* dynam
 
     if (!isGrabbing) {
         // Update virtual mouse position
-        lastXValue = xValue;
-        lastYValue = yValue;
+        [ControllerInput setMouseAxisX:xValue Y:yValue];
         return;
     }
 
@@ -198,18 +194,12 @@ NSMutableDictionary* createButton(NSString* name, int* keycodes, NSString* dynam
     self.background.center = self.mCenter;
 }
 
-- (void)update {
+- (void)updateAtOrigin:(CGPoint)origin {
     NSAssert(self.superview != nil, @"should not be nil");
 
     self.displayInGame = [self.properties[@"displayInGame"] boolValue];
     self.displayInMenu = [self.properties[@"displayInMenu"] boolValue];
 
-    // net/kdt/pojavlaunch/customcontrols/ControlData.update()
-    [self preProcessProperties];
-
-    NSString *propDynamicX = (NSString *) self.properties[@"dynamicX"];
-    NSString *propDynamicY = (NSString *) self.properties[@"dynamicY"];
-
     CGFloat propW = [self.properties[@"width"] floatValue];
     CGFloat propH = [self.properties[@"height"] floatValue];
     float propStrokeWidth = [self.properties[@"strokeWidth"] floatValue];
@@ -220,12 +210,8 @@ NSMutableDictionary* createButton(NSString* name, int* keycodes, NSString* dynam
     self.background.layer.borderColor = [convertARGB2UIColor(propStrokeColor) CGColor];
     self.background.layer.borderWidth = propStrokeWidth + 1;
 
-    // Calculate dynamic position
-    CGFloat propX = [self calculateDynamicPos:propDynamicX];
-    CGFloat propY = [self calculateDynamicPos:propDynamicY];
-
     // Update other properties
-    self.frame = CGRectMake(propX, propY, propW, propH);
+    self.frame = CGRectMake(origin.x, origin.y, propW, propH);
     self.alpha = [self.properties[@"opacity"] floatValue];
     self.alpha = MAX(self.alpha, isControlModifiable ? 0.1 : 0.01);
     self.layer.cornerRadius = MIN(self.frame.size.width, self.frame.size.height) / 2.0;
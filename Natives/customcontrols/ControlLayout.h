@@ -1,5 +1,10 @@
 #import <UIKit/UIKit.h>
 
+@class ControlButton;
+
+// Key of a dynamic position expression evaluated for a control of this size
+NSString* ControlLayout_dynamicPositionKey(NSString *expression, CGFloat width, CGFloat height);
+
 @interface CALayer(private)
 @property(atomic, assign) NSUInteger disableUpdateMask;
 @end
@@ -13,4 +18,12 @@
 - (void)removeAllButtons;
 - (void)hideViewFromCapture:(BOOL)hide;
 
+// Controls are hit tested through a grid, rebuilt after a control moves or is added or removed
+- (void)setNeedsHitTestUpdate;
+// Topmost control at point passing test, whether hidden or not
+- (ControlButton *)controlAtPoint:(CGPoint)point passingTest:(BOOL (^)(ControlButton *button))test;
+
+// Dynamic positions evaluated for the current bounds and button scale
+- (NSMutableDictionary<NSString *, NSNumber *> *)dynamicPositions;
+
 @end
@@ -1,14 +1,144 @@
 #import "ControlButton.h"
+#import "ControlDrawer.h"
+#import "ControlJoystick.h"
 #import "ControlLayout.h"
 #import "ControlSubButton.h"
 #import "CustomControlsUtils.h"
 #import "../LauncherPreferences.h"
 #import "../ios_uikit_bridge.h"
 #import "../utils.h"
+#include "../control_cache.h"
+#include "../control_grid.h"
 
-@interface ControlLayout ()
+// Evaluated positions are dropped past this, edits keep adding new ones
+#define MAX_DYNAMIC_POSITIONS 4096
+
+@interface ControlLayout () {
+    control_grid_t hitGrid;
+    BOOL hitGridValid;
+    NSMutableDictionary<NSString *, NSNumber *> *resolvedPositions;
+    CGSize resolvedPositionsSize;
+    CGFloat resolvedPositionsScale;
+}
+// Subviews the grid was built from, indexed like its controls
+@property(nonatomic) NSArray<UIView *> *hitGridViews;
 @end
 
+typedef struct {
+    __unsafe_unretained NSArray<UIView *> *views;
+    __unsafe_unretained BOOL (^test)(ControlButton *button);
+} ControlLayoutHitContext;
+
+// Same rules as -[UIView hitTest:withEvent:]
+static bool ControlLayout_canReceiveTouch(size_t index, void *ctx) {
+    UIView *view = ((__bridge NSArray<UIView *> *)ctx)[index];
+    return !view.hidden && view.userInteractionEnabled && view.alpha >= 0.01;
+}
+
+static bool ControlLayout_passesTest(size_t index, void *ctx) {
+    ControlLayoutHitContext *context = ctx;
+    UIView *view = context->views[index];
+    return [view isKindOfClass:ControlButton.class] && context->test((ControlButton *)view);
+}
+
+NSString* ControlLayout_dynamicPositionKey(NSString *expression, CGFloat width, CGFloat height) {
+    return [NSString stringWithFormat:@"%f %f %@", width, height, expression];
+}
+
+#pragma mark - Compiled layouts
+
+static NSString* ControlLayout_string(const control_cache_t *cache, uint32_t offset) {
+    return @(control_cache_string(cache, offset));
+}
+
+static NSMutableDictionary* ControlLayout_propertiesFromRecord(const control_cache_t *cache, const control_cache_record_t *record) {
+    NSMutableDictionary *properties = [[NSMutableDictionary alloc] init];
+    properties[@"name"] = ControlLayout_string(cache, record->name);
+    properties[@"keycodes"] = [[NSMutableArray alloc] initWithCapacity:4];
+    for (int i = 0; i < 4; i++) {
+        [properties[@"keycodes"] addObject:@(record->keycodes[i])];
+    }
+    properties[@"dynamicX"] = ControlLayout_string(cache, record->dynamic_x);
+    properties[@"dynamicY"] = ControlLayout_string(cache, record->dynamic_y);
+    properties[@"width"] = @(record->width);
+    properties[@"height"] = @(record->height);
+    properties[@"opacity"] = @(record->opacity);
+    properties[@"cornerRadius"] = @(record->corner_radius);
+    properties[@"strokeWidth"] = @(record->stroke_width);
+    properties[@"bgColor"] = @((int)record->bg_color);
+    properties[@"strokeColor"] = @((int)record->stroke_color);
+    properties[@"displayInGame"] = @((record->flags & CONTROL_FLAG_DISPLAY_IN_GAME) != 0);
+    properties[@"displayInMenu"] = @((record->flags & CONTROL_FLAG_DISPLAY_IN_MENU) != 0);
+    properties[@"isToggle"] = @((record->flags & CONTROL_FLAG_TOGGLE) != 0);
+    properties[@"passThruEnabled"] = @((record->flags & CONTROL_FLAG_PASS_THRU) != 0);
+    properties[@"isSwipeable"] = @((record->flags & CONTROL_FLAG_SWIPEABLE) != 0);
+    if (record->kind == CONTROL_KIND_JOYSTICK) {
+        properties[@"forwardLock"] = @((record->flags & CONTROL_FLAG_FORWARD_LOCK) != 0);
+    }
+    return properties;
+}
+
+// Compiled layouts are kept out of the controlmap folder the user browses
+static NSString* ControlLayout_cacheDirectory() {
+    return [NSString stringWithFormat:@"%s/cache/controlmap", getenv("POJAV_HOME")];
+}
+
+// Drops compiled forms of layouts that were deleted or renamed, and files
+// left behind by an interrupted write
+static void ControlLayout_pruneCaches() {
+    NSFileManager *fm = NSFileManager.defaultManager;
+    NSString *cacheDir = ControlLayout_cacheDirectory();
+    NSString *controlDir = [NSString stringWithFormat:@"%s/controlmap", getenv("POJAV_HOME")];
+    [fm createDirectoryAtPath:cacheDir withIntermediateDirectories:YES attributes:nil error:nil];
+    for (NSString *file in [fm contentsOfDirectoryAtPath:cacheDir error:nil]) {
+        NSString *name = [file stringByDeletingPathExtension];
+        if ([file.pathExtension isEqualToString:@"cache"] &&
+            [fm fileExistsAtPath:[controlDir stringByAppendingPathComponent:name]]) {
+            continue;
+        }
+        [fm removeItemAtPath:[cacheDir stringByAppendingPathComponent:file] error:nil];
+    }
+}
+
+static BOOL ControlLayout_internString(control_cache_builder_t *builder, id string, uint32_t *offset) {
+    if (string && ![string isKindOfClass:NSString.class]) {
+        return NO;
+    }
+    *offset = string ? control_cache_intern(builder, [string UTF8String]) : 0;
+    return *offset != UINT32_MAX;
+}
+
+// Only the properties controls read in game are kept
+static BOOL ControlLayout_recordFromButton(control_cache_builder_t *builder, ControlButton *button, control_cache_record_t *record) {
+    NSDictionary *properties = button.properties;
+    NSArray *keycodes = properties[@"keycodes"];
+    if (keycodes && ![keycodes isKindOfClass:NSArray.class]) {
+        return NO;
+    }
+    for (int i = 0; i < 4; i++) {
+        record->keycodes[i] = i < keycodes.count ? [keycodes[i] intValue] : 0;
+    }
+    record->x = button.frame.origin.x;
+    record->y = button.frame.origin.y;
+    record->width = [properties[@"width"] floatValue];
+    record->height = [properties[@"height"] floatValue];
+    record->opacity = [properties[@"opacity"] floatValue];
+    record->corner_radius = [properties[@"cornerRadius"] floatValue];
+    record->stroke_width = [properties[@"strokeWidth"] floatValue];
+    record->bg_color = (uint32_t)[properties[@"bgColor"] intValue];
+    record->stroke_color = (uint32_t)[properties[@"strokeColor"] intValue];
+    record->flags =
+        ([properties[@"displayInGame"] boolValue] ? CONTROL_FLAG_DISPLAY_IN_GAME : 0) |
+        ([properties[@"displayInMenu"] boolValue] ? CONTROL_FLAG_DISPLAY_IN_MENU : 0) |
+        ([properties[@"isToggle"] boolValue] ? CONTROL_FLAG_TOGGLE : 0) |
+        ([properties[@"passThruEnabled"] boolValue] ? CONTROL_FLAG_PASS_THRU : 0) |
+        ([properties[@"isSwipeable"] boolValue] ? CONTROL_FLAG_SWIPEABLE : 0) |
+        ([properties[@"forwardLock"] boolValue] ? CONTROL_FLAG_FORWARD_LOCK : 0);
+    return ControlLayout_internString(builder, properties[@"name"], &record->name) &&
+        ControlLayout_internString(builder, properties[@"dynamicX"], &record->dynamic_x) &&
+        ControlLayout_internString(builder, properties[@"dynamicY"], &record->dynamic_y);
+}
+
 @implementation ControlLayout
 
 - (void)loadControlLayout:(NSMutableDictionary *)layoutDictionary {
@@ -25,13 +155,191 @@
     [self removeAllButtons];
 
     NSString *controlFilePath = [NSString stringWithFormat:@"%s/controlmap/%@", getenv("POJAV_HOME"), name];
+    NSString *cachePath = [ControlLayout_cacheDirectory() stringByAppendingPathComponent:[name stringByAppendingString:@CONTROL_CACHE_SUFFIX]];
+
+    // In game, an unchanged layout comes straight from its compiled form
+    NSData *data = isControlModifiable ? nil : [NSData dataWithContentsOfFile:controlFilePath options:NSDataReadingMappedIfSafe error:nil];
+    uint64_t sourceHash = control_cache_hash(data.bytes, data.length);
+    int cacheErr = data ? [self loadCompiledControlFile:cachePath sourceHash:sourceHash] : ENOENT;
+    if (cacheErr == 0) {
+        return;
+    }
 
     self.layoutDictionary = parseJSONFromFile(controlFilePath);
     if (self.layoutDictionary[@"NSErrorObject"] != nil) {
         showDialog(localize(@"Error", nil), [NSString stringWithFormat:@"Could not open %@: %@", controlFilePath, [self.layoutDictionary[@"NSErrorObject"] localizedDescription]]);
         return;
     }
+    // Layouts that needed converting depend on the screen they were converted on
+    int version = [self.layoutDictionary[@"version"] intValue];
     [self loadControlLayout:self.layoutDictionary];
+    if (data && (version == 6 || version == 7)) {
+        // A layout was edited or replaced, others may have been deleted or renamed
+        if (cacheErr == ESTALE) {
+            ControlLayout_pruneCaches();
+        }
+        [self saveCompiledControlFile:cachePath sourceHash:sourceHash];
+    }
+}
+
+// Returns 0 on success, otherwise an errno-style error code
+- (int)loadCompiledControlFile:(NSString *)path sourceHash:(uint64_t)sourceHash {
+    control_cache_t cache;
+    int err = control_cache_open(&cache, path.fileSystemRepresentation, sourceHash);
+    if (err) {
+        if (err != ENOENT && err != ESTALE) {
+            NSLog(@"[ControlLayout] Ignoring compiled layout %@: %s", path, strerror(err));
+        }
+        return err;
+    }
+
+    // Positions resolved for this screen skip evaluating the dynamic expressions
+    const control_cache_header_t *header = cache.header;
+    BOOL resolved = header->screen_width == (float)self.bounds.size.width &&
+        header->screen_height == (float)self.bounds.size.height &&
+        header->screen_scale == (float)UIScreen.mainScreen.scale &&
+        header->button_scale == (float)getPrefFloat(@"control.button_scale");
+    NSMutableDictionary *positions = resolved ? self.dynamicPositions : nil;
+
+    NSMutableArray *controls = [[NSMutableArray alloc] init];
+    NSMutableArray *drawers = [[NSMutableArray alloc] init];
+    NSMutableArray *joysticks = [[NSMutableArray alloc] init];
+    self.layoutDictionary = [@{
+        @"version": @(header->layout_version),
+        @"scaledAt": @(header->scaled_at),
+        @"mControlDataList": controls,
+        @"mDrawerDataList": drawers,
+        @"mJoystickDataList": joysticks
+    } mutableCopy];
+
+    // Controls are created straight from the records, in the order they were
+    // saved in. Each keeps a properties dictionary, that's what editing and
+    // touch handling read, but nothing goes through loadControlObject
+    NSMutableArray<ControlButton *> *buttons = [[NSMutableArray alloc] initWithCapacity:header->record_count];
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const control_cache_record_t *record = &cache.records[i];
+        NSMutableDictionary *properties = ControlLayout_propertiesFromRecord(&cache, record);
+        ControlButton *button;
+        switch (record->kind) {
+            case CONTROL_KIND_BUTTON:
+                button = [ControlButton buttonWithProperties:properties];
+                [controls addObject:properties];
+                break;
+            case CONTROL_KIND_DRAWER: {
+                NSMutableDictionary *drawerData = [@{
+                    @"properties": properties,
+                    @"orientation": ControlLayout_string(&cache, record->orientation),
+                    @"buttonProperties": [[NSMutableArray alloc] init]
+                } mutableCopy];
+                button = [ControlDrawer buttonWithData:drawerData];
+                [drawers addObject:drawerData];
+                break;
+            }
+            case CONTROL_KIND_SUB_BUTTON: {
+                // The parent was checked to be an earlier drawer record
+                ControlDrawer *drawer = (ControlDrawer *)buttons[record->parent];
+                button = [ControlSubButton buttonWithProperties:properties];
+                [drawer.drawerData[@"buttonProperties"] addObject:properties];
+                [drawer addButton:(ControlSubButton *)button];
+                break;
+            }
+            case CONTROL_KIND_JOYSTICK:
+                button = [ControlJoystick buttonWithProperties:properties];
+                [joysticks addObject:properties];
+                break;
+        }
+        [self addSubview:button];
+        [buttons addObject:button];
+        positions[ControlLayout_dynamicPositionKey(properties[@"dynamicX"], record->width, record->height)] = @(record->x);
+        positions[ControlLayout_dynamicPositionKey(properties[@"dynamicY"], record->width, record->height)] = @(record->y);
+    }
+
+    @try {
+        for (uint32_t i = 0; i < header->record_count; i++) {
+            if (resolved) {
+                // Sub buttons were saved already lined up with their drawer
+                [buttons[i] updateAtOrigin:CGPointMake(cache.records[i].x, cache.records[i].y)];
+            } else if (cache.records[i].kind != CONTROL_KIND_SUB_BUTTON) {
+                // Drawers line up their buttons again
+                [buttons[i] update];
+            }
+        }
+    } @catch (NSException *exception) {
+        // Let the layout file report it
+        NSLog(@"[ControlLayout] Ignoring compiled layout %@: %@", path, exception.reason);
+        err = EINVAL;
+    }
+    control_cache_close(&cache);
+    if (err) {
+        [self removeAllButtons];
+        return err;
+    }
+    self.layoutDictionary[@"scaledAt"] = getPrefObject(@"control.button_scale");
+    return 0;
+}
+
+- (void)saveCompiledControlFile:(NSString *)path sourceHash:(uint64_t)sourceHash {
+    // Skip layouts with controls that failed to load
+    NSUInteger expected = [self.layoutDictionary[@"mControlDataList"] count] + [self.layoutDictionary[@"mJoystickDataList"] count];
+    for (NSDictionary *drawerData in self.layoutDictionary[@"mDrawerDataList"]) {
+        expected += 1 + [drawerData[@"buttonProperties"] count];
+    }
+    if (self.subviews.count != expected) {
+        return;
+    }
+
+    control_cache_builder_t builder;
+    if (control_cache_builder_init(&builder) != 0) {
+        return;
+    }
+    NSMutableArray<ControlDrawer *> *drawers = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *drawerRecords = [[NSMutableArray alloc] init];
+    BOOL compiled = YES;
+    for (UIView *view in self.subviews) {
+        if (![view isKindOfClass:ControlButton.class]) {
+            compiled = NO;
+            break;
+        }
+        control_cache_record_t record = {.parent = -1};
+        if ([view isKindOfClass:ControlDrawer.class]) {
+            ControlDrawer *drawer = (ControlDrawer *)view;
+            record.kind = CONTROL_KIND_DRAWER;
+            compiled = ControlLayout_internString(&builder, drawer.drawerData[@"orientation"], &record.orientation);
+            [drawers addObject:drawer];
+            [drawerRecords addObject:@(builder.count)];
+        } else if ([view isKindOfClass:ControlSubButton.class]) {
+            NSUInteger drawer = [drawers indexOfObjectIdenticalTo:((ControlSubButton *)view).parentDrawer];
+            record.kind = CONTROL_KIND_SUB_BUTTON;
+            record.parent = drawer == NSNotFound ? -1 : drawerRecords[drawer].intValue;
+            compiled = drawer != NSNotFound;
+        } else if ([view isKindOfClass:ControlJoystick.class]) {
+            record.kind = CONTROL_KIND_JOYSTICK;
+        } else {
+            record.kind = CONTROL_KIND_BUTTON;
+        }
+        if (!compiled || !ControlLayout_recordFromButton(&builder, (ControlButton *)view, &record) ||
+            control_cache_add(&builder, &record) != 0) {
+            compiled = NO;
+            break;
+        }
+    }
+
+    if (compiled) {
+        control_cache_header_t header = {
+            .source_hash = sourceHash,
+            .screen_width = self.bounds.size.width,
+            .screen_height = self.bounds.size.height,
+            .screen_scale = UIScreen.mainScreen.scale,
+            .button_scale = getPrefFloat(@"control.button_scale"),
+            .layout_version = [self.layoutDictionary[@"version"] intValue],
+            .scaled_at = [self.layoutDictionary[@"scaledAt"] floatValue]
+        };
+        int err = control_cache_write(&builder, &header, path.fileSystemRepresentation);
+        if (err) {
+            NSLog(@"[ControlLayout] Could not write compiled layout %@: %s", path, strerror(err));
+        }
+    }
+    control_cache_builder_free(&builder);
 }
 
 - (void)removeAllButtons {
@@ -58,8 +366,76 @@
     return YES;
 }
 
+- (void)dealloc {
+    control_grid_free(&hitGrid);
+}
+
+- (NSMutableDictionary<NSString *, NSNumber *> *)dynamicPositions {
+    CGFloat buttonScale = getPrefFloat(@"control.button_scale");
+    if (!resolvedPositions || resolvedPositions.count > MAX_DYNAMIC_POSITIONS ||
+        !CGSizeEqualToSize(resolvedPositionsSize, self.bounds.size) || resolvedPositionsScale != buttonScale) {
+        resolvedPositions = [[NSMutableDictionary alloc] init];
+        resolvedPositionsSize = self.bounds.size;
+        resolvedPositionsScale = buttonScale;
+    }
+    return resolvedPositions;
+}
+
+- (void)setNeedsHitTestUpdate {
+    hitGridValid = NO;
+}
+
+- (void)didAddSubview:(UIView *)subview {
+    [super didAddSubview:subview];
+    hitGridValid = NO;
+}
+
+- (void)willRemoveSubview:(UIView *)subview {
+    [super willRemoveSubview:subview];
+    hitGridValid = NO;
+}
+
+- (void)updateHitGrid {
+    if (hitGridValid) return;
+    NSArray<UIView *> *views = self.subviews;
+    control_rect_t *rects = malloc(MAX(views.count, 1) * sizeof(control_rect_t));
+    for (NSUInteger i = 0; i < views.count; i++) {
+        CGRect frame = views[i].frame;
+        rects[i] = (control_rect_t){frame.origin.x, frame.origin.y, frame.size.width, frame.size.height};
+    }
+    control_grid_free(&hitGrid);
+    hitGridValid = control_grid_build(&hitGrid, rects, views.count, self.bounds.size.width, self.bounds.size.height) == 0;
+    free(rects);
+    self.hitGridViews = views;
+}
+
+- (ControlButton *)controlAtPoint:(CGPoint)point passingTest:(BOOL (^)(ControlButton *button))test {
+    [self updateHitGrid];
+    ControlLayoutHitContext context = {self.hitGridViews, test};
+    int index = control_grid_hit(&hitGrid, point.x, point.y, ControlLayout_passesTest, &context);
+    return index < 0 ? nil : (ControlButton *)self.hitGridViews[index];
+}
+
 - (UIView *)hitTest:(CGPoint)point withEvent:(UIEvent *)event {
-    UIView *result = [super hitTest:point withEvent:event];
+    if (self.hidden || !self.userInteractionEnabled || self.alpha < 0.01 || ![self pointInside:point withEvent:event]) {
+        return nil;
+    }
+    // Called for every touch, only look at the controls around the point
+    [self updateHitGrid];
+    int index = control_grid_hit(&hitGrid, point.x, point.y, ControlLayout_canReceiveTouch, (__bridge void *)self.hitGridViews);
+    UIView *result;
+    if (!hitGridValid) {
+        result = [super hitTest:point withEvent:event];
+    } else if (index >= 0) {
+        UIView *view = self.hitGridViews[index];
+        result = [view hitTest:[self convertPoint:point toView:view] withEvent:event];
+        if (!result) {
+            // Not a plain rectangle after all, let UIKit decide
+            result = [super hitTest:point withEvent:event];
+        }
+    } else {
+        result = self;
+    }
     if (result == self && !isControlModifiable) {
         return nil;
     }
@@ -68,6 +444,7 @@
 
 - (void)setFrame:(CGRect)frame {
     [super setFrame:frame];
+    hitGridValid = NO;
 
     for (UIView *view in self.subviews) {
         if (![view isKindOfClass:ControlButton.class]) {
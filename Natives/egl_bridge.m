@@ -17,6 +17,7 @@
 #include "glfw_keycodes.h"
 #include "ctxbridges/bridge_tbl.h"
 #include "ctxbridges/osmesa_internal.h"
+#include "launch_timeline.h"
 #include "utils.h"
 
 int clientAPI;
@@ -42,6 +43,7 @@ void* pojavGetCurrentContext() {
 }
 
 int pojavInit(BOOL useStackQueue) {
+    launch_timeline_mark("GLFW init");
     clientAPI = GLFW_OPENGL_API;
     isInputReady = 1;
     isUseStackQueueCall = useStackQueue;
@@ -91,6 +93,18 @@ void pojavSetWindowHint(int hint, int value) {
 
 void pojavSwapBuffers() {
     br_swap_buffers();
+
+    static BOOL firstFrame = YES;
+    if (firstFrame) {
+        firstFrame = NO;
+        launch_timeline_mark("First frame");
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+            NSString *path = [NSString stringWithFormat:@"%s/startup_trace.json", getenv("POJAV_HOME")];
+            if (launch_timeline_write(path.fileSystemRepresentation)) {
+                NSLog(@"[Timeline] Wrote startup timeline to %@", path);
+            }
+        });
+    }
 }
 
 void pojavMakeCurrent(basic_render_window_t* window) {
@@ -106,10 +120,15 @@ void* pojavCreateContext(basic_render_window_t* contextSrc) {
     static BOOL inited = NO;
     if (!inited) {
         inited = YES;
+        launch_timeline_begin("Renderer init");
         pojavInitOpenGL();
+        launch_timeline_end("Renderer init");
     }
 
-    return br_init_context(contextSrc);
+    launch_timeline_begin("Context creation");
+    void *context = br_init_context(contextSrc);
+    launch_timeline_end("Context creation");
+    return context;
 }
 
 void pojavSwapInterval(int interval) {
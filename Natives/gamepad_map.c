@@ -0,0 +1,91 @@
+#include <math.h>
+
+#include "gamepad_map.h"
+#include "glfw_keycodes.h"
+
+void gamepad_map_init(gamepad_map_t *map) {
+    for (int mode = 0; mode < GAMEPAD_MODE_COUNT; mode++) {
+        for (int i = 0; i < GAMEPAD_MAP_BUTTONS; i++) {
+            map->keycodes[mode][i] = GLFW_KEY_UNKNOWN;
+        }
+    }
+}
+
+int gamepad_map_index(int button) {
+    if (button >= 0 && button <= GLFW_GAMEPAD_BUTTON_LAST) {
+        return button;
+    } else if (button == GLFW_GAMEPAD_BUTTON_LEFT_TRIGGER) {
+        return GLFW_GAMEPAD_BUTTON_LAST + 1;
+    } else if (button == GLFW_GAMEPAD_BUTTON_RIGHT_TRIGGER) {
+        return GLFW_GAMEPAD_BUTTON_LAST + 2;
+    }
+    return -1;
+}
+
+bool gamepad_map_set(gamepad_map_t *map, gamepad_mode_t mode, int button, int keycode) {
+    int index = gamepad_map_index(button);
+    if (index < 0 || (unsigned)mode >= GAMEPAD_MODE_COUNT || keycode < INT16_MIN || keycode > INT16_MAX) {
+        return false;
+    }
+    map->keycodes[mode][index] = (int16_t)keycode;
+    return true;
+}
+
+int gamepad_map_lookup(const gamepad_map_t *map, gamepad_mode_t mode, int button) {
+    int index = gamepad_map_index(button);
+    if (index < 0 || (unsigned)mode >= GAMEPAD_MODE_COUNT) {
+        return GLFW_KEY_UNKNOWN;
+    }
+    return map->keycodes[mode][index];
+}
+
+#pragma mark - Sticks
+
+float gamepad_stick_magnitude(float x, float y, float deadzone) {
+    float length = sqrtf(x * x + y * y);
+    if (length <= deadzone) return 0;
+    float magnitude = (length - deadzone) / (1 - deadzone);
+    return magnitude > 1 ? 1 : magnitude;
+}
+
+int gamepad_stick_direction(float x, float y, float deadzone) {
+    if (gamepad_stick_magnitude(x, y, deadzone) == 0) {
+        return GAMEPAD_DIRECTION_NONE;
+    }
+    float degree = atan2f(y, x) * (float)(180.0 / M_PI);
+    if (degree < 0) {
+        degree += 360;
+    }
+    return (int)((degree + 22.5f) / 45.0f) % 8;
+}
+
+unsigned gamepad_direction_keys(int direction) {
+    // East, north east, ..., south east
+    static const unsigned keys[8] = {
+        GAMEPAD_KEY_D,
+        GAMEPAD_KEY_W | GAMEPAD_KEY_D,
+        GAMEPAD_KEY_W,
+        GAMEPAD_KEY_W | GAMEPAD_KEY_A,
+        GAMEPAD_KEY_A,
+        GAMEPAD_KEY_A | GAMEPAD_KEY_S,
+        GAMEPAD_KEY_S,
+        GAMEPAD_KEY_S | GAMEPAD_KEY_D
+    };
+    return direction >= 0 && direction < 8 ? keys[direction] : 0;
+}
+
+bool gamepad_stick_mouse_delta(const gamepad_stick_config_t *config, float x, float y, double dt, float *dx, float *dy) {
+    float length = sqrtf(x * x + y * y);
+    float magnitude = gamepad_stick_magnitude(x, y, config->deadzone);
+    if (magnitude == 0) {
+        *dx = *dy = 0;
+        return false;
+    }
+    // The rescaled deflection, slowed down further near the center
+    float acceleration = powf(magnitude, config->acceleration);
+    // Scale of 1 = 60Hz
+    float scale = config->speed * magnitude * acceleration * (float)(dt * 60.0) / length;
+    *dx = x * scale;
+    *dy = -y * scale;
+    return true;
+}
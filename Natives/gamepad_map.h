@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Gamepad mappings compiled from the controlmap JSON into one keycode per
+// button and mode, so a button event is a single array load. Also holds the
+// stick math shared by the controller and its polling timer.
+
+// GLFW gamepad buttons, then the left and right triggers
+#define GAMEPAD_MAP_BUTTONS 17
+
+typedef enum {
+    GAMEPAD_MODE_GAME,
+    GAMEPAD_MODE_MENU,
+    GAMEPAD_MODE_COUNT
+} gamepad_mode_t;
+
+typedef struct {
+    // GLFW_KEY_UNKNOWN where a button has no mapping
+    int16_t keycodes[GAMEPAD_MODE_COUNT][GAMEPAD_MAP_BUTTONS];
+} gamepad_map_t;
+
+// Stick directions, counter clockwise from east in 45 degree steps
+#define GAMEPAD_DIRECTION_NONE -1
+
+// WASD key bits of a direction
+#define GAMEPAD_KEY_W (1 << 0)
+#define GAMEPAD_KEY_A (1 << 1)
+#define GAMEPAD_KEY_S (1 << 2)
+#define GAMEPAD_KEY_D (1 << 3)
+
+typedef struct {
+    // Radial deadzone, the range outside it is rescaled to start at zero
+    float deadzone;
+    // Pixels per 60 Hz frame at full deflection
+    float speed;
+    // Speed is scaled by the deflection to the power of this on top
+    float acceleration;
+} gamepad_stick_config_t;
+
+void gamepad_map_init(gamepad_map_t *map);
+// Table index of a GLFW gamepad button or trigger, or -1
+int gamepad_map_index(int button);
+// Later mappings of the same button replace earlier ones. Returns false for
+// buttons and keycodes the table can't hold
+bool gamepad_map_set(gamepad_map_t *map, gamepad_mode_t mode, int button, int keycode);
+// GLFW_KEY_UNKNOWN for unmapped and unknown buttons
+int gamepad_map_lookup(const gamepad_map_t *map, gamepad_mode_t mode, int button);
+
+// Deflection past the deadzone, from 0 to 1
+float gamepad_stick_magnitude(float x, float y, float deadzone);
+// GAMEPAD_DIRECTION_NONE inside the deadzone
+int gamepad_stick_direction(float x, float y, float deadzone);
+unsigned gamepad_direction_keys(int direction);
+// Mouse movement for dt seconds of deflection, y pointing down. Returns
+// false when the stick is inside the deadzone
+bool gamepad_stick_mouse_delta(const gamepad_stick_config_t *config, float x, float y, double dt, float *dx, float *dy);
@@ -0,0 +1,81 @@
+#include <math.h>
+
+#include "gyro_filter.h"
+
+// Longest interval a single sample may cover
+#define MAX_SAMPLE_INTERVAL 0.05
+// Accumulated pixels are stored in 1/4096ths
+#define FIXED_ONE 4096.0f
+
+void gyro_filter_init(gyro_filter_t *filter, const gyro_filter_config_t *config) {
+    filter->config = *config;
+    gyro_filter_reset(filter);
+}
+
+void gyro_filter_reset(gyro_filter_t *filter) {
+    filter->value[0] = filter->value[1] = 0;
+    filter->derivative[0] = filter->derivative[1] = 0;
+    filter->last_time = 0;
+    filter->primed = false;
+}
+
+// Smoothing factor of a low pass filter with the given cutoff
+static inline float smoothing(float cutoff, double dt) {
+    float tau = 1.0f / (2.0f * (float)M_PI * cutoff);
+    return 1.0f / (1.0f + tau / (float)dt);
+}
+
+double gyro_filter_update(gyro_filter_t *filter, double time, const float rate[2], float out[2]) {
+    double dt = filter->primed ? time - filter->last_time : 0;
+    if (dt > MAX_SAMPLE_INTERVAL) {
+        dt = MAX_SAMPLE_INTERVAL;
+    }
+    filter->last_time = time;
+
+    const gyro_filter_config_t *config = &filter->config;
+    if (!filter->primed || dt <= 0 || config->min_cutoff <= 0) {
+        for (int i = 0; i < 2; i++) {
+            filter->value[i] = out[i] = rate[i];
+            filter->derivative[i] = 0;
+        }
+        filter->primed = true;
+        return dt > 0 ? dt : 0;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        float derivative = (rate[i] - filter->value[i]) / (float)dt;
+        filter->derivative[i] += smoothing(config->derivative_cutoff, dt) * (derivative - filter->derivative[i]);
+        float cutoff = config->min_cutoff + config->beta * fabsf(filter->derivative[i]);
+        filter->value[i] += smoothing(cutoff, dt) * (rate[i] - filter->value[i]);
+        out[i] = filter->value[i];
+    }
+    return dt;
+}
+
+#pragma mark - Accumulator
+
+static inline uint64_t pack(int32_t x, int32_t y) {
+    return (uint64_t)(uint32_t)x << 32 | (uint32_t)y;
+}
+
+static inline int32_t add_saturated(int32_t value, float delta) {
+    double sum = (double)value + roundf(delta * FIXED_ONE);
+    return sum > INT32_MAX ? INT32_MAX : (sum < INT32_MIN ? INT32_MIN : (int32_t)sum);
+}
+
+void gyro_accumulator_add(gyro_accumulator_t *accumulator, float dx, float dy) {
+    if (!isfinite(dx) || !isfinite(dy)) return;
+    uint64_t old = atomic_load_explicit(&accumulator->packed, memory_order_relaxed);
+    uint64_t updated;
+    do {
+        updated = pack(add_saturated((int32_t)(old >> 32), dx), add_saturated((int32_t)old, dy));
+    } while (!atomic_compare_exchange_weak_explicit(&accumulator->packed, &old, updated,
+        memory_order_relaxed, memory_order_relaxed));
+}
+
+bool gyro_accumulator_take(gyro_accumulator_t *accumulator, float *dx, float *dy) {
+    uint64_t packed = atomic_exchange_explicit(&accumulator->packed, 0, memory_order_relaxed);
+    *dx = (int32_t)(packed >> 32) / FIXED_ONE;
+    *dy = (int32_t)packed / FIXED_ONE;
+    return packed != 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Gyro aiming runs at the sensor rate: every rotation rate sample is
+// smoothed with a one-euro filter, integrated over its own interval and
+// added to an accumulator, which the render side empties once per frame.
+// The aim then doesn't depend on how often frames happen to come.
+
+typedef struct {
+    // Cutoff in Hz for a still device, lower removes more jitter
+    float min_cutoff;
+    // How fast the cutoff rises with the rotation speed, higher lags less
+    float beta;
+    // Cutoff in Hz for the speed estimate itself
+    float derivative_cutoff;
+} gyro_filter_config_t;
+
+typedef struct {
+    gyro_filter_config_t config;
+    float value[2], derivative[2];
+    double last_time;
+    bool primed;
+} gyro_filter_t;
+
+// Pixels moved since the last take, as two 32 bit fixed point numbers in
+// one word so both axes are added and taken at once without a lock
+typedef struct {
+    _Atomic uint64_t packed;
+} gyro_accumulator_t;
+
+// A min_cutoff of 0 turns filtering off
+void gyro_filter_init(gyro_filter_t *filter, const gyro_filter_config_t *config);
+// Starts over at the next sample, e.g. after sensor updates were paused
+void gyro_filter_reset(gyro_filter_t *filter);
+// Filters the x and y rates sampled at time seconds into out. Returns the
+// seconds covered by this sample: 0 for the first one, and gaps after a
+// stall are clamped so they don't turn into a jump
+double gyro_filter_update(gyro_filter_t *filter, double time, const float rate[2], float out[2]);
+
+void gyro_accumulator_add(gyro_accumulator_t *accumulator, float dx, float dy);
+// Takes everything added so far. Returns false if that was nothing
+bool gyro_accumulator_take(gyro_accumulator_t *accumulator, float *dx, float *dy);
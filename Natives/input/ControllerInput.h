@@ -6,6 +6,7 @@
 + (void)initKeycodeTable;
 + (void)registerControllerCallbacks:(GCController *)controller;
 + (void)unregisterControllerCallbacks:(GCController *)controller;
-+ (void)tick;
+// Stick position driving the mouse, moved at a fixed rate while deflected
++ (void)setMouseAxisX:(CGFloat)xValue Y:(CGFloat)yValue;
 
 @end
@@ -4,55 +4,67 @@
 #import "../SurfaceViewController.h"
 #import "../utils.h"
 
+#include "../gamepad_map.h"
 #include "../glfw_keycodes.h"
 
-// Left thumbstick directions
-#define DIRECTION_EAST 0
-#define DIRECTION_NORTH_EAST 1
-//#define DIRECTION_NORTH 2
-#define DIRECTION_NORTH_WEST 3
-//#define DIRECTION_WEST 4
-#define DIRECTION_SOUTH_WEST 5
-//#define DIRECTION_SOUTH 6
-#define DIRECTION_SOUTH_EAST 7
-#define MOUSE_MAX_ACCELERATION 2
-
-CFAbsoluteTime lastFrameTime;
-CGFloat lastXValue; // lastHorizontalValue
-CGFloat lastYValue; // lastVerticalValue
+// The mouse moves at a fixed rate of its own instead of with the display link,
+// which the system may throttle
+#define MOUSE_POLL_RATE 120
+#define STICK_DEADZONE 0.05f
 
-@implementation ControllerInput
+static const gamepad_stick_config_t mouseStick = {
+    .deadzone = STICK_DEADZONE,
+    .speed = 18,
+    .acceleration = 2
+};
+
+static gamepad_map_t keycodeMap;
+static BOOL keycodeMapLoaded;
+
+static dispatch_source_t mouseTimer;
+static CFTimeInterval lastFrameTime;
+static CGFloat lastXValue; // lastHorizontalValue
+static CGFloat lastYValue; // lastVerticalValue
 
-NSMutableDictionary *gameMap, *menuMap;
 BOOL leftShiftHeld;
 
+void init_compileGamepadMappings(NSArray *mappings, gamepad_mode_t mode) {
+    if (![mappings isKindOfClass:NSArray.class]) return;
+    for (NSDictionary *buttonDict in mappings) {
+        if (![buttonDict isKindOfClass:NSDictionary.class]) continue;
+        int button = [buttonDict[@"gamepad_button"] intValue];
+        int keycode = [buttonDict[@"keycode"] intValue];
+        if (!gamepad_map_set(&keycodeMap, mode, button, keycode)) {
+            NSLog(@"[ControllerInput] Ignoring mapping of gamepad button %d to %d", button, keycode);
+        }
+    }
+}
+
+@implementation ControllerInput
+
 + (void)initKeycodeTable {
-    if (gameMap && menuMap) {
+    if (keycodeMapLoaded) {
         return;
     }
     
+    // Unmapped until the layout is read, also when it can't be
+    gamepad_map_init(&keycodeMap);
+
     NSString *controlFile = [PLProfiles resolveKeyForCurrentProfile:@"defaultGamepadCtrl"];
     NSString *gamepadPath = [NSString stringWithFormat:@"%s/controlmap/gamepads/%@", getenv("POJAV_HOME"), controlFile];
     NSMutableDictionary *gamepadJSON = parseJSONFromFile(gamepadPath);
-    
-    gameMap = gamepadJSON[@"mGameMappingList"];
-    menuMap = gamepadJSON[@"mMenuMappingList"];
+    if (gamepadJSON[@"NSErrorObject"]) {
+        return;
+    }
+
+    // Compiled once, so a button press is a table lookup
+    init_compileGamepadMappings(gamepadJSON[@"mGameMappingList"], GAMEPAD_MODE_GAME);
+    init_compileGamepadMappings(gamepadJSON[@"mMenuMappingList"], GAMEPAD_MODE_MENU);
+    keycodeMapLoaded = YES;
 }
 
 + (void)sendKeyEvent:(int)controllerKeycode pressed:(BOOL)pressed {
-    int keycode;
-    __block NSMutableDictionary *mapping;
-    if (isGrabbing) {
-        mapping = gameMap;
-    } else {
-        mapping = menuMap;
-    }
-    
-    for (NSMutableDictionary *buttonDict in mapping) {
-        if(controllerKeycode == [buttonDict[@"gamepad_button"] intValue]) {
-            keycode = [buttonDict[@"keycode"] intValue];
-        }
-    }
+    int keycode = gamepad_map_lookup(&keycodeMap, isGrabbing ? GAMEPAD_MODE_GAME : GAMEPAD_MODE_MENU, controllerKeycode);
 
     switch (keycode) {
         case GLFW_KEY_UNKNOWN:
@@ -143,45 +155,28 @@ BOOL leftShiftHeld;
     gamepad.leftThumbstick.valueChangedHandler = ^(GCControllerDirectionPad * _Nonnull dpad, float xValue, float yValue) {
         if (!isGrabbing) {
             // Update virtual mouse position
-            lastXValue = xValue;
-            lastYValue = yValue;
+            [self setMouseAxisX:xValue Y:yValue];
             return;
         }
 
-        static char lastLThumbDirection = -2;
-        char direction = -1;
-        if (xValue != 0 && yValue != 0) {
-            CGFloat degree = atan2f(yValue, xValue) * (180.0 / M_PI);
-            if (degree < 0) {
-                degree += 360;
-            }
-            direction = (int)((degree+22.5)/45.0) % 8;
-        }
+        static int lastLThumbDirection = -2;
+        int direction = gamepad_stick_direction(xValue, yValue, STICK_DEADZONE);
         if (lastLThumbDirection == direction) {
             return;
         }
 
         // Update WASD states
-        CallbackBridge_nativeSendKey(GLFW_KEY_W, 0,
-            direction >= DIRECTION_NORTH_EAST &&
-            direction <= DIRECTION_NORTH_WEST, 0);
-        CallbackBridge_nativeSendKey(GLFW_KEY_A, 0,
-            direction >= DIRECTION_NORTH_WEST &&
-            direction <= DIRECTION_SOUTH_WEST, 0);
-        CallbackBridge_nativeSendKey(GLFW_KEY_S, 0,
-            direction >= DIRECTION_SOUTH_WEST &&
-            direction <= DIRECTION_SOUTH_EAST, 0);
-        CallbackBridge_nativeSendKey(GLFW_KEY_D, 0,
-            direction == DIRECTION_SOUTH_EAST ||
-            direction == DIRECTION_EAST ||
-            direction == DIRECTION_NORTH_EAST, 0);
+        unsigned keys = gamepad_direction_keys(direction);
+        CallbackBridge_nativeSendKey(GLFW_KEY_W, 0, (keys & GAMEPAD_KEY_W) != 0, 0);
+        CallbackBridge_nativeSendKey(GLFW_KEY_A, 0, (keys & GAMEPAD_KEY_A) != 0, 0);
+        CallbackBridge_nativeSendKey(GLFW_KEY_S, 0, (keys & GAMEPAD_KEY_S) != 0, 0);
+        CallbackBridge_nativeSendKey(GLFW_KEY_D, 0, (keys & GAMEPAD_KEY_D) != 0, 0);
 
         lastLThumbDirection = direction;
     };
     gamepad.rightThumbstick.valueChangedHandler = ^(GCControllerDirectionPad * _Nonnull dpad, float xValue, float yValue) {
         if (isGrabbing) {
-            lastXValue = xValue;
-            lastYValue = yValue;
+            [self setMouseAxisX:xValue Y:yValue];
         }
     };
     gamepad.leftThumbstickButton.pressedChangedHandler = ^(GCControllerButtonInput * _Nonnull button, float value, BOOL pressed) {
@@ -192,25 +187,34 @@ BOOL leftShiftHeld;
     };
 }
 
++ (void)setMouseAxisX:(CGFloat)xValue Y:(CGFloat)yValue {
+    lastXValue = xValue;
+    lastYValue = yValue;
+
+    // Only keep the timer around while the stick is deflected
+    BOOL moving = gamepad_stick_magnitude(xValue, yValue, STICK_DEADZONE) > 0;
+    if (moving && !mouseTimer) {
+        lastFrameTime = CACurrentMediaTime();
+        mouseTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        uint64_t interval = NSEC_PER_SEC / MOUSE_POLL_RATE;
+        dispatch_source_set_timer(mouseTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, NSEC_PER_MSEC);
+        dispatch_source_set_event_handler(mouseTimer, ^{
+            [self tick];
+        });
+        dispatch_resume(mouseTimer);
+    } else if (!moving && mouseTimer) {
+        dispatch_source_cancel(mouseTimer);
+        mouseTimer = nil;
+    }
+}
+
 /**
  * Send the new mouse position, computing the delta
  */
 + (void)tick {
-    // There isn't a convenient way to get ns, use ms at this point
-    CGFloat frameTime = CACurrentMediaTime();
-    // GameController automatically performs deadzone calculations
-    // so we just take the raw input
-    if (lastFrameTime != 0 && (lastXValue != 0 || lastYValue != 0)) {
-        CGFloat acceleration = pow(MathUtils_dist(0, 0, lastXValue, lastYValue), MOUSE_MAX_ACCELERATION); // magnitude
-        if (acceleration > 1) acceleration = 1;
-
-        // Compute delta since last tick time
-        CGFloat deltaX = lastXValue * acceleration * 18;
-        CGFloat deltaY = -lastYValue * acceleration * 18;
-        CGFloat deltaTimeScale = (frameTime - lastFrameTime) / (1.0/60.0); // Scale of 1 = 60Hz
-        deltaX *= deltaTimeScale;
-        deltaY *= deltaTimeScale;
-
+    CFTimeInterval frameTime = CACurrentMediaTime();
+    float deltaX, deltaY;
+    if (gamepad_stick_mouse_delta(&mouseStick, lastXValue, lastYValue, frameTime - lastFrameTime, &deltaX, &deltaY)) {
         SurfaceViewController *vc = (id)UIWindow.mainWindow.rootViewController;
         [vc sendTouchPoint:CGPointMake(deltaX, deltaY) withEvent:ACTION_MOVE_MOTION];
     }
@@ -238,6 +242,7 @@ BOOL leftShiftHeld;
     gamepad.rightThumbstick.valueChangedHandler = nil;
     gamepad.leftThumbstickButton.pressedChangedHandler = nil;
     gamepad.rightThumbstickButton.pressedChangedHandler = nil;
+    [self setMouseAxisX:0 Y:0];
 }
 
 @end
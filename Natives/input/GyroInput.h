@@ -3,6 +3,8 @@
 @interface GyroInput : NSObject
 
 + (void)updateOrientation;
+// The game window was resized or grabbed the cursor
++ (void)updateWindow;
 + (void)updateSensitivity:(int)sensitivity invertXAxis:(BOOL)invertX;
 + (void)tick;
 
@@ -4,68 +4,128 @@
 #import "../SurfaceViewController.h"
 #import "../utils.h"
 
+#include "../gyro_filter.h"
+
+// Samples are taken as fast as device motion goes, about 100 Hz
+#define GYRO_SAMPLE_RATE 100
+
+// Light smoothing while still, hardly any lag on quick turns
+static const gyro_filter_config_t gyroFilterConfig = {
+    .min_cutoff = 4,
+    .beta = 0.5,
+    .derivative_cutoff = 1
+};
+
+// Everything processMotion reads, gyroQueue gets a copy whenever it changes
+typedef struct {
+    CGFloat sensitivity;
+    int invertX;
+    BOOL invertAxis, swapAxis;
+    BOOL grabbing;
+    int windowWidth, windowHeight;
+} GyroInputSettings;
+
 @implementation GyroInput
 
-static CGFloat lastXValue, lastYValue, lastFrameTime;
-static CGFloat gyroSensitivity;
-static int gyroInvertX;
-static BOOL gyroInvertAxis, gyroSwapAxis;
 static CMMotionManager* cmInstance;
+static NSOperationQueue *gyroQueue;
+// Only touched from the main thread
+static GyroInputSettings mainSettings;
+// Only touched from gyroQueue
+static GyroInputSettings gyroSettings;
+static gyro_filter_t gyroFilter;
+static gyro_accumulator_t gyroDelta;
+
+// Called on the main thread after a setting changed. Queued behind the
+// samples already waiting, so each sample sees one consistent set
++ (void)commitSettings {
+    mainSettings.grabbing = isGrabbing == JNI_TRUE;
+    mainSettings.windowWidth = windowWidth;
+    mainSettings.windowHeight = windowHeight;
+    GyroInputSettings settings = mainSettings;
+    [gyroQueue addOperationWithBlock:^{
+        gyroSettings = settings;
+    }];
+}
 
 + (void)updateOrientation {
     UIInterfaceOrientation orientation = UIApplication.sharedApplication.windows[0].windowScene.interfaceOrientation;
-    gyroInvertAxis =
+    mainSettings.invertAxis =
         orientation==UIInterfaceOrientationPortraitUpsideDown ||
         orientation==UIInterfaceOrientationLandscapeLeft;
-    gyroSwapAxis = UIInterfaceOrientationIsPortrait(orientation);
+    mainSettings.swapAxis = UIInterfaceOrientationIsPortrait(orientation);
     // FIXME: camera jumps upon rotating screen
+    [self commitSettings];
+}
+
++ (void)updateWindow {
+    [self commitSettings];
 }
 
 + (void)updateSensitivity:(int)sensitivity invertXAxis:(BOOL)invertX {
     if (cmInstance == nil) {
         cmInstance = [[CMMotionManager alloc] init];
+        cmInstance.deviceMotionUpdateInterval = 1.0 / GYRO_SAMPLE_RATE;
+        gyroQueue = [[NSOperationQueue alloc] init];
+        gyroQueue.name = @"GyroInput";
+        gyroQueue.maxConcurrentOperationCount = 1;
+        gyroQueue.qualityOfService = NSQualityOfServiceUserInteractive;
+        gyro_filter_init(&gyroFilter, &gyroFilterConfig);
     }
-    gyroSensitivity = sensitivity / 100.0;
+    mainSettings.sensitivity = sensitivity / 100.0;
     if (sensitivity > 0) {
-        gyroInvertX = invertX ? 1 : -1;
+        mainSettings.invertX = invertX ? 1 : -1;
         [self updateOrientation];
-        [cmInstance startDeviceMotionUpdates];
+        [cmInstance startDeviceMotionUpdatesToQueue:gyroQueue withHandler:^(CMDeviceMotion *motion, NSError *error) {
+            if (motion) {
+                [self processMotion:motion];
+            }
+        }];
     } else {
-        lastXValue = lastYValue = lastFrameTime = 0;
         [cmInstance stopDeviceMotionUpdates];
+        [self commitSettings];
+        [gyroQueue addOperationWithBlock:^{
+            gyro_filter_reset(&gyroFilter);
+        }];
     }
 }
 
-+ (void)tick {
-    if (!isGrabbing || gyroSensitivity == 0) {
-        lastFrameTime = 0;
+// Runs on gyroQueue for every sample
++ (void)processMotion:(CMDeviceMotion *)motion {
+    if (!gyroSettings.grabbing || gyroSettings.sensitivity == 0) {
+        gyro_filter_reset(&gyroFilter);
         return;
     }
 
-    // Compute delta since last tick time
-    CGFloat frameTime = CACurrentMediaTime();
-    CGFloat factor = gyroSensitivity;
-    if (lastFrameTime != 0) {
-        CGFloat deltaTimeScale = (frameTime - lastFrameTime) / (1.0/60.0); // Scale of 1 = 60Hz
-        factor *= deltaTimeScale;
+    // Filtered in rad/s, before scaling to the window
+    float rate[2] = {motion.rotationRate.x, motion.rotationRate.y};
+    double dt = gyro_filter_update(&gyroFilter, motion.timestamp, rate, rate);
+    float deltaX, deltaY;
+    if (gyroSettings.swapAxis) {
+        deltaX = rate[1] / (M_PI*90) * gyroSettings.windowWidth * gyroSettings.invertX;
+        deltaY = -rate[0] / (M_PI*180) * gyroSettings.windowHeight;
+    } else {
+        deltaX = rate[0] / (M_PI*180) * gyroSettings.windowWidth * gyroSettings.invertX;
+        deltaY = rate[1] / (M_PI*90) * gyroSettings.windowHeight;
     }
 
     // 100% sensitivity -> 1:1 ratio between real world and ingame camera
-    if (gyroInvertAxis) {
+    CGFloat factor = gyroSettings.sensitivity * dt / (1.0/60.0); // Scale of 1 = 60Hz
+    if (gyroSettings.invertAxis) {
         factor *= -1;
     }
-    if (gyroSwapAxis) {
-        lastXValue = cmInstance.deviceMotion.rotationRate.y / (M_PI*90) * windowWidth * factor * gyroInvertX;
-        lastYValue = -cmInstance.deviceMotion.rotationRate.x / (M_PI*180) * windowHeight * factor;
-    } else {
-        lastXValue = cmInstance.deviceMotion.rotationRate.x / (M_PI*180) * windowWidth * factor * gyroInvertX;
-        lastYValue = cmInstance.deviceMotion.rotationRate.y / (M_PI*90) * windowHeight * factor;
+    gyro_accumulator_add(&gyroDelta, deltaX * factor, deltaY * factor);
+}
+
++ (void)tick {
+    // Send whatever the sensor moved since the last frame
+    float deltaX, deltaY;
+    if (!gyro_accumulator_take(&gyroDelta, &deltaX, &deltaY) || !isGrabbing) {
+        return;
     }
 
     SurfaceViewController *vc = (id)UIWindow.mainWindow.rootViewController;
-    [vc sendTouchPoint:CGPointMake(lastXValue, lastYValue) withEvent:ACTION_MOVE_MOTION];
-
-    lastFrameTime = frameTime;
+    [vc sendTouchPoint:CGPointMake(deltaX, deltaY) withEvent:ACTION_MOVE_MOTION];
 }
 
 @end
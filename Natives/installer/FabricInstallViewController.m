@@ -5,6 +5,7 @@
 #import "LauncherPreferences.h"
 #import "LauncherProfileEditorViewController.h"
 #import "PickTextField.h"
+#import "PLMetadataCache.h"
 #import "PLProfiles.h"
 #import "ios_uikit_bridge.h"
 #import "utils.h"
@@ -115,7 +116,7 @@
 - (void)fetchVersionEndpoints:(int)type {
     // Fetch version
     __block BOOL errorShown = NO;
-    id errorCallback = ^(NSURLSessionTask *operation, NSError *error) {
+    void (^errorCallback)(NSError *) = ^(NSError *error) {
         if (!errorShown) {
             errorShown = YES;
             NSDebugLog(@"Error: %@", error);
@@ -123,18 +124,31 @@
             [self actionClose];
         }
     };
-    AFHTTPSessionManager *manager = [AFHTTPSessionManager manager];
-    NSDictionary *endpoint = self.endpoints[self.localKVO[@"loaderVendor"]];
-    [manager GET:endpoint[@"game"] parameters:nil headers:nil progress:nil  success:^(NSURLSessionTask *task, NSArray *response) {
-        NSDebugLog(@"[%@ Installer] Got %d game versions", self.localKVO[@"loaderVendor"], response.count);
+    NSString *vendor = self.localKVO[@"loaderVendor"];
+    NSDictionary *endpoint = self.endpoints[vendor];
+    // Cached lists are shown right away and replaced if the server has newer ones
+    [PLMetadataCache.sharedCache fetchJSONFromURL:endpoint[@"game"] handler:^(NSArray *response, NSError *error) {
+        if (error) {
+            errorCallback(error);
+            return;
+        } else if (![vendor isEqualToString:self.localKVO[@"loaderVendor"]]) {
+            return;
+        }
+        NSDebugLog(@"[%@ Installer] Got %d game versions", vendor, response.count);
         self.versionMetadata = response;
         [self changeVersionTypeTo:[self.localKVO[@"gameType_index"] intValue]];
-    } failure:errorCallback];
-    [manager GET:endpoint[@"loader"] parameters:nil headers:nil progress:nil success:^(NSURLSessionTask *task, NSArray *response) {
-        NSDebugLog(@"[%@ Installer] Got %d loader versions", self.localKVO[@"loaderVendor"], response.count);
+    }];
+    [PLMetadataCache.sharedCache fetchJSONFromURL:endpoint[@"loader"] handler:^(NSArray *response, NSError *error) {
+        if (error) {
+            errorCallback(error);
+            return;
+        } else if (![vendor isEqualToString:self.localKVO[@"loaderVendor"]]) {
+            return;
+        }
+        NSDebugLog(@"[%@ Installer] Got %d loader versions", vendor, response.count);
         self.loaderMetadata = response;
         [self changeLoaderTypeTo:[self.localKVO[@"loaderType_index"] intValue]];
-    } failure:errorCallback];
+    }];
 }
 
 - (void)actionClose {
@@ -1,20 +1,25 @@
 #import "AFNetworking.h"
 #import "ForgeInstallViewController.h"
+#import "ForgeVersionListParser.h"
 #import "LauncherNavigationController.h"
+#import "PLMetadataCache.h"
 #import "WFWorkflowProgressView.h"
 #import "ios_uikit_bridge.h"
 #import "utils.h"
 #include <dlfcn.h>
 
-@interface ForgeInstallViewController()<NSXMLParserDelegate>
+@interface ForgeInstallViewController()
 @property(atomic) AFURLSessionManager *afManager;
 @property(nonatomic) WFWorkflowProgressView *progressView;
 
 @property(nonatomic) NSDictionary *endpoints;
+@property(nonatomic) NSString *vendor;
 @property(nonatomic) NSMutableArray<NSNumber *> *visibilityList;
 @property(nonatomic) NSMutableArray<NSString *> *versionList;
 @property(nonatomic) NSMutableArray<NSMutableArray *> *forgeList;
-@property(nonatomic, assign) BOOL isVersionElement;
+// Body the lists were built from, and the parse allowed to replace them
+@property(nonatomic) NSData *metadataData;
+@property(nonatomic, assign) NSUInteger metadataGeneration;
 @end
 
 @implementation ForgeInstallViewController
@@ -59,17 +64,46 @@
 
 - (void)loadMetadataFromVendor:(NSString *)vendor {
     [self switchToLoadingState];
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-        NSURL *url = [[NSURL alloc] initWithString:self.endpoints[vendor][@"metadata"]];
-        NSXMLParser *parser = [[NSXMLParser alloc] initWithContentsOfURL:url];
-        parser.delegate = self;
-        if (![parser parse]) {
+    self.vendor = vendor;
+    self.metadataData = nil;
+    // Drops parses still running for the previous vendor
+    self.metadataGeneration++;
+    // Called again if the cached metadata turns out to be outdated
+    [PLMetadataCache.sharedCache fetchURL:self.endpoints[vendor][@"metadata"] handler:^(NSData *data, NSError *error) {
+        if (![vendor isEqualToString:self.vendor]) {
+            return;
+        } else if (error) {
+            showDialog(localize(@"Error", nil), error.localizedDescription);
+            [self actionClose];
+            return;
+        } else if ([data isEqualToData:self.metadataData]) {
+            return;
+        }
+        self.metadataData = data;
+        NSUInteger generation = ++self.metadataGeneration;
+        // The table keeps showing the current lists until the new ones are complete
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            ForgeVersionListParser *list = [ForgeVersionListParser new];
+            NSXMLParser *parser = [[NSXMLParser alloc] initWithData:data];
+            parser.delegate = list;
+            BOOL parsed = [parser parse];
             dispatch_async(dispatch_get_main_queue(), ^{
-                showDialog(localize(@"Error", nil), parser.parserError.localizedDescription);
-                [self actionClose];
+                // Also keep the list while an installer downloads, this screen closes once it is done
+                if (generation != self.metadataGeneration || !self.tableView.allowsSelection) {
+                    return;
+                } else if (!parsed) {
+                    showDialog(localize(@"Error", nil), parser.parserError.localizedDescription);
+                    [self actionClose];
+                    return;
+                }
+                self.visibilityList = list.visibilityList;
+                self.versionList = list.versionList;
+                self.forgeList = list.forgeList;
+                [self switchToReadyState];
+                [self.tableView reloadData];
             });
-        }
-    });
+        });
+    }];
 }
 
 - (void)switchToLoadingState {
@@ -184,38 +218,4 @@
     });
 }
 
-- (void)addVersionToList:(NSString *)version {
-    if (![version containsString:@"-"]) {
-        return;
-    }
-    NSRange range = [version rangeOfString:@"-"];
-    NSString *gameVersion = [version substringToIndex:range.location];
-    //NSString *forgeVersion = [version substringFromIndex:range.location + 1];
-    if (![self.versionList containsObject:gameVersion]) {
-        [self.visibilityList addObject:@(NO)];
-        [self.versionList addObject:gameVersion];
-        [self.forgeList addObject:[NSMutableArray new]];
-    }
-    [self.forgeList.lastObject addObject:version];
-}
-
-#pragma mark NSXMLParser
-
-- (void)parserDidEndDocument:(NSXMLParser *)unused {
-        dispatch_async(dispatch_get_main_queue(), ^{
-        [self switchToReadyState];
-        [self.tableView reloadData];
-    });
-}
-
-- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qualifiedName attributes:(NSDictionary *)attributeDict {
-    self.isVersionElement = [elementName isEqualToString:@"version"];
-}
-
-- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)version {
-    if (self.isVersionElement) {
-        [self addVersionToList:version];
-    }
-}
-
 @end
@@ -0,0 +1,11 @@
+#import <Foundation/Foundation.h>
+
+// Collects the versions listed in a maven-metadata.xml, grouped by game
+// version. Each parse fills its own lists, so it can run off the main queue
+// while the lists of an earlier parse are still shown.
+@interface ForgeVersionListParser : NSObject<NSXMLParserDelegate>
+@property(nonatomic) NSMutableArray<NSNumber *> *visibilityList;
+@property(nonatomic) NSMutableArray<NSString *> *versionList;
+@property(nonatomic) NSMutableArray<NSMutableArray *> *forgeList;
+@property(nonatomic, assign) BOOL isVersionElement;
+@end
@@ -0,0 +1,38 @@
+#import "ForgeVersionListParser.h"
+
+@implementation ForgeVersionListParser
+
+- (instancetype)init {
+    self = [super init];
+    self.visibilityList = [NSMutableArray new];
+    self.versionList = [NSMutableArray new];
+    self.forgeList = [NSMutableArray new];
+    return self;
+}
+
+- (void)addVersionToList:(NSString *)version {
+    if (![version containsString:@"-"]) {
+        return;
+    }
+    NSRange range = [version rangeOfString:@"-"];
+    NSString *gameVersion = [version substringToIndex:range.location];
+    //NSString *forgeVersion = [version substringFromIndex:range.location + 1];
+    if (![self.versionList containsObject:gameVersion]) {
+        [self.visibilityList addObject:@(NO)];
+        [self.versionList addObject:gameVersion];
+        [self.forgeList addObject:[NSMutableArray new]];
+    }
+    [self.forgeList.lastObject addObject:version];
+}
+
+- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qualifiedName attributes:(NSDictionary *)attributeDict {
+    self.isVersionElement = [elementName isEqualToString:@"version"];
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)version {
+    if (self.isVersionElement) {
+        [self addVersionToList:version];
+    }
+}
+
+@end
@@ -1,5 +1,8 @@
+#import <ImageIO/ImageIO.h>
+
 #import "ModpackInstallViewController.h"
 #import "LauncherNavigationController.h"
+#import "PLDiskCache.h"
 #import "WFWorkflowProgressView.h"
 #import "ios_uikit_bridge.h"
 #import "utils.h"
@@ -10,16 +13,39 @@
 #import "modpack/CurseForgeAPI.h"
 #import "modpack/ModrinthAPI.h"
 
-@interface ModpackInstallViewController () <UITableViewDelegate, UITableViewDataSource, UISearchResultsUpdating, UIContextMenuInteractionDelegate>
+// Rows left before the end of the list at which the next page is requested
+#define SEARCH_PREFETCH_ROWS 15
+// Thumbnails are stored already downscaled, so this holds a few thousand logos
+#define THUMBNAIL_CACHE_CAPACITY (32 * 1024 * 1024)
+// Bounding box of a thumbnail, in points
+static const CGFloat kThumbnailSize = 64;
+
+@interface ModpackInstallViewController () <UITableViewDelegate, UITableViewDataSource, UITableViewDataSourcePrefetching, UISearchResultsUpdating, UIContextMenuInteractionDelegate>
 
 // We hold a strong reference to the table view as a separate property
 @property (nonatomic, strong) UITableView *tableView;
 @property (nonatomic, strong) UIImage *fallbackImage;
 
+// Decoded thumbnails by URL, and the URLs being loaded
+@property (nonatomic, strong) NSCache<NSString *, UIImage *> *imageCache;
+@property (nonatomic, strong) NSMutableSet<NSString *> *pendingImages;
+// Bumped by every new search so pages of an older one are dropped
+@property (nonatomic, assign) NSUInteger searchGeneration;
+@property (nonatomic, assign) BOOL loadingNextPage;
+
 @end
 
 @implementation ModpackInstallViewController
 
++ (PLDiskCache *)thumbnailCache {
+    static PLDiskCache *cache;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        cache = [[PLDiskCache alloc] initWithName:@"thumbnails" capacity:THUMBNAIL_CACHE_CAPACITY];
+    });
+    return cache;
+}
+
 - (void)viewDidLoad {
     [super viewDidLoad];
     
@@ -27,6 +53,7 @@
     self.tableView = [[UITableView alloc] initWithFrame:self.view.bounds style:UITableViewStylePlain];
     self.tableView.delegate = self;
     self.tableView.dataSource = self;
+    self.tableView.prefetchDataSource = self;
     self.tableView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
     [self.view addSubview:self.tableView];
     
@@ -58,6 +85,8 @@
     // Initialize Filters
     self.filters = [@{@"isModpack": @(YES), @"name": @""} mutableCopy];
     self.fallbackImage = [UIImage imageNamed:@"DefaultProfile"];
+    self.imageCache = [NSCache new];
+    self.pendingImages = [NSMutableSet new];
     
     // First load
     [self updateSearchResults];
@@ -66,6 +95,8 @@
 #pragma mark - Segment Control Handler
 
 - (void)apiSegmentChanged:(UISegmentedControl *)sender {
+    self.searchGeneration++;
+    self.loadingNextPage = NO;
     [self.list removeAllObjects];
     [self.tableView reloadData];
     [self updateSearchResults];
@@ -125,36 +156,63 @@
     NSString *previousName = ([self.filters[@"name"] isKindOfClass:[NSString class]] ? self.filters[@"name"] : @"");
     if (!prevList && [previousName isEqualToString:name]) return;
     
-    [self switchToLoadingState];
+    if (prevList) {
+        // Next pages load in the background while the user keeps scrolling
+        self.loadingNextPage = YES;
+    } else {
+        self.searchGeneration++;
+        self.loadingNextPage = NO;
+        [self switchToLoadingState];
+    }
+    NSUInteger generation = self.searchGeneration;
+    BOOL usingCurseForge = self.apiSegmentControl.selectedSegmentIndex == 0;
+    // The API appends to the list it is given, keep the one on screen untouched
+    NSMutableArray *prevResult = prevList ? self.list.mutableCopy : nil;
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
         self.filters[@"name"] = name;
         NSError *searchError = nil;
         NSMutableArray *results = nil;
         
-        if (self.apiSegmentControl.selectedSegmentIndex == 0) {
+        if (usingCurseForge) {
             // Searching with CurseForge
             results = [self.curseForge searchModWithFilters:self.filters
-                                         previousPageResult:prevList ? self.list : nil];
+                                         previousPageResult:prevResult];
             searchError = self.curseForge.lastError;
         } else {
             // Searching with Modrinth
             results = [self.modrinth searchModWithFilters:self.filters
-                                       previousPageResult:prevList ? self.list : nil];
+                                       previousPageResult:prevResult];
             searchError = self.modrinth.lastError;
         }
         
         dispatch_async(dispatch_get_main_queue(), ^{
+            if (generation != self.searchGeneration) {
+                // A newer search replaced the list meanwhile
+                return;
+            }
             if (results) {
                 self.list = results;
                 [self.tableView reloadData];
             } else {
                 showDialog(localize(@"Error", nil), searchError.localizedDescription);
             }
-            [self switchToReadyState];
+            if (prevList) {
+                self.loadingNextPage = NO;
+            } else {
+                [self switchToReadyState];
+            }
         });
     });
 }
 
+- (void)loadNextPageIfNeeded {
+    BOOL usingCurseForge = (self.apiSegmentControl.selectedSegmentIndex == 0);
+    BOOL reachedLastPage = usingCurseForge ? self.curseForge.reachedLastPage : self.modrinth.reachedLastPage;
+    if (!reachedLastPage && !self.loadingNextPage && self.list.count > 0) {
+        [self loadSearchResultsWithPrevList:YES];
+    }
+}
+
 #pragma mark - TableView DataSource
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
@@ -180,23 +238,34 @@
     cell.detailTextLabel.text = ([item[@"description"] isKindOfClass:[NSString class]] ? item[@"description"] : @"No description");
     
     // Image Loading
-    NSString *imageUrl = ([item[@"imageUrl"] isKindOfClass:[NSString class]] ? item[@"imageUrl"] : @"");
-    if (imageUrl.length > 0) {
-        [self loadImageForCell:cell withURL:imageUrl];
-    } else {
-        cell.imageView.image = self.fallbackImage;
+    NSString *imageUrl = [self imageURLAtRow:indexPath.row];
+    UIImage *image = imageUrl.length > 0 ? [self.imageCache objectForKey:imageUrl] : nil;
+    // Reused cells would otherwise show the previous row's logo until the new one arrives
+    cell.imageView.image = image ?: self.fallbackImage;
+    if (!image && imageUrl.length > 0) {
+        [self loadImageWithURL:imageUrl];
     }
     
     // Pagination
-    BOOL usingCurseForge = (self.apiSegmentControl.selectedSegmentIndex == 0);
-    BOOL reachedLastPage = usingCurseForge ? self.curseForge.reachedLastPage : self.modrinth.reachedLastPage;
-    if (!reachedLastPage && indexPath.row == self.list.count - 1) {
-        [self loadSearchResultsWithPrevList:YES];
+    if (indexPath.row >= (NSInteger)self.list.count - SEARCH_PREFETCH_ROWS) {
+        [self loadNextPageIfNeeded];
     }
     
     return cell;
 }
 
+- (void)tableView:(UITableView *)tableView prefetchRowsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    for (NSIndexPath *indexPath in indexPaths) {
+        NSString *imageUrl = [self imageURLAtRow:indexPath.row];
+        if (imageUrl.length > 0) {
+            [self loadImageWithURL:imageUrl];
+        }
+        if (indexPath.row >= (NSInteger)self.list.count - SEARCH_PREFETCH_ROWS) {
+            [self loadNextPageIfNeeded];
+        }
+    }
+}
+
 #pragma mark - Context Menu Handling
 
 - (void)showDetails:(NSDictionary *)details atIndexPath:(NSIndexPath *)indexPath {
@@ -290,25 +359,71 @@
 
 #pragma mark - Image Loading
 
-- (void)loadImageForCell:(UITableViewCell *)cell withURL:(NSString *)urlString {
+- (NSString *)imageURLAtRow:(NSInteger)row {
+    if (row >= self.list.count) return nil;
+    NSString *imageUrl = self.list[row][@"imageUrl"];
+    return [imageUrl isKindOfClass:[NSString class]] ? imageUrl : nil;
+}
+
+// Decodes and downscales in one step, so neither the full size image nor its decoding reach the main thread
+static UIImage *ModpackThumbnailFromData(NSData *data, CGFloat scale) {
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) return nil;
+    NSDictionary *options = @{
+        (id)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+        (id)kCGImageSourceCreateThumbnailWithTransform: @YES,
+        (id)kCGImageSourceShouldCacheImmediately: @YES,
+        (id)kCGImageSourceThumbnailMaxPixelSize: @(kThumbnailSize * scale)
+    };
+    CGImageRef image = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    CFRelease(source);
+    if (!image) return nil;
+    UIImage *thumbnail = [UIImage imageWithCGImage:image scale:scale orientation:UIImageOrientationUp];
+    CGImageRelease(image);
+    return thumbnail;
+}
+
+- (void)loadImageWithURL:(NSString *)urlString {
     NSURL *url = [NSURL URLWithString:urlString];
-    if (!url) return;
-    
-    NSURLSessionDataTask *task =
-      [[NSURLSession sharedSession] dataTaskWithURL:url
-                                  completionHandler:^(NSData *data,
-                                                      NSURLResponse *response,
-                                                      NSError *error)
-    {
-        if (!error && data) {
-            UIImage *downloadedImage = [UIImage imageWithData:data];
-            dispatch_async(dispatch_get_main_queue(), ^{
-                cell.imageView.image = downloadedImage ?: self.fallbackImage;
+    if (!url || [self.imageCache objectForKey:urlString] || [self.pendingImages containsObject:urlString]) return;
+    [self.pendingImages addObject:urlString];
+
+    CGFloat scale = UIScreen.mainScreen.scale;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSData *cached = [ModpackInstallViewController.thumbnailCache dataForKey:urlString maxAge:0];
+        if (cached) {
+            [self finishLoadingImage:ModpackThumbnailFromData(cached, scale) withURL:urlString];
+            return;
+        }
+        NSURLSessionDataTask *task =
+          [[NSURLSession sharedSession] dataTaskWithURL:url
+                                      completionHandler:^(NSData *data,
+                                                          NSURLResponse *response,
+                                                          NSError *error)
+        {
+            UIImage *thumbnail = (!error && data) ? ModpackThumbnailFromData(data, scale) : nil;
+            if (thumbnail) {
+                [ModpackInstallViewController.thumbnailCache setData:UIImagePNGRepresentation(thumbnail) forKey:urlString];
+            }
+            [self finishLoadingImage:thumbnail withURL:urlString];
+        }];
+        [task resume];
+    });
+}
+
+- (void)finishLoadingImage:(UIImage *)image withURL:(NSString *)urlString {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.pendingImages removeObject:urlString];
+        if (!image) return;
+        [self.imageCache setObject:image forKey:urlString];
+        for (NSIndexPath *indexPath in self.tableView.indexPathsForVisibleRows) {
+            if ([[self imageURLAtRow:indexPath.row] isEqualToString:urlString]) {
+                UITableViewCell *cell = [self.tableView cellForRowAtIndexPath:indexPath];
+                cell.imageView.image = image;
                 [cell setNeedsLayout];
-            });
+            }
         }
-    }];
-    [task resume];
+    });
 }
 
 @end
@@ -2,18 +2,21 @@
 #define CurseForgeAPI_h
 
 #import <Foundation/Foundation.h>
+#import "ModpackAPI.h"
 
-@interface CurseForgeAPI : NSObject
+@interface CurseForgeAPI : ModpackAPI
 
 @property (nonatomic, strong, readonly) NSString *apiKey;
-@property (nonatomic, strong) NSError *lastError;
 @property (nonatomic, assign) NSInteger previousOffset;
-@property (nonatomic, assign) BOOL reachedLastPage;
 @property (nonatomic, strong) NSString *lastSearchTerm;
 
 - (instancetype)initWithAPIKey:(NSString *)apiKey;
 - (NSString *)loadAPIKey;
 - (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params;
+- (id)postEndpoint:(NSString *)endpoint body:(NSDictionary *)body;
+// Same as above, but the error is returned instead of being stored in lastError
+- (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params error:(NSError **)error;
+- (id)postEndpoint:(NSString *)endpoint body:(NSDictionary *)body error:(NSError **)error;
 - (NSMutableArray *)searchModWithFilters:(NSDictionary<NSString *, id> *)searchFilters previousPageResult:(NSMutableArray *)previousResults;
 - (void)installModpackFromDetail:(NSDictionary *)detail atIndex:(NSInteger)index;
 - (void)loadDetailsOfMod:(NSMutableDictionary *)item;
@@ -1,7 +1,9 @@
 #import "CurseForgeAPI.h"
+#import "CurseForgeFileCache.h"
 #import "config.h"
 #import "MinecraftResourceDownloadTask.h"
 #import "PLProfiles.h"
+#import "ModpackInstallPipeline.h"
 #import "ModpackUtils.h"
 #import "UnzipKit.h"
 #import "AFNetworking.h"
@@ -12,6 +14,13 @@
 #define CURSEFORGE_PAGINATION_SIZE 50
 #define CURSEFORGE_PAGINATION_END_REACHED -1
 #define CURSEFORGE_PAGINATION_ERROR -2
+// Files per request to the bulk files endpoint
+#define CURSEFORGE_BULK_FILES_SIZE 100
+// Concurrent per-file lookups for files missing from the bulk response
+#define CURSEFORGE_MAX_FALLBACK_REQUESTS 6
+// Resolved files kept in curseforge_files.json, the oldest are dropped first
+#define CURSEFORGE_FILE_CACHE_CAPACITY 8192
+static const NSTimeInterval kFileCacheMaxAge = 30 * 24 * 60 * 60;
 
 @interface CurseForgeAPI ()
 @property (nonatomic, copy) NSString *apiKey;
@@ -31,14 +40,7 @@
 
 #pragma mark - Overridden GET Endpoint
 
-- (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params {
-    __block id result;
-    dispatch_group_t group = dispatch_group_create();
-    dispatch_group_enter(group);
-
-    NSString *url = [self.baseURL stringByAppendingPathComponent:endpoint];
-    AFHTTPSessionManager *manager = [AFHTTPSessionManager manager];
-    
+- (NSString *)resolvedAPIKey {
     NSString *key = self.apiKey;
     if (key.length == 0) {
         char *envKey = getenv("CURSEFORGE_API_KEY");
@@ -46,18 +48,77 @@
             key = [NSString stringWithUTF8String:envKey];
         }
     }
-    [manager.requestSerializer setValue:key forHTTPHeaderField:@"x-api-key"];
+    return key;
+}
+
+- (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params {
+    NSError *error;
+    id result = [self getEndpoint:endpoint params:params error:&error];
+    if (!result) {
+        self.lastError = error;
+    }
+    return result;
+}
+
+- (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params error:(NSError **)error {
+    __block id result;
+    __block NSError *requestError;
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_enter(group);
+
+    NSString *url = [self.baseURL stringByAppendingPathComponent:endpoint];
+    AFHTTPSessionManager *manager = [AFHTTPSessionManager manager];
+    [manager.requestSerializer setValue:[self resolvedAPIKey] forHTTPHeaderField:@"x-api-key"];
     
     [manager GET:url parameters:params headers:nil progress:nil
          success:^(NSURLSessionTask *task, id obj) {
              result = obj;
              dispatch_group_leave(group);
          }
-         failure:^(NSURLSessionTask *operation, NSError *error) {
-             self.lastError = error;
+         failure:^(NSURLSessionTask *operation, NSError *failure) {
+             requestError = failure;
              dispatch_group_leave(group);
          }];
     dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    if (error) {
+        *error = requestError;
+    }
+    return result;
+}
+
+- (id)postEndpoint:(NSString *)endpoint body:(NSDictionary *)body {
+    NSError *error;
+    id result = [self postEndpoint:endpoint body:body error:&error];
+    if (!result) {
+        self.lastError = error;
+    }
+    return result;
+}
+
+- (id)postEndpoint:(NSString *)endpoint body:(NSDictionary *)body error:(NSError **)error {
+    __block id result;
+    __block NSError *requestError;
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_enter(group);
+
+    NSString *url = [self.baseURL stringByAppendingPathComponent:endpoint];
+    AFHTTPSessionManager *manager = [AFHTTPSessionManager manager];
+    manager.requestSerializer = [AFJSONRequestSerializer serializer];
+    [manager.requestSerializer setValue:[self resolvedAPIKey] forHTTPHeaderField:@"x-api-key"];
+
+    [manager POST:url parameters:body headers:nil progress:nil
+         success:^(NSURLSessionTask *task, id obj) {
+             result = obj;
+             dispatch_group_leave(group);
+         }
+         failure:^(NSURLSessionTask *operation, NSError *failure) {
+             requestError = failure;
+             dispatch_group_leave(group);
+         }];
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    if (error) {
+        *error = requestError;
+    }
     return result;
 }
 
@@ -86,7 +147,7 @@
             params[@"gameVersion"] = searchFilters[@"mcVersion"];
         }
         
-        NSDictionary *response = [self getEndpoint:@"mods/search" params:params];
+        NSDictionary *response = [self getCachedEndpoint:@"mods/search" params:params];
         if (!response) {
             if (completion) {
                 dispatch_async(dispatch_get_main_queue(), ^{
@@ -136,12 +197,13 @@
 {
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
         NSString *modId = [NSString stringWithFormat:@"%@", item[@"id"]];
+        NSError *error;
         NSDictionary *response = [self getEndpoint:[NSString stringWithFormat:@"mods/%@/files", modId]
-                                            params:nil];
+                                            params:nil error:&error];
         if (!response) {
             if (completion) {
                 dispatch_async(dispatch_get_main_queue(), ^{
-                    completion(self.lastError);
+                    completion(error);
                 });
             }
             return;
@@ -264,65 +326,6 @@ submitDownloadTasksFromPackage:(NSString *)packagePath
             return;
         }
         
-        // Use the file count as total progress units
-        downloader.progress.totalUnitCount = files.count;
-        
-        // Submit download tasks for each file
-        for (NSDictionary *fileEntry in files) {
-            NSNumber *projectID = fileEntry[@"projectID"];
-            NSNumber *fileID = fileEntry[@"fileID"];
-            BOOL required = [fileEntry[@"required"] boolValue];
-            
-            NSString *url = [self getDownloadUrlForProject:[projectID unsignedLongLongValue]
-                                                    fileID:[fileID unsignedLongLongValue]];
-            if (!url && required) {
-                [downloader finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to obtain download URL for project %@ file %@", projectID, fileID]];
-                return;
-            } else if (!url) {
-                // This is an optional file with no URL. Skip.
-                continue;
-            }
-            
-            NSString *relativePath = fileEntry[@"path"];
-            if (!relativePath || relativePath.length == 0) {
-                relativePath = [NSString stringWithFormat:@"%@.jar", fileID];
-            }
-            
-            NSString *destinationPath = [destPath stringByAppendingPathComponent:relativePath];
-            NSURLSessionDownloadTask *task = [downloader createDownloadTask:url
-                                                                       size:0
-                                                                       sha:nil
-                                                                   altName:nil
-                                                                     toPath:destinationPath];
-            if (task) {
-                [downloader.fileList addObject:relativePath];
-                [task resume];
-            } else if (!downloader.progress.cancelled) {
-                downloader.progress.completedUnitCount++;
-            } else {
-                return; // cancelled
-            }
-        }
-        
-        // Extract the "overrides" directory
-        [ModpackUtils archive:archive extractDirectory:@"overrides" toPath:destPath error:&error];
-        if (error) {
-            [downloader finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to extract overrides: %@", error.localizedDescription]];
-            return;
-        }
-        
-        // Clean up the package
-        [[NSFileManager defaultManager] removeItemAtPath:packagePath error:nil];
-        
-        // Download dependency JSON if it's a Fabric-based pack
-        NSDictionary<NSString *, NSString *> *depInfo = [ModpackUtils infoForDependencies:manifestDict[@"dependencies"]];
-        if (depInfo[@"json"]) {
-            NSString *jsonPath = [NSString stringWithFormat:@"%1$s/versions/%2$@/%2$@.json",
-                                  getenv("POJAV_GAME_DIR"), depInfo[@"id"]];
-            NSURLSessionDownloadTask *task = [downloader createDownloadTask:depInfo[@"json"] size:0 sha:nil altName:nil toPath:jsonPath];
-            [task resume];
-        }
-        
         // Build the final version string (Forge/Fabric, etc.)
         NSDictionary *minecraft = manifestDict[@"minecraft"];
         NSString *vanillaVersion = @"";
@@ -381,17 +384,54 @@ submitDownloadTasksFromPackage:(NSString *)packagePath
             finalVersionString = [NSString stringWithFormat:@"%@ | %@", vanillaVersion, modLoaderId];
         }
         
-        NSString *profileName = manifestDict[@"name"];
-        if (profileName) {
-            NSDictionary *profileInfo = @{
-                @"gameDir": [NSString stringWithFormat:@"./custom_gamedir/%@", [destPath lastPathComponent]],
-                @"name": profileName,
-                @"lastVersionId": finalVersionString,
-                @"icon": @""
-            };
-            PLProfiles.current.profiles[profileName] = [profileInfo mutableCopy];
-            PLProfiles.current.selectedProfileName = profileName;
-        }
+        ModpackInstallPipeline *pipeline = [[ModpackInstallPipeline alloc] initWithDownloader:downloader archive:archive destination:destPath];
+        pipeline.overrideDirectories = @[manifestDict[@"overrides"] ?: @"overrides"];
+        pipeline.dependencyInfo = [ModpackUtils infoForDependencies:manifestDict[@"dependencies"]];
+        pipeline.writeProfile = ^{
+            NSString *profileName = manifestDict[@"name"];
+            if (profileName) {
+                NSDictionary *profileInfo = @{
+                    @"gameDir": [NSString stringWithFormat:@"./custom_gamedir/%@", [destPath lastPathComponent]],
+                    @"name": profileName,
+                    @"lastVersionId": finalVersionString,
+                    @"icon": @""
+                };
+                PLProfiles.current.profiles[profileName] = [profileInfo mutableCopy];
+                PLProfiles.current.selectedProfileName = profileName;
+            }
+        };
+        [pipeline runWithResolver:^NSArray *(NSString **error) {
+            // Resolve every file up front instead of one blocking lookup per file
+            NSDictionary<NSString *, NSDictionary *> *resolvedFiles = [self resolveManifestFiles:files];
+            NSMutableArray *downloads = [NSMutableArray new];
+            for (NSDictionary *fileEntry in files) {
+                NSNumber *projectID = fileEntry[@"projectID"];
+                NSNumber *fileID = fileEntry[@"fileID"];
+                BOOL required = [fileEntry[@"required"] boolValue];
+
+                NSDictionary *fileInfo = resolvedFiles[[self cacheKeyForProject:projectID fileID:fileID]];
+                NSString *url = fileInfo[@"url"];
+                if (!url && required) {
+                    *error = [NSString stringWithFormat:@"Failed to obtain download URL for project %@ file %@", projectID, fileID];
+                    return nil;
+                } else if (!url) {
+                    // This is an optional file with no URL. Skip.
+                    continue;
+                }
+
+                NSString *relativePath = fileEntry[@"path"];
+                if (!relativePath || relativePath.length == 0) {
+                    relativePath = [NSString stringWithFormat:@"%@.jar", fileID];
+                }
+                [downloads addObject:@{
+                    @"url": url,
+                    @"path": relativePath,
+                    @"size": fileInfo[@"size"] ?: @0,
+                    @"sha1": fileInfo[@"sha1"] ?: @""
+                }];
+            }
+            return downloads;
+        }];
     });
 }
 
@@ -406,30 +446,121 @@ submitDownloadTasksFromPackage:(NSString *)packagePath
     return (modLoaders.count >= 1);
 }
 
-- (NSString *)getDownloadUrlForProject:(unsigned long long)projectID fileID:(unsigned long long)fileID {
-    NSString *endpoint = [NSString stringWithFormat:@"mods/%llu/files/%llu/download-url", projectID, fileID];
-    NSDictionary *response = [self getEndpoint:endpoint params:nil];
-    if (response && response[@"data"] && ![response[@"data"] isKindOfClass:[NSNull class]]) {
-        return [NSString stringWithFormat:@"%@", response[@"data"]];
+#pragma mark - File Resolution
+
+- (NSString *)cacheKeyForProject:(id)projectID fileID:(id)fileID {
+    return [NSString stringWithFormat:@"%llu:%llu", [projectID unsignedLongLongValue], [fileID unsignedLongLongValue]];
+}
+
+- (NSString *)fileCachePath {
+    return [NSString stringWithFormat:@"%s/cache/curseforge_files.json", getenv("POJAV_HOME")];
+}
+
++ (NSString *)edgeURLForFileID:(unsigned long long)fileID fileName:(NSString *)fileName {
+    // e.g. "https://edge.forgecdn.net/files/1234/5678/example.jar"
+    return [NSString stringWithFormat:@"https://edge.forgecdn.net/files/%llu/%llu/%@",
+            fileID / 1000, fileID % 1000, fileName];
+}
+
+// Extracts what the installer needs from a CurseForge File object
+- (NSDictionary *)fileInfoFromData:(NSDictionary *)file {
+    NSString *fileName = [file[@"fileName"] isKindOfClass:NSString.class] ? file[@"fileName"] : nil;
+    NSString *url = [file[@"downloadUrl"] isKindOfClass:NSString.class] ? file[@"downloadUrl"] : nil;
+    if (!url && fileName) {
+        // Third party downloads disabled by the author, the CDN still serves the file
+        url = [CurseForgeAPI edgeURLForFileID:[file[@"id"] unsignedLongLongValue] fileName:fileName];
     }
-    
-    endpoint = [NSString stringWithFormat:@"mods/%llu/files/%llu", projectID, fileID];
-    NSDictionary *fallbackResponse = [self getEndpoint:endpoint params:nil];
-    if (fallbackResponse && fallbackResponse[@"data"] && ![fallbackResponse[@"data"] isKindOfClass:[NSNull class]]) {
-        NSDictionary *modData = fallbackResponse[@"data"];
-        NSNumber *idNumber = modData[@"id"];
-        if (idNumber) {
-            unsigned long long idValue = [idNumber unsignedLongLongValue];
-            NSString *fileName = modData[@"fileName"];
-            if (fileName) {
-                // e.g. "https://edge.forgecdn.net/files/1234/5678/example.jar"
-                return [NSString stringWithFormat:@"https://edge.forgecdn.net/files/%llu/%llu/%@",
-                        idValue / 1000,
-                        idValue % 1000,
-                        fileName];
+    if (!url) {
+        return nil;
+    }
+    NSMutableDictionary *info = @{@"url": url}.mutableCopy;
+    info[@"fileName"] = fileName;
+    if ([file[@"fileLength"] isKindOfClass:NSNumber.class]) {
+        info[@"size"] = file[@"fileLength"];
+    }
+    for (NSDictionary *hashDict in file[@"hashes"]) {
+        // algo 1 is SHA1
+        if ([hashDict[@"algo"] intValue] == 1 && [hashDict[@"value"] isKindOfClass:NSString.class]) {
+            info[@"sha1"] = hashDict[@"value"];
+            break;
+        }
+    }
+    return info;
+}
+
+// Returns "projectID:fileID" -> {url, fileName, size, sha1} for every file that could be resolved
+- (NSDictionary<NSString *, NSDictionary *> *)resolveManifestFiles:(NSArray<NSDictionary *> *)files {
+    // File ids don't change, but download URLs and third party permissions can
+    CurseForgeFileCache *cache = [[CurseForgeFileCache alloc] initWithPath:self.fileCachePath
+        capacity:CURSEFORGE_FILE_CACHE_CAPACITY maxAge:kFileCacheMaxAge];
+
+    NSMutableDictionary<NSNumber *, NSString *> *pending = [NSMutableDictionary new];
+    for (NSDictionary *fileEntry in files) {
+        NSString *key = [self cacheKeyForProject:fileEntry[@"projectID"] fileID:fileEntry[@"fileID"]];
+        if (!cache[key]) {
+            pending[@([fileEntry[@"fileID"] unsignedLongLongValue])] = key;
+        }
+    }
+
+    NSArray<NSNumber *> *fileIDs = pending.allKeys;
+    for (NSUInteger i = 0; i < fileIDs.count; i += CURSEFORGE_BULK_FILES_SIZE) {
+        NSArray *chunk = [fileIDs subarrayWithRange:NSMakeRange(i, MIN(CURSEFORGE_BULK_FILES_SIZE, fileIDs.count - i))];
+        NSError *error;
+        NSDictionary *response = [self postEndpoint:@"mods/files" body:@{@"fileIds": chunk} error:&error];
+        if (![response[@"data"] isKindOfClass:NSArray.class]) {
+            NSLog(@"[CurseForge] Bulk file lookup failed: %@", error.localizedDescription);
+            continue;
+        }
+        for (NSDictionary *file in response[@"data"]) {
+            NSNumber *fileID = @([file[@"id"] unsignedLongLongValue]);
+            NSString *key = pending[fileID];
+            NSDictionary *info = [self fileInfoFromData:file];
+            // A file id only ever belongs to one project, but the manifest is what we key by
+            if (key && info && [key isEqualToString:[self cacheKeyForProject:file[@"modId"] fileID:fileID]]) {
+                cache[key] = info;
+                [pending removeObjectForKey:fileID];
             }
         }
     }
+
+    if (pending.count > 0) {
+        NSLog(@"[CurseForge] Resolving %lu files individually", (unsigned long)pending.count);
+        dispatch_group_t group = dispatch_group_create();
+        dispatch_semaphore_t slots = dispatch_semaphore_create(CURSEFORGE_MAX_FALLBACK_REQUESTS);
+        dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+        for (NSString *key in pending.allValues) {
+            NSArray<NSString *> *ids = [key componentsSeparatedByString:@":"];
+            dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+            dispatch_group_async(group, queue, ^{
+                NSDictionary *info = [self fileInfoForProject:ids[0].longLongValue fileID:ids[1].longLongValue];
+                if (info) {
+                    cache[key] = info;
+                }
+                dispatch_semaphore_signal(slots);
+            });
+        }
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    }
+
+    // Taken before saving, the install still sees entries the capacity drops
+    NSDictionary *resolved = cache.entries;
+    [cache save];
+    return resolved;
+}
+
+- (NSDictionary *)fileInfoForProject:(unsigned long long)projectID fileID:(unsigned long long)fileID {
+    NSString *endpoint = [NSString stringWithFormat:@"mods/%llu/files/%llu", projectID, fileID];
+    // Runs on several threads at once, so errors are not reported through lastError
+    NSDictionary *response = [self getEndpoint:endpoint params:nil error:nil];
+    if ([response[@"data"] isKindOfClass:NSDictionary.class]) {
+        return [self fileInfoFromData:response[@"data"]];
+    }
+
+    endpoint = [NSString stringWithFormat:@"mods/%llu/files/%llu/download-url", projectID, fileID];
+    response = [self getEndpoint:endpoint params:nil error:nil];
+    if ([response[@"data"] isKindOfClass:NSString.class]) {
+        return @{@"url": response[@"data"]};
+    }
     return nil;
 }
 
@@ -0,0 +1,20 @@
+#import <Foundation/Foundation.h>
+
+// Resolved CurseForge files by "projectID:fileID", kept in a JSON file. Each
+// entry is stamped with the time it was added: entries older than maxAge are
+// dropped on load, and only the newest capacity entries are written back.
+// Adding entries is safe from any thread.
+@interface CurseForgeFileCache : NSObject
+
+- (instancetype)initWithPath:(NSString *)path capacity:(NSUInteger)capacity maxAge:(NSTimeInterval)maxAge;
+
+// Every entry loaded or added since, including those save will drop
+@property(nonatomic, readonly) NSDictionary<NSString *, NSDictionary *> *entries;
+
+- (NSDictionary *)objectForKeyedSubscript:(NSString *)key;
+- (void)setObject:(NSDictionary *)info forKeyedSubscript:(NSString *)key;
+
+// Writes the file if an entry was added or expired
+- (void)save;
+
+@end
@@ -0,0 +1,73 @@
+#import "CurseForgeFileCache.h"
+
+@interface CurseForgeFileCache()
+@property(nonatomic) NSString *path;
+@property(nonatomic) NSUInteger capacity;
+@property(nonatomic) NSMutableDictionary<NSString *, NSDictionary *> *cache;
+@property(nonatomic) BOOL changed;
+@end
+
+@implementation CurseForgeFileCache
+
+- (instancetype)initWithPath:(NSString *)path capacity:(NSUInteger)capacity maxAge:(NSTimeInterval)maxAge {
+    self = [super init];
+    self.path = path;
+    self.capacity = capacity;
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    if (data) {
+        self.cache = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingMutableContainers error:nil];
+    }
+    if (![self.cache isKindOfClass:NSMutableDictionary.class]) {
+        self.cache = [NSMutableDictionary new];
+    }
+    NSTimeInterval now = NSDate.date.timeIntervalSince1970;
+    NSArray *expired = [self.cache keysOfEntriesPassingTest:^BOOL(NSString *key, NSDictionary *info, BOOL *stop) {
+        return ![info isKindOfClass:NSDictionary.class] || now - [info[@"cachedAt"] doubleValue] > maxAge;
+    }].allObjects;
+    [self.cache removeObjectsForKeys:expired];
+    self.changed = expired.count > 0;
+    return self;
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)entries {
+    @synchronized (self) {
+        return self.cache.copy;
+    }
+}
+
+- (NSDictionary *)objectForKeyedSubscript:(NSString *)key {
+    @synchronized (self) {
+        return self.cache[key];
+    }
+}
+
+- (void)setObject:(NSDictionary *)info forKeyedSubscript:(NSString *)key {
+    NSMutableDictionary *entry = info.mutableCopy;
+    entry[@"cachedAt"] = @(NSDate.date.timeIntervalSince1970);
+    @synchronized (self) {
+        self.cache[key] = entry;
+        self.changed = YES;
+    }
+}
+
+- (void)save {
+    NSMutableDictionary *cache;
+    @synchronized (self) {
+        if (!self.changed) {
+            return;
+        }
+        cache = self.cache.mutableCopy;
+        self.changed = NO;
+    }
+    if (cache.count > self.capacity) {
+        NSArray *oldest = [cache keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *a, NSDictionary *b) {
+            return [a[@"cachedAt"] compare:b[@"cachedAt"]];
+        }];
+        [cache removeObjectsForKeys:[oldest subarrayWithRange:NSMakeRange(0, cache.count - self.capacity)]];
+    }
+    [NSFileManager.defaultManager createDirectoryAtPath:self.path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+    NSData *data = [NSJSONSerialization dataWithJSONObject:cache options:0 error:nil];
+    [data writeToFile:self.path atomically:YES];
+}
+
+@end
@@ -6,7 +6,8 @@
 
 @interface ModpackAPI : NSObject
 @property(nonatomic) NSString *baseURL;
-@property(nonatomic) NSError *lastError;
+// Error of the last failed request, possibly made on another thread
+@property(atomic) NSError *lastError;
 @property(nonatomic) BOOL reachedLastPage;
 
 - (instancetype)initWithURL:(NSString *)url;
@@ -17,5 +18,7 @@
 - (void)downloader:(MinecraftResourceDownloadTask *)downloader submitDownloadTasksFromPackage:(NSString *)packagePath toPath:(NSString *)destPath;
 
 - (id)getEndpoint:(NSString *)endpoint params:(NSDictionary *)params;
+// Same as getEndpoint:params:, but served from the search cache while fresh
+- (id)getCachedEndpoint:(NSString *)endpoint params:(NSDictionary *)params;
 
 @end
@@ -1,8 +1,13 @@
 #import "AFNetworking.h"
 #import "MinecraftResourceDownloadTask.h"
 #import "ModpackAPI.h"
+#import "PLDiskCache.h"
 #import "utils.h"
 
+// Search pages are kept for a while so going back and forth doesn't refetch them
+static const NSTimeInterval kSearchCacheMaxAge = 600;
+#define SEARCH_CACHE_CAPACITY (8 * 1024 * 1024)
+
 @implementation ModpackAPI
 
 #pragma mark Interface methods
@@ -45,6 +50,34 @@
     return result;
 }
 
++ (PLDiskCache *)searchCache {
+    static PLDiskCache *cache;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        cache = [[PLDiskCache alloc] initWithName:@"search" capacity:SEARCH_CACHE_CAPACITY];
+    });
+    return cache;
+}
+
+- (id)getCachedEndpoint:(NSString *)endpoint params:(NSDictionary *)params {
+    // Sorted keys make the same filter set map to the same entry
+    NSMutableString *key = [[self.baseURL stringByAppendingPathComponent:endpoint] mutableCopy];
+    for (NSString *name in [params.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        [key appendFormat:@"&%@=%@", name, params[name]];
+    }
+    NSData *data = [ModpackAPI.searchCache dataForKey:key maxAge:kSearchCacheMaxAge];
+    id result = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (result) {
+        return result;
+    }
+
+    result = [self getEndpoint:endpoint params:params];
+    if ([NSJSONSerialization isValidJSONObject:result]) {
+        [ModpackAPI.searchCache setData:[NSJSONSerialization dataWithJSONObject:result options:0 error:nil] forKey:key];
+    }
+    return result;
+}
+
 - (void)installModpackFromDetail:(NSDictionary *)modDetail atIndex:(NSUInteger)selectedVersion {
     // Pass details to LauncherNavigationController
     NSDictionary* userInfo = @{
@@ -0,0 +1,36 @@
+#import <Foundation/Foundation.h>
+#import "UnzipKit.h"
+
+@class MinecraftResourceDownloadTask;
+
+// Installs a downloaded modpack package as overlapping stages. Overrides
+// extraction and the loader json fetch start immediately, mod downloads are
+// fed to the session through a bounded window as the resolver produces them,
+// and the profile is written once every stage has finished. All stages report
+// into the downloader's progress.
+//
+// Installing over a previous install of the pack is an update: the state file
+// left by the last install is diffed by path and hash, so only added or changed
+// files are downloaded or extracted. Files modified since, by size or date, are
+// hashed again. Changes, the loader json included, are staged next to the game
+// directory contents and only moved into place once every stage succeeded.
+@interface ModpackInstallPipeline : NSObject
+
+// Archive directories extracted into the destination, in order
+@property(nonatomic) NSArray<NSString *> *overrideDirectories;
+// Result of +[ModpackUtils infoForDependencies:], the json is fetched if present
+@property(nonatomic) NSDictionary<NSString *, NSString *> *dependencyInfo;
+// Profile write stage, called on the main queue after everything else succeeded
+@property(nonatomic, copy) void(^writeProfile)(void);
+
+- (instancetype)initWithDownloader:(MinecraftResourceDownloadTask *)downloader archive:(UZKArchive *)archive destination:(NSString *)destPath;
+
+// The resolver runs on a background queue and returns the files to download as
+// {url or urls, path (relative to the destination), size, sha1}, or nil with an error message
+- (void)runWithResolver:(NSArray<NSDictionary *> *(^)(NSString **error))resolver;
+
+// Moves staged files into place, removes deleted ones and commits the new state.
+// Safe to call again after being interrupted.
++ (BOOL)applyStagedUpdateAtPath:(NSString *)destPath error:(NSError **)error;
+
+@end
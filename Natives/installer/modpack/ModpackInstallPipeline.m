@@ -0,0 +1,425 @@
+#include <CommonCrypto/CommonDigest.h>
+#include <zlib.h>
+
+#import "MinecraftResourceDownloadTask.h"
+#import "ModpackInstallPipeline.h"
+#import "ModpackUtils.h"
+
+// Downloads handed to the session at once. Enough to keep every connection
+// busy without creating hundreds of tasks and progress objects up front.
+#define MODPACK_MAX_ACTIVE_DOWNLOADS 16
+// What the last install of the pack put into its game directory
+#define MODPACK_STATE_NAME @".modpack_state.json"
+// Changes of the install in progress. Once the state file is written in here
+// the staged set is complete and gets applied, even after a restart.
+#define MODPACK_STAGING_NAME @".modpack_staging"
+// Loader json staged with the install, it belongs in the shared versions folder
+#define MODPACK_LOADER_NAME @".loader.json"
+
+@interface ModpackInstallPipeline ()
+@property(nonatomic) MinecraftResourceDownloadTask *downloader;
+@property(nonatomic) UZKArchive *archive;
+@property(nonatomic) NSString *destPath, *stagingPath;
+@property(nonatomic) dispatch_group_t group;
+// One token per unit of work the group was entered for and not yet left
+@property(nonatomic) NSMutableSet *pendingWork;
+// Guards the fetch window below
+@property(nonatomic) dispatch_queue_t fetchQueue;
+@property(nonatomic) NSArray<NSDictionary *> *files;
+@property(nonatomic) NSUInteger nextFile, activeDownloads;
+@property(nonatomic) BOOL failed;
+// Logged once the install is done, to tell how much the stages overlapped and
+// how full the fetch window was. Times are seconds since the run started
+@property(nonatomic) NSDate *startDate;
+@property(nonatomic) NSTimeInterval extractEnd, firstDownloadStart, lastDownloadEnd;
+@property(nonatomic) NSUInteger peakActiveDownloads;
+
+// path -> {hash, size, mtime} of downloaded files (sha1) and overrides (crc32),
+// from the last install. Installs before size and mtime were kept stored the hash only
+@property(nonatomic) NSDictionary<NSString *, id> *previousFiles, *previousOverrides;
+// Same for this install, filled in by the fetch and extract stages
+@property(nonatomic) NSMutableDictionary<NSString *, NSString *> *installedFiles, *installedOverrides;
+@property(nonatomic) NSUInteger unchangedFiles;
+@end
+
+// Hex digest of the file at path in the form of expected: crc32 of overrides, sha1 of downloads
+static NSString* ModpackInstallPipeline_hashOfFile(NSString *path, NSString *expected) {
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        return nil;
+    }
+    if (expected.length == 8) {
+        uLong crc = crc32(crc32(0, Z_NULL, 0), data.bytes, (uInt)data.length);
+        return [NSString stringWithFormat:@"%08lx", crc];
+    } else if (expected.length == CC_SHA1_DIGEST_LENGTH * 2) {
+        unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+        CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+        NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+        for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+            [hash appendFormat:@"%02x", digest[i]];
+        }
+        return hash;
+    }
+    return nil;
+}
+
+@implementation ModpackInstallPipeline
+
+- (instancetype)initWithDownloader:(MinecraftResourceDownloadTask *)downloader archive:(UZKArchive *)archive destination:(NSString *)destPath {
+    self = [super init];
+    self.downloader = downloader;
+    self.archive = archive;
+    self.destPath = destPath;
+    self.stagingPath = [destPath stringByAppendingPathComponent:MODPACK_STAGING_NAME];
+    self.group = dispatch_group_create();
+    self.pendingWork = [NSMutableSet new];
+    self.fetchQueue = dispatch_queue_create("net.kdt.pojavlauncher.modpack.fetch", DISPATCH_QUEUE_SERIAL);
+    self.installedFiles = [NSMutableDictionary new];
+    self.installedOverrides = [NSMutableDictionary new];
+    return self;
+}
+
+- (void)runWithResolver:(NSArray<NSDictionary *> *(^)(NSString **error))resolver {
+    self.startDate = NSDate.date;
+    // A failed download cancels the whole install without calling its success
+    // block, so nothing would ever leave the group for it
+    self.downloader.progress.cancellationHandler = ^{
+        [self leaveAllWork];
+    };
+    [self loadPreviousState];
+    [self startExtractStage];
+    [self startDependencyStage];
+    [self startFetchStageWithResolver:resolver];
+
+    dispatch_group_notify(self.group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        self.downloader.progress.cancellationHandler = nil;
+        if (self.failed || self.downloader.progress.cancelled) {
+            return;
+        }
+        NSError *error;
+        if (![self commitStagedChanges:&error]) {
+            [self failWithError:[NSString stringWithFormat:@"Failed to apply modpack files: %@", error.localizedDescription]];
+            return;
+        }
+        NSLog(@"[ModpackDL] Installed %lu files (%lu unchanged) in %.2fs", (unsigned long)self.files.count,
+            (unsigned long)self.unchangedFiles, -self.startDate.timeIntervalSinceNow);
+        if (self.peakActiveDownloads > 0) {
+            NSLog(@"[ModpackDL] Overrides extracted at %.2fs, downloads ran from %.2fs to %.2fs with up to %lu at once",
+                self.extractEnd, self.firstDownloadStart, self.lastDownloadEnd, (unsigned long)self.peakActiveDownloads);
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [NSFileManager.defaultManager removeItemAtURL:self.archive.fileURL error:nil];
+            if (self.writeProfile) {
+                self.writeProfile();
+            }
+            // Release the unit held by downloadModpackFromAPI so the install can finish
+            self.downloader.progress.completedUnitCount++;
+        });
+    });
+}
+
+- (void)failWithError:(NSString *)error {
+    @synchronized (self) {
+        if (self.failed || self.downloader.progress.cancelled) {
+            return;
+        }
+        self.failed = YES;
+    }
+    [self.downloader finishDownloadWithErrorString:error];
+}
+
+// Enters the group and returns the block that leaves it. The block may be
+// called more than once, the group is only left the first time.
+- (dispatch_block_t)enterWork {
+    NSObject *token = [NSObject new];
+    @synchronized (self.pendingWork) {
+        dispatch_group_enter(self.group);
+        [self.pendingWork addObject:token];
+    }
+    return ^{
+        @synchronized (self.pendingWork) {
+            if (![self.pendingWork containsObject:token]) {
+                return;
+            }
+            [self.pendingWork removeObject:token];
+        }
+        dispatch_group_leave(self.group);
+    };
+}
+
+// Leaves the group for all work still running, once the install failed or was cancelled
+- (void)leaveAllWork {
+    NSUInteger count;
+    @synchronized (self.pendingWork) {
+        count = self.pendingWork.count;
+        [self.pendingWork removeAllObjects];
+    }
+    for (NSUInteger i = 0; i < count; i++) {
+        dispatch_group_leave(self.group);
+    }
+}
+
+// Adds a stage progress weighted by the bytes it is expected to process
+- (NSProgress *)addStageProgressWithWeight:(int64_t)weight {
+    NSProgress *stage = [NSProgress progressWithTotalUnitCount:1];
+    stage.kind = NSProgressKindFile;
+    @synchronized (self.downloader.progress) {
+        [self.downloader.progress addChild:stage withPendingUnitCount:weight];
+        self.downloader.progress.totalUnitCount += weight;
+        self.downloader.textProgress.totalUnitCount = self.downloader.progress.totalUnitCount;
+    }
+    return stage;
+}
+
+#pragma mark - Update state
+
+- (void)loadPreviousState {
+    NSError *error;
+    if ([NSFileManager.defaultManager fileExistsAtPath:[self.stagingPath stringByAppendingPathComponent:MODPACK_STATE_NAME]]) {
+        // A previous update was interrupted after staging completed, finish it first
+        if (![ModpackInstallPipeline applyStagedUpdateAtPath:self.destPath error:&error]) {
+            NSLog(@"[ModpackDL] Failed to finish interrupted update: %@", error.localizedDescription);
+        }
+    }
+    // Anything left here is from an install that never completed
+    [NSFileManager.defaultManager removeItemAtPath:self.stagingPath error:nil];
+
+    NSData *data = [NSData dataWithContentsOfFile:[self.destPath stringByAppendingPathComponent:MODPACK_STATE_NAME]];
+    NSDictionary *state = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![state isKindOfClass:NSDictionary.class]) {
+        return;
+    }
+    if ([state[@"files"] isKindOfClass:NSDictionary.class]) {
+        self.previousFiles = state[@"files"];
+    }
+    if ([state[@"overrides"] isKindOfClass:NSDictionary.class]) {
+        self.previousOverrides = state[@"overrides"];
+    }
+    NSLog(@"[ModpackDL] Updating existing install with %lu files", (unsigned long)(self.previousFiles.count + self.previousOverrides.count));
+}
+
+// An entry of the previous install can be kept if its hash is unchanged and the
+// file on disk is still the one installed. A file whose size or modification
+// date differs from the recorded ones was touched since, it is only kept if it
+// hashes the same
+- (BOOL)isUnchanged:(NSString *)path hash:(NSString *)hash previous:(NSDictionary *)previous {
+    id entry = previous[path];
+    NSDictionary *record = [entry isKindOfClass:NSDictionary.class] ? entry : nil;
+    NSString *previousHash = record ? record[@"hash"] : entry;
+    if (hash.length == 0 || ![previousHash isKindOfClass:NSString.class] ||
+        [previousHash caseInsensitiveCompare:hash] != NSOrderedSame) {
+        return NO;
+    }
+    NSString *fullPath = [self.destPath stringByAppendingPathComponent:path];
+    NSDictionary *attributes = [NSFileManager.defaultManager attributesOfItemAtPath:fullPath error:nil];
+    if (![attributes.fileType isEqualToString:NSFileTypeRegular]) {
+        return NO;
+    } else if ([record[@"size"] isKindOfClass:NSNumber.class] && [record[@"mtime"] isKindOfClass:NSNumber.class] &&
+        [record[@"size"] unsignedLongLongValue] == attributes.fileSize &&
+        fabs([record[@"mtime"] doubleValue] - attributes.fileModificationDate.timeIntervalSince1970) < 0.001) {
+        return YES;
+    }
+    NSString *actualHash = ModpackInstallPipeline_hashOfFile(fullPath, hash);
+    return actualHash && [actualHash caseInsensitiveCompare:hash] == NSOrderedSame;
+}
+
+// Records the hash, size and modification date of each installed file, staged or kept
+- (NSDictionary *)stateEntriesForHashes:(NSDictionary<NSString *, NSString *> *)hashes {
+    NSMutableDictionary *entries = [NSMutableDictionary dictionaryWithCapacity:hashes.count];
+    for (NSString *path in hashes) {
+        NSFileManager *fileManager = NSFileManager.defaultManager;
+        // Moving the staged file into place keeps both
+        NSDictionary *attributes = [fileManager attributesOfItemAtPath:[self.stagingPath stringByAppendingPathComponent:path] error:nil] ?:
+            [fileManager attributesOfItemAtPath:[self.destPath stringByAppendingPathComponent:path] error:nil];
+        if (attributes) {
+            entries[path] = @{
+                @"hash": hashes[path],
+                @"size": @(attributes.fileSize),
+                @"mtime": @(attributes.fileModificationDate.timeIntervalSince1970)
+            };
+        } else {
+            entries[path] = @{@"hash": hashes[path]};
+        }
+    }
+    return entries;
+}
+
+- (BOOL)commitStagedChanges:(NSError **)error {
+    NSMutableSet *removed = [NSMutableSet setWithArray:self.previousFiles.allKeys];
+    [removed addObjectsFromArray:self.previousOverrides.allKeys];
+    [removed minusSet:[NSSet setWithArray:self.installedFiles.allKeys]];
+    [removed minusSet:[NSSet setWithArray:self.installedOverrides.allKeys]];
+
+    // Only placed once every stage succeeded, a failed install leaves the versions folder alone
+    NSString *loaderPath = [self.stagingPath stringByAppendingPathComponent:MODPACK_LOADER_NAME];
+    if (self.dependencyInfo[@"json"]) {
+        NSString *jsonPath = [NSString stringWithFormat:@"%1$s/versions/%2$@/%2$@.json", getenv("POJAV_GAME_DIR"), self.dependencyInfo[@"id"]];
+        [NSFileManager.defaultManager createDirectoryAtPath:jsonPath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+        if (rename(loaderPath.fileSystemRepresentation, jsonPath.fileSystemRepresentation) != 0) {
+            if (error) {
+                *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: jsonPath}];
+            }
+            return NO;
+        }
+    }
+
+    NSDictionary *state = @{
+        @"formatVersion": @(2),
+        @"files": [self stateEntriesForHashes:self.installedFiles],
+        @"overrides": [self stateEntriesForHashes:self.installedOverrides],
+        @"removed": removed.allObjects
+    };
+    NSData *data = [NSJSONSerialization dataWithJSONObject:state options:0 error:error];
+    [NSFileManager.defaultManager createDirectoryAtPath:self.stagingPath withIntermediateDirectories:YES attributes:nil error:nil];
+    if (!data || ![data writeToFile:[self.stagingPath stringByAppendingPathComponent:MODPACK_STATE_NAME] options:NSDataWritingAtomic error:error]) {
+        return NO;
+    }
+    return [ModpackInstallPipeline applyStagedUpdateAtPath:self.destPath error:error];
+}
+
++ (BOOL)applyStagedUpdateAtPath:(NSString *)destPath error:(NSError **)error {
+    NSFileManager *fileManager = NSFileManager.defaultManager;
+    NSString *stagingPath = [destPath stringByAppendingPathComponent:MODPACK_STAGING_NAME];
+    NSString *statePath = [stagingPath stringByAppendingPathComponent:MODPACK_STATE_NAME];
+    NSDictionary *state = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:statePath] ?: NSData.data options:0 error:error];
+    if (![state isKindOfClass:NSDictionary.class]) {
+        return NO;
+    }
+
+    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:stagingPath];
+    for (NSString *path in enumerator) {
+        if ([enumerator.fileAttributes.fileType isEqualToString:NSFileTypeDirectory] || [path isEqualToString:MODPACK_STATE_NAME]) {
+            continue;
+        }
+        NSString *target = [destPath stringByAppendingPathComponent:path];
+        [fileManager createDirectoryAtPath:target.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+        // rename() replaces the old file in one step, a reader sees either version
+        if (rename([stagingPath stringByAppendingPathComponent:path].fileSystemRepresentation, target.fileSystemRepresentation) != 0) {
+            if (error) {
+                *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: target}];
+            }
+            return NO;
+        }
+    }
+
+    for (NSString *path in state[@"removed"]) {
+        if (![path isKindOfClass:NSString.class] || [path.pathComponents containsObject:@".."]) {
+            continue;
+        }
+        [fileManager removeItemAtPath:[destPath stringByAppendingPathComponent:path] error:nil];
+    }
+
+    // Committing the state last makes the next update diff against what is actually on disk
+    NSString *committedPath = [destPath stringByAppendingPathComponent:MODPACK_STATE_NAME];
+    if (rename(statePath.fileSystemRepresentation, committedPath.fileSystemRepresentation) != 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: committedPath}];
+        }
+        return NO;
+    }
+    [fileManager removeItemAtPath:stagingPath error:nil];
+    NSLog(@"[ModpackDL] Applied staged update, removed %lu files", (unsigned long)[state[@"removed"] count]);
+    return YES;
+}
+
+#pragma mark - Stages
+
+- (void)startExtractStage {
+    NSNumber *packageSize;
+    [self.archive.fileURL getResourceValue:&packageSize forKey:NSURLFileSizeKey error:nil];
+    NSProgress *stage = [self addStageProgressWithWeight:MAX(packageSize.longLongValue, 1)];
+
+    dispatch_group_async(self.group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        // Paths written by an earlier directory must be written again by later ones to keep their order
+        NSMutableSet<NSString *> *extracted = [NSMutableSet new];
+        for (NSString *dir in self.overrideDirectories) {
+            NSError *error;
+            [ModpackUtils archive:self.archive extractDirectory:dir toPath:self.stagingPath filter:^BOOL(NSString *path, uint32_t crc) {
+                NSString *hash = [NSString stringWithFormat:@"%08x", crc];
+                self.installedOverrides[path] = hash;
+                if (![extracted containsObject:path] && [self isUnchanged:path hash:hash previous:self.previousOverrides]) {
+                    return NO;
+                }
+                [extracted addObject:path];
+                return YES;
+            } error:&error];
+            if (error) {
+                [self failWithError:[NSString stringWithFormat:@"Failed to extract %@: %@", dir, error.localizedDescription]];
+                return;
+            }
+        }
+        stage.completedUnitCount = 1;
+        self.extractEnd = -self.startDate.timeIntervalSinceNow;
+    });
+}
+
+- (void)startDependencyStage {
+    NSString *url = self.dependencyInfo[@"json"];
+    if (!url) {
+        return;
+    }
+    NSString *jsonPath = [self.stagingPath stringByAppendingPathComponent:MODPACK_LOADER_NAME];
+    dispatch_block_t leave = [self enterWork];
+    NSURLSessionDownloadTask *task = [self.downloader createDownloadTask:url size:0 sha:nil altName:nil toPath:jsonPath success:leave];
+    [task resume];
+}
+
+- (void)startFetchStageWithResolver:(NSArray<NSDictionary *> *(^)(NSString **error))resolver {
+    dispatch_block_t leave = [self enterWork];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSString *error;
+        NSArray *files = resolver(&error);
+        if (!files) {
+            [self failWithError:error];
+            leave();
+            return;
+        }
+        dispatch_async(self.fetchQueue, ^{
+            self.files = files;
+            [self submitNextDownloads];
+            leave();
+        });
+    });
+}
+
+// Called on fetchQueue whenever a slot frees up
+- (void)submitNextDownloads {
+    while (self.activeDownloads < MODPACK_MAX_ACTIVE_DOWNLOADS && self.nextFile < self.files.count) {
+        if (self.failed || self.downloader.progress.cancelled) {
+            return;
+        }
+        NSDictionary *file = self.files[self.nextFile++];
+        NSArray *urls = [file[@"urls"] isKindOfClass:NSArray.class] ? file[@"urls"] :
+            [file[@"url"] isKindOfClass:NSString.class] ? @[file[@"url"]] : nil;
+        if (![file[@"path"] isKindOfClass:NSString.class] || urls.count == 0) {
+            [self failWithError:[NSString stringWithFormat:@"No download URL for modpack file %@", file[@"path"]]];
+            return;
+        }
+        self.installedFiles[file[@"path"]] = file[@"sha1"] ?: @"";
+        if ([self isUnchanged:file[@"path"] hash:file[@"sha1"] previous:self.previousFiles]) {
+            self.unchangedFiles++;
+            continue;
+        }
+        self.activeDownloads++;
+        NSAssert(self.activeDownloads <= MODPACK_MAX_ACTIVE_DOWNLOADS, @"Fetch window overrun");
+        if (self.peakActiveDownloads == 0) {
+            self.firstDownloadStart = -self.startDate.timeIntervalSinceNow;
+        }
+        self.peakActiveDownloads = MAX(self.peakActiveDownloads, self.activeDownloads);
+        dispatch_block_t leave = [self enterWork];
+        NSString *path = [self.stagingPath stringByAppendingPathComponent:file[@"path"]];
+        // Verification happens in the downloader before success is called
+        NSURLSessionDownloadTask *task = [self.downloader createDownloadTaskWithURLs:urls
+            size:[file[@"size"] unsignedLongLongValue] sha:file[@"sha1"] altName:nil toPath:path success:^{
+            dispatch_async(self.fetchQueue, ^{
+                self.activeDownloads--;
+                self.lastDownloadEnd = -self.startDate.timeIntervalSinceNow;
+                [self submitNextDownloads];
+                leave();
+            });
+        }];
+        [task resume];
+    }
+}
+
+@end
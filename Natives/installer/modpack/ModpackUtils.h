@@ -4,6 +4,8 @@
 @interface ModpackUtils : NSObject
 
 + (void)archive:(UZKArchive *)archive extractDirectory:(NSString *)dir toPath:(NSString *)path error:(NSError **)error;
+// The filter sees each file's path relative to dir and its CRC-32, returning NO skips it
++ (void)archive:(UZKArchive *)archive extractDirectory:(NSString *)dir toPath:(NSString *)path filter:(BOOL(^)(NSString *path, uint32_t crc))filter error:(NSError **)error;
 + (NSDictionary *)infoForDependencies:(NSDictionary *)dependency;
 
 @end
@@ -1,35 +1,35 @@
 #import "installer/FabricUtils.h"
 #import "ModpackUtils.h"
+#include "zip_extract.h"
 
 @implementation ModpackUtils
 
+static bool ModpackUtils_filterEntry(const char *path, uint32_t crc, uint64_t size, void *ctx) {
+    BOOL(^filter)(NSString *, uint32_t) = (__bridge id)ctx;
+    return filter(@(path), crc);
+}
+
 + (void)archive:(UZKArchive *)archive extractDirectory:(NSString *)dir toPath:(NSString *)path error:(NSError *__autoreleasing*)error {
-    [archive performOnFilesInArchive:^(UZKFileInfo *fileInfo, BOOL *stop) {
-        if (![fileInfo.filename hasPrefix:dir] ||
-            fileInfo.filename.length <= dir.length) {
-            return;
-        }
-        NSString *fileName = [fileInfo.filename substringFromIndex:dir.length + 1];
-        NSString *destItemPath = [path stringByAppendingPathComponent:fileName];
-        NSString *destDirPath = fileInfo.isDirectory ? destItemPath : destItemPath.stringByDeletingLastPathComponent;
-        BOOL createdDir = [NSFileManager.defaultManager createDirectoryAtPath:destDirPath
-                                                withIntermediateDirectories:YES
-                                                                 attributes:nil
-                                                                      error:error];
-        if (!createdDir) {
-            *stop = YES;
-            return;
-        } else if (fileInfo.isDirectory) {
-            return;
-        }
+    [self archive:archive extractDirectory:dir toPath:path filter:nil error:error];
+}
 
-        NSData *data = [archive extractData:fileInfo error:error];
-        BOOL written = [data writeToFile:destItemPath options:NSDataWritingAtomic error:error];
-        *stop = !data || !written;
-        if (!*stop) {
-            NSLog(@"[ModpackDL] Extracted %@", fileInfo.filename);
++ (void)archive:(UZKArchive *)archive extractDirectory:(NSString *)dir toPath:(NSString *)path filter:(BOOL(^)(NSString *path, uint32_t crc))filter error:(NSError *__autoreleasing*)error {
+    char errbuf[PATH_MAX + 64];
+    zip_extract_options_t options = {.prefix = dir.UTF8String};
+    if (filter) {
+        options.filter = ModpackUtils_filterEntry;
+        options.filter_ctx = (__bridge void *)filter;
+    }
+    zip_extract_stats_t stats;
+    NSDate *start = NSDate.date;
+    int err = zip_extract(archive.fileURL.path.fileSystemRepresentation, path.fileSystemRepresentation, &options, &stats, errbuf, sizeof(errbuf));
+    if (err) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:err userInfo:@{NSLocalizedDescriptionKey: @(errbuf)}];
         }
-    } error:error];
+        return;
+    }
+    NSLog(@"[ModpackDL] Extracted %zu files (%llu bytes, %zu unchanged) from %@ in %.2fs", stats.files, stats.bytes, stats.skipped, dir, -start.timeIntervalSinceNow);
 }
 
 + (NSDictionary *)infoForDependencies:(NSDictionary *)dependency {
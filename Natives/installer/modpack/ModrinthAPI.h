@@ -2,5 +2,4 @@
 #import "ModpackAPI.h"
 
 @interface ModrinthAPI : ModpackAPI
-- (void)installModpackFromDetail:(NSDictionary *)detail atIndex:(NSInteger)index;
 @end
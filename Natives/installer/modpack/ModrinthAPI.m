@@ -1,6 +1,7 @@
 #import "ModrinthAPI.h"
 #import "MinecraftResourceDownloadTask.h"
 #import "PLProfiles.h"
+#import "ModpackInstallPipeline.h"
 #import "ModpackUtils.h"
 #import "UZKArchive.h"
 
@@ -25,7 +26,7 @@
         @"offset": @(modrinthSearchResult.count)
     };
     
-    NSDictionary *response = [self getEndpoint:@"search" params:params];
+    NSDictionary *response = [self getCachedEndpoint:@"search" params:params];
     if (!response) return nil;
     
     NSMutableArray *result = modrinthSearchResult ?: [NSMutableArray new];
@@ -72,23 +73,6 @@
     item[@"versionDetailsLoaded"] = @(YES);
 }
 
-- (void)installModpackFromDetail:(NSDictionary *)detail atIndex:(NSInteger)index {
-    NSString *packageUrl = detail[@"versionUrls"][index];
-    NSString *destPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"modrinth_install"];
-    [[NSFileManager defaultManager] createDirectoryAtPath:destPath withIntermediateDirectories:YES attributes:nil error:nil];
-    
-    NSURLSessionDownloadTask *task = [[NSURLSession sharedSession] downloadTaskWithURL:[NSURL URLWithString:packageUrl] completionHandler:^(NSURL *location, NSURLResponse *response, NSError *error) {
-        if (error) return;
-        
-        NSString *packagePath = [destPath stringByAppendingPathComponent:@"modpack.mrpack"];
-        [[NSFileManager defaultManager] moveItemAtURL:location toURL:[NSURL fileURLWithPath:packagePath] error:nil];
-        
-        MinecraftResourceDownloadTask *downloader = [MinecraftResourceDownloadTask new];
-        [self downloader:downloader submitDownloadTasksFromPackage:packagePath toPath:destPath];
-    }];
-    [task resume];
-}
-
 - (void)downloader:(MinecraftResourceDownloadTask *)downloader submitDownloadTasksFromPackage:(NSString *)packagePath toPath:(NSString *)destPath {
     NSError *error;
     UZKArchive *archive = [[UZKArchive alloc] initWithPath:packagePath error:&error];
@@ -104,50 +88,46 @@
         return;
     }
 
-    downloader.progress.totalUnitCount = [indexDict[@"files"] count];
-    for (NSDictionary *indexFile in indexDict[@"files"]) {
-        NSString *url = [indexFile[@"downloads"] firstObject];
-        NSString *sha = indexFile[@"hashes"][@"sha1"];
-        NSString *path = [destPath stringByAppendingPathComponent:indexFile[@"path"]];
-        NSUInteger size = [indexFile[@"fileSize"] unsignedLongLongValue];
-        NSURLSessionDownloadTask *task = [downloader createDownloadTask:url size:size sha:sha altName:nil toPath:path];
-        if (task) {
-            [downloader.fileList addObject:indexFile[@"path"]];
-            [task resume];
-        }
-    }
-
-    [ModpackUtils archive:archive extractDirectory:@"overrides" toPath:destPath error:&error];
-    if (error) {
-        [downloader finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to extract overrides: %@", error.localizedDescription]];
-        return;
-    }
-
-    [ModpackUtils archive:archive extractDirectory:@"client-overrides" toPath:destPath error:&error];
-    if (error) {
-        [downloader finishDownloadWithErrorString:[NSString stringWithFormat:@"Failed to extract client-overrides: %@", error.localizedDescription]];
-        return;
-    }
-
-    [[NSFileManager defaultManager] removeItemAtPath:packagePath error:nil];
-
+    ModpackInstallPipeline *pipeline = [[ModpackInstallPipeline alloc] initWithDownloader:downloader archive:archive destination:destPath];
+    pipeline.overrideDirectories = @[@"overrides", @"client-overrides"];
     NSDictionary<NSString *, NSString *> *depInfo = [ModpackUtils infoForDependencies:indexDict[@"dependencies"]];
-    if (depInfo[@"json"]) {
-        NSString *jsonPath = [NSString stringWithFormat:@"%1$s/versions/%2$@/%2$@.json", getenv("POJAV_GAME_DIR"), depInfo[@"id"]];
-        NSURLSessionDownloadTask *task = [downloader createDownloadTask:depInfo[@"json"] size:0 sha:nil altName:nil toPath:jsonPath];
-        [task resume];
-    }
-
-    NSString *tmpIconPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"icon.png"];
-    PLProfiles.current.profiles[indexDict[@"name"]] = @{
-        @"gameDir": [NSString stringWithFormat:@"./custom_gamedir/%@", destPath.lastPathComponent],
-        @"name": indexDict[@"name"],
-        @"lastVersionId": depInfo[@"id"],
-        @"icon": [NSString stringWithFormat:@"data:image/png;base64,%@",
-                 [[NSData dataWithContentsOfFile:tmpIconPath]
-                 base64EncodedStringWithOptions:0]]
-    }.mutableCopy;
-    PLProfiles.current.selectedProfileName = indexDict[@"name"];
+    pipeline.dependencyInfo = depInfo;
+    pipeline.writeProfile = ^{
+        NSString *tmpIconPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"icon.png"];
+        PLProfiles.current.profiles[indexDict[@"name"]] = @{
+            @"gameDir": [NSString stringWithFormat:@"./custom_gamedir/%@", destPath.lastPathComponent],
+            @"name": indexDict[@"name"],
+            @"lastVersionId": depInfo[@"id"],
+            @"icon": [NSString stringWithFormat:@"data:image/png;base64,%@",
+                     [[NSData dataWithContentsOfFile:tmpIconPath]
+                     base64EncodedStringWithOptions:0]]
+        }.mutableCopy;
+        PLProfiles.current.selectedProfileName = indexDict[@"name"];
+    };
+    [pipeline runWithResolver:^NSArray *(NSString **error) {
+        NSMutableArray *files = [NSMutableArray new];
+        for (NSDictionary *indexFile in indexDict[@"files"]) {
+            NSString *path = indexFile[@"path"];
+            if (![path isKindOfClass:NSString.class]) {
+                *error = @"Failed to parse modrinth.index.json: a file has no path";
+                return nil;
+            }
+            // Required by the index format, a file that can't be verified isn't installed
+            NSDictionary *hashes = indexFile[@"hashes"];
+            NSString *sha1 = [hashes isKindOfClass:NSDictionary.class] ? hashes[@"sha1"] : nil;
+            if (![sha1 isKindOfClass:NSString.class] || sha1.length != 40) {
+                *error = [NSString stringWithFormat:@"Failed to parse modrinth.index.json: %@ has no SHA-1", path];
+                return nil;
+            }
+            [files addObject:@{
+                @"urls": indexFile[@"downloads"] ?: @[],
+                @"path": path,
+                @"size": indexFile[@"fileSize"] ?: @0,
+                @"sha1": sha1.lowercaseString
+            }];
+        }
+        return files;
+    }];
 }
 
 @end
@@ -9,6 +9,7 @@
 
 #include <objc/runtime.h>
 #include "ios_uikit_bridge.h"
+#include "launch_timeline.h"
 #include "utils.h"
 
 void internal_showDialog(NSString* title, NSString* message) {
@@ -37,6 +38,16 @@ void showDialog(NSString* title, NSString* message) {
     });
 }
 
+JNIEXPORT void JNICALL Java_net_kdt_pojavlaunch_uikit_UIKit_timelineEvent(JNIEnv* env, jclass clazz, jchar phase, jstring name) {
+    const char *name_c = (*env)->GetStringUTFChars(env, name, 0);
+    switch (phase) {
+        case 'B': launch_timeline_begin(name_c); break;
+        case 'E': launch_timeline_end(name_c); break;
+        default: launch_timeline_mark(name_c); break;
+    }
+    (*env)->ReleaseStringUTFChars(env, name, name_c);
+}
+
 JNIEXPORT void JNICALL Java_net_kdt_pojavlaunch_uikit_UIKit_showError(JNIEnv* env, jclass clazz, jstring title, jstring message, jboolean exitIfOk) {
     const char *title_c = (*env)->GetStringUTFChars(env, title, 0);
     const char *message_c = (*env)->GetStringUTFChars(env, message, 0);
@@ -0,0 +1,248 @@
+#include <string.h>
+
+#include "json_pull.h"
+
+void json_pull_init(json_pull_t *p, const char *buf, size_t len) {
+    memset(p, 0, sizeof(*p));
+    p->buf = buf;
+    p->len = len;
+}
+
+static json_token_type json_pull_fail(json_pull_t *p) {
+    p->type = JSON_TOKEN_ERROR;
+    return p->type;
+}
+
+static void json_pull_skip_whitespace(json_pull_t *p) {
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        p->pos++;
+    }
+}
+
+static json_token_type json_pull_scan_string(json_pull_t *p, json_token_type type) {
+    size_t start = ++p->pos;
+    p->has_escapes = false;
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos];
+        if (c == '"') {
+            p->value = p->buf + start;
+            p->value_len = p->pos - start;
+            p->pos++;
+            p->type = type;
+            return type;
+        } else if (c == '\\') {
+            p->has_escapes = true;
+            p->pos += 2;
+        } else {
+            p->pos++;
+        }
+    }
+    return json_pull_fail(p);
+}
+
+static json_token_type json_pull_scan_literal(json_pull_t *p, const char *literal, json_token_type type) {
+    size_t len = strlen(literal);
+    if (p->len - p->pos < len || memcmp(p->buf + p->pos, literal, len) != 0) {
+        return json_pull_fail(p);
+    }
+    p->value = p->buf + p->pos;
+    p->value_len = len;
+    p->pos += len;
+    p->type = type;
+    return type;
+}
+
+static json_token_type json_pull_scan_number(json_pull_t *p) {
+    size_t start = p->pos;
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos];
+        if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') break;
+        p->pos++;
+    }
+    if (p->pos == start) {
+        return json_pull_fail(p);
+    }
+    p->value = p->buf + start;
+    p->value_len = p->pos - start;
+    p->type = JSON_TOKEN_NUMBER;
+    return p->type;
+}
+
+json_token_type json_pull_next(json_pull_t *p) {
+    if (p->type == JSON_TOKEN_ERROR) {
+        return p->type;
+    }
+
+    json_pull_skip_whitespace(p);
+    // Separators carry no information for a pull consumer
+    while (p->pos < p->len && (p->buf[p->pos] == ',' || p->buf[p->pos] == ':')) {
+        if (p->buf[p->pos] == ',' && p->depth > 0 && p->is_object[p->depth - 1]) {
+            p->expect_key = true;
+        }
+        p->pos++;
+        json_pull_skip_whitespace(p);
+    }
+    if (p->pos >= p->len) {
+        p->type = p->depth == 0 ? JSON_TOKEN_END : JSON_TOKEN_ERROR;
+        return p->type;
+    }
+
+    p->value = NULL;
+    p->value_len = 0;
+    char c = p->buf[p->pos];
+    switch (c) {
+        case '{':
+        case '[':
+            if (p->depth >= JSON_PULL_MAX_DEPTH) {
+                return json_pull_fail(p);
+            }
+            p->is_object[p->depth++] = (c == '{');
+            p->expect_key = (c == '{');
+            p->pos++;
+            p->type = c == '{' ? JSON_TOKEN_OBJECT_START : JSON_TOKEN_ARRAY_START;
+            return p->type;
+        case '}':
+        case ']':
+            if (p->depth == 0 || p->is_object[p->depth - 1] != (c == '}')) {
+                return json_pull_fail(p);
+            }
+            p->depth--;
+            p->expect_key = false;
+            p->pos++;
+            p->type = c == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END;
+            return p->type;
+        case '"': {
+            bool isKey = p->expect_key;
+            p->expect_key = false;
+            return json_pull_scan_string(p, isKey ? JSON_TOKEN_KEY : JSON_TOKEN_STRING);
+        }
+        case 't':
+            return json_pull_scan_literal(p, "true", JSON_TOKEN_TRUE);
+        case 'f':
+            return json_pull_scan_literal(p, "false", JSON_TOKEN_FALSE);
+        case 'n':
+            return json_pull_scan_literal(p, "null", JSON_TOKEN_NULL);
+        default:
+            return json_pull_scan_number(p);
+    }
+}
+
+bool json_pull_skip(json_pull_t *p) {
+    if (p->type != JSON_TOKEN_OBJECT_START && p->type != JSON_TOKEN_ARRAY_START) {
+        return p->type > JSON_TOKEN_END;
+    }
+    int depth = p->depth - 1;
+    while (p->depth > depth) {
+        if (json_pull_next(p) <= JSON_TOKEN_END) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool json_pull_token_equals(const json_pull_t *p, const char *str) {
+    size_t len = strlen(str);
+    return !p->has_escapes && p->value_len == len && memcmp(p->value, str, len) == 0;
+}
+
+static int json_pull_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static size_t json_pull_put_utf8(char *dst, uint32_t cp) {
+    if (cp < 0x80) {
+        dst[0] = cp;
+        return 1;
+    } else if (cp < 0x800) {
+        dst[0] = 0xC0 | (cp >> 6);
+        dst[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    } else if (cp < 0x10000) {
+        dst[0] = 0xE0 | (cp >> 12);
+        dst[1] = 0x80 | ((cp >> 6) & 0x3F);
+        dst[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    dst[0] = 0xF0 | (cp >> 18);
+    dst[1] = 0x80 | ((cp >> 12) & 0x3F);
+    dst[2] = 0x80 | ((cp >> 6) & 0x3F);
+    dst[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+long json_pull_copy_string(const json_pull_t *p, char *dst, size_t cap) {
+    if (p->type != JSON_TOKEN_STRING && p->type != JSON_TOKEN_KEY) {
+        return -1;
+    }
+    if (!p->has_escapes) {
+        if (p->value_len >= cap) return -1;
+        memcpy(dst, p->value, p->value_len);
+        dst[p->value_len] = '\0';
+        return p->value_len;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < p->value_len; i++) {
+        char c = p->value[i];
+        if (c != '\\') {
+            if (out + 1 >= cap) return -1;
+            dst[out++] = c;
+            continue;
+        }
+        if (++i >= p->value_len) return -1;
+        // Everything but \u comes out as one byte, \u is checked once decoded
+        if (p->value[i] != 'u' && out + 1 >= cap) return -1;
+        switch (p->value[i]) {
+            case 'b': dst[out++] = '\b'; break;
+            case 'f': dst[out++] = '\f'; break;
+            case 'n': dst[out++] = '\n'; break;
+            case 'r': dst[out++] = '\r'; break;
+            case 't': dst[out++] = '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (i + 4 >= p->value_len) return -1;
+                for (int j = 1; j <= 4; j++) {
+                    int digit = json_pull_hex(p->value[i + j]);
+                    if (digit < 0) return -1;
+                    cp = cp << 4 | digit;
+                }
+                i += 4;
+                // Combine surrogate pairs
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 6 < p->value_len &&
+                    p->value[i + 1] == '\\' && p->value[i + 2] == 'u') {
+                    uint32_t low = 0;
+                    for (int j = 3; j <= 6; j++) {
+                        int digit = json_pull_hex(p->value[i + j]);
+                        if (digit < 0) return -1;
+                        low = low << 4 | digit;
+                    }
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+                if (out + (cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4) >= cap) return -1;
+                out += json_pull_put_utf8(dst + out, cp);
+                break;
+            }
+            default: dst[out++] = p->value[i]; break;
+        }
+    }
+    dst[out] = '\0';
+    return out;
+}
+
+uint64_t json_pull_token_uint64(const json_pull_t *p) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < p->value_len; i++) {
+        char c = p->value[i];
+        if (c < '0' || c > '9') break;
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal pull-style JSON tokenizer. It never allocates: strings and numbers
+// are returned as slices of the input buffer, and escapes are only decoded
+// on demand with json_pull_copy_string().
+
+typedef enum {
+    JSON_TOKEN_ERROR = -1,
+    JSON_TOKEN_END = 0,
+    JSON_TOKEN_OBJECT_START,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_START,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_KEY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL
+} json_token_type;
+
+#define JSON_PULL_MAX_DEPTH 64
+
+typedef struct {
+    const char *buf;
+    size_t len, pos;
+    int depth;
+    // Per nesting level: 1 = object, 0 = array
+    uint8_t is_object[JSON_PULL_MAX_DEPTH];
+    // Whether the next string in the current object is a key
+    bool expect_key;
+
+    // Current token
+    json_token_type type;
+    const char *value;
+    size_t value_len;
+    bool has_escapes;
+} json_pull_t;
+
+void json_pull_init(json_pull_t *p, const char *buf, size_t len);
+json_token_type json_pull_next(json_pull_t *p);
+// Skips the value whose first token was just returned, including nested containers
+bool json_pull_skip(json_pull_t *p);
+
+bool json_pull_token_equals(const json_pull_t *p, const char *str);
+// Decodes the current string or key into dst, returns the decoded length or -1 on error/overflow
+long json_pull_copy_string(const json_pull_t *p, char *dst, size_t cap);
+uint64_t json_pull_token_uint64(const json_pull_t *p);
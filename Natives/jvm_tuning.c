@@ -0,0 +1,199 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jvm_tuning.h"
+
+#define MIN_HEAP_MB 512
+// Collections seen before a session's log is trusted over the baseline
+#define MIN_PAUSES 8
+// One tick at 20 TPS
+#define PAUSE_GOAL_MS 50
+// Room above the metaspace peak of the last session, for mods loading more
+// classes late and for the JIT's share of it
+#define METASPACE_HEADROOM_MB 128
+
+#pragma mark - Decisions
+
+static uint32_t clamp_heap(uint32_t heap, const jvm_tuning_input_t *input) {
+    // Round to 64 MB so the flags, and anything keyed on them, don't churn
+    heap = (heap + 32) / 64 * 64;
+    if (heap < MIN_HEAP_MB) heap = MIN_HEAP_MB;
+    if (input->max_heap_mb && heap > input->max_heap_mb) heap = input->max_heap_mb;
+    return heap;
+}
+
+static uint32_t decide_heap(const jvm_tuning_input_t *input) {
+    // Baseline before any history: newer versions allocate more per tick,
+    // and each mod adds loaded classes and registry data
+    uint32_t heap = (input->java_version >= 17 ? 1536 : 1024) + input->mod_count * 24;
+    const jvm_gc_stats_t *last = &input->last;
+    if (!input->last_heap_mb || last->pauses < MIN_PAUSES) {
+        return clamp_heap(heap, input);
+    }
+
+    // Keep the live set under a third of the heap, where G1 rarely needs
+    // mixed collections and never a full one
+    uint32_t target = last->max_after_mb * 3;
+    if (last->full_pauses > 0) {
+        // Ran out of heap, grow at once rather than halfway
+        uint32_t grown = input->last_heap_mb + input->last_heap_mb / 2;
+        heap = target > grown ? target : grown;
+    } else {
+        // Move halfway, so one unusual session doesn't swing the next one
+        heap = (input->last_heap_mb + target) / 2;
+        if (last->p95_pause_ms > PAUSE_GOAL_MS * 2 && heap < input->last_heap_mb + input->last_heap_mb / 4) {
+            // Long young pauses with a small heap usually mean premature promotion
+            heap = input->last_heap_mb + input->last_heap_mb / 4;
+        }
+    }
+    return clamp_heap(heap, input);
+}
+
+void jvm_tuning_decide(const jvm_tuning_input_t *input, jvm_tuning_profile_t *profile) {
+    memset(profile, 0, sizeof(*profile));
+    int cores = input->cores > 0 ? input->cores : 1;
+
+    profile->heap_mb = decide_heap(input);
+    // Start from the live set of the last session, growing from a tiny heap
+    // costs a series of back-to-back collections while the world loads
+    profile->initial_heap_mb = 128;
+    if (input->last_heap_mb && input->last.pauses >= MIN_PAUSES && input->last.max_after_mb > 128) {
+        profile->initial_heap_mb = input->last.max_after_mb < profile->heap_mb ? input->last.max_after_mb : profile->heap_mb;
+    }
+
+    if (cores >= 2 && profile->heap_mb >= 768) {
+        profile->gc = JVM_GC_G1;
+        profile->max_gc_pause_ms = PAUSE_GOAL_MS;
+        // Leave a core to the render thread during pauses
+        profile->parallel_gc_threads = cores > 2 ? cores - 1 : cores;
+        profile->conc_gc_threads = (profile->parallel_gc_threads + 2) / 4;
+    } else {
+        // Concurrent collectors cost more than they save on a single core or small heap
+        profile->gc = JVM_GC_SERIAL;
+    }
+
+    // Large modpacks recurse deeply during registry and world generation
+    if (input->mod_count >= 100) {
+        profile->thread_stack_kb = 2048;
+    }
+    // The default 240 MB reservation is a lot of the address space a jailed
+    // app gets, compiled code of a modded game stays well below this
+    profile->reserved_code_cache_mb = input->mod_count >= 50 ? 192 : 128;
+    // An OutOfMemoryError with a log beats being killed by jetsam without
+    // one, but a guess would stop games that need more. Only bound it once
+    // the last session of this workload showed how much it takes
+    uint32_t metaspace = input->last_heap_mb ? input->last.max_metaspace_mb : 0;
+    if (input->physical_mb && input->physical_mb <= 4096 && metaspace > 0) {
+        uint32_t headroom = metaspace / 2 > METASPACE_HEADROOM_MB ? metaspace / 2 : METASPACE_HEADROOM_MB;
+        profile->max_metaspace_mb = (metaspace + headroom + 63) / 64 * 64;
+    }
+}
+
+#pragma mark - GC log parsing
+
+// Parses "123M" into MB, advancing *p
+static bool parse_size_mb(const char **p, uint32_t *mb) {
+    char *end;
+    unsigned long long value = strtoull(*p, &end, 10);
+    if (end == *p) return false;
+    switch (*end) {
+        case 'K': value /= 1024; break;
+        case 'M': break;
+        case 'G': value *= 1024; break;
+        case 'B': value /= 1024 * 1024; break;
+        default: return false;
+    }
+    *mb = (uint32_t)value;
+    *p = end + 1;
+    return true;
+}
+
+// [12.345s][info][gc] GC(12) Pause Young (Normal) (G1 Evacuation Pause) 123M->45M(256M) 5.678ms
+// [12.345s][info][gc,metaspace] GC(12) Metaspace: 21059K(21248K)->21059K(21248K) NonClass: ...
+bool jvm_gc_log_parse_line(const char *line, jvm_gc_stats_t *stats, uint32_t *histogram) {
+    if (line[0] == '[') {
+        char *end;
+        double uptime = strtod(line + 1, &end);
+        if (end != line + 1 && *end == 's' && uptime > stats->uptime_s) {
+            stats->uptime_s = uptime;
+        }
+    }
+    const char *metaspace = strstr(line, " Metaspace: ");
+    if (metaspace) {
+        // Use before the collection, Java 11 logs it without the committed size
+        const char *p = metaspace + 12;
+        uint32_t used;
+        if (parse_size_mb(&p, &used) && used > stats->max_metaspace_mb) {
+            stats->max_metaspace_mb = used;
+        }
+        return false;
+    }
+    const char *pause = strstr(line, " Pause ");
+    if (!pause) return false;
+    // Sizes come after the cause, which may contain anything but "->"
+    const char *arrow = strstr(pause, "->");
+    if (!arrow) return false;
+    const char *p = arrow + 2;
+    uint32_t after, committed;
+    if (!parse_size_mb(&p, &after) || *p != '(') return false;
+    ++p;
+    if (!parse_size_mb(&p, &committed) || *p != ')') return false;
+    char *end;
+    double ms = strtod(p + 1, &end);
+    if (end == p + 1 || strncmp(end, "ms", 2) != 0) return false;
+
+    stats->pauses++;
+    if (!strncmp(pause, " Pause Full", 11)) {
+        stats->full_pauses++;
+    }
+    stats->total_pause_ms += ms;
+    if (ms > stats->max_pause_ms) stats->max_pause_ms = ms;
+    if (after > stats->max_after_mb) stats->max_after_mb = after;
+    if (committed > stats->max_committed_mb) stats->max_committed_mb = committed;
+    if (histogram) {
+        int bucket = ms < JVM_TUNING_PAUSE_BUCKETS - 1 ? (int)ms : JVM_TUNING_PAUSE_BUCKETS - 1;
+        histogram[bucket]++;
+    }
+    return true;
+}
+
+int jvm_gc_log_parse(const char *path, jvm_gc_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    FILE *file = fopen(path, "r");
+    if (!file) return errno;
+
+    uint32_t *histogram = calloc(JVM_TUNING_PAUSE_BUCKETS, sizeof(uint32_t));
+    if (!histogram) {
+        fclose(file);
+        return ENOMEM;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            // Overlong line, skip the rest of it
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n');
+        }
+        jvm_gc_log_parse_line(line, stats, histogram);
+    }
+    int err = ferror(file) ? EIO : 0;
+    fclose(file);
+
+    if (stats->pauses > 0) {
+        uint32_t rank = stats->pauses - stats->pauses / 20, seen = 0;
+        for (int i = 0; i < JVM_TUNING_PAUSE_BUCKETS; i++) {
+            seen += histogram[i];
+            if (seen >= rank) {
+                // Upper bound of the bucket, the exact maximum for the last one
+                stats->p95_pause_ms = i == JVM_TUNING_PAUSE_BUCKETS - 1 ? stats->max_pause_ms : i + 1;
+                break;
+            }
+        }
+        if (stats->p95_pause_ms > stats->max_pause_ms) stats->p95_pause_ms = stats->max_pause_ms;
+    }
+    free(histogram);
+    return err;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// JVM tuning profiles: picks heap, GC and memory area sizes from the device,
+// the runtime and the workload, and refines the heap from the GC log of the
+// previous session of the same version. Decisions are pure functions of
+// their inputs so recorded logs can be replayed off-device.
+
+// Pauses longer than this land in the last histogram bucket
+#define JVM_TUNING_PAUSE_BUCKETS 1000
+
+typedef struct {
+    uint32_t pauses;
+    uint32_t full_pauses;
+    double total_pause_ms;
+    double max_pause_ms;
+    double p95_pause_ms;
+    // Largest heap occupancy right after a collection, the live set estimate
+    uint32_t max_after_mb;
+    uint32_t max_committed_mb;
+    // Largest metaspace use seen at a collection, 0 if not logged
+    uint32_t max_metaspace_mb;
+    // JVM uptime at the last GC line
+    double uptime_s;
+} jvm_gc_stats_t;
+
+typedef struct {
+    uint32_t physical_mb;
+    // Largest heap the launcher allows on this device, 0 for no limit
+    uint32_t max_heap_mb;
+    int cores;
+    int java_version;
+    int mod_count;
+    // Heap of the previous session, 0 if there is no history
+    uint32_t last_heap_mb;
+    jvm_gc_stats_t last;
+} jvm_tuning_input_t;
+
+typedef enum {
+    JVM_GC_DEFAULT,
+    JVM_GC_SERIAL,
+    JVM_GC_G1
+} jvm_gc_t;
+
+typedef struct {
+    uint32_t heap_mb;
+    uint32_t initial_heap_mb;
+    jvm_gc_t gc;
+    // 0 leaves the JVM default for any of the following
+    int max_gc_pause_ms;
+    int parallel_gc_threads;
+    int conc_gc_threads;
+    int thread_stack_kb;
+    int reserved_code_cache_mb;
+    int max_metaspace_mb;
+} jvm_tuning_profile_t;
+
+void jvm_tuning_decide(const jvm_tuning_input_t *input, jvm_tuning_profile_t *profile);
+
+// Parses a unified GC log (-Xlog:gc,gc+metaspace), lines other than pauses
+// and metaspace use are skipped.
+// Returns 0 on success, otherwise an errno-style error code
+int jvm_gc_log_parse(const char *path, jvm_gc_stats_t *stats);
+// Same for a single line, returns whether it was a pause
+bool jvm_gc_log_parse_line(const char *line, jvm_gc_stats_t *stats, uint32_t *histogram);
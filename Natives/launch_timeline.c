@@ -0,0 +1,138 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "launch_timeline.h"
+
+// Startup produces a few dozen events, anything past this is dropped
+#define LAUNCH_TIMELINE_CAPACITY 512
+#define LAUNCH_TIMELINE_NAME_LEN 64
+
+typedef struct {
+    // Set last, readers skip slots that are still being filled
+    atomic_bool ready;
+    char phase;
+    uint64_t tid;
+    uint64_t time_ns;
+    char name[LAUNCH_TIMELINE_NAME_LEN];
+} launch_timeline_event_t;
+
+static launch_timeline_event_t launch_timeline_events[LAUNCH_TIMELINE_CAPACITY];
+static atomic_uint launch_timeline_count;
+static atomic_bool launch_timeline_done;
+
+static uint64_t launch_timeline_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t launch_timeline_tid(void) {
+#ifdef __APPLE__
+    uint64_t tid;
+    pthread_threadid_np(NULL, &tid);
+    return tid;
+#else
+    return (uint64_t)pthread_self();
+#endif
+}
+
+static void launch_timeline_append(char phase, const char *name) {
+    if (atomic_load_explicit(&launch_timeline_done, memory_order_relaxed)) {
+        return;
+    }
+    unsigned int index = atomic_fetch_add_explicit(&launch_timeline_count, 1, memory_order_relaxed);
+    if (index >= LAUNCH_TIMELINE_CAPACITY) {
+        return;
+    }
+    launch_timeline_event_t *event = &launch_timeline_events[index];
+    event->time_ns = launch_timeline_now();
+    event->phase = phase;
+    event->tid = launch_timeline_tid();
+    strncpy(event->name, name, LAUNCH_TIMELINE_NAME_LEN - 1);
+    atomic_store_explicit(&event->ready, true, memory_order_release);
+}
+
+void launch_timeline_begin(const char *name) {
+    launch_timeline_append('B', name);
+}
+
+void launch_timeline_end(const char *name) {
+    launch_timeline_append('E', name);
+}
+
+void launch_timeline_mark(const char *name) {
+    launch_timeline_append('i', name);
+}
+
+static void launch_timeline_write_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for (; *str; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool launch_timeline_write(const char *path) {
+    if (atomic_exchange(&launch_timeline_done, true)) {
+        return false;
+    }
+    unsigned int count = atomic_load(&launch_timeline_count);
+    if (count > LAUNCH_TIMELINE_CAPACITY) count = LAUNCH_TIMELINE_CAPACITY;
+
+    launch_timeline_event_t *events = launch_timeline_events;
+    bool used[LAUNCH_TIMELINE_CAPACITY] = {false};
+    uint64_t origin = UINT64_MAX;
+    for (unsigned int i = 0; i < count; i++) {
+        if (!atomic_load_explicit(&events[i].ready, memory_order_acquire)) {
+            used[i] = true;
+        } else if (events[i].time_ns < origin) {
+            origin = events[i].time_ns;
+        }
+    }
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    bool first = true;
+    for (unsigned int i = 0; i < count; i++) {
+        if (used[i] || events[i].phase == 'E') continue;
+        launch_timeline_event_t *event = &events[i];
+        // Emit begin/end pairs as complete events on the beginning thread, as they
+        // can end elsewhere (e.g. the JVM is started and runs main on different threads)
+        int64_t duration = -1;
+        if (event->phase == 'B') {
+            for (unsigned int j = i + 1; j < count; j++) {
+                if (!used[j] && events[j].phase == 'E' && strcmp(events[j].name, event->name) == 0) {
+                    used[j] = true;
+                    duration = events[j].time_ns - event->time_ns;
+                    break;
+                }
+            }
+        }
+        fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+        launch_timeline_write_string(file, event->name);
+        fprintf(file, ",\"pid\":1,\"tid\":%llu,\"ts\":%.3f", (unsigned long long)event->tid, (event->time_ns - origin) / 1000.0);
+        if (duration >= 0) {
+            fprintf(file, ",\"ph\":\"X\",\"dur\":%.3f}", duration / 1000.0);
+        } else {
+            // Instant, or a phase that never ended
+            fputs(",\"ph\":\"i\",\"s\":\"t\"}", file);
+        }
+        first = false;
+    }
+    fputs("\n]}\n", file);
+    return fclose(file) == 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Process-wide startup timeline. Native code and Java (through the UIKit
+// timeline natives) append named phases to one fixed buffer without locking,
+// so marking a phase costs a clock read and a few stores. The buffer is
+// written out once as Chrome trace JSON, viewable in chrome://tracing or
+// Perfetto, to attribute startup time to a phase.
+
+// begin and end are paired by name and may happen on different threads
+void launch_timeline_begin(const char *name);
+void launch_timeline_end(const char *name);
+void launch_timeline_mark(const char *name);
+
+// Writes the timeline on the first call, later calls do nothing and return false
+bool launch_timeline_write(const char *path);
@@ -0,0 +1,233 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_lines.h"
+
+#pragma mark - Line store
+
+int log_lines_init(log_lines_t *store, size_t capacity, size_t arena_size) {
+    memset(store, 0, sizeof(*store));
+    // A line must always fit, even right after a wasted arena tail
+    if (arena_size < LOG_LINES_MAX_LINE * 2) arena_size = LOG_LINES_MAX_LINE * 2;
+    store->arena = malloc(arena_size);
+    store->lines = malloc(capacity * sizeof(log_line_t));
+    if (!store->arena || !store->lines || capacity == 0) {
+        free(store->arena);
+        free(store->lines);
+        return ENOMEM;
+    }
+    store->arena_size = arena_size;
+    store->capacity = capacity;
+    pthread_mutex_init(&store->lock, NULL);
+    return 0;
+}
+
+void log_lines_free(log_lines_t *store) {
+    pthread_mutex_destroy(&store->lock);
+    free(store->arena);
+    free(store->lines);
+}
+
+// Length of text cut to at most max bytes without splitting a UTF-8 sequence
+static size_t utf8_truncate(const char *text, size_t len, size_t max) {
+    if (len <= max) return len;
+    while (max > 0 && ((unsigned char)text[max] & 0xC0) == 0x80) {
+        max--;
+    }
+    return max;
+}
+
+// Called with the lock held
+static void commit_line(log_lines_t *store, const char *text, size_t len) {
+    uint64_t pos = store->arena_pos;
+    size_t offset = pos % store->arena_size;
+    // Lines never wrap, skip the tail of the arena instead
+    if (offset + len > store->arena_size) {
+        pos += store->arena_size - offset;
+        offset = 0;
+    }
+    // Evict every line whose bytes the new one overwrites, and the oldest
+    // one if the ring is full
+    while (store->first < store->next) {
+        log_line_t *oldest = &store->lines[store->first % store->capacity];
+        if (oldest->start + store->arena_size >= pos + len && store->next - store->first < store->capacity) break;
+        store->first++;
+    }
+    memcpy(store->arena + offset, text, len);
+    store->lines[store->next % store->capacity] = (log_line_t){pos, (uint32_t)len};
+    store->next++;
+    store->arena_pos = pos + len;
+}
+
+// Called with the lock held
+static void append_partial(log_lines_t *store, const char *text, size_t len) {
+    if (store->partial_truncated) return;
+    size_t room = LOG_LINES_MAX_LINE - store->partial_len;
+    size_t kept = utf8_truncate(text, len, room);
+    memcpy(store->partial + store->partial_len, text, kept);
+    store->partial_len += kept;
+    store->partial_truncated = kept < len;
+}
+
+void log_lines_append(log_lines_t *store, const char *buf, size_t len) {
+    pthread_mutex_lock(&store->lock);
+    const char *end = buf + len;
+    while (buf < end) {
+        const char *newline = memchr(buf, '\n', end - buf);
+        if (!newline) {
+            append_partial(store, buf, end - buf);
+            break;
+        }
+        size_t line_len = newline - buf;
+        if (line_len > 0 && buf[line_len - 1] == '\r') line_len--;
+        if (store->partial_len == 0 && !store->partial_truncated) {
+            // Common case, straight from the chunk. Blank lines only take up rows
+            if (line_len > 0) {
+                commit_line(store, buf, utf8_truncate(buf, line_len, LOG_LINES_MAX_LINE));
+            }
+        } else {
+            append_partial(store, buf, line_len);
+            if (store->partial_len > 0 && store->partial[store->partial_len - 1] == '\r') store->partial_len--;
+            commit_line(store, store->partial, store->partial_len);
+            store->partial_len = 0;
+            store->partial_truncated = false;
+        }
+        buf = newline + 1;
+    }
+    store->version++;
+    pthread_mutex_unlock(&store->lock);
+}
+
+void log_lines_clear(log_lines_t *store) {
+    pthread_mutex_lock(&store->lock);
+    store->first = store->next;
+    store->partial_len = 0;
+    store->partial_truncated = false;
+    store->version++;
+    pthread_mutex_unlock(&store->lock);
+}
+
+uint64_t log_lines_range(log_lines_t *store, uint64_t *first, uint64_t *next) {
+    pthread_mutex_lock(&store->lock);
+    *first = store->first;
+    *next = store->next + (store->partial_len > 0);
+    uint64_t version = store->version;
+    pthread_mutex_unlock(&store->lock);
+    return version;
+}
+
+bool log_lines_get(log_lines_t *store, uint64_t id, char *buf, size_t len) {
+    if (len == 0) return false;
+    pthread_mutex_lock(&store->lock);
+    const char *text;
+    size_t text_len;
+    if (id < store->first || id > store->next || (id == store->next && store->partial_len == 0)) {
+        pthread_mutex_unlock(&store->lock);
+        buf[0] = '\0';
+        return false;
+    } else if (id == store->next) {
+        text = store->partial;
+        text_len = store->partial_len;
+    } else {
+        log_line_t *line = &store->lines[id % store->capacity];
+        text = store->arena + line->start % store->arena_size;
+        text_len = line->len;
+    }
+    text_len = utf8_truncate(text, text_len, len - 1);
+    memcpy(buf, text, text_len);
+    buf[text_len] = '\0';
+    pthread_mutex_unlock(&store->lock);
+    return true;
+}
+
+#pragma mark - Filter
+
+int log_filter_init(log_filter_t *filter, const char *needle, size_t capacity) {
+    memset(filter, 0, sizeof(*filter));
+    filter->needle_len = strlen(needle);
+    filter->needle = malloc(filter->needle_len + 1);
+    filter->matches = malloc(capacity * sizeof(uint64_t));
+    if (!filter->needle || !filter->matches || capacity == 0) {
+        free(filter->needle);
+        free(filter->matches);
+        return ENOMEM;
+    }
+    for (size_t i = 0; i <= filter->needle_len; i++) {
+        filter->needle[i] = tolower((unsigned char)needle[i]);
+    }
+    filter->capacity = capacity;
+    pthread_mutex_init(&filter->lock, NULL);
+    return 0;
+}
+
+void log_filter_free(log_filter_t *filter) {
+    pthread_mutex_destroy(&filter->lock);
+    free(filter->needle);
+    free(filter->matches);
+}
+
+static bool line_matches(const log_filter_t *filter, const char *text, size_t len) {
+    size_t n = filter->needle_len;
+    if (n == 0) return true;
+    if (n > len) return false;
+    char first = filter->needle[0];
+    for (size_t i = 0; i + n <= len; i++) {
+        if (tolower((unsigned char)text[i]) != first) continue;
+        size_t j = 1;
+        while (j < n && tolower((unsigned char)text[i + j]) == filter->needle[j]) j++;
+        if (j == n) return true;
+    }
+    return false;
+}
+
+size_t log_filter_update(log_filter_t *filter, log_lines_t *store, size_t max_lines) {
+    // Matches are buffered so the store lock isn't held while taking the filter lock
+    uint64_t found[256];
+    if (max_lines > 256) max_lines = 256;
+    size_t count = 0;
+
+    pthread_mutex_lock(&store->lock);
+    uint64_t id = filter->scanned > store->first ? filter->scanned : store->first;
+    uint64_t end = store->next - id > max_lines ? id + max_lines : store->next;
+    uint64_t live_first = store->first;
+    for (; id < end; id++) {
+        log_line_t *line = &store->lines[id % store->capacity];
+        if (line_matches(filter, store->arena + line->start % store->arena_size, line->len)) {
+            found[count++] = id;
+        }
+    }
+    pthread_mutex_unlock(&store->lock);
+    size_t scanned = end - (filter->scanned > live_first ? filter->scanned : live_first);
+
+    pthread_mutex_lock(&filter->lock);
+    for (size_t i = 0; i < count; i++) {
+        if (filter->next - filter->first == filter->capacity) filter->first++;
+        filter->matches[filter->next++ % filter->capacity] = found[i];
+    }
+    // Drop matches whose lines were evicted
+    while (filter->first < filter->next && filter->matches[filter->first % filter->capacity] < live_first) {
+        filter->first++;
+    }
+    filter->scanned = end;
+    pthread_mutex_unlock(&filter->lock);
+    return scanned;
+}
+
+void log_filter_range(log_filter_t *filter, uint64_t *first, uint64_t *next) {
+    pthread_mutex_lock(&filter->lock);
+    *first = filter->first;
+    *next = filter->next;
+    pthread_mutex_unlock(&filter->lock);
+}
+
+bool log_filter_get(log_filter_t *filter, uint64_t index, uint64_t *id) {
+    pthread_mutex_lock(&filter->lock);
+    bool found = index >= filter->first && index < filter->next;
+    if (found) {
+        *id = filter->matches[index % filter->capacity];
+    }
+    pthread_mutex_unlock(&filter->lock);
+    return found;
+}
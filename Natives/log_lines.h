@@ -0,0 +1,71 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded store of log lines for the log console: line text lives in one
+// fixed arena and line records in a fixed ring, the oldest lines are evicted
+// once either fills up. Lines are addressed by monotonic ids, so a reader
+// can tell an evicted line from a live one. All functions are thread safe.
+
+// Longer lines are cut at a UTF-8 boundary below this
+#define LOG_LINES_MAX_LINE 2048
+
+typedef struct {
+    uint64_t start; // monotonic arena position, start % arena_size is the offset
+    uint32_t len;
+} log_line_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    char *arena;
+    size_t arena_size;
+    uint64_t arena_pos;
+    log_line_t *lines;
+    size_t capacity;
+    // Ids of the oldest live line and of the next line to be committed
+    uint64_t first, next;
+    // Text after the last newline, shown as line `next` until completed
+    char partial[LOG_LINES_MAX_LINE];
+    size_t partial_len;
+    bool partial_truncated;
+    // Bumped on every change
+    uint64_t version;
+} log_lines_t;
+
+int log_lines_init(log_lines_t *store, size_t capacity, size_t arena_size);
+void log_lines_free(log_lines_t *store);
+// Splits buf into lines, an unterminated last line is completed by later calls
+void log_lines_append(log_lines_t *store, const char *buf, size_t len);
+void log_lines_clear(log_lines_t *store);
+// Visible ids are [first, next), including an incomplete last line. Returns the version
+uint64_t log_lines_range(log_lines_t *store, uint64_t *first, uint64_t *next);
+// Copies line id into buf, NUL terminated. Returns false once it was evicted
+bool log_lines_get(log_lines_t *store, uint64_t id, char *buf, size_t len);
+
+// Incremental substring filter over a store: each update scans only the
+// lines committed since the previous one, so it can run off the main thread
+// while lines keep coming in.
+typedef struct {
+    pthread_mutex_t lock;
+    char *needle; // lowercased
+    size_t needle_len;
+    uint64_t *matches; // ring of matching line ids
+    size_t capacity;
+    // Monotonic indices of the oldest kept match and of the next match
+    uint64_t first, next;
+    // First line id not scanned yet
+    uint64_t scanned;
+} log_filter_t;
+
+// Case insensitive for ASCII. Returns 0 on success, otherwise an errno-style error code
+int log_filter_init(log_filter_t *filter, const char *needle, size_t capacity);
+void log_filter_free(log_filter_t *filter);
+// Scans up to max_lines new lines, returns how many were scanned.
+// Only one thread may update a filter, any may read it
+size_t log_filter_update(log_filter_t *filter, log_lines_t *store, size_t max_lines);
+void log_filter_range(log_filter_t *filter, uint64_t *first, uint64_t *next);
+// Returns false if the match at index was dropped
+bool log_filter_get(log_filter_t *filter, uint64_t index, uint64_t *id);
@@ -0,0 +1,335 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_redact.h"
+
+// A value without a stop byte in sight is most likely not one
+#define MAX_VALUE_LEN 4096
+// "255.255.255.255."
+#define MAX_IPV4_LEN 16
+#define IPV4_REPLACEMENT "<ip>"
+
+typedef struct {
+    size_t len;
+    char *replacement;
+    size_t replacement_len;
+    bool value;
+    bool whole_word;
+    uint8_t stop[32]; // bitmap
+} pattern_t;
+
+typedef struct {
+    // Goto function with failure links folded in, a full DFA
+    uint16_t next[256];
+    uint16_t depth;
+    // Longest pattern ending here, including through suffix links, or -1
+    int16_t pattern;
+} node_t;
+
+struct log_redactor {
+    pattern_t *patterns;
+    size_t pattern_count;
+    node_t *nodes;
+    size_t node_count;
+    size_t min_len, max_replacement, max_carry;
+    bool redact_ipv4;
+
+    // Streaming state
+    uint16_t state;
+    char prev;
+    // Last byte already returned, precedes the held back ones
+    char last_out;
+    // Whole word match waiting for the byte after it
+    const pattern_t *pending;
+    // Replacing a value up to one of the stop bytes of skip_pattern
+    bool skipping;
+    size_t skipped;
+    const pattern_t *skip_pattern;
+    // IPv4 candidate: bytes so far, completed dots, digits and value of the
+    // current octet. dead marks a digit run that can't be an address
+    size_t ip_len;
+    int ip_dots, ip_digits, ip_value;
+    bool ip_dead, ip_trailing_dot;
+    // Tail of the last chunk that may still be part of a match
+    char *carry;
+    size_t carry_len;
+};
+
+static inline bool stop_has(const pattern_t *pattern, unsigned char c) {
+    return pattern->stop[c >> 3] & (1 << (c & 7));
+}
+
+static inline bool is_word(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+#pragma mark - Automaton
+
+static bool build_automaton(log_redactor_t *r, const log_redact_pattern_t *patterns) {
+    size_t total = 1;
+    for (size_t i = 0; i < r->pattern_count; i++) {
+        total += strlen(patterns[i].match);
+    }
+    if (total > UINT16_MAX) return false;
+    r->nodes = calloc(total, sizeof(node_t));
+    if (!r->nodes) return false;
+    r->node_count = 1;
+    r->nodes[0].pattern = -1;
+
+    // Trie, 0 doubles as "no edge" since nothing points back at the root yet
+    for (size_t i = 0; i < r->pattern_count; i++) {
+        const unsigned char *match = (const unsigned char *)patterns[i].match;
+        uint16_t state = 0;
+        for (size_t j = 0; match[j]; j++) {
+            if (!r->nodes[state].next[match[j]]) {
+                uint16_t node = r->node_count++;
+                r->nodes[node].depth = r->nodes[state].depth + 1;
+                r->nodes[node].pattern = -1;
+                r->nodes[state].next[match[j]] = node;
+            }
+            state = r->nodes[state].next[match[j]];
+        }
+        // The first of duplicate patterns wins
+        if (r->nodes[state].pattern < 0) {
+            r->nodes[state].pattern = (int16_t)i;
+        }
+    }
+
+    // Breadth first: fold failure links into missing edges and inherit the
+    // pattern of the failure state where a node has none of its own
+    uint16_t *queue = malloc(r->node_count * sizeof(uint16_t));
+    uint16_t *fail = calloc(r->node_count, sizeof(uint16_t));
+    if (!queue || !fail) {
+        free(queue);
+        free(fail);
+        return false;
+    }
+    size_t head = 0, tail = 0;
+    for (int c = 0; c < 256; c++) {
+        uint16_t child = r->nodes[0].next[c];
+        if (child) {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        uint16_t node = queue[head++];
+        if (r->nodes[node].pattern < 0) {
+            r->nodes[node].pattern = r->nodes[fail[node]].pattern;
+        }
+        for (int c = 0; c < 256; c++) {
+            uint16_t child = r->nodes[node].next[c];
+            uint16_t fallback = r->nodes[fail[node]].next[c];
+            if (child) {
+                fail[child] = fallback;
+                queue[tail++] = child;
+            } else {
+                r->nodes[node].next[c] = fallback;
+            }
+        }
+    }
+    free(queue);
+    free(fail);
+    return true;
+}
+
+log_redactor_t *log_redactor_create(const log_redact_pattern_t *patterns, size_t count, bool redact_ipv4) {
+    log_redactor_t *r = calloc(1, sizeof(log_redactor_t));
+    if (!r) return NULL;
+    r->patterns = calloc(count ? count : 1, sizeof(pattern_t));
+    r->redact_ipv4 = redact_ipv4;
+    r->min_len = redact_ipv4 ? 7 : SIZE_MAX;
+    r->max_replacement = redact_ipv4 ? strlen(IPV4_REPLACEMENT) : 0;
+    r->max_carry = MAX_IPV4_LEN;
+    if (!r->patterns) goto fail;
+
+    for (size_t i = 0; i < count; i++) {
+        pattern_t *pattern = &r->patterns[i];
+        pattern->len = strlen(patterns[i].match);
+        if (pattern->len == 0) goto fail;
+        pattern->replacement = strdup(patterns[i].replacement);
+        if (!pattern->replacement) goto fail;
+        pattern->replacement_len = strlen(pattern->replacement);
+        pattern->value = patterns[i].stop != NULL;
+        pattern->whole_word = patterns[i].whole_word;
+        for (const unsigned char *c = (const unsigned char *)patterns[i].stop; c && *c; c++) {
+            pattern->stop[*c >> 3] |= 1 << (*c & 7);
+        }
+        r->pattern_count++;
+        if (pattern->len < r->min_len) r->min_len = pattern->len;
+        if (pattern->replacement_len > r->max_replacement) r->max_replacement = pattern->replacement_len;
+        if (pattern->len > r->max_carry) r->max_carry = pattern->len;
+    }
+    if (!build_automaton(r, patterns)) goto fail;
+    r->carry = malloc(r->max_carry);
+    if (!r->carry) goto fail;
+    return r;
+
+fail:
+    log_redactor_free(r);
+    return NULL;
+}
+
+void log_redactor_free(log_redactor_t *r) {
+    if (!r) return;
+    for (size_t i = 0; i < r->pattern_count; i++) {
+        free(r->patterns[i].replacement);
+    }
+    free(r->patterns);
+    free(r->nodes);
+    free(r->carry);
+    free(r);
+}
+
+bool log_redactor_idle(const log_redactor_t *r) {
+    return r->carry_len == 0 && !r->skipping;
+}
+
+size_t log_redactor_max_output(const log_redactor_t *r, size_t len) {
+    // Held back bytes may complete matches too
+    size_t matches = r->min_len == SIZE_MAX ? 0 : (len + r->max_carry) / r->min_len + 1;
+    return r->max_carry + len + matches * r->max_replacement;
+}
+
+#pragma mark - Matching
+
+static inline void reset_ipv4(log_redactor_t *r) {
+    r->ip_len = 0;
+    r->ip_dots = r->ip_digits = r->ip_value = 0;
+    r->ip_dead = r->ip_trailing_dot = false;
+}
+
+// Feeds c to the IPv4 matcher before it is appended to out. Returns the
+// length of an address that c completed, ending right before out + o
+// (or before the held trailing dot)
+static size_t step_ipv4(log_redactor_t *r, unsigned char c) {
+    bool digit = c >= '0' && c <= '9';
+    if (r->ip_trailing_dot) {
+        size_t len = r->ip_len - 1;
+        reset_ipv4(r);
+        if (digit) {
+            // A longer dotted run, a version number more likely than an address
+            r->ip_dead = true;
+            return 0;
+        }
+        return len;
+    }
+    if (digit) {
+        if (r->ip_dead) return 0;
+        if (r->ip_len == 0) {
+            if (is_word(r->prev) || r->prev == '.') {
+                r->ip_dead = true;
+                return 0;
+            }
+        }
+        r->ip_value = r->ip_value * 10 + (c - '0');
+        if (++r->ip_digits > 3 || r->ip_value > 255) {
+            reset_ipv4(r);
+            r->ip_dead = true;
+            return 0;
+        }
+        r->ip_len++;
+        return 0;
+    }
+    if (c == '.' && r->ip_len > 0) {
+        if (r->ip_digits == 0) {
+            reset_ipv4(r);
+            r->ip_dead = true;
+        } else if (r->ip_dots < 3) {
+            r->ip_dots++;
+            r->ip_digits = r->ip_value = 0;
+            r->ip_len++;
+        } else {
+            // Could end a sentence, decided by the next byte
+            r->ip_trailing_dot = true;
+            r->ip_len++;
+        }
+        return 0;
+    }
+    if (c == '.' && r->ip_dead) {
+        return 0;
+    }
+    size_t len = r->ip_len > 0 && r->ip_dots == 3 && r->ip_digits > 0 && !is_word(c) ? r->ip_len : 0;
+    reset_ipv4(r);
+    return len;
+}
+
+// Replaces the match of pattern ending at out + o, returns the new end
+static size_t replace_match(log_redactor_t *r, const pattern_t *pattern, char *out, size_t o) {
+    if (!pattern->value) {
+        o -= pattern->len;
+    }
+    memcpy(out + o, pattern->replacement, pattern->replacement_len);
+    o += pattern->replacement_len;
+    r->state = 0;
+    reset_ipv4(r);
+    r->prev = '>';
+    if (pattern->value) {
+        r->skipping = true;
+        r->skipped = 0;
+        r->skip_pattern = pattern;
+    }
+    return o;
+}
+
+size_t log_redactor_process(log_redactor_t *r, const char *in, size_t len, char *out) {
+    memcpy(out, r->carry, r->carry_len);
+    size_t o = r->carry_len;
+    const node_t *nodes = r->nodes;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = in[i];
+        if (r->pending) {
+            const pattern_t *pattern = r->pending;
+            r->pending = NULL;
+            if (!is_word(c)) {
+                o = replace_match(r, pattern, out, o);
+            }
+        }
+        if (r->skipping) {
+            if (c != '\n' && !stop_has(r->skip_pattern, c) && ++r->skipped <= MAX_VALUE_LEN) {
+                continue;
+            }
+            r->skipping = false;
+        }
+
+        // Most bytes can neither start nor continue an address
+        if (r->redact_ipv4 && (r->ip_len > 0 || r->ip_dead || (c >= '0' && c <= '9'))) {
+            bool held_dot = r->ip_trailing_dot;
+            size_t ip = step_ipv4(r, c);
+            if (ip > 0) {
+                size_t start = o - ip - held_dot;
+                memcpy(out + start, IPV4_REPLACEMENT, sizeof(IPV4_REPLACEMENT) - 1);
+                o = start + sizeof(IPV4_REPLACEMENT) - 1;
+                if (held_dot) out[o++] = '.';
+                r->state = 0;
+            }
+        }
+
+        out[o++] = c;
+        r->prev = c;
+        r->state = nodes[r->state].next[c];
+        int16_t index = nodes[r->state].pattern;
+        if (index >= 0) {
+            const pattern_t *pattern = &r->patterns[index];
+            if (!pattern->whole_word) {
+                o = replace_match(r, pattern, out, o);
+            } else if (!is_word(o > pattern->len ? out[o - pattern->len - 1] : r->last_out)) {
+                // Decided by the next byte, the match stays held back until then
+                r->pending = pattern;
+            }
+        }
+    }
+
+    // Hold back whatever may still turn out to be part of a match
+    size_t hold = nodes[r->state].depth;
+    if (r->ip_len > hold) hold = r->ip_len;
+    if (hold > o) hold = o;
+    memcpy(r->carry, out + o - hold, hold);
+    r->carry_len = hold;
+    if (o > hold) {
+        r->last_out = out[o - hold - 1];
+    }
+    return o - hold;
+}
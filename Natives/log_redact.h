@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming redaction of secrets in log output. All patterns are matched in
+// one pass by an Aho-Corasick automaton, next to a small IPv4 matcher, and
+// the state carries over between chunks, so a secret split across two reads
+// is still caught. Bytes that could be the start of a match are held back
+// until the next chunk, which a line break always releases.
+
+typedef struct {
+    const char *match;
+    const char *replacement;
+    // NULL replaces match itself. Otherwise match is kept and the value after
+    // it is replaced, up to any of these bytes or a line break
+    const char *stop;
+    // Only matches between non-word bytes or line ends, e.g. a username that
+    // would otherwise hit the middle of identifiers
+    bool whole_word;
+} log_redact_pattern_t;
+
+typedef struct log_redactor log_redactor_t;
+
+// Returns NULL if out of memory
+log_redactor_t *log_redactor_create(const log_redact_pattern_t *patterns, size_t count, bool redact_ipv4);
+void log_redactor_free(log_redactor_t *redactor);
+
+// True between lines: nothing is held back and no value is being replaced
+bool log_redactor_idle(const log_redactor_t *redactor);
+
+// Size of the output buffer process() needs for len bytes of input
+size_t log_redactor_max_output(const log_redactor_t *redactor, size_t len);
+// Redacts a chunk into out, returns the number of bytes written. Doesn't allocate
+size_t log_redactor_process(log_redactor_t *redactor, const char *in, size_t len, char *out);
@@ -0,0 +1,341 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "log_writer.h"
+
+#define LOG_WRITER_COMPRESS_BUFFER_SIZE (64 * 1024)
+// Room for on_read to rewrite a chunk slightly longer, plus the terminator
+#define LOG_WRITER_READ_SLACK 64
+
+static struct {
+    log_writer_options_t options;
+    pthread_mutex_t lock;
+    pthread_cond_t data_cond;  // writer waits for pending data
+    pthread_cond_t space_cond; // reader waits for ring space
+    pthread_cond_t done_cond;  // log_writer_sync waits for a batch to land
+    char *ring;
+    size_t ring_size;
+    // Monotonic byte counts: appended by the reader and written by the writer
+    _Atomic uint64_t head, tail;
+    // Set by whoever writes the ring to the file: the writer thread around
+    // each batch, or a fatal signal for good
+    _Atomic bool draining;
+    // End of the batch being written while draining is held by the writer
+    _Atomic uint64_t draining_end;
+    uint64_t flush_request;
+    int read_fd;
+    _Atomic int fd;
+    char *path;
+    size_t file_size;
+    int segment;
+} lw = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .data_cond = PTHREAD_COND_INITIALIZER,
+    .space_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+    .fd = -1
+};
+
+void log_writer_segment_path(const char *path, int n, char *buf, size_t len) {
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(slash ? slash : path, '.');
+    if (!dot || dot == path || dot == slash + 1) {
+        snprintf(buf, len, "%s.%d", path, n);
+    } else {
+        snprintf(buf, len, "%.*s.%d%s", (int)(dot - path), path, n, dot);
+    }
+}
+
+// Writes [start, end) of the ring to fd, retrying short writes
+static int write_ring(int fd, uint64_t start, uint64_t end) {
+    while (start < end) {
+        size_t offset = start % lw.ring_size;
+        size_t first = lw.ring_size - offset;
+        if (first > end - start) first = end - start;
+        struct iovec iov[2] = {
+            {lw.ring + offset, first},
+            {lw.ring, end - start - first}
+        };
+        ssize_t written = writev(fd, iov, iov[1].iov_len ? 2 : 1);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        start += written;
+    }
+    return 0;
+}
+
+#pragma mark - Rotation
+
+typedef struct {
+    int segment;
+} compress_job_t;
+
+static void *compress_main(void *arg) {
+    compress_job_t *job = arg;
+    size_t len = strlen(lw.path) + 32;
+    char *source = malloc(len), *dest = malloc(len + 8), *tmp = malloc(len + 16);
+    log_writer_segment_path(lw.path, job->segment, source, len);
+    snprintf(dest, len + 8, "%s.gz", source);
+    snprintf(tmp, len + 16, "%s.gz.tmp", source);
+
+    bool ok = false;
+    int in = open(source, O_RDONLY);
+    gzFile out = in >= 0 ? gzopen(tmp, "wb6") : NULL;
+    char *buf = malloc(LOG_WRITER_COMPRESS_BUFFER_SIZE);
+    if (out && buf) {
+        ssize_t n;
+        ok = true;
+        while ((n = read(in, buf, LOG_WRITER_COMPRESS_BUFFER_SIZE)) > 0) {
+            if (gzwrite(out, buf, (unsigned)n) != n) {
+                ok = false;
+                break;
+            }
+        }
+        ok = ok && n == 0;
+    }
+    if (out && gzclose(out) != Z_OK) ok = false;
+    if (in >= 0) close(in);
+    if (ok && rename(tmp, dest) == 0) {
+        unlink(source);
+    } else {
+        // Keep the plain segment rather than lose it
+        unlink(tmp);
+    }
+
+    int expired = job->segment - lw.options.keep_rotated;
+    if (expired > 0) {
+        log_writer_segment_path(lw.path, expired, source, len);
+        snprintf(dest, len + 8, "%s.gz", source);
+        unlink(dest);
+        unlink(source);
+    }
+    free(buf);
+    free(tmp);
+    free(dest);
+    free(source);
+    free(job);
+    return NULL;
+}
+
+// Called on the writer thread with the lock held
+static void rotate(void) {
+    char segment_path[PATH_MAX];
+    int segment = lw.segment + 1;
+    log_writer_segment_path(lw.path, segment, segment_path, sizeof(segment_path));
+    if (rename(lw.path, segment_path) != 0) {
+        // Keep appending to the current file
+        lw.file_size = 0;
+        return;
+    }
+    int fd = open(lw.path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        // The renamed file is still open, carry on there
+        rename(segment_path, lw.path);
+        lw.file_size = 0;
+        return;
+    }
+    close(lw.fd);
+    lw.fd = fd;
+    lw.file_size = 0;
+    lw.segment = segment;
+
+    compress_job_t *job = malloc(sizeof(compress_job_t));
+    job->segment = segment;
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, compress_main, job) != 0) {
+        free(job);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+#pragma mark - Threads
+
+static void *reader_main(void *arg) {
+    (void)arg;
+    char *buf = malloc(LOG_WRITER_READ_SIZE + LOG_WRITER_READ_SLACK);
+    ssize_t n;
+    while ((n = read(lw.read_fd, buf, LOG_WRITER_READ_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        buf[n] = '\0';
+        size_t len = n;
+        const char *p = buf;
+        if (lw.options.on_read) {
+            p = lw.options.on_read(buf, &len, lw.options.ctx);
+        }
+
+        pthread_mutex_lock(&lw.lock);
+        while (len > 0) {
+            uint64_t head = lw.head;
+            size_t space = lw.ring_size - (size_t)(head - lw.tail);
+            if (space == 0) {
+                pthread_cond_wait(&lw.space_cond, &lw.lock);
+                continue;
+            }
+            size_t offset = head % lw.ring_size;
+            size_t chunk = len < space ? len : space;
+            if (chunk > lw.ring_size - offset) chunk = lw.ring_size - offset;
+            memcpy(lw.ring + offset, p, chunk);
+            lw.head = head + chunk;
+            p += chunk;
+            len -= chunk;
+            pthread_cond_signal(&lw.data_cond);
+        }
+        pthread_mutex_unlock(&lw.lock);
+    }
+    free(buf);
+    close(lw.read_fd);
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&lw.lock);
+    while (true) {
+        while (lw.head == lw.tail) {
+            pthread_cond_wait(&lw.data_cond, &lw.lock);
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += lw.options.flush_interval_ms / 1000;
+        deadline.tv_nsec += (lw.options.flush_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (lw.head - lw.tail < lw.options.flush_bytes && lw.flush_request <= lw.tail) {
+            if (pthread_cond_timedwait(&lw.data_cond, &lw.lock, &deadline) == ETIMEDOUT) break;
+        }
+
+        uint64_t start = lw.tail, end = lw.head;
+        int fd = lw.fd;
+        bool unclaimed = false;
+        if (!atomic_compare_exchange_strong(&lw.draining, &unclaimed, true)) {
+            // A fatal signal took over the file
+            break;
+        }
+        lw.draining_end = end;
+        pthread_mutex_unlock(&lw.lock);
+        // A failed write drops the batch, the producers must not stall on it
+        write_ring(fd, start, end);
+        pthread_mutex_lock(&lw.lock);
+
+        lw.tail = end;
+        lw.file_size += end - start;
+        if (lw.options.rotate_size && lw.file_size >= lw.options.rotate_size) {
+            rotate();
+        }
+        // Released only once tail and fd are up to date
+        atomic_store(&lw.draining, false);
+        pthread_cond_broadcast(&lw.space_cond);
+        pthread_cond_broadcast(&lw.done_cond);
+    }
+    pthread_mutex_unlock(&lw.lock);
+    return NULL;
+}
+
+#pragma mark - Public API
+
+int log_writer_start(int read_fd, const char *path, const log_writer_options_t *options) {
+    if (lw.ring) return EBUSY;
+    lw.options = *options;
+    if (!lw.options.ring_size) lw.options.ring_size = 4 * 1024 * 1024;
+    if (!lw.options.flush_bytes) lw.options.flush_bytes = 64 * 1024;
+    if (!lw.options.flush_interval_ms) lw.options.flush_interval_ms = 250;
+    if (lw.options.flush_bytes > lw.options.ring_size / 2) lw.options.flush_bytes = lw.options.ring_size / 2;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return errno;
+    lw.path = strdup(path);
+    lw.ring = malloc(lw.options.ring_size);
+    if (!lw.path || !lw.ring) {
+        close(fd);
+        free(lw.path);
+        free(lw.ring);
+        lw.ring = NULL;
+        return ENOMEM;
+    }
+    lw.ring_size = lw.options.ring_size;
+    lw.fd = fd;
+    lw.read_fd = read_fd;
+#ifdef F_SETPIPE_SZ
+    // Linux only, Darwin pipes grow on their own up to 64 KiB
+    fcntl(read_fd, F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&thread, &attr, writer_main, NULL);
+    if (!err) {
+        err = pthread_create(&thread, &attr, reader_main, NULL);
+    }
+    pthread_attr_destroy(&attr);
+    return err;
+}
+
+void log_writer_sync(void) {
+    if (!lw.ring) return;
+    fflush(stdout);
+    fflush(stderr);
+    // Give the reader a moment to pick up what is still in the pipe
+    for (int i = 0; i < 200; i++) {
+        int pending = 0;
+        if (ioctl(lw.read_fd, FIONREAD, &pending) != 0 || pending == 0) break;
+        usleep(1000);
+    }
+    pthread_mutex_lock(&lw.lock);
+    uint64_t target = lw.head;
+    lw.flush_request = target;
+    pthread_cond_signal(&lw.data_cond);
+    while (lw.tail < target) {
+        pthread_cond_wait(&lw.done_cond, &lw.lock);
+    }
+    fsync(lw.fd);
+    pthread_mutex_unlock(&lw.lock);
+}
+
+void log_writer_sync_from_signal(void) {
+    if (!lw.ring) return;
+    // The other threads keep running: let the reader filter whatever is
+    // left in the pipe and the writer pick it up with its next batch
+    for (int i = 0; i < 400; i++) {
+        int pending = 0;
+        if ((ioctl(lw.read_fd, FIONREAD, &pending) != 0 || pending == 0) && lw.head == lw.tail) break;
+        usleep(1000);
+    }
+    // Take the file over from the writer between two batches, so the ring
+    // is never written from both sides
+    bool claimed = false;
+    for (int i = 0; i < 200 && !claimed; i++) {
+        bool unclaimed = false;
+        claimed = atomic_compare_exchange_strong(&lw.draining, &unclaimed, true);
+        if (!claimed) usleep(1000);
+    }
+    // Otherwise the writer is stuck in a batch or was the one to crash, and
+    // only what comes after that batch is left to write
+    uint64_t start = claimed ? lw.tail : lw.draining_end, head = lw.head;
+    if (head > start) {
+        write_ring(lw.fd, start, head);
+    }
+    fsync(lw.fd);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest chunk passed to on_read
+#define LOG_WRITER_READ_SIZE (64 * 1024)
+
+// Asynchronous log file writer: a reader thread drains a pipe into an
+// in-memory ring and a writer thread commits the ring to disk in batches,
+// so whoever writes to the pipe never waits on the filesystem. Nothing is
+// fsynced until log_writer_sync(), meant for exit and fatal signals.
+// There is a single writer per process.
+
+typedef struct {
+    // Ring capacity, 0 for 4 MiB. The reader only blocks once it is full
+    size_t ring_size;
+    // A batch is written once this much is pending, 0 for 64 KiB
+    size_t flush_bytes;
+    // ...or once the oldest pending byte is this old, 0 for 250 ms
+    int flush_interval_ms;
+    // Past this size the file is moved to <stem>.<n><ext> and compressed to
+    // <stem>.<n><ext>.gz in the background, 0 never rotates
+    size_t rotate_size;
+    // Compressed segments kept, older ones are deleted
+    int keep_rotated;
+    // Called on the reader thread with each chunk read, NUL terminated.
+    // Returns what to write and updates len: either buf, rewritten in place,
+    // or memory of its own that stays valid until the next call
+    const char *(*on_read)(char *buf, size_t *len, void *ctx);
+    void *ctx;
+} log_writer_options_t;
+
+// Truncates path and starts the threads, read_fd is owned from then on.
+// Returns 0 on success, otherwise an errno-style error code
+int log_writer_start(int read_fd, const char *path, const log_writer_options_t *options);
+
+// Waits for everything written to the pipe so far to reach the disk
+void log_writer_sync(void);
+// Best effort variant for signal handlers, only async-signal-safe calls
+void log_writer_sync_from_signal(void);
+
+// Fills buf with the path of rotated segment n (before compression)
+void log_writer_segment_path(const char *path, int n, char *buf, size_t len);
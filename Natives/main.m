@@ -16,12 +16,15 @@
 
 #include <libgen.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
 #include "utils.h"
 #include "codesign.h"
+#include "log_redact.h"
+#include "log_writer.h"
 
 #define CS_PLATFORM_BINARY 0x4000000
 #define PT_TRACE_ME 0
@@ -127,6 +130,76 @@ void init_logDeviceAndVer(char *argument) {
     //printEntitlementAvailability(@"dynamic-codesigning");
 }
 
+// Secrets never make it to latestlog.txt or the log console
+static const log_redact_pattern_t logRedactPatterns[] = {
+    {"(Session ID is ", "<censored>", ")"},
+    {"--accessToken ", "<censored>", " "},
+    {"--accessToken, ", "<censored>", ",]"},
+    {"\"accessToken\":\"", "<censored>", "\""},
+    {"\"access_token\":\"", "<censored>", "\""},
+    {"access_token=", "<censored>", "& "},
+    {"Bearer ", "<censored>", " \""},
+    {"Setting user: ", "<username>", ""}
+};
+static NSMutableSet<NSString *> *logRedactUsernames;
+// Built by redactLogUsername, picked up by the reader thread
+static _Atomic(log_redactor_t *) pendingLogRedactor;
+
+log_redactor_t *init_createLogRedactor() {
+    NSArray<NSString *> *usernames = logRedactUsernames.allObjects;
+    size_t count = sizeof(logRedactPatterns) / sizeof(log_redact_pattern_t);
+    log_redact_pattern_t patterns[count + usernames.count];
+    memcpy(patterns, logRedactPatterns, sizeof(logRedactPatterns));
+    for (NSString *username in usernames) {
+        patterns[count++] = (log_redact_pattern_t){username.UTF8String, "<username>", NULL, true};
+    }
+    return log_redactor_create(patterns, count, YES);
+}
+
+void redactLogUsername(NSString *username) {
+    // Shorter names would mostly hit unrelated words
+    if (!logRedactUsernames || username.length < 3) return;
+    @synchronized (logRedactUsernames) {
+        if ([logRedactUsernames containsObject:username]) return;
+        [logRedactUsernames addObject:username];
+        log_redactor_free(atomic_exchange(&pendingLogRedactor, init_createLogRedactor()));
+    }
+}
+
+const char *init_handleLogChunk(char *buf, size_t *len, void *ctx) {
+    static log_redactor_t *redactor;
+    static char *redacted;
+    // Swap only between lines, so a match in progress is never lost
+    if (atomic_load_explicit(&pendingLogRedactor, memory_order_relaxed) && (!redactor || log_redactor_idle(redactor))) {
+        log_redactor_t *next = atomic_exchange(&pendingLogRedactor, NULL);
+        char *nextBuf = next ? malloc(log_redactor_max_output(next, LOG_WRITER_READ_SIZE)) : NULL;
+        if (nextBuf) {
+            log_redactor_free(redactor);
+            free(redacted);
+            redactor = next;
+            redacted = nextBuf;
+        } else {
+            log_redactor_free(next);
+        }
+    }
+    if (redactor) {
+        *len = log_redactor_process(redactor, buf, *len, redacted);
+        buf = redacted;
+    }
+    if (canAppendToLog) {
+        @autoreleasepool {
+            [PLLogOutputView appendBytes:buf length:*len];
+        }
+    }
+    return buf;
+}
+
+void init_syncLogOnSignal(int sig) {
+    log_writer_sync_from_signal();
+    // The handler was reset on entry, this terminates as usual
+    raise(sig);
+}
+
 void init_redirectStdio() {
     NSLog(@"[Pre-init] Starting logging STDIO to latestlog.txt\n");
 
@@ -135,52 +208,66 @@ void init_redirectStdio() {
     NSString *oldName = [home stringByAppendingPathComponent:@"latestlog.old.txt"];
     [fm removeItemAtPath:oldName error:nil];
     [fm moveItemAtPath:currName toPath:oldName error:nil];
-
-    [fm createFileAtPath:currName contents:nil attributes:nil];
-    NSFileHandle *file = [NSFileHandle fileHandleForWritingAtPath:currName];
-
-    if (!file) {
-        NSLog(@"[Pre-init] Error: failed to open %@", currName);
-        assert(0 && "Failed to open latestlog.txt. Check oslog for more details.");
+    // Rotated segments latestlog.<n>.txt.gz follow the same scheme
+    for (NSString *file in [fm contentsOfDirectoryAtPath:home error:nil]) {
+        if ([file hasPrefix:@"latestlog.old."] && ![file isEqualToString:oldName.lastPathComponent]) {
+            [fm removeItemAtPath:[home stringByAppendingPathComponent:file] error:nil];
+        }
+    }
+    for (NSString *file in [fm contentsOfDirectoryAtPath:home error:nil]) {
+        if ([file hasPrefix:@"latestlog."] && ![file hasPrefix:@"latestlog.old."]) {
+            NSString *segment = [file substringFromIndex:@"latestlog.".length];
+            [fm moveItemAtPath:[home stringByAppendingPathComponent:file]
+                toPath:[home stringByAppendingPathComponent:[@"latestlog.old." stringByAppendingString:segment]] error:nil];
+        }
     }
 
     setvbuf(stdout, 0, _IOLBF, 0); // make stdout line-buffered
     setvbuf(stderr, 0, _IONBF, 0); // make stderr unbuffered
 
-    /* create the pipe and redirect stdout and stderr */
+    // Saved accounts are known up front, the one being launched is added by launchJVM
+    logRedactUsernames = [NSMutableSet new];
+    NSString *accountsDir = [home stringByAppendingPathComponent:@"accounts"];
+    for (NSString *file in [fm contentsOfDirectoryAtPath:accountsDir error:nil]) {
+        if ([file.pathExtension isEqualToString:@"json"] && file.stringByDeletingPathExtension.length >= 3) {
+            [logRedactUsernames addObject:file.stringByDeletingPathExtension];
+        }
+    }
+    pendingLogRedactor = init_createLogRedactor();
+
+    /* create the pipe and the logging threads */
     static int pfd[2];
     pipe(pfd);
+    log_writer_options_t options = {
+        .rotate_size = 32 * 1024 * 1024,
+        .keep_rotated = 4,
+        .on_read = init_handleLogChunk
+    };
+    int err = log_writer_start(pfd[0], currName.fileSystemRepresentation, &options);
+    if (err) {
+        NSLog(@"[Pre-init] Error: failed to open %@: %s", currName, strerror(err));
+        assert(0 && "Failed to open latestlog.txt. Check oslog for more details.");
+    }
+
+    /* redirect stdout and stderr */
     dup2(pfd[1], fileno(stdout));
     dup2(pfd[1], fileno(stderr));
 
-    /* create the logging thread */
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-        static BOOL filteredSessionID;
-        ssize_t rsize;
-        char buf[2048];
-        while((rsize = read(pfd[0], buf, sizeof(buf)-1)) > 0) {
-            if (rsize < 2048) {
-                buf[rsize] = '\0';
-            }
-            // Filter out Session ID here
-            int index;
-            if (!filteredSessionID) {
-                char *sessionStr = strstr(buf, "(Session ID is ");
-                if (sessionStr) {
-                    char *censorStr = "(Session ID is <censored>)\n\0";
-                    strcpy(sessionStr, censorStr);
-                    rsize = strlen(buf);
-                    filteredSessionID = true;
-                }
-            }
-            if (canAppendToLog) {
-                [PLLogOutputView appendToLog:@(buf)];
-            }
-            [file writeData:[NSData dataWithBytes:buf length:rsize]];
-            [file synchronizeFile];
-        }
-        [file closeFile];
-    });
+    // Writes are batched, only make sure they land when the process goes away.
+    // HotSpot installs its own SIGSEGV, SIGBUS, SIGILL and SIGFPE handlers
+    // when the JVM starts, as it relies on those signals internally, and
+    // does not chain to these without libjsig. From then on its error
+    // handler writes hs_err and calls abort(), so SIGABRT still gets here
+    atexit(log_writer_sync);
+    struct sigaction action = {
+        .sa_handler = init_syncLogOnSignal,
+        .sa_flags = SA_RESETHAND
+    };
+    sigemptyset(&action.sa_mask);
+    int fatalSignals[] = {SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV};
+    for (int i = 0; i < sizeof(fatalSignals) / sizeof(int); i++) {
+        sigaction(fatalSignals[i], &action, NULL);
+    }
 
     // We can start catching exception right now
     NSSetUncaughtExceptionHandler(&uncaughtExceptionHandler);
@@ -4,12 +4,16 @@
 #import "ios_uikit_bridge.h"
 #import "utils.h"
 
+#include "asset_root.h"
 #include "external/fishhook/fishhook.h"
 
 void (*orig_abort)();
 void (*orig_exit)(int code);
 void* (*orig_dlopen)(const char* path, int mode);
 int (*orig_open)(const char *path, int oflag, ...);
+int (*orig_stat)(const char *path, struct stat *st);
+int (*orig_lstat)(const char *path, struct stat *st);
+int (*orig_access)(const char *path, int mode);
 
 void handle_fatal_exit(int code) {
     if (NSThread.isMainThread) {
@@ -78,17 +82,40 @@ int hooked_open(const char *path, int oflag, ...) {
     if (path && !strcmp(path, "/etc/resolv.conf")) {
         return orig_open([NSString stringWithFormat:@"%s/resolv.conf", getenv("POJAV_HOME")].UTF8String, oflag, mode);
     }
+    int fd;
+    if (asset_root_open(path, oflag, &fd)) {
+        return fd;
+    }
 
     return orig_open(path, oflag, mode);
 }
 
+// Packed assets look like loose files to the game
+int hooked_stat(const char *path, struct stat *st) {
+    int result;
+    return asset_root_stat(path, st, &result) ? result : orig_stat(path, st);
+}
+
+int hooked_lstat(const char *path, struct stat *st) {
+    int result;
+    return asset_root_stat(path, st, &result) ? result : orig_lstat(path, st);
+}
+
+int hooked_access(const char *path, int mode) {
+    int result;
+    return asset_root_access(path, mode, &result) ? result : orig_access(path, mode);
+}
+
 void init_hookFunctions() {
     struct rebinding rebindings[] = (struct rebinding[]){
         {"abort", hooked_abort, (void *)&orig_abort},
         {"__assert_rtn", hooked___assert_rtn, NULL},
         {"exit", hooked_exit, (void *)&orig_exit},
         {"dlopen", hooked_dlopen, (void *)&orig_dlopen},
-        {"open", hooked_open, (void *)&orig_open}
+        {"open", hooked_open, (void *)&orig_open},
+        {"stat", hooked_stat, (void *)&orig_stat},
+        {"lstat", hooked_lstat, (void *)&orig_lstat},
+        {"access", hooked_access, (void *)&orig_access}
     };
     rebind_symbols(rebindings, sizeof(rebindings)/sizeof(struct rebinding));
 }
@@ -0,0 +1,863 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <lzma.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tar_xz.h"
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_XZ_IN_BUFFER_SIZE (1024 * 1024)
+#define TAR_XZ_OUT_BUFFER_SIZE (1024 * 1024)
+// Largest write handed to the writer at once, smaller files are written in one go
+#define TAR_XZ_CHUNK_SIZE (4 * 1024 * 1024)
+// How far decoding may run ahead of the writer
+#define TAR_XZ_QUEUE_LIMIT (32 * 1024 * 1024)
+// Decoder memory above which the decoder uses fewer threads
+#define TAR_XZ_THREADING_MEMLIMIT (256 * 1024 * 1024)
+#define TAR_XZ_PROGRESS_INTERVAL (1024 * 1024)
+// Upper bound for GNU long names and pax headers
+#define TAR_XZ_META_LIMIT (1024 * 1024)
+
+// https://www.gnu.org/software/tar/manual/html_node/Standard.html
+typedef struct {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+} tar_header_t;
+
+typedef struct tar_xz_job {
+    struct tar_xz_job *next;
+    // Destination, set on the first chunk of a file
+    char *path;
+    // Name relative to dest, set on the last chunk
+    char *name;
+    uint8_t *data;
+    size_t len;
+    mode_t mode;
+} tar_xz_job_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    // Signalled whenever the queue changes, in either direction
+    pthread_cond_t cond;
+    tar_xz_job_t *head, *tail;
+    size_t queued_bytes;
+    bool busy;
+    bool done;
+
+    // First error of either thread
+    int err;
+    char *errbuf;
+    size_t errlen;
+
+    const tar_xz_options_t *options;
+    tar_xz_stats_t *stats;
+} tar_xz_writer_t;
+
+typedef enum {
+    TAR_STATE_HEADER,
+    TAR_STATE_DATA,
+    TAR_STATE_PADDING,
+    TAR_STATE_END
+} tar_state_t;
+
+typedef enum {
+    TAR_ENTRY_SKIP,
+    TAR_ENTRY_FILE,
+    TAR_ENTRY_LONG_NAME,
+    TAR_ENTRY_LONG_LINK,
+    TAR_ENTRY_PAX
+} tar_entry_kind_t;
+
+typedef struct {
+    const char *dest;
+    size_t dest_len;
+    tar_xz_writer_t *writer;
+    tar_xz_stats_t *stats;
+    const tar_xz_options_t *options;
+    uint64_t in_bytes;
+    uint64_t out_bytes;
+
+    tar_state_t state;
+    tar_header_t header;
+    size_t header_fill;
+    tar_entry_kind_t kind;
+    uint64_t remaining;
+    size_t padding;
+
+    // Set by GNU long name entries or pax headers, applies to the next entry
+    char *long_name;
+    char *long_link;
+    // Data of the metadata entry being read
+    char *meta;
+    size_t meta_len;
+
+    // Regular file being read
+    char *name;
+    char *path;
+    mode_t mode;
+    tar_xz_job_t *job;
+    size_t job_cap;
+    bool job_first;
+
+    // Last directory known to exist, saves a syscall per file
+    char last_dir[PATH_MAX];
+} tar_parser_t;
+
+static int tar_xz_fail(tar_xz_writer_t *w, int err, const char *fmt, ...) {
+    pthread_mutex_lock(&w->lock);
+    if (!w->err) {
+        w->err = err;
+        if (w->errbuf && w->errlen) {
+            va_list args;
+            va_start(args, fmt);
+            vsnprintf(w->errbuf, w->errlen, fmt, args);
+            va_end(args);
+        }
+        pthread_cond_broadcast(&w->cond);
+    }
+    err = w->err;
+    pthread_mutex_unlock(&w->lock);
+    return err;
+}
+
+static const char *tar_xz_lzma_error(lzma_ret ret) {
+    switch (ret) {
+        case LZMA_MEM_ERROR: return "Memory allocation failed";
+        case LZMA_MEMLIMIT_ERROR: return "Memory usage limit reached";
+        case LZMA_FORMAT_ERROR: return "The input is not in the .xz format";
+        case LZMA_OPTIONS_ERROR: return "Unsupported compression options";
+        case LZMA_DATA_ERROR: return "Compressed file is corrupt";
+        case LZMA_BUF_ERROR: return "Compressed file is truncated or otherwise corrupt";
+        default: return "Unknown error, possibly a bug";
+    }
+}
+
+// Directories past the first trusted bytes of path must be real ones, so
+// nothing is written through a symlink the archive planted
+static int tar_xz_mkdirs(const char *path, size_t trusted) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) return ENAMETOOLONG;
+    for (char *p = tmp + 1;; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        char c = *p;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0) {
+            struct stat st;
+            if (errno != EEXIST) return errno;
+            if ((size_t)(p - tmp) > trusted && (lstat(tmp, &st) != 0 || !S_ISDIR(st.st_mode))) return ENOTDIR;
+        }
+        if (!c) break;
+        *p = c;
+    }
+    return 0;
+}
+
+// Same check for the parents of an existing path
+static int tar_xz_check_parents(const char *path, size_t trusted) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) return ENAMETOOLONG;
+    for (char *p = tmp + trusted + 1; *p; p++) {
+        if (*p != '/') continue;
+        struct stat st;
+        *p = '\0';
+        if (lstat(tmp, &st) != 0 || !S_ISDIR(st.st_mode)) return ENOTDIR;
+        *p = '/';
+    }
+    return 0;
+}
+
+static int tar_xz_write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        buf += written;
+        len -= written;
+    }
+    return 0;
+}
+
+static void tar_xz_free_job(tar_xz_job_t *job) {
+    if (!job) return;
+    free(job->path);
+    free(job->name);
+    free(job->data);
+    free(job);
+}
+
+#pragma mark - Writer
+
+static void *tar_xz_writer_main(void *arg) {
+    tar_xz_writer_t *w = arg;
+    int fd = -1;
+    // Owned path of the open file, for error messages
+    char *path = NULL;
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        while (!w->head && !w->done) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        tar_xz_job_t *job = w->head;
+        if (!job) {
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        w->head = job->next;
+        if (!w->head) w->tail = NULL;
+        w->busy = true;
+        bool failed = w->err != 0;
+        pthread_mutex_unlock(&w->lock);
+
+        if (job->path) {
+            free(path);
+            path = job->path;
+            job->path = NULL;
+            if (!failed) {
+                // A symlink in the way would otherwise be written through
+                unlink(path);
+                fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+                if (fd < 0) {
+                    failed = true;
+                    tar_xz_fail(w, errno, "%s: %s", path, strerror(errno));
+                }
+            }
+        }
+        if (fd >= 0 && !failed && job->len > 0) {
+            int err = tar_xz_write_all(fd, job->data, job->len);
+            if (err) {
+                failed = true;
+                tar_xz_fail(w, err, "%s: %s", path, strerror(err));
+            } else {
+                w->stats->bytes += job->len;
+            }
+        }
+        if (job->name && fd >= 0) {
+            // Owner always keeps read/write so the runtime can be removed or replaced later
+            if (!failed) fchmod(fd, (job->mode & 0777) | 0600);
+            if (close(fd) != 0 && !failed) {
+                failed = true;
+                tar_xz_fail(w, errno, "%s: %s", path, strerror(errno));
+            }
+            fd = -1;
+            if (!failed) {
+                w->stats->files++;
+                if (w->options && w->options->file_written && !w->options->file_written(job->name, w->options->ctx)) {
+                    tar_xz_fail(w, ECANCELED, "Cancelled");
+                }
+            }
+        }
+
+        pthread_mutex_lock(&w->lock);
+        w->queued_bytes -= job->len;
+        w->busy = false;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        tar_xz_free_job(job);
+    }
+    if (fd >= 0) close(fd);
+    free(path);
+    return NULL;
+}
+
+static int tar_xz_enqueue(tar_xz_writer_t *w, tar_xz_job_t *job) {
+    pthread_mutex_lock(&w->lock);
+    while (w->queued_bytes > 0 && w->queued_bytes + job->len > TAR_XZ_QUEUE_LIMIT && !w->err) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+    int err = w->err;
+    if (!err) {
+        if (w->tail) {
+            w->tail->next = job;
+        } else {
+            w->head = job;
+        }
+        w->tail = job;
+        w->queued_bytes += job->len;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    if (err) tar_xz_free_job(job);
+    return err;
+}
+
+// Waits until everything queued so far is on disk
+static int tar_xz_drain(tar_xz_writer_t *w) {
+    pthread_mutex_lock(&w->lock);
+    while ((w->head || w->busy) && !w->err) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+    int err = w->err;
+    pthread_mutex_unlock(&w->lock);
+    return err;
+}
+
+#pragma mark - Tar parser
+
+// Octal, or GNU base-256 for values that don't fit
+static uint64_t tar_parse_number(const char *field, size_t len) {
+    const unsigned char *p = (const unsigned char *)field;
+    uint64_t value = 0;
+    if (p[0] & 0x80) {
+        value = p[0] & 0x3f;
+        for (size_t i = 1; i < len; i++) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+    size_t i = 0;
+    while (i < len && p[i] == ' ') i++;
+    for (; i < len && p[i] >= '0' && p[i] <= '7'; i++) {
+        value = (value << 3) | (p[i] - '0');
+    }
+    return value;
+}
+
+static bool tar_is_zero_block(const tar_header_t *header) {
+    const uint8_t *p = (const uint8_t *)header;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        if (p[i]) return false;
+    }
+    return true;
+}
+
+// The checksum is computed with its own field filled with spaces
+static bool tar_verify_checksum(const tar_header_t *header) {
+    const uint8_t *p = (const uint8_t *)header;
+    size_t start = offsetof(tar_header_t, chksum);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (i >= start && i < start + sizeof(header->chksum)) ? ' ' : p[i];
+    }
+    return sum == tar_parse_number(header->chksum, sizeof(header->chksum));
+}
+
+// Strips "./" and trailing slashes, returns NULL for absolute paths or any ".." component
+static char *tar_clean_name(const char *name) {
+    while (name[0] == '.' && (name[1] == '/' || name[1] == '\0')) {
+        name += name[1] ? 2 : 1;
+        while (*name == '/' && name[1] == '/') name++;
+    }
+    if (name[0] == '/') {
+        return NULL;
+    }
+    size_t len = strlen(name);
+    while (len > 0 && name[len - 1] == '/') len--;
+    const char *component = name;
+    while (component < name + len) {
+        const char *end = memchr(component, '/', name + len - component);
+        size_t component_len = end ? (size_t)(end - component) : (size_t)(name + len - component);
+        if (component_len == 2 && component[0] == '.' && component[1] == '.') {
+            return NULL;
+        }
+        if (!end) break;
+        component = end + 1;
+    }
+    return strndup(name, len);
+}
+
+// Follows the components of path from depth levels below dest, false once it steps above dest
+static bool tar_walk_depth(const char *path, size_t len, int *depth) {
+    const char *component = path;
+    while (component < path + len) {
+        const char *end = memchr(component, '/', path + len - component);
+        size_t component_len = end ? (size_t)(end - component) : (size_t)(path + len - component);
+        if (component_len == 2 && component[0] == '.' && component[1] == '.') {
+            if (--*depth < 0) return false;
+        } else if (component_len > 0 && !(component_len == 1 && component[0] == '.')) {
+            ++*depth;
+        }
+        if (!end) break;
+        component = end + 1;
+    }
+    return true;
+}
+
+// Whether a symlink at name pointing to target resolves inside dest
+static bool tar_link_inside(const char *name, const char *target) {
+    if (!target[0] || target[0] == '/') {
+        return false;
+    }
+    const char *slash = strrchr(name, '/');
+    int depth = 0;
+    return tar_walk_depth(name, slash ? (size_t)(slash - name) : 0, &depth) &&
+        tar_walk_depth(target, strlen(target), &depth);
+}
+
+static char *tar_join(const char *dest, const char *name) {
+    size_t len = strlen(dest) + strlen(name) + 2;
+    char *path = malloc(len);
+    if (path) snprintf(path, len, "%s/%s", dest, name);
+    return path;
+}
+
+static int tar_ensure_parent(tar_parser_t *p, const char *path) {
+    const char *slash = strrchr(path, '/');
+    size_t len = slash ? (size_t)(slash - path) : 0;
+    if (len == 0 || len >= sizeof(p->last_dir)) {
+        return 0;
+    }
+    if (strlen(p->last_dir) == len && memcmp(p->last_dir, path, len) == 0) {
+        return 0;
+    }
+    memcpy(p->last_dir, path, len);
+    p->last_dir[len] = '\0';
+    int err = tar_xz_mkdirs(p->last_dir, p->dest_len);
+    if (err) {
+        p->last_dir[0] = '\0';
+        return tar_xz_fail(p->writer, err, "%s: %s", path, strerror(err));
+    }
+    return 0;
+}
+
+static void tar_clear_pending(tar_parser_t *p) {
+    free(p->long_name);
+    free(p->long_link);
+    p->long_name = NULL;
+    p->long_link = NULL;
+}
+
+// Hands the buffered part of the current file to the writer
+static int tar_flush_file(tar_parser_t *p, bool last) {
+    tar_xz_job_t *job = p->job;
+    if (!job) {
+        job = calloc(1, sizeof(tar_xz_job_t));
+        if (!job) return tar_xz_fail(p->writer, ENOMEM, "Out of memory");
+    }
+    p->job = NULL;
+    if (p->job_first) {
+        job->path = p->path;
+        p->path = NULL;
+        p->job_first = false;
+    }
+    if (last) {
+        job->name = p->name;
+        job->mode = p->mode;
+        p->name = NULL;
+    }
+    return tar_xz_enqueue(p->writer, job);
+}
+
+static int tar_append_file(tar_parser_t *p, const uint8_t *buf, size_t len) {
+    // Includes len
+    uint64_t left = p->remaining;
+    while (len > 0) {
+        if (!p->job) {
+            p->job_cap = left < TAR_XZ_CHUNK_SIZE ? (size_t)left : TAR_XZ_CHUNK_SIZE;
+            p->job = calloc(1, sizeof(tar_xz_job_t));
+            if (p->job) p->job->data = malloc(p->job_cap);
+            if (!p->job || !p->job->data) {
+                return tar_xz_fail(p->writer, ENOMEM, "Out of memory");
+            }
+        }
+        size_t n = p->job_cap - p->job->len;
+        if (n > len) n = len;
+        memcpy(p->job->data + p->job->len, buf, n);
+        p->job->len += n;
+        buf += n;
+        len -= n;
+        left -= n;
+        if (p->job->len == p->job_cap && left > 0) {
+            int err = tar_flush_file(p, false);
+            if (err) return err;
+        }
+    }
+    return 0;
+}
+
+// pax records are "<length> <key>=<value>\n"
+static void tar_parse_pax(tar_parser_t *p) {
+    const char *record = p->meta;
+    const char *end = p->meta + p->meta_len;
+    while (record < end) {
+        char *space;
+        unsigned long len = strtoul(record, &space, 10);
+        if (space == record || *space != ' ' || len == 0 || len > (unsigned long)(end - record)) {
+            break;
+        }
+        const char *key = space + 1;
+        const char *record_end = record + len - 1;
+        const char *equals = memchr(key, '=', record_end - key);
+        if (equals) {
+            size_t key_len = equals - key;
+            char **target = NULL;
+            if (key_len == 4 && memcmp(key, "path", 4) == 0) {
+                target = &p->long_name;
+            } else if (key_len == 8 && memcmp(key, "linkpath", 8) == 0) {
+                target = &p->long_link;
+            }
+            if (target) {
+                free(*target);
+                *target = strndup(equals + 1, record_end - equals - 1);
+            }
+        }
+        record += len;
+    }
+}
+
+static int tar_end_data(tar_parser_t *p) {
+    int err = 0;
+    switch (p->kind) {
+        case TAR_ENTRY_FILE:
+            err = tar_flush_file(p, true);
+            break;
+        case TAR_ENTRY_LONG_NAME:
+            free(p->long_name);
+            p->long_name = strndup(p->meta, p->meta_len);
+            break;
+        case TAR_ENTRY_LONG_LINK:
+            free(p->long_link);
+            p->long_link = strndup(p->meta, p->meta_len);
+            break;
+        case TAR_ENTRY_PAX:
+            tar_parse_pax(p);
+            break;
+        case TAR_ENTRY_SKIP:
+            break;
+    }
+    free(p->meta);
+    p->meta = NULL;
+    p->meta_len = 0;
+    p->kind = TAR_ENTRY_SKIP;
+    return err;
+}
+
+static int tar_begin_entry(tar_parser_t *p) {
+    tar_xz_writer_t *w = p->writer;
+    tar_header_t *h = &p->header;
+    if (tar_is_zero_block(h)) {
+        p->state = TAR_STATE_END;
+        return 0;
+    }
+    if (!tar_verify_checksum(h)) {
+        return tar_xz_fail(w, EINVAL, "Corrupted tar header");
+    }
+    uint64_t size = tar_parse_number(h->size, sizeof(h->size));
+    p->remaining = size;
+    p->padding = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+    p->state = size > 0 ? TAR_STATE_DATA : TAR_STATE_HEADER;
+    p->kind = TAR_ENTRY_SKIP;
+
+    switch (h->typeflag) {
+        case 'L':
+        case 'K':
+        case 'x':
+            if (size > TAR_XZ_META_LIMIT) {
+                return tar_xz_fail(w, EINVAL, "Oversized tar extended header");
+            }
+            p->kind = h->typeflag == 'L' ? TAR_ENTRY_LONG_NAME : h->typeflag == 'K' ? TAR_ENTRY_LONG_LINK : TAR_ENTRY_PAX;
+            p->meta = malloc(size + 1);
+            if (!p->meta) return tar_xz_fail(w, ENOMEM, "Out of memory");
+            p->meta_len = 0;
+            return size > 0 ? 0 : tar_end_data(p);
+        case 'g':
+            // Global pax header, nothing in it matters here
+            return 0;
+    }
+
+    char raw[PATH_MAX];
+    if (p->long_name) {
+        snprintf(raw, sizeof(raw), "%s", p->long_name);
+    } else if (h->prefix[0] && memcmp(h->magic, "ustar", 5) == 0) {
+        snprintf(raw, sizeof(raw), "%.*s/%.*s", (int)strnlen(h->prefix, sizeof(h->prefix)), h->prefix,
+            (int)strnlen(h->name, sizeof(h->name)), h->name);
+    } else {
+        snprintf(raw, sizeof(raw), "%.*s", (int)strnlen(h->name, sizeof(h->name)), h->name);
+    }
+    char *name = tar_clean_name(raw);
+    if (!name) {
+        tar_clear_pending(p);
+        return tar_xz_fail(w, EPERM, "Refusing to extract %s", raw);
+    }
+    if (!name[0]) {
+        // The archive root itself
+        free(name);
+        tar_clear_pending(p);
+        return 0;
+    }
+    char *path = tar_join(p->dest, name);
+    char *link_name = p->long_link ? strdup(p->long_link) : strndup(h->linkname, strnlen(h->linkname, sizeof(h->linkname)));
+    tar_clear_pending(p);
+    if (!path || !link_name) {
+        free(name);
+        free(path);
+        free(link_name);
+        return tar_xz_fail(w, ENOMEM, "Out of memory");
+    }
+
+    int err = 0;
+    if (p->options && p->options->progress && !p->options->progress(p->in_bytes, p->out_bytes, name, p->options->ctx)) {
+        err = tar_xz_fail(w, ECANCELED, "Cancelled");
+    }
+    switch (err ? -1 : h->typeflag) {
+        case '0':
+        case '\0':
+        case '7':
+            if ((err = tar_ensure_parent(p, path))) break;
+            p->kind = TAR_ENTRY_FILE;
+            p->name = name;
+            p->path = path;
+            p->mode = (mode_t)tar_parse_number(h->mode, sizeof(h->mode));
+            p->job_first = true;
+            name = path = NULL;
+            if (size == 0) {
+                err = tar_end_data(p);
+            }
+            break;
+        case '5':
+            if ((err = tar_xz_mkdirs(path, p->dest_len))) {
+                tar_xz_fail(w, err, "%s: %s", path, strerror(err));
+                break;
+            }
+            p->stats->directories++;
+            break;
+        case '2':
+            if (!tar_link_inside(name, link_name)) {
+                err = tar_xz_fail(w, EPERM, "Refusing to link %s to %s", name, link_name);
+                break;
+            }
+            if ((err = tar_ensure_parent(p, path))) break;
+            // Relative targets resolve against the link's own directory, not the cwd
+            unlink(path);
+            if (symlink(link_name, path) != 0) {
+                err = tar_xz_fail(w, errno, "%s: %s", path, strerror(errno));
+                break;
+            }
+            p->stats->links++;
+            break;
+        case '1': {
+            char *target_name = tar_clean_name(link_name);
+            char *target = target_name && target_name[0] ? tar_join(p->dest, target_name) : NULL;
+            free(target_name);
+            if (!target) {
+                err = tar_xz_fail(w, EPERM, "Refusing to link %s to %s", name, link_name);
+                break;
+            }
+            // The target may still be waiting in the writer queue
+            if (!(err = tar_xz_drain(w)) && !(err = tar_ensure_parent(p, path))) {
+                unlink(path);
+                if ((err = tar_xz_check_parents(target, p->dest_len))) {
+                    err = tar_xz_fail(w, EPERM, "Refusing to link %s to %s", name, link_name);
+                } else if (linkat(AT_FDCWD, target, AT_FDCWD, path, 0) != 0) {
+                    err = tar_xz_fail(w, errno, "%s: %s", path, strerror(errno));
+                } else {
+                    p->stats->links++;
+                }
+            }
+            free(target);
+            break;
+        }
+        default:
+            // Devices, fifos and vendor extensions are skipped along with their data
+            break;
+    }
+    free(name);
+    free(path);
+    free(link_name);
+    return err;
+}
+
+static int tar_consume(tar_parser_t *p, const uint8_t *buf, size_t len) {
+    int err = 0;
+    while (len > 0 && !err && p->state != TAR_STATE_END) {
+        size_t n = len;
+        switch (p->state) {
+            case TAR_STATE_HEADER:
+                n = TAR_BLOCK_SIZE - p->header_fill;
+                if (n > len) n = len;
+                memcpy((uint8_t *)&p->header + p->header_fill, buf, n);
+                p->header_fill += n;
+                if (p->header_fill == TAR_BLOCK_SIZE) {
+                    p->header_fill = 0;
+                    err = tar_begin_entry(p);
+                }
+                break;
+            case TAR_STATE_DATA:
+                n = p->remaining < len ? (size_t)p->remaining : len;
+                if (p->kind == TAR_ENTRY_FILE) {
+                    err = tar_append_file(p, buf, n);
+                } else if (p->meta) {
+                    memcpy(p->meta + p->meta_len, buf, n);
+                    p->meta_len += n;
+                }
+                p->remaining -= n;
+                if (!err && p->remaining == 0) {
+                    err = tar_end_data(p);
+                    p->state = p->padding > 0 ? TAR_STATE_PADDING : TAR_STATE_HEADER;
+                }
+                break;
+            case TAR_STATE_PADDING:
+                n = p->padding < len ? p->padding : len;
+                p->padding -= n;
+                if (p->padding == 0) {
+                    p->state = TAR_STATE_HEADER;
+                }
+                break;
+            case TAR_STATE_END:
+                break;
+        }
+        buf += n;
+        len -= n;
+    }
+    return err;
+}
+
+#pragma mark - Extraction
+
+int tar_xz_extract(const char *xz_path, const char *dest, const tar_xz_options_t *options,
+    tar_xz_stats_t *stats, char *errbuf, size_t errlen) {
+    tar_xz_stats_t local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    tar_xz_writer_t writer = {
+        .errbuf = errbuf,
+        .errlen = errlen,
+        .options = options,
+        .stats = stats
+    };
+    pthread_mutex_init(&writer.lock, NULL);
+    pthread_cond_init(&writer.cond, NULL);
+
+    lzma_stream strm = LZMA_STREAM_INIT;
+    uint8_t *in_buf = NULL, *out_buf = NULL;
+    tar_parser_t *parser = NULL;
+    bool writer_started = false;
+    pthread_t writer_thread;
+    int err = 0;
+
+    int fd = open(xz_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        err = tar_xz_fail(&writer, errno, "%s: %s", xz_path, strerror(errno));
+        goto cleanup;
+    }
+    if ((err = tar_xz_mkdirs(dest, strlen(dest)))) {
+        tar_xz_fail(&writer, err, "%s: %s", dest, strerror(err));
+        goto cleanup;
+    }
+
+    uint32_t threads = options && options->threads > 0 ? (uint32_t)options->threads : lzma_cputhreads();
+    lzma_mt mt = {
+        .flags = LZMA_CONCATENATED,
+        .threads = threads > 0 ? threads : 1,
+        .memlimit_threading = TAR_XZ_THREADING_MEMLIMIT,
+        .memlimit_stop = UINT64_MAX
+    };
+    lzma_ret ret = lzma_stream_decoder_mt(&strm, &mt);
+    if (ret != LZMA_OK) {
+        err = tar_xz_fail(&writer, ret == LZMA_MEM_ERROR ? ENOMEM : EINVAL, "%s", tar_xz_lzma_error(ret));
+        goto cleanup;
+    }
+
+    in_buf = malloc(TAR_XZ_IN_BUFFER_SIZE);
+    out_buf = malloc(TAR_XZ_OUT_BUFFER_SIZE);
+    parser = calloc(1, sizeof(tar_parser_t));
+    if (!in_buf || !out_buf || !parser) {
+        err = tar_xz_fail(&writer, ENOMEM, "Out of memory");
+        goto cleanup;
+    }
+    parser->dest = dest;
+    parser->dest_len = strlen(dest);
+    parser->writer = &writer;
+    parser->stats = stats;
+    parser->options = options;
+
+    if (pthread_create(&writer_thread, NULL, tar_xz_writer_main, &writer) != 0) {
+        err = tar_xz_fail(&writer, EAGAIN, "Unable to start the writer thread");
+        goto cleanup;
+    }
+    writer_started = true;
+
+    lzma_action action = LZMA_RUN;
+    uint64_t next_progress = TAR_XZ_PROGRESS_INTERVAL;
+    while (!err) {
+        if (strm.avail_in == 0 && action == LZMA_RUN) {
+            ssize_t n = read(fd, in_buf, TAR_XZ_IN_BUFFER_SIZE);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                err = tar_xz_fail(&writer, errno, "%s: %s", xz_path, strerror(errno));
+                break;
+            }
+            strm.next_in = in_buf;
+            strm.avail_in = n;
+            if (n == 0) action = LZMA_FINISH;
+        }
+        strm.next_out = out_buf;
+        strm.avail_out = TAR_XZ_OUT_BUFFER_SIZE;
+        ret = lzma_code(&strm, action);
+
+        parser->in_bytes = strm.total_in;
+        parser->out_bytes = strm.total_out;
+        size_t produced = TAR_XZ_OUT_BUFFER_SIZE - strm.avail_out;
+        if (produced > 0 && (err = tar_consume(parser, out_buf, produced))) {
+            break;
+        }
+        if (ret == LZMA_STREAM_END || parser->state == TAR_STATE_END) {
+            // Anything after the end-of-archive blocks is padding
+            break;
+        }
+        if (ret != LZMA_OK) {
+            err = tar_xz_fail(&writer, ret == LZMA_MEM_ERROR ? ENOMEM : EINVAL, "%s", tar_xz_lzma_error(ret));
+            break;
+        }
+        if (strm.total_in >= next_progress) {
+            next_progress = strm.total_in + TAR_XZ_PROGRESS_INTERVAL;
+            if (options && options->progress && !options->progress(strm.total_in, strm.total_out, NULL, options->ctx)) {
+                err = tar_xz_fail(&writer, ECANCELED, "Cancelled");
+            }
+        }
+    }
+    // Archives without end-of-archive blocks are fine as long as no entry was cut off
+    if (!err && parser->state != TAR_STATE_END && (parser->state != TAR_STATE_HEADER || parser->header_fill > 0)) {
+        err = tar_xz_fail(&writer, EINVAL, "Unexpected end of archive");
+    }
+
+cleanup:
+    if (writer_started) {
+        pthread_mutex_lock(&writer.lock);
+        writer.done = true;
+        pthread_cond_broadcast(&writer.cond);
+        pthread_mutex_unlock(&writer.lock);
+        pthread_join(writer_thread, NULL);
+    }
+    err = writer.err;
+    if (parser) {
+        tar_xz_free_job(parser->job);
+        tar_clear_pending(parser);
+        free(parser->meta);
+        free(parser->name);
+        free(parser->path);
+        free(parser);
+    }
+    free(in_buf);
+    free(out_buf);
+    lzma_end(&strm);
+    if (fd >= 0) close(fd);
+    pthread_cond_destroy(&writer.cond);
+    pthread_mutex_destroy(&writer.lock);
+    return err;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming .tar.xz extraction: the xz stream is decoded with the
+// multi-threaded decoder into large buffers, tar entries are parsed from
+// those buffers directly, and file contents are handed to a write-behind
+// thread so decoding never waits on the filesystem.
+
+typedef struct {
+    // Decoder threads, 0 uses every online CPU
+    int threads;
+    // Called on the decoding thread at every entry and about every MiB of input,
+    // with the compressed bytes read and the tar bytes decoded so far.
+    // name is the entry being started relative to dest, NULL for the periodic calls.
+    // Returning false cancels with ECANCELED.
+    bool (*progress)(uint64_t in_bytes, uint64_t out_bytes, const char *name, void *ctx);
+    // Called on the writer thread once a regular file is complete on disk.
+    // Returning false cancels with ECANCELED.
+    bool (*file_written)(const char *name, void *ctx);
+    void *ctx;
+} tar_xz_options_t;
+
+typedef struct {
+    size_t files;
+    size_t directories;
+    size_t links;
+    uint64_t bytes;
+} tar_xz_stats_t;
+
+// Returns 0 on success, otherwise an errno-style error code with a message in errbuf
+int tar_xz_extract(const char *xz_path, const char *dest, const tar_xz_options_t *options,
+    tar_xz_stats_t *stats, char *errbuf, size_t errlen);
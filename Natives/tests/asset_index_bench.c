@@ -0,0 +1,42 @@
+#include <limits.h>
+
+#include "asset_index.h"
+
+#include "asset_index_fixture.h"
+#include "bench.h"
+#include "test.h"
+
+// Loads an asset index 200 times and prints the best time and the RSS
+// added by the loaded index. Uses the synthetic index unless a path is given.
+int main(int argc, char **argv) {
+    char dir[PATH_MAX], path[PATH_MAX + 16];
+    dir[0] = '\0';
+    if (argc > 1) {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    } else {
+        test_make_tmpdir(dir, sizeof(dir));
+        snprintf(path, sizeof(path), "%s/index.json", dir);
+        asset_index_fixture_write(path);
+    }
+
+    long before = bench_rss();
+    double best = 1e9;
+    asset_index_t index = {0};
+    for (int i = 0; i < 200; i++) {
+        asset_index_free(&index);
+        double start = bench_now();
+        if (asset_index_load(path, &index) != 0) {
+            fprintf(stderr, "could not load %s\n", path);
+            return EXIT_FAILURE;
+        }
+        double elapsed = bench_now() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    printf("asset_index_load: %zu objects, best %.3f ms, rss +%ld KB\n",
+        index.count, best * 1e3, bench_rss() - before);
+    asset_index_free(&index);
+    if (dir[0]) {
+        test_remove_tree(dir);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include <json/json.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+extern "C" {
+#include "asset_index_fixture.h"
+#include "bench.h"
+#include "test.h"
+}
+
+// The asset_index_bench baseline: a full DOM parse with jsoncpp, walked the way
+// downloadClientAssets walks the NSJSONSerialization tree
+int main(int argc, char **argv) {
+    char dir[PATH_MAX], path[PATH_MAX + 16];
+    dir[0] = '\0';
+    if (argc > 1) {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    } else {
+        test_make_tmpdir(dir, sizeof(dir));
+        snprintf(path, sizeof(path), "%s/index.json", dir);
+        asset_index_fixture_write(path);
+    }
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+
+    long before = bench_rss();
+    double best = 1e9;
+    size_t count = 0;
+    std::unique_ptr<Json::Value> kept;
+    for (int i = 0; i < 200; i++) {
+        double start = bench_now();
+        std::unique_ptr<Json::Value> root(new Json::Value);
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string error;
+        if (!reader->parse(json.data(), json.data() + json.size(), root.get(), &error)) {
+            fprintf(stderr, "could not parse %s: %s\n", path, error.c_str());
+            return EXIT_FAILURE;
+        }
+        const Json::Value &objects = (*root)["objects"];
+        count = 0;
+        for (auto it = objects.begin(); it != objects.end(); ++it) {
+            count += (*it)["hash"].asString().size() == 40;
+            (void)(*it)["size"].asUInt64();
+        }
+        double elapsed = bench_now() - start;
+        if (elapsed < best) best = elapsed;
+        // Keep one tree alive, as the installer does while it walks it
+        kept = std::move(root);
+    }
+    printf("jsoncpp DOM: %zu objects, best %.3f ms, rss +%ld KB\n",
+        count, best * 1e3, bench_rss() - before);
+    if (dir[0]) {
+        test_remove_tree(dir);
+    }
+    return EXIT_SUCCESS;
+}
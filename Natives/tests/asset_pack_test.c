@@ -0,0 +1,179 @@
+#include <CommonCrypto/CommonDigest.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "asset_pack.h"
+#include "asset_root.h"
+
+#include "test.h"
+
+static char root[PATH_MAX], assets[PATH_MAX + 16], objects[PATH_MAX + 32], tmp[PATH_MAX + 16];
+
+static void hash_data(const char *data, uint8_t *hash, char *hex) {
+    CC_SHA1(data, (CC_LONG)strlen(data), hash);
+    for (int i = 0; i < 20; i++) {
+        sprintf(hex + i * 2, "%02x", hash[i]);
+    }
+}
+
+static void object_path(const char *hex, char *path, size_t cap) {
+    snprintf(path, cap, "%s/%.2s/%s", objects, hex, hex);
+}
+
+static void write_loose(const char *hex, const char *data) {
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/%.2s", objects, hex);
+    mkdir(path, 0755);
+    object_path(hex, path, sizeof(path));
+    test_write_file(path, data, strlen(data));
+}
+
+static void test_append(void) {
+    const char *data = "hello asset";
+    uint8_t hash[20];
+    char hex[41];
+    hash_data(data, hash, hex);
+    // The damaged copy is superseded by the one appended after it
+    CHECK(asset_pack_append(assets, hash, "bad", 3) == 0);
+    CHECK(asset_pack_append(assets, hash, data, strlen(data)) == 0);
+
+    asset_pack_t pack;
+    CHECK(asset_pack_open(assets, &pack) == 0);
+    uint64_t size = 0;
+    const char *found = asset_pack_find(&pack, hash, &size);
+    CHECK(found && size == strlen(data) && memcmp(found, data, size) == 0);
+    CHECK(asset_pack_verify(&pack, hash));
+    uint8_t other[20] = {0};
+    CHECK(!asset_pack_find(&pack, other, NULL));
+    CHECK(!asset_pack_verify(&pack, other));
+    asset_pack_close(&pack);
+
+    // Opened again, the index written by the first open answers the same
+    CHECK(asset_pack_open(assets, &pack) == 0);
+    CHECK(pack.count == 1 && asset_pack_verify(&pack, hash));
+    asset_pack_close(&pack);
+}
+
+static void test_import_export(void) {
+    uint8_t goodHash[20], linkedHash[20];
+    char goodHex[41], linkedHex[41], badHex[41], path[PATH_MAX * 2], storeCopy[PATH_MAX * 2];
+    hash_data("loose object", goodHash, goodHex);
+    hash_data("linked object", linkedHash, linkedHex);
+    // Named after data it doesn't hold
+    hash_data("something else", (uint8_t[20]){0}, badHex);
+    write_loose(goodHex, "loose object");
+    write_loose(linkedHex, "linked object");
+    write_loose(badHex, "corrupt");
+    object_path(linkedHex, path, sizeof(path));
+    snprintf(storeCopy, sizeof(storeCopy), "%s/store_copy", root);
+    CHECK(link(path, storeCopy) == 0);
+
+    size_t imported = 0;
+    CHECK(asset_pack_import_loose(assets, objects, true, &imported) == 0);
+    CHECK(imported == 1);
+    struct stat st;
+    object_path(goodHex, path, sizeof(path));
+    CHECK(stat(path, &st) != 0);
+    object_path(badHex, path, sizeof(path));
+    CHECK(stat(path, &st) != 0);
+    // Hard linked objects stay loose and out of the pack
+    object_path(linkedHex, path, sizeof(path));
+    CHECK(stat(path, &st) == 0);
+
+    asset_pack_t pack;
+    CHECK(asset_pack_open(assets, &pack) == 0);
+    CHECK(asset_pack_verify(&pack, goodHash));
+    CHECK(!asset_pack_find(&pack, linkedHash, NULL));
+
+    size_t exported = 0;
+    CHECK(asset_pack_export(&pack, objects, true, &exported) == 0);
+    CHECK(exported == 2);
+    object_path(goodHex, path, sizeof(path));
+    CHECK(stat(path, &st) == 0 && st.st_size == (off_t)strlen("loose object"));
+    // Nothing changed since, so nothing is written again
+    CHECK(asset_pack_export(&pack, objects, true, &exported) == 0);
+    CHECK(exported == 0);
+    // A damaged loose copy is rewritten once the export is invalidated
+    test_write_file(path, "x", 1);
+    asset_pack_invalidate_export(objects);
+    CHECK(asset_pack_export(&pack, objects, true, &exported) == 0);
+    CHECK(exported == 1);
+    CHECK(stat(path, &st) == 0 && st.st_size == (off_t)strlen("loose object"));
+    asset_pack_close(&pack);
+}
+
+static void test_root(void) {
+    const char *data = "hello asset";
+    uint8_t hash[20];
+    char hex[41], path[PATH_MAX * 2], other[PATH_MAX * 4];
+    hash_data(data, hash, hex);
+    // Served through a link to the game directory, as the game may be told
+    char linkRoot[PATH_MAX * 2], linkAssets[PATH_MAX * 3];
+    snprintf(linkRoot, sizeof(linkRoot), "%s/link", root);
+    snprintf(linkAssets, sizeof(linkAssets), "%s/assets", linkRoot);
+    CHECK(symlink(root, linkRoot) == 0);
+    CHECK(asset_root_serve(linkAssets, tmp) == 0);
+    CHECK(asset_root_serve(linkAssets, tmp) == EBUSY);
+
+    // Loose copies left by the export must not be what answers
+    char resolved[PATH_MAX];
+    CHECK(realpath(objects, resolved) != NULL);
+    snprintf(path, sizeof(path), "%s/%.2s/%s", resolved, hex, hex);
+    unlink(path);
+    struct stat st;
+    int result;
+    CHECK(asset_root_stat(path, &st, &result) && result == 0);
+    CHECK(S_ISREG(st.st_mode) && st.st_size == (off_t)strlen(data));
+    CHECK(asset_root_access(path, R_OK, &result) && result == 0);
+    CHECK(asset_root_access(path, W_OK, &result) && result == -1 && errno == EACCES);
+
+    int fd = -1;
+    char buf[64] = {0};
+    CHECK(asset_root_open(path, O_RDONLY | O_CLOEXEC, &fd) && fd >= 0);
+    CHECK(read(fd, buf, sizeof(buf)) == (ssize_t)strlen(data) && strcmp(buf, data) == 0);
+    CHECK(fstat(fd, &st) == 0 && st.st_size == (off_t)strlen(data));
+    close(fd);
+    // Writers get the real file system
+    CHECK(!asset_root_open(path, O_WRONLY, &fd));
+    CHECK(!asset_root_open(path, O_RDONLY | O_CREAT, &fd));
+
+    // Objects that aren't packed, other folders and wrong prefixes fall through
+    snprintf(other, sizeof(other), "%s/00/%040d", objects, 0);
+    CHECK(!asset_root_stat(other, &st, &result));
+    snprintf(other, sizeof(other), "%s/indexes/1.20.json", assets);
+    CHECK(!asset_root_stat(other, &st, &result));
+    snprintf(other, sizeof(other), "%s/ff/%s", objects, hex);
+    CHECK(!asset_root_stat(other, &st, &result));
+
+    // Answered through the linked root as well as the resolved one above
+    snprintf(other, sizeof(other), "%s/objects/%.2s/%s", linkAssets, hex, hex);
+    CHECK(asset_root_stat(other, &st, &result) && result == 0);
+
+    // Opened objects are unlinked right away, nothing is left behind
+    DIR *dir = opendir(tmp);
+    struct dirent *entry;
+    int leftover = 0;
+    while (dir && (entry = readdir(dir))) {
+        leftover += entry->d_name[0] != '.';
+    }
+    if (dir) closedir(dir);
+    CHECK(leftover == 0);
+}
+
+int main(void) {
+    test_make_tmpdir(root, sizeof(root));
+    snprintf(assets, sizeof(assets), "%s/assets", root);
+    snprintf(objects, sizeof(objects), "%s/objects", assets);
+    snprintf(tmp, sizeof(tmp), "%s/tmp", root);
+    mkdir(assets, 0755);
+    mkdir(objects, 0755);
+    mkdir(tmp, 0755);
+
+    test_append();
+    test_import_export();
+    test_root();
+    test_remove_tree(root);
+    return TEST_RESULT();
+}
@@ -0,0 +1,52 @@
+#include <pthread.h>
+
+#include "awt_input_queue.h"
+
+#include "bench.h"
+#include "test.h"
+
+// Push cost and batch size with a consumer thread draining 64 events per
+// wake, like AWTInputQueue. The producer floods in bursts of 4096 events
+// with a short pause between them, three cursor moves per key press.
+
+#define EVENTS 2000000
+
+static awt_input_queue_t queue;
+static size_t delivered, batches;
+
+static void *consumer(void *arg) {
+    awt_input_event_t events[64];
+    while (true) {
+        size_t count = awt_input_queue_wait(&queue, events, 64);
+        batches++;
+        for (size_t i = 0; i < count; i++) {
+            if (events[i].type == -1) return NULL;
+            delivered++;
+        }
+    }
+}
+
+int main(void) {
+    awt_input_queue_init(&queue, 1024);
+    pthread_t thread;
+    pthread_create(&thread, NULL, consumer, NULL);
+
+    double start = bench_now();
+    for (long i = 0; i < EVENTS; i++) {
+        bool key = i % 4 == 0;
+        awt_input_event_t event = {key ? 1 : 1003, (int)i, (int)i, 0, 0};
+        awt_input_queue_push(&queue, &event, !key);
+        if (i % 4096 == 0) {
+            struct timespec pause = {0, 20000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    awt_input_event_t end = {-1, 0, 0, 0, 0};
+    awt_input_queue_push(&queue, &end, false);
+    pthread_join(thread, NULL);
+    double elapsed = bench_now() - start;
+
+    printf("awt_input_queue: %d pushed, %zu delivered, %zu dropped, %.1f events per wake, %.1f ns per push\n",
+        EVENTS, delivered, queue.dropped, (double)delivered / batches, elapsed * 1e9 / EVENTS);
+    return EXIT_SUCCESS;
+}
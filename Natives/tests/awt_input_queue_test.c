@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <pthread.h>
+
+#include "awt_input_queue.h"
+
+#include "test.h"
+
+#define EVENT_KEY 1
+#define EVENT_CURSOR 1003
+#define EVENT_END -1
+#define STRESS_EVENTS 200000
+
+static void push(awt_input_queue_t *queue, int type, int i1, bool coalesce) {
+    awt_input_event_t event = {type, i1, 0, 0, 0};
+    awt_input_queue_push(queue, &event, coalesce);
+}
+
+static void test_coalesce_and_drop(void) {
+    awt_input_queue_t queue;
+    CHECK(awt_input_queue_init(&queue, 8) == 0);
+    awt_input_event_t events[8];
+
+    // Only the latest of consecutive cursor moves is kept
+    push(&queue, EVENT_CURSOR, 1, true);
+    push(&queue, EVENT_CURSOR, 2, true);
+    push(&queue, EVENT_KEY, 3, false);
+    push(&queue, EVENT_CURSOR, 4, true);
+    // Not coalesced with a cursor move pushed without coalesce
+    push(&queue, EVENT_CURSOR, 5, false);
+    push(&queue, EVENT_CURSOR, 6, true);
+    CHECK(awt_input_queue_wait(&queue, events, 8) == 5);
+    CHECK(events[0].type == EVENT_CURSOR && events[0].i1 == 2);
+    CHECK(events[1].type == EVENT_KEY && events[1].i1 == 3);
+    CHECK(events[2].i1 == 4 && events[3].i1 == 5 && events[4].i1 == 6);
+    CHECK(queue.dropped == 0);
+
+    // A taken event can't be replaced
+    push(&queue, EVENT_CURSOR, 7, true);
+    CHECK(awt_input_queue_wait(&queue, events, 1) == 1 && events[0].i1 == 7);
+    push(&queue, EVENT_CURSOR, 8, true);
+    CHECK(awt_input_queue_wait(&queue, events, 8) == 1 && events[0].i1 == 8);
+
+    // Once full the oldest is dropped, batches stop at max
+    for (int i = 0; i < 10; i++) {
+        push(&queue, EVENT_KEY, 10 + i, false);
+    }
+    CHECK(queue.dropped == 2);
+    CHECK(awt_input_queue_wait(&queue, events, 3) == 3 && events[0].i1 == 12 && events[2].i1 == 14);
+    CHECK(awt_input_queue_wait(&queue, events, 8) == 5 && events[0].i1 == 15 && events[4].i1 == 19);
+
+    awt_input_queue_t empty;
+    CHECK(awt_input_queue_init(&empty, 0) == ENOMEM);
+}
+
+static awt_input_queue_t stressQueue;
+static size_t delivered, batches;
+static bool keysOrdered = true;
+
+static void *consumer(void *arg) {
+    awt_input_event_t events[64];
+    int lastKey = -1;
+    while (true) {
+        size_t count = awt_input_queue_wait(&stressQueue, events, 64);
+        batches++;
+        for (size_t i = 0; i < count; i++) {
+            if (events[i].type == EVENT_END) return NULL;
+            if (events[i].type == EVENT_KEY) {
+                if (events[i].i1 <= lastKey) keysOrdered = false;
+                lastKey = events[i].i1;
+            }
+            delivered++;
+        }
+    }
+}
+
+// A producer flooding a consumer thread, every fourth event is a key
+static void test_threads(void) {
+    CHECK(awt_input_queue_init(&stressQueue, 1024) == 0);
+    pthread_t thread;
+    pthread_create(&thread, NULL, consumer, NULL);
+    for (int i = 0; i < STRESS_EVENTS; i++) {
+        bool key = i % 4 == 0;
+        push(&stressQueue, key ? EVENT_KEY : EVENT_CURSOR, i, !key);
+    }
+    push(&stressQueue, EVENT_END, 0, false);
+    pthread_join(thread, NULL);
+
+    CHECK(keysOrdered);
+    // Keys are never coalesced, so at least those arrive unless dropped
+    CHECK(delivered + stressQueue.dropped >= STRESS_EVENTS / 4);
+    CHECK(delivered <= STRESS_EVENTS && batches > 0);
+}
+
+int main(void) {
+    test_coalesce_and_drop();
+    test_threads();
+    return TEST_RESULT();
+}
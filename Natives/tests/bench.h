@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// Timing helpers for the benchmarks, which aren't part of ctest since their
+// numbers depend on the machine. Build them with the tests and run them by hand.
+
+static inline double bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Current resident set size in KB, 0 where /proc isn't available. The peak
+// isn't used, the loader's startup pages already exceed a small parse.
+static inline long bench_rss(void) {
+    long size, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -0,0 +1,61 @@
+#include "control_cache.h"
+
+#include "bench.h"
+#include "test.h"
+
+// Opening and walking a compiled 201-control layout, the work of a cached
+// layout switch, against hashing a 60 KB layout JSON to validate the cache
+int main(void) {
+    char dir[PATH_MAX], path[PATH_MAX + 32];
+    test_make_tmpdir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/default.json.cache", dir);
+
+    control_cache_builder_t builder;
+    control_cache_builder_init(&builder);
+    control_cache_record_t drawer = {.kind = CONTROL_KIND_DRAWER, .parent = -1};
+    control_cache_add(&builder, &drawer);
+    for (int i = 0; i < 200; i++) {
+        char expression[64];
+        snprintf(expression, sizeof(expression), "0.%d * ${screen_width}", i);
+        control_cache_record_t record = {.x = i, .width = 50};
+        record.kind = i % 2 ? CONTROL_KIND_SUB_BUTTON : CONTROL_KIND_BUTTON;
+        record.parent = i % 2 ? 0 : -1;
+        record.dynamic_x = control_cache_intern(&builder, expression);
+        record.keycodes[0] = i;
+        control_cache_add(&builder, &record);
+    }
+    control_cache_header_t header = {.source_hash = 1, .screen_width = 800, .screen_height = 400};
+    if (control_cache_write(&builder, &header, path) != 0) {
+        fprintf(stderr, "could not write %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    const int n = 20000;
+    volatile uint64_t sink = 0;
+    control_cache_t cache;
+    double start = bench_now();
+    for (int i = 0; i < n; i++) {
+        if (control_cache_open(&cache, path, header.source_hash) != 0) {
+            fprintf(stderr, "could not open %s\n", path);
+            return EXIT_FAILURE;
+        }
+        for (uint32_t j = 0; j < cache.header->record_count; j++) {
+            sink += cache.records[j].keycodes[0];
+        }
+        control_cache_close(&cache);
+    }
+    double open = bench_now() - start;
+
+    static char json[60000];
+    memset(json, 'a', sizeof(json));
+    start = bench_now();
+    for (int i = 0; i < n; i++) {
+        sink += control_cache_hash(json, sizeof(json));
+    }
+    double hash = bench_now() - start;
+
+    printf("open and walk %u records: %.1f us, hash of 60 KB: %.1f us\n", header.record_count, open / n * 1e6, hash / n * 1e6);
+    control_cache_builder_free(&builder);
+    test_remove_tree(dir);
+    return EXIT_SUCCESS;
+}
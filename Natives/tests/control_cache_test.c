@@ -0,0 +1,136 @@
+#include <errno.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "control_cache.h"
+
+#include "test.h"
+
+static char path[PATH_MAX + 32];
+static control_cache_builder_t builder;
+static control_cache_header_t header;
+static uint32_t expressions[5000];
+
+static void build(void) {
+    CHECK(control_cache_builder_init(&builder) == 0);
+    CHECK(control_cache_intern(&builder, "") == 0);
+    uint32_t right = control_cache_intern(&builder, "${right}"), bottom = control_cache_intern(&builder, "${bottom}");
+    CHECK(right == 1 && control_cache_intern(&builder, "${right}") == right && bottom != right);
+
+    // Enough strings to grow the table and the slots several times
+    char buf[64];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "0.%d * ${screen_width}", i);
+        expressions[i] = control_cache_intern(&builder, buf);
+    }
+    int mismatches = 0;
+    for (int i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "0.%d * ${screen_width}", i);
+        if (control_cache_intern(&builder, buf) != expressions[i] || strcmp(builder.strings + expressions[i], buf) != 0) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // A drawer, then buttons alternating with its sub buttons
+    control_cache_record_t drawer = {.x = 12.5, .y = 0.1, .kind = CONTROL_KIND_DRAWER, .parent = -1};
+    drawer.name = control_cache_intern(&builder, "Drawer");
+    drawer.orientation = control_cache_intern(&builder, "RIGHT");
+    CHECK(control_cache_add(&builder, &drawer) == 0);
+    for (int i = 0; i < 200; i++) {
+        control_cache_record_t record = {.x = i, .width = 50};
+        record.kind = i % 2 ? CONTROL_KIND_SUB_BUTTON : CONTROL_KIND_BUTTON;
+        record.parent = i % 2 ? 0 : -1;
+        record.dynamic_x = expressions[i];
+        record.keycodes[0] = i;
+        CHECK(control_cache_add(&builder, &record) == 0);
+    }
+    header = (control_cache_header_t){
+        .source_hash = control_cache_hash("abc", 3),
+        .screen_width = 800, .screen_height = 400, .scaled_at = 100, .layout_version = 7
+    };
+}
+
+static void patch(long offset, const void *data, size_t len) {
+    FILE *f = fopen(path, "r+b");
+    CHECK(f != NULL);
+    if (!f) return;
+    fseek(f, offset, offset < 0 ? SEEK_END : SEEK_SET);
+    fwrite(data, 1, len, f);
+    fclose(f);
+}
+
+static void test_round_trip(void) {
+    char tmpPath[PATH_MAX + 48];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    CHECK(access(tmpPath, F_OK) != 0);
+    CHECK(header.record_count == 201);
+
+    control_cache_t cache;
+    CHECK(control_cache_open(&cache, path, header.source_hash + 1) == ESTALE && cache.map == NULL);
+    CHECK(control_cache_open(&cache, tmpPath, header.source_hash) == ENOENT);
+    CHECK(control_cache_open(&cache, path, header.source_hash) == 0);
+    if (!cache.map) return;
+    CHECK(cache.header->record_count == 201 && cache.header->screen_width == 800 && cache.header->layout_version == 7);
+    CHECK(strcmp(control_cache_string(&cache, cache.records[0].orientation), "RIGHT") == 0);
+    CHECK(strcmp(control_cache_string(&cache, cache.records[0].name), "Drawer") == 0);
+    CHECK(cache.records[0].x == 12.5 && cache.records[7].keycodes[0] == 6 && cache.records[8].parent == 0);
+    CHECK(strcmp(control_cache_string(&cache, cache.records[1].dynamic_x), "0.0 * ${screen_width}") == 0);
+    CHECK(strcmp(control_cache_string(&cache, cache.records[1].dynamic_y), "") == 0);
+    control_cache_close(&cache);
+}
+
+// Every corruption is caught before a record is handed out
+static void test_corrupt(void) {
+    control_cache_t cache;
+    long record2 = sizeof(control_cache_header_t) + 2 * sizeof(control_cache_record_t);
+
+    // A sub button whose parent isn't an earlier drawer
+    int32_t parent = 5;
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    patch(record2 + offsetof(control_cache_record_t, parent), &parent, sizeof(parent));
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+
+    // A string offset past the table
+    uint32_t offset = UINT32_MAX / 2;
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    patch(record2 + offsetof(control_cache_record_t, dynamic_y), &offset, sizeof(offset));
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+
+    uint8_t kind = 9;
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    patch(record2 + offsetof(control_cache_record_t, kind), &kind, sizeof(kind));
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+
+    // No terminator at the end of the string table
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    patch(-1, "x", 1);
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    CHECK(truncate(path, 1000) == 0);
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+    CHECK(truncate(path, 10) == 0);
+    CHECK(control_cache_open(&cache, path, header.source_hash) == EINVAL);
+
+    // Another build's format
+    uint32_t version = UINT32_MAX;
+    CHECK(control_cache_write(&builder, &header, path) == 0);
+    patch(offsetof(control_cache_header_t, version), &version, sizeof(version));
+    CHECK(control_cache_open(&cache, path, header.source_hash) == ESTALE);
+}
+
+int main(void) {
+    char dir[PATH_MAX];
+    test_make_tmpdir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/default.json.cache", dir);
+
+    build();
+    test_round_trip();
+    test_corrupt();
+    CHECK(control_cache_hash("abc", 3) != control_cache_hash("abd", 3));
+    control_cache_builder_free(&builder);
+    test_remove_tree(dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+#include "control_grid.h"
+
+#include "bench.h"
+#include "test.h"
+
+// Grid lookups against a linear scan over random layouts on an iPad-sized
+// screen in points, for 2M random touches each
+
+static int linear_hit(const control_rect_t *rects, size_t count, float x, float y) {
+    for (size_t i = count; i-- > 0;) {
+        const control_rect_t *r = &rects[i];
+        if (x >= r->x && y >= r->y && x < r->x + r->width && y < r->y + r->height) return (int)i;
+    }
+    return -1;
+}
+
+int main(void) {
+    const float width = 2732 / 2.0f, height = 2048 / 2.0f;
+    const int touches = 2000000;
+    srand(1);
+    for (size_t count = 16; count <= 1024; count *= 4) {
+        control_rect_t *rects = malloc(count * sizeof(control_rect_t));
+        for (size_t i = 0; i < count; i++) {
+            float size = 30 + rand() % 60;
+            rects[i] = (control_rect_t){rand() % (int)width - 20, rand() % (int)height - 20, size * (i % 7 == 0 ? 3 : 1), size};
+        }
+        control_grid_t grid = {0};
+        double start = bench_now();
+        for (int i = 0; i < 100; i++) {
+            control_grid_free(&grid);
+            control_grid_build(&grid, rects, count, width, height);
+        }
+        double build = (bench_now() - start) / 100;
+
+        float *points = malloc(touches * 2 * sizeof(float));
+        for (int i = 0; i < touches * 2; i += 2) {
+            points[i] = rand() % (int)(width + 40) - 20;
+            points[i + 1] = rand() % (int)(height + 40) - 20;
+        }
+        volatile long sum = 0;
+        start = bench_now();
+        for (int i = 0; i < touches; i++) {
+            sum += control_grid_hit(&grid, points[i * 2], points[i * 2 + 1], NULL, NULL);
+        }
+        double gridHit = (bench_now() - start) / touches;
+        start = bench_now();
+        for (int i = 0; i < touches; i++) {
+            sum += linear_hit(rects, count, points[i * 2], points[i * 2 + 1]);
+        }
+        double linearHit = (bench_now() - start) / touches;
+
+        printf("%4zu controls: grid %dx%d, build %.1f us, hit %.1f ns, linear scan %.1f ns\n",
+            count, grid.cols, grid.rows, build * 1e6, gridHit * 1e9, linearHit * 1e9);
+        control_grid_free(&grid);
+        free(points);
+        free(rects);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include <errno.h>
+
+#include "control_grid.h"
+
+#include "test.h"
+
+// Reference the grid has to agree with: topmost containing rect, half open
+static int linear_hit(const control_rect_t *rects, size_t count, float x, float y) {
+    for (size_t i = count; i-- > 0;) {
+        const control_rect_t *r = &rects[i];
+        if (x >= r->x && y >= r->y && x < r->x + r->width && y < r->y + r->height) return (int)i;
+    }
+    return -1;
+}
+
+static bool skip_index(size_t index, void *ctx) {
+    return index != *(size_t *)ctx;
+}
+
+static void test_layout(void) {
+    const control_rect_t rects[] = {
+        {0, 0, 100, 100},
+        {50, 50, 100, 100},   // over the first
+        {500, 500, 0, 40},    // empty, never hit
+        {-30, 740, 60, 60},   // partly off screen
+        {600, 10, 400, 50},   // wide, spans many cells
+    };
+    control_grid_t grid;
+    CHECK(control_grid_build(&grid, rects, 5, 1024, 768) == 0);
+    CHECK(grid.cols > 1 && grid.rows > 1);
+
+    CHECK(control_grid_hit(&grid, 10, 10, NULL, NULL) == 0);
+    CHECK(control_grid_hit(&grid, 75, 75, NULL, NULL) == 1);
+    CHECK(control_grid_hit(&grid, 149, 149, NULL, NULL) == 1);
+    CHECK(control_grid_hit(&grid, 150, 150, NULL, NULL) == -1);
+    CHECK(control_grid_hit(&grid, 100, 10, NULL, NULL) == -1);
+    CHECK(control_grid_hit(&grid, 500, 520, NULL, NULL) == -1);
+    CHECK(control_grid_hit(&grid, -10, 790, NULL, NULL) == 3);
+    CHECK(control_grid_hit(&grid, 10, 750, NULL, NULL) == 3);
+    CHECK(control_grid_hit(&grid, 990, 30, NULL, NULL) == 4);
+
+    // Filtered out, the control below gets the touch
+    size_t hidden = 1;
+    CHECK(control_grid_hit(&grid, 75, 75, skip_index, &hidden) == 0);
+    CHECK(control_grid_hit(&grid, 120, 120, skip_index, &hidden) == -1);
+
+    const float points[] = {10, 10, 75, 75, 2000, 2000, 990, 30};
+    int results[4];
+    control_grid_hit_many(&grid, points, 4, results, NULL, NULL);
+    CHECK(results[0] == 0 && results[1] == 1 && results[2] == -1 && results[3] == 4);
+    control_grid_free(&grid);
+    CHECK(control_grid_hit(&grid, 10, 10, NULL, NULL) == -1);
+
+    CHECK(control_grid_build(&grid, rects, 5, 0, 768) == EINVAL);
+    CHECK(control_grid_build(&grid, NULL, 0, 1024, 768) == 0);
+    CHECK(control_grid_hit(&grid, 10, 10, NULL, NULL) == -1);
+    control_grid_free(&grid);
+}
+
+// Random layouts like the benchmark's, compared with a linear scan
+static void test_random_layouts(void) {
+    const float width = 1366, height = 1024;
+    srand(1);
+    for (size_t count = 16; count <= 1024; count *= 4) {
+        control_rect_t *rects = malloc(count * sizeof(control_rect_t));
+        for (size_t i = 0; i < count; i++) {
+            float size = 30 + rand() % 60;
+            rects[i] = (control_rect_t){rand() % (int)width - 20, rand() % (int)height - 20, size * (i % 7 == 0 ? 3 : 1), size};
+        }
+        control_grid_t grid;
+        CHECK(control_grid_build(&grid, rects, count, width, height) == 0);
+        CHECK((size_t)grid.cols * grid.rows <= 4096);
+        int mismatches = 0;
+        for (int i = 0; i < 200000; i++) {
+            float x = rand() % (int)(width + 40) - 20 + (rand() % 4) / 4.0f;
+            float y = rand() % (int)(height + 40) - 20 + (rand() % 4) / 4.0f;
+            if (control_grid_hit(&grid, x, y, NULL, NULL) != linear_hit(rects, count, x, y)) mismatches++;
+        }
+        if (mismatches) {
+            fprintf(stderr, "%zu controls: %d points differ from a linear scan\n", count, mismatches);
+            test_failures++;
+        }
+        control_grid_free(&grid);
+        free(rects);
+    }
+}
+
+int main(void) {
+    test_layout();
+    test_random_layouts();
+    return TEST_RESULT();
+}
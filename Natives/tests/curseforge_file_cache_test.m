@@ -0,0 +1,77 @@
+#import <Foundation/Foundation.h>
+
+#import "CurseForgeFileCache.h"
+
+#include "test.h"
+
+static NSDictionary *read_file(NSString *path) {
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    return data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+}
+
+static void test_expiry(NSString *path) {
+    NSTimeInterval now = NSDate.date.timeIntervalSince1970;
+    NSDictionary *stored = @{
+        @"1:10": @{@"url": @"https://example.invalid/fresh.jar", @"cachedAt": @(now - 60)},
+        @"1:11": @{@"url": @"https://example.invalid/old.jar", @"cachedAt": @(now - 31 * 86400)},
+        @"1:12": @{@"url": @"https://example.invalid/unstamped.jar"},
+        @"1:13": @"not an entry"
+    };
+    [[NSJSONSerialization dataWithJSONObject:stored options:0 error:nil] writeToFile:path atomically:YES];
+
+    CurseForgeFileCache *cache = [[CurseForgeFileCache alloc] initWithPath:path capacity:8192 maxAge:30 * 86400];
+    CHECK([cache.entries.allKeys isEqualToArray:@[@"1:10"]]);
+    CHECK(cache[@"1:11"] == nil);
+    // Dropping expired entries is a change of its own
+    [cache save];
+    CHECK([read_file(path).allKeys isEqualToArray:@[@"1:10"]]);
+
+    // Nothing changed, nothing is written
+    [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+    cache = [[CurseForgeFileCache alloc] initWithPath:path capacity:8192 maxAge:30 * 86400];
+    [cache save];
+    CHECK(read_file(path) == nil);
+}
+
+static void test_capacity(NSString *path) {
+    [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+    CurseForgeFileCache *cache = [[CurseForgeFileCache alloc] initWithPath:path capacity:2 maxAge:30 * 86400];
+    for (int i = 0; i < 4; i++) {
+        cache[[NSString stringWithFormat:@"2:%d", i]] = @{@"url": [NSString stringWithFormat:@"https://example.invalid/%d.jar", i]};
+        // cachedAt orders the entries
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    CHECK([cache[@"2:0"][@"url"] isEqualToString:@"https://example.invalid/0.jar"]);
+    CHECK(cache[@"2:0"][@"cachedAt"] != nil);
+    [cache save];
+    // The install keeps every entry it resolved, only the file is trimmed
+    CHECK(cache.entries.count == 4);
+    NSArray *kept = [read_file(path).allKeys sortedArrayUsingSelector:@selector(compare:)];
+    CHECK([kept isEqualToArray:(@[@"2:2", @"2:3"])]);
+}
+
+static void test_concurrent_adds(NSString *path) {
+    [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+    CurseForgeFileCache *cache = [[CurseForgeFileCache alloc] initWithPath:path capacity:8192 maxAge:30 * 86400];
+    // As the fallback lookups add what they resolved
+    dispatch_apply(1000, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t i) {
+        cache[[NSString stringWithFormat:@"3:%zu", i]] = @{@"url": @"https://example.invalid/file.jar"};
+    });
+    [cache save];
+    CHECK(cache.entries.count == 1000);
+    CHECK(read_file(path).count == 1000);
+}
+
+int main(void) {
+    @autoreleasepool {
+        char dir[PATH_MAX];
+        test_make_tmpdir(dir, sizeof(dir));
+        NSString *path = [@(dir) stringByAppendingPathComponent:@"cache/curseforge_files.json"];
+        [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+        test_expiry(path);
+        test_capacity(path);
+        test_concurrent_adds(path);
+        test_remove_tree(dir);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,55 @@
+#include "gamepad_map.h"
+#include "glfw_keycodes.h"
+
+#include "bench.h"
+#include "test.h"
+
+// A table lookup against a linear scan of the 17 mapping entries, like the
+// old walk over the mapping array minus the unboxing, and the stick delta
+int main(void) {
+    const int buttons[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+        GLFW_GAMEPAD_BUTTON_LEFT_TRIGGER, GLFW_GAMEPAD_BUTTON_RIGHT_TRIGGER};
+    struct {
+        int button, keycode;
+    } list[GAMEPAD_MAP_BUTTONS];
+    gamepad_map_t map;
+    gamepad_map_init(&map);
+    for (int i = 0; i < GAMEPAD_MAP_BUTTONS; i++) {
+        list[i].button = buttons[i];
+        list[i].keycode = i + 40;
+        gamepad_map_set(&map, GAMEPAD_MODE_GAME, buttons[i], i + 40);
+    }
+
+    const int n = 50000000;
+    volatile int sink = 0;
+    unsigned random = 1;
+    double start = bench_now();
+    for (int i = 0; i < n; i++) {
+        random = random * 1103515245 + 12345;
+        sink += gamepad_map_lookup(&map, i & 1, buttons[(random >> 16) % GAMEPAD_MAP_BUTTONS]);
+    }
+    double lookup = bench_now() - start;
+
+    start = bench_now();
+    for (int i = 0; i < n; i++) {
+        random = random * 1103515245 + 12345;
+        int button = buttons[(random >> 16) % GAMEPAD_MAP_BUTTONS], keycode = 0;
+        for (int j = 0; j < GAMEPAD_MAP_BUTTONS; j++) {
+            if (list[j].button == button) keycode = list[j].keycode;
+        }
+        sink += keycode;
+    }
+    double scan = bench_now() - start;
+
+    gamepad_stick_config_t config = {0.05f, 18, 2};
+    float dx, dy;
+    start = bench_now();
+    for (int i = 0; i < n; i++) {
+        gamepad_stick_mouse_delta(&config, (i % 200) / 100.0f - 1, 0.5f, 1 / 120.0, &dx, &dy);
+        sink += (int)dx;
+    }
+    double delta = bench_now() - start;
+
+    printf("lookup %.2f ns, linear scan %.2f ns, mouse delta %.2f ns\n", lookup / n * 1e9, scan / n * 1e9, delta / n * 1e9);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include <math.h>
+
+#include "gamepad_map.h"
+#include "glfw_keycodes.h"
+
+#include "test.h"
+
+static void test_table(void) {
+    gamepad_map_t map;
+    gamepad_map_init(&map);
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_A) == GLFW_KEY_UNKNOWN);
+
+    CHECK(gamepad_map_set(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_A, GLFW_KEY_SPACE));
+    // Negative keycodes are mouse buttons and special actions
+    CHECK(gamepad_map_set(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_RIGHT_TRIGGER, -3));
+    CHECK(gamepad_map_set(&map, GAMEPAD_MODE_MENU, GLFW_GAMEPAD_BUTTON_LEFT_TRIGGER, -GLFW_KEY_LEFT_SHIFT));
+    CHECK(!gamepad_map_set(&map, GAMEPAD_MODE_MENU, 15, 1));
+    CHECK(!gamepad_map_set(&map, GAMEPAD_MODE_MENU, -1, 1));
+    CHECK(!gamepad_map_set(&map, GAMEPAD_MODE_COUNT, 0, 1));
+
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_A) == GLFW_KEY_SPACE);
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_MENU, GLFW_GAMEPAD_BUTTON_A) == GLFW_KEY_UNKNOWN);
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_RIGHT_TRIGGER) == -3);
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_MENU, GLFW_GAMEPAD_BUTTON_LEFT_TRIGGER) == -GLFW_KEY_LEFT_SHIFT);
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_MENU, 99) == GLFW_KEY_UNKNOWN);
+    CHECK(gamepad_map_index(GLFW_GAMEPAD_BUTTON_LEFT_TRIGGER) == 15);
+    CHECK(gamepad_map_index(15) == -1);
+
+    // Later entries win
+    CHECK(gamepad_map_set(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_A, GLFW_KEY_E));
+    CHECK(gamepad_map_lookup(&map, GAMEPAD_MODE_GAME, GLFW_GAMEPAD_BUTTON_A) == GLFW_KEY_E);
+}
+
+static void test_directions(void) {
+    CHECK(gamepad_stick_direction(0, 0, 0.05f) == GAMEPAD_DIRECTION_NONE);
+    CHECK(gamepad_stick_direction(0.03f, 0.02f, 0.05f) == GAMEPAD_DIRECTION_NONE);
+    // Pure horizontal or vertical deflection counts too
+    CHECK(gamepad_stick_direction(1, 0, 0.05f) == 0);
+    CHECK(gamepad_stick_direction(0, 1, 0.05f) == 2);
+    CHECK(gamepad_stick_direction(-1, 0, 0.05f) == 4);
+    CHECK(gamepad_stick_direction(0, -1, 0.05f) == 6);
+    CHECK(gamepad_stick_direction(0.7f, 0.7f, 0.05f) == 1);
+    CHECK(gamepad_stick_direction(0.7f, -0.7f, 0.05f) == 7);
+    CHECK(gamepad_stick_direction(1, -0.01f, 0.05f) == 0);
+
+    CHECK(gamepad_direction_keys(2) == GAMEPAD_KEY_W);
+    CHECK(gamepad_direction_keys(0) == GAMEPAD_KEY_D);
+    CHECK(gamepad_direction_keys(5) == (GAMEPAD_KEY_A | GAMEPAD_KEY_S));
+    CHECK(gamepad_direction_keys(GAMEPAD_DIRECTION_NONE) == 0);
+}
+
+static void test_mouse_delta(void) {
+    gamepad_stick_config_t config = {0, 18, 2};
+    float dx, dy;
+    // Without a deadzone the delta is the old value * min(dist^2, 1) * speed * dt * 60
+    int mismatches = 0;
+    for (int i = -10; i <= 10; i++) {
+        for (int j = -10; j <= 10; j++) {
+            float x = i / 10.0f, y = j / 10.0f, dist = sqrtf(x * x + y * y);
+            bool moved = gamepad_stick_mouse_delta(&config, x, y, 1 / 60.0, &dx, &dy);
+            if (dist == 0) {
+                CHECK(!moved);
+                continue;
+            }
+            if (dist > 1) continue;
+            float scale = dist * dist * 18;
+            if (!moved || fabsf(dx - x * scale) > 1e-3f || fabsf(dy + y * scale) > 1e-3f) mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // The range past the deadzone starts at zero
+    config.deadzone = 0.05f;
+    CHECK(!gamepad_stick_mouse_delta(&config, 0.04f, 0, 1 / 60.0, &dx, &dy) && dx == 0 && dy == 0);
+    CHECK(gamepad_stick_mouse_delta(&config, 0.0501f, 0, 1 / 60.0, &dx, &dy) && dx > 0 && dx < 1e-6f);
+    // Scaled by time
+    CHECK(gamepad_stick_mouse_delta(&config, 1, 0, 1 / 120.0, &dx, &dy) && fabsf(dx - 9) < 1e-4f);
+    CHECK(gamepad_stick_magnitude(0.3f, 0.4f, 0) > 0.499f && gamepad_stick_magnitude(0.3f, 0.4f, 0) < 0.501f);
+}
+
+int main(void) {
+    test_table();
+    test_directions();
+    test_mouse_delta();
+    return TEST_RESULT();
+}
@@ -0,0 +1,146 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "gyro_filter.h"
+
+#include "test.h"
+
+// Synthetic 100 Hz gyro trace, in place of a recording from a device: 15 s
+// with timestamp jitter and sensor noise on top of still phases, sine sweeps
+// on both axes, a 6 rad/s flick and a 300 ms stall in the updates
+#define TRACE_START 1000.0
+#define TRACE_SECONDS 15.0
+#define NOISE_RMS 0.03
+
+static uint32_t randomState = 1;
+
+static double random_uniform(void) {
+    randomState = randomState * 1664525u + 1013904223u;
+    return (randomState >> 8) / 16777216.0;
+}
+
+static double random_normal(void) {
+    double u = random_uniform(), v = random_uniform();
+    return sqrt(-2 * log(u + 1e-12)) * cos(2 * M_PI * v);
+}
+
+// True rates at s seconds into the trace
+static void trace_rate(double s, float rate[2]) {
+    rate[0] = rate[1] = 0;
+    if (s >= 2 && s < 8) {
+        rate[0] = 1.5f * sinf(2 * (float)M_PI * (s - 2) / 3 + (float)M_PI);
+    }
+    if (s >= 3 && s < 9.5) {
+        rate[1] = 0.8f * sinf(2 * (float)M_PI * (s - 3) / 2.5f + (float)M_PI);
+    }
+    if (s >= 10 && s < 10.15) {
+        rate[0] = 6;
+    }
+}
+
+static bool still(double s) {
+    return s < 1.9 || (s > 12 && s < 14);
+}
+
+static void test_trace(void) {
+    gyro_filter_config_t config = {4, 0.5f, 1}, off = {0};
+    gyro_filter_t filter, raw;
+    gyro_filter_init(&filter, &config);
+    gyro_filter_init(&raw, &off);
+
+    double truth = 0, filtered = 0, unfiltered = 0, stillRaw = 0, stillFiltered = 0, previous = 0;
+    int samples = 0, stillSamples = 0;
+    for (double s = 0.01; s < TRACE_SECONDS; s += 0.008 + 0.004 * random_uniform()) {
+        // The stall: no updates at all
+        if (s > 8.95 && s < 9.25) continue;
+        float rate[2], in[2], out[2], rawOut[2];
+        trace_rate(s, rate);
+        for (int i = 0; i < 2; i++) {
+            in[i] = rate[i] + (float)(NOISE_RMS * random_normal());
+        }
+        double time = TRACE_START + s;
+        double dt = gyro_filter_update(&filter, time, in, out);
+        // Filtering off passes the sample through, the interval is the same
+        CHECK(gyro_filter_update(&raw, time, in, rawOut) == dt && rawOut[0] == in[0]);
+        CHECK(dt >= 0 && dt <= 0.05);
+        if (samples > 0) {
+            truth += rate[0] * fmin(time - previous, 0.05);
+        }
+        filtered += out[0] * dt;
+        unfiltered += rawOut[0] * dt;
+        if (still(s)) {
+            stillRaw += in[0] * in[0];
+            stillFiltered += out[0] * out[0];
+            stillSamples++;
+        }
+        previous = time;
+        samples++;
+    }
+    double rawRms = sqrt(stillRaw / stillSamples), filteredRms = sqrt(stillFiltered / stillSamples);
+    printf("%d samples, x integrated: truth %.4f, filtered %.4f, unfiltered %.4f rad\n", samples, truth, filtered, unfiltered);
+    printf("at rest: raw rms %.4f, filtered rms %.4f rad/s\n", rawRms, filteredRms);
+    CHECK(samples > 1400);
+    // Smoothing takes out most of the noise at rest without costing aim. The
+    // deviation is almost all from the flick, whose edges the filter follows
+    // at different speeds
+    CHECK(fabs(filtered - unfiltered) < 0.03);
+    CHECK(filteredRms < rawRms / 2);
+
+    // A reset starts over without an interval
+    gyro_filter_reset(&filter);
+    float in[2] = {1, 2}, out[2];
+    CHECK(gyro_filter_update(&filter, 5, in, out) == 0 && out[0] == 1 && out[1] == 2);
+}
+
+#define PRODUCER_ADDS 2000000
+
+static gyro_accumulator_t racingAccumulator;
+static atomic_int producersDone;
+
+static void *producer(void *arg) {
+    for (int i = 0; i < PRODUCER_ADDS; i++) {
+        gyro_accumulator_add(&racingAccumulator, 0.015625f, -0.03125f);
+    }
+    atomic_fetch_add(&producersDone, 1);
+    return NULL;
+}
+
+static void test_accumulator(void) {
+    gyro_accumulator_t accumulator = {0};
+    float dx, dy;
+    CHECK(!gyro_accumulator_take(&accumulator, &dx, &dy) && dx == 0 && dy == 0);
+    gyro_accumulator_add(&accumulator, 1.5f, -2.25f);
+    // Non-finite deltas are dropped, huge ones saturate
+    gyro_accumulator_add(&accumulator, NAN, 1);
+    gyro_accumulator_add(&accumulator, 1e9f, 0);
+    CHECK(gyro_accumulator_take(&accumulator, &dx, &dy) && dx == 524287.999755859375f && dy == -2.25f);
+    CHECK(!gyro_accumulator_take(&accumulator, &dx, &dy));
+
+    // Three producers racing a consumer lose no movement
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, producer, NULL);
+    }
+    double sumX = 0, sumY = 0;
+    while (atomic_load(&producersDone) < 3) {
+        if (gyro_accumulator_take(&racingAccumulator, &dx, &dy)) {
+            sumX += dx;
+            sumY += dy;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (gyro_accumulator_take(&racingAccumulator, &dx, &dy)) {
+        sumX += dx;
+        sumY += dy;
+    }
+    CHECK(sumX == 0.015625 * 3 * PRODUCER_ADDS && sumY == -0.03125 * 3 * PRODUCER_ADDS);
+}
+
+int main(void) {
+    test_trace();
+    test_accumulator();
+    return TEST_RESULT();
+}
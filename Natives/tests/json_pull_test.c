@@ -0,0 +1,120 @@
+#include <errno.h>
+#include <limits.h>
+
+#include "asset_index.h"
+#include "json_pull.h"
+
+#include "asset_index_fixture.h"
+#include "test.h"
+
+// Copies the first token of json, which must be a string
+static long copy_string(const char *json, char *out, size_t cap) {
+    json_pull_t p;
+    json_pull_init(&p, json, strlen(json));
+    if (json_pull_next(&p) != JSON_TOKEN_STRING) {
+        return -2;
+    }
+    return json_pull_copy_string(&p, out, cap);
+}
+
+static void test_copy_string(void) {
+    char out[64];
+    CHECK(copy_string("\"plain\"", out, sizeof(out)) == 5 && strcmp(out, "plain") == 0);
+    // "a\nb" needs 3 bytes and the terminator, no more
+    CHECK(copy_string("\"a\\nb\"", out, 4) == 3 && strcmp(out, "a\nb") == 0);
+    CHECK(copy_string("\"a\\nb\"", out, 3) == -1);
+    // U+00E9 is 2 bytes of UTF-8
+    CHECK(copy_string("\"x\\u00e9\"", out, 4) == 3 && strcmp(out, "x\xc3\xa9") == 0);
+    CHECK(copy_string("\"x\\u00e9\"", out, 3) == -1);
+    // A surrogate pair is one 4 byte code point
+    CHECK(copy_string("\"\\ud83d\\ude00\"", out, 5) == 4 && strcmp(out, "\xf0\x9f\x98\x80") == 0);
+    CHECK(copy_string("\"\\ud83d\\ude00\"", out, 4) == -1);
+    CHECK(copy_string("\"\\u00g9\"", out, sizeof(out)) == -1);
+}
+
+static void test_tokens(void) {
+    static const char json[] = "{\"a\": [1, true, null, {\"b\": \"c\"}], \"d\": false}";
+    static const json_token_type expected[] = {
+        JSON_TOKEN_OBJECT_START, JSON_TOKEN_KEY, JSON_TOKEN_ARRAY_START, JSON_TOKEN_NUMBER,
+        JSON_TOKEN_TRUE, JSON_TOKEN_NULL, JSON_TOKEN_OBJECT_START, JSON_TOKEN_KEY,
+        JSON_TOKEN_STRING, JSON_TOKEN_OBJECT_END, JSON_TOKEN_ARRAY_END, JSON_TOKEN_KEY,
+        JSON_TOKEN_FALSE, JSON_TOKEN_OBJECT_END, JSON_TOKEN_END
+    };
+    json_pull_t p;
+    json_pull_init(&p, json, sizeof(json) - 1);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); i++) {
+        CHECK(json_pull_next(&p) == expected[i]);
+    }
+
+    // Skipping the array lands on the next key
+    json_pull_init(&p, json, sizeof(json) - 1);
+    json_pull_next(&p);
+    json_pull_next(&p);
+    json_pull_next(&p);
+    CHECK(json_pull_skip(&p));
+    CHECK(json_pull_next(&p) == JSON_TOKEN_KEY && json_pull_token_equals(&p, "d"));
+
+    json_pull_init(&p, "[1, 2", 5);
+    json_pull_next(&p);
+    CHECK(!json_pull_skip(&p));
+}
+
+static void test_parse(void) {
+    static const char json[] =
+        "{\"virtual\": true, \"extra\": {\"x\": [1]}, \"objects\": {"
+        "\"minecraft/lang/n\\u00e9.json\": {\"size\": 12, \"hash\": \"00112233445566778899aabbccddeeff00112233\"},"
+        "\"icons/icon_16x16.png\": {\"hash\": \"bdf48ef6b5d0d23bbb02e17d04865216179f510a\", \"size\": 3665}}}";
+    asset_index_t index;
+    CHECK(asset_index_parse(json, sizeof(json) - 1, &index) == 0);
+    CHECK(index.is_virtual && !index.map_to_resources);
+    CHECK(index.count == 2);
+    if (index.count == 2) {
+        char hex[41];
+        CHECK(strcmp(asset_object_name(&index, &index.objects[0]), "minecraft/lang/n\xc3\xa9.json") == 0);
+        CHECK(index.objects[0].size == 12);
+        asset_object_hash_hex(&index.objects[1], hex);
+        CHECK(strcmp(hex, "bdf48ef6b5d0d23bbb02e17d04865216179f510a") == 0);
+        CHECK(index.objects[1].size == 3665);
+    }
+    asset_index_free(&index);
+
+    // Objects without a hash, or with a short one, reject the whole index
+    static const char noHash[] = "{\"objects\": {\"a\": {\"size\": 1}}}";
+    static const char shortHash[] = "{\"objects\": {\"a\": {\"hash\": \"0011\", \"size\": 1}}}";
+    CHECK(asset_index_parse(noHash, sizeof(noHash) - 1, &index) == EINVAL);
+    CHECK(asset_index_parse(shortHash, sizeof(shortHash) - 1, &index) == EINVAL);
+    CHECK(index.objects == NULL && index.count == 0);
+}
+
+static void test_load(void) {
+    char dir[PATH_MAX], path[PATH_MAX + 32];
+    test_make_tmpdir(dir, sizeof(dir));
+    asset_index_t index;
+
+    snprintf(path, sizeof(path), "%s/missing.json", dir);
+    CHECK(asset_index_load(path, &index) == ENOENT);
+
+    snprintf(path, sizeof(path), "%s/empty.json", dir);
+    test_write_file(path, "", 0);
+    CHECK(asset_index_load(path, &index) == EINVAL);
+
+    snprintf(path, sizeof(path), "%s/index.json", dir);
+    CHECK(asset_index_fixture_write(path) == 0);
+    CHECK(asset_index_load(path, &index) == 0);
+    CHECK(index.count == 3901);
+    size_t escaped = 0;
+    for (size_t i = 0; i < index.count; i++) {
+        escaped += strstr(asset_object_name(&index, &index.objects[i]), "/n\xc3\xa9") != NULL;
+    }
+    CHECK(escaped == 41);
+    asset_index_free(&index);
+    test_remove_tree(dir);
+}
+
+int main(void) {
+    test_copy_string();
+    test_tokens();
+    test_parse();
+    test_load();
+    return TEST_RESULT();
+}
@@ -0,0 +1,126 @@
+#include <errno.h>
+
+#include "jvm_tuning.h"
+
+#include "test.h"
+
+// A JDK 11 session that ran out of heap once
+static const char gc_log[] =
+    "[0.012s][info][gc] Using G1\n"
+    "[1.234s][info][gc] GC(0) Pause Young (Normal) (G1 Evacuation Pause) 23M->5M(256M) 3.456ms\n"
+    "[2.5s][info][gc] GC(1) Pause Young (Concurrent Start) (Metadata GC Threshold) 120M->60M(256M) 12.1ms\n"
+    "[2.6s][info][gc] GC(1) Concurrent Mark Cycle 50.123ms\n"
+    "[2.7s][info][gc] GC(1) Pause Remark 100M->98M(256M) 1.2ms\n"
+    "[2.8s][info][gc] GC(1) Pause Cleanup 98M->98M(256M) 0.1ms\n"
+    "[3.0s][info][gc] GC(2) Pause Young (Normal) (G1 Evacuation Pause) 200M->150M(512M) 20.5ms\n"
+    "[3.1s][info][gc] GC(3) Pause Young (Normal) (G1 Evacuation Pause) 300M->180M(512M) 22ms\n"
+    "[3.2s][info][gc] GC(4) Pause Young (Normal) (G1 Evacuation Pause) 300M->190M(512M) 25ms\n"
+    "[3.3s][info][gc] GC(5) Pause Young (Normal) (G1 Evacuation Pause) 300M->200K(1G) 30ms\n"
+    "[4.0s][info][gc] GC(6) Pause Full (System.gc()) 400M->350M(1G) 140.5ms\n";
+
+// A JDK 17 session with gc+metaspace lines, peaking at 187000K of metaspace
+static const char gc17_log[] =
+    "[0.012s][info][gc] Using G1\n"
+    "[1.500s][info][gc,metaspace] GC(0) Metaspace: 21059K(21248K)->21059K(21248K) NonClass: 18667K(18752K)->18667K(18752K) Class: 2391K(2496K)->2391K(2496K)\n"
+    "[1.500s][info][gc] GC(0) Pause Young (Normal) (G1 Evacuation Pause) 24M->8M(256M) 3.456ms\n"
+    "[5.000s][info][gc,metaspace] GC(1) Metaspace: 187000K(190000K)->187000K(190000K) NonClass: 1K(1K)->1K(1K) Class: 1K(1K)->1K(1K)\n"
+    "[5.000s][info][gc] GC(1) Pause Young (Normal) (G1 Evacuation Pause) 300M->120M(512M) 12.0ms\n"
+    "[6.000s][info][gc] GC(2) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n"
+    "[7.000s][info][gc] GC(3) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n"
+    "[8.000s][info][gc] GC(4) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n"
+    "[9.000s][info][gc] GC(5) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n"
+    "[10.000s][info][gc] GC(6) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n"
+    "[11.000s][info][gc] GC(7) Pause Young (Normal) (G1 Evacuation Pause) 300M->130M(512M) 11.0ms\n";
+
+static void parse(const char *dir, const char *name, const char *log, jvm_gc_stats_t *stats) {
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    test_write_file(path, log, strlen(log));
+    CHECK(jvm_gc_log_parse(path, stats) == 0);
+}
+
+static void test_parse(const char *dir) {
+    jvm_gc_stats_t stats;
+    parse(dir, "gc.log", gc_log, &stats);
+    // Concurrent phases aren't pauses
+    CHECK(stats.pauses == 9 && stats.full_pauses == 1);
+    CHECK(stats.total_pause_ms > 254.85 && stats.total_pause_ms < 254.87);
+    CHECK(stats.max_pause_ms == 140.5 && stats.p95_pause_ms == 140.5);
+    CHECK(stats.max_after_mb == 350 && stats.max_committed_mb == 1024);
+    CHECK(stats.uptime_s == 4.0 && stats.max_metaspace_mb == 0);
+
+    parse(dir, "gc17.log", gc17_log, &stats);
+    CHECK(stats.pauses == 8 && stats.full_pauses == 0);
+    CHECK(stats.max_metaspace_mb == 182);
+    // p95 is the upper bound of its 1 ms bucket
+    CHECK(stats.p95_pause_ms == 12.0 && stats.max_pause_ms == 12.0);
+
+    // JDK 11 logs metaspace without the committed size before the arrow
+    memset(&stats, 0, sizeof(stats));
+    CHECK(!jvm_gc_log_parse_line("[12.000s][info][gc,metaspace] GC(8) Metaspace: 6494K->6494K(1056768K)\n", &stats, NULL));
+    CHECK(stats.max_metaspace_mb == 6 && stats.uptime_s == 12.0);
+    // Malformed pauses are skipped
+    CHECK(!jvm_gc_log_parse_line("[1.0s][info][gc] GC(0) Pause Young 23M->5M 3ms\n", &stats, NULL));
+    CHECK(!jvm_gc_log_parse_line("[1.0s][info][gc] GC(0) Pause Young 23M->5M(256M) 3\n", &stats, NULL));
+    CHECK(stats.pauses == 0);
+
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/missing.log", dir);
+    CHECK(jvm_gc_log_parse(path, &stats) == ENOENT);
+}
+
+static void test_decide(const char *dir) {
+    jvm_tuning_input_t input = {
+        .physical_mb = 6144, .max_heap_mb = 1536, .cores = 6, .java_version = 17, .mod_count = 40
+    };
+    jvm_tuning_profile_t profile;
+    jvm_tuning_decide(&input, &profile);
+    // The baseline is above the device limit
+    CHECK(profile.heap_mb == 1536 && profile.initial_heap_mb == 128);
+    CHECK(profile.gc == JVM_GC_G1 && profile.parallel_gc_threads == 5 && profile.conc_gc_threads == 1);
+    CHECK(profile.thread_stack_kb == 0 && profile.reserved_code_cache_mb == 128);
+    CHECK(profile.max_metaspace_mb == 0);
+
+    // After a full GC, starting from the live set
+    parse(dir, "gc.log", gc_log, &input.last);
+    input.last_heap_mb = 1536;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.heap_mb == 1536 && profile.initial_heap_mb == 350);
+
+    // Shrinks halfway toward three times the live set: (1536 + 390) / 2, rounded to 64
+    parse(dir, "gc17.log", gc17_log, &input.last);
+    input.max_heap_mb = 0;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.heap_mb == 960);
+
+    // Metaspace is only bounded with history on devices with 4 GB or less
+    input.physical_mb = 4096;
+    input.mod_count = 120;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.max_metaspace_mb == 320);
+    CHECK(profile.thread_stack_kb == 2048 && profile.reserved_code_cache_mb == 192);
+    input.physical_mb = 8192;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.max_metaspace_mb == 0);
+    input.physical_mb = 4096;
+    input.last.max_metaspace_mb = 60;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.max_metaspace_mb == 192);
+    input.last_heap_mb = 0;
+    jvm_tuning_decide(&input, &profile);
+    CHECK(profile.max_metaspace_mb == 0);
+
+    // Single core or small heap
+    jvm_tuning_input_t small = {.physical_mb = 2048, .max_heap_mb = 512, .cores = 1, .java_version = 8};
+    jvm_tuning_decide(&small, &profile);
+    CHECK(profile.heap_mb == 512 && profile.gc == JVM_GC_SERIAL && profile.parallel_gc_threads == 0);
+}
+
+int main(void) {
+    char dir[PATH_MAX];
+    test_make_tmpdir(dir, sizeof(dir));
+    test_parse(dir);
+    test_decide(dir);
+    test_remove_tree(dir);
+    return TEST_RESULT();
+}
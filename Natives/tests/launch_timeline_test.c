@@ -0,0 +1,107 @@
+#include <pthread.h>
+
+#include "json_pull.h"
+#include "launch_timeline.h"
+
+#include "test.h"
+
+typedef struct {
+    char name[64];
+    char ph[4];
+    double ts, dur;
+    unsigned long long tid;
+} trace_event_t;
+
+static void *other_thread(void *arg) {
+    // Ends a phase begun on the main thread, and times one of its own
+    launch_timeline_end("cross \"thread\"\n");
+    launch_timeline_begin("inner");
+    usleep(1000);
+    launch_timeline_end("inner");
+    return NULL;
+}
+
+// Reads back the traceEvents of the written file
+static size_t read_trace(const char *path, trace_event_t *events, size_t cap) {
+    FILE *f = fopen(path, "rb");
+    static char buf[1 << 20];
+    size_t len = f ? fread(buf, 1, sizeof(buf), f) : 0;
+    if (f) fclose(f);
+
+    json_pull_t p;
+    json_pull_init(&p, buf, len);
+    size_t count = 0;
+    CHECK(json_pull_next(&p) == JSON_TOKEN_OBJECT_START);
+    while (json_pull_next(&p) == JSON_TOKEN_KEY) {
+        if (!json_pull_token_equals(&p, "traceEvents")) {
+            json_pull_next(&p);
+            json_pull_skip(&p);
+            continue;
+        }
+        CHECK(json_pull_next(&p) == JSON_TOKEN_ARRAY_START);
+        while (json_pull_next(&p) == JSON_TOKEN_OBJECT_START && count < cap) {
+            trace_event_t *event = &events[count++];
+            memset(event, 0, sizeof(*event));
+            event->dur = -1;
+            while (json_pull_next(&p) == JSON_TOKEN_KEY) {
+                char key[16];
+                json_pull_copy_string(&p, key, sizeof(key));
+                json_token_type type = json_pull_next(&p);
+                if (strcmp(key, "name") == 0) {
+                    json_pull_copy_string(&p, event->name, sizeof(event->name));
+                } else if (strcmp(key, "ph") == 0) {
+                    json_pull_copy_string(&p, event->ph, sizeof(event->ph));
+                } else if (type == JSON_TOKEN_NUMBER) {
+                    double value = strtod(p.value, NULL);
+                    if (strcmp(key, "ts") == 0) event->ts = value;
+                    if (strcmp(key, "dur") == 0) event->dur = value;
+                    if (strcmp(key, "tid") == 0) event->tid = strtoull(p.value, NULL, 10);
+                }
+            }
+        }
+    }
+    // The whole file has to be valid JSON
+    CHECK(p.type == JSON_TOKEN_OBJECT_END && json_pull_next(&p) == JSON_TOKEN_END);
+    return count;
+}
+
+int main(void) {
+    char dir[PATH_MAX], path[PATH_MAX + 16];
+    test_make_tmpdir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/timeline.json", dir);
+
+    launch_timeline_mark("start");
+    launch_timeline_begin("cross \"thread\"\n");
+    usleep(2000);
+    pthread_t thread;
+    pthread_create(&thread, NULL, other_thread, NULL);
+    pthread_join(thread, NULL);
+    launch_timeline_begin("never ended");
+    // Past the 512 event buffer, the rest is dropped
+    for (int i = 0; i < 600; i++) {
+        launch_timeline_mark("filler");
+    }
+    CHECK(launch_timeline_write(path));
+    CHECK(!launch_timeline_write(path));
+    launch_timeline_mark("after write");
+
+    static trace_event_t events[1024];
+    size_t count = read_trace(path, events, 1024);
+    // 6 slots for the phases above, of which the 2 ends merge into their begins
+    CHECK(count == 4 + 506);
+    if (count >= 4) {
+        CHECK(strcmp(events[0].name, "start") == 0 && strcmp(events[0].ph, "i") == 0 && events[0].ts == 0);
+        CHECK(strcmp(events[1].name, "cross \"thread\"\n") == 0 && strcmp(events[1].ph, "X") == 0);
+        CHECK(events[1].dur >= 2000);
+        CHECK(strcmp(events[2].name, "inner") == 0 && strcmp(events[2].ph, "X") == 0);
+        CHECK(events[2].dur >= 1000 && events[2].ts >= events[1].ts);
+        // The complete event stays on the thread that began it
+        CHECK(events[1].tid == events[0].tid && events[2].tid != events[1].tid);
+        CHECK(strcmp(events[3].name, "never ended") == 0 && strcmp(events[3].ph, "i") == 0);
+    }
+    for (size_t i = 4; i < count; i++) {
+        CHECK(strcmp(events[i].name, "filler") == 0);
+    }
+    test_remove_tree(dir);
+    return TEST_RESULT();
+}
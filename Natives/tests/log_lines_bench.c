@@ -0,0 +1,55 @@
+#include "log_lines.h"
+
+#include "bench.h"
+#include "test.h"
+
+// Store and filter of the log console at their app sizes, fed 64 KiB chunks
+// of typical game output like the log reader does
+int main(void) {
+    log_lines_t store;
+    log_lines_init(&store, 10000, 2 * 1024 * 1024);
+    char *chunk = malloc(64 * 1024);
+    size_t len = 0;
+    int lines = 0;
+    while (len < 64 * 1024 - 200) {
+        len += sprintf(chunk + len, "[12:34:56] [Render thread/INFO]: Loaded texture minecraft:block/stone_%d.png into atlas\n", lines++);
+    }
+
+    double start = bench_now();
+    for (int i = 0; i < 2000; i++) {
+        log_lines_append(&store, chunk, len);
+    }
+    double elapsed = bench_now() - start;
+    printf("append: %.0f MB/s, %.1f M lines/s\n", len * 2000 / 1e6 / elapsed, lines * 2000 / 1e6 / elapsed);
+
+    // Rescans the full store, as if the search text changed each time
+    size_t scanned = 0, n;
+    log_filter_t filter;
+    start = bench_now();
+    for (int i = 0; i < 50; i++) {
+        log_filter_init(&filter, "STONE_42", 10000);
+        while ((n = log_filter_update(&filter, &store, 256)) > 0) {
+            scanned += n;
+        }
+        if (i < 49) log_filter_free(&filter);
+    }
+    elapsed = bench_now() - start;
+    uint64_t first, next;
+    log_filter_range(&filter, &first, &next);
+    printf("filter: %.1f M lines/s, %llu matches\n", scanned / 1e6 / elapsed, (unsigned long long)(next - first));
+    log_filter_free(&filter);
+
+    // Row fetches near the end, as the table does while following the log
+    char buf[LOG_LINES_MAX_LINE];
+    start = bench_now();
+    for (int i = 0; i < 1000000; i++) {
+        log_lines_range(&store, &first, &next);
+        log_lines_get(&store, next - 1 - (i % 40), buf, sizeof(buf));
+    }
+    elapsed = bench_now() - start;
+    printf("get: %.0f ns\n", elapsed * 1e3);
+
+    log_lines_free(&store);
+    free(chunk);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include "log_lines.h"
+
+#include "test.h"
+
+static bool line_equals(log_lines_t *store, uint64_t id, const char *expected) {
+    char buf[LOG_LINES_MAX_LINE + 1];
+    return log_lines_get(store, id, buf, sizeof(buf)) && strcmp(buf, expected) == 0;
+}
+
+static void test_partial_lines(void) {
+    log_lines_t store;
+    CHECK(log_lines_init(&store, 8, 4096 * 2) == 0);
+    uint64_t first, next;
+
+    // An unterminated line is shown, then completed by the next chunk
+    log_lines_append(&store, "hello\nwor", 9);
+    uint64_t version = log_lines_range(&store, &first, &next);
+    CHECK(first == 0 && next == 2);
+    CHECK(line_equals(&store, 0, "hello") && line_equals(&store, 1, "wor"));
+    log_lines_append(&store, "ld\r\n\nx\r\n", 8);
+    CHECK(log_lines_range(&store, &first, &next) > version);
+    // CRLF is stripped and blank lines take no row
+    CHECK(first == 0 && next == 3);
+    CHECK(line_equals(&store, 1, "world") && line_equals(&store, 2, "x"));
+    // A CR split from its LF by a chunk boundary
+    log_lines_append(&store, "y\r", 2);
+    log_lines_append(&store, "\n", 1);
+    CHECK(line_equals(&store, 3, "y"));
+
+    char buf[8];
+    CHECK(!log_lines_get(&store, 4, buf, sizeof(buf)) && buf[0] == '\0');
+    // Copies are cut to the buffer
+    CHECK(log_lines_get(&store, 1, buf, 4) && strcmp(buf, "wor") == 0);
+
+    // The ring keeps the newest 8 lines
+    for (int i = 0; i < 20; i++) {
+        char line[32];
+        int len = snprintf(line, sizeof(line), "line %d\n", i);
+        log_lines_append(&store, line, len);
+    }
+    log_lines_range(&store, &first, &next);
+    CHECK(first == 16 && next == 24);
+    CHECK(!log_lines_get(&store, 15, buf, sizeof(buf)));
+    CHECK(line_equals(&store, 16, "line 12") && line_equals(&store, 23, "line 19"));
+
+    log_lines_clear(&store);
+    log_lines_range(&store, &first, &next);
+    CHECK(first == 24 && next == 24);
+    log_lines_free(&store);
+}
+
+static void test_long_lines(void) {
+    log_lines_t store;
+    CHECK(log_lines_init(&store, 100, LOG_LINES_MAX_LINE * 2) == 0);
+    uint64_t first, next;
+    for (int i = 0; i < 5; i++) {
+        log_lines_append(&store, "short\n", 6);
+    }
+
+    // Cut below the limit without splitting the two byte "é"
+    char big[5000];
+    memset(big, 'a', sizeof(big));
+    memcpy(big + LOG_LINES_MAX_LINE - 1, "\xc3\xa9", 2);
+    big[sizeof(big) - 1] = '\n';
+    log_lines_append(&store, big, sizeof(big));
+    char buf[LOG_LINES_MAX_LINE + 1];
+    log_lines_range(&store, &first, &next);
+    CHECK(log_lines_get(&store, next - 1, buf, sizeof(buf)) && strlen(buf) == LOG_LINES_MAX_LINE - 1);
+
+    // Each long line evicts whatever its bytes overwrite in the small arena
+    log_lines_append(&store, big, sizeof(big));
+    log_lines_append(&store, big, sizeof(big));
+    log_lines_range(&store, &first, &next);
+    CHECK(next == 8 && first > 0);
+    for (uint64_t id = first; id < next; id++) {
+        CHECK(log_lines_get(&store, id, buf, sizeof(buf)));
+    }
+
+    // The same cut applies to a line assembled from several chunks
+    log_lines_append(&store, "b", 1);
+    for (int i = 0; i < 3; i++) {
+        log_lines_append(&store, big, sizeof(big) - 1);
+    }
+    log_lines_append(&store, "\n", 1);
+    log_lines_range(&store, &first, &next);
+    CHECK(log_lines_get(&store, next - 1, buf, sizeof(buf)));
+    CHECK(buf[0] == 'b' && strlen(buf) == LOG_LINES_MAX_LINE);
+    log_lines_free(&store);
+}
+
+static void test_filter(void) {
+    log_lines_t store;
+    CHECK(log_lines_init(&store, 16, 4096 * 2) == 0);
+    log_filter_t filter;
+    CHECK(log_filter_init(&filter, "StOnE", 4) == 0);
+    uint64_t first, next, id;
+
+    log_lines_append(&store, "loaded stone\nloaded dirt\nSTONE again\npartial stone", 50);
+    // The incomplete last line isn't scanned until it is committed
+    CHECK(log_filter_update(&filter, &store, 256) == 3);
+    CHECK(log_filter_update(&filter, &store, 256) == 0);
+    log_filter_range(&filter, &first, &next);
+    CHECK(first == 0 && next == 2);
+    CHECK(log_filter_get(&filter, 0, &id) && id == 0);
+    CHECK(log_filter_get(&filter, 1, &id) && id == 2);
+    CHECK(!log_filter_get(&filter, 2, &id));
+
+    // Only new lines are scanned, in steps of max_lines
+    log_lines_append(&store, "\nstone 1\nstone 2\nstone 3\n", 25);
+    CHECK(log_filter_update(&filter, &store, 2) == 2);
+    CHECK(log_filter_update(&filter, &store, 2) == 2);
+    // The match ring keeps the newest 4
+    log_filter_range(&filter, &first, &next);
+    CHECK(first == 2 && next == 6);
+    CHECK(log_filter_get(&filter, 5, &id) && id == 6);
+
+    // Matches of evicted lines are dropped, the scan resumes at the oldest live line
+    for (int i = 0; i < 20; i++) {
+        log_lines_append(&store, "dirt\n", 5);
+    }
+    CHECK(log_filter_update(&filter, &store, 256) == 16);
+    log_filter_range(&filter, &first, &next);
+    CHECK(first == next);
+    log_filter_free(&filter);
+
+    // An empty needle matches everything
+    CHECK(log_filter_init(&filter, "", 32) == 0);
+    CHECK(log_filter_update(&filter, &store, 256) == 16);
+    log_filter_range(&filter, &first, &next);
+    CHECK(next - first == 16);
+    log_filter_free(&filter);
+    log_lines_free(&store);
+}
+
+int main(void) {
+    test_partial_lines();
+    test_long_lines();
+    test_filter();
+    return TEST_RESULT();
+}
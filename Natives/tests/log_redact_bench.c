@@ -0,0 +1,46 @@
+#include "log_redact.h"
+
+#include "bench.h"
+#include "test.h"
+
+// Redacts 256 MB of Minecraft-style log in 64 KiB chunks, the log reader's
+// read size, with the app's session, token and username patterns
+int main(void) {
+    const log_redact_pattern_t patterns[] = {
+        {"(Session ID is ", "<censored>", ")\n"},
+        {"--accessToken ", "<censored>", " \n"},
+        {"--accessToken, ", "<censored>", ", ]\n"},
+        {"\"accessToken\":\"", "<censored>", "\""},
+        {"Setting user: ", "<username>", "\n"},
+        {"Steve123", "<username>", NULL, true},
+    };
+    const char *lines[] = {
+        "[12:34:56] [Render thread/INFO]: Loaded 1234 recipes\n",
+        "[12:34:56] [Worker-Main-3/WARN]: Missing texture minecraft:block/foo for model bar\n",
+        "[12:34:57] [Server thread/INFO]: Steve123 joined the game from /192.168.0.12:51234\n",
+        "\tat net.minecraft.client.Minecraft.run(Minecraft.java:1234) ~[client-1.20.1.jar:?]\n"
+    };
+    size_t size = 256 << 20, len = 0;
+    char *log = malloc(size);
+    for (int i = 0; len + 200 < size; i++) {
+        size_t lineLen = strlen(lines[i % 4]);
+        memcpy(log + len, lines[i % 4], lineLen);
+        len += lineLen;
+    }
+
+    log_redactor_t *redactor = log_redactor_create(patterns, sizeof(patterns) / sizeof(patterns[0]), true);
+    char *out = malloc(log_redactor_max_output(redactor, 64 * 1024));
+    size_t written = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < len; i += 64 * 1024) {
+        size_t n = len - i < 64 * 1024 ? len - i : 64 * 1024;
+        written += log_redactor_process(redactor, log + i, n, out);
+    }
+    double elapsed = bench_now() - start;
+    printf("log_redactor_process: %zu MB in %.3f s, %.0f MB/s, %zu bytes out\n",
+        len >> 20, elapsed, len / 1e6 / elapsed, written);
+    log_redactor_free(redactor);
+    free(out);
+    free(log);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+#include "log_redact.h"
+
+#include "test.h"
+
+static const log_redact_pattern_t patterns[] = {
+    {"(Session ID is ", "<censored>", ")\n"},
+    {"--accessToken ", "<censored>", " \n"},
+    {"--accessToken, ", "<censored>", ", ]\n"},
+    {"\"accessToken\":\"", "<censored>", "\""},
+    {"Setting user: ", "<username>", "\n"},
+    {"Steve123", "<username>", NULL, true},
+    {"eve", "<username>", NULL, true},
+    {"mod", "<username>", NULL, true},
+};
+
+static const char sample[] =
+    "[main] Setting user: Steve123\n"
+    "(Session ID is token:abcdef:ghij) ok\n"
+    "args --accessToken xyz.abc --uuid 1\n"
+    "[--username, Steve123, --accessToken, ABCDEF, --x]\n"
+    "{\"accessToken\":\"eyJhb\",\"a\":1}\n"
+    "Connecting to 192.168.1.20:25565 and 10.0.0.1. version 1.20.1.2 v1.2.3.4 999.1.1.1 1.2.3.4x 255.255.255.255\n"
+    "Steve123 joined; Steven left; eve left; (eve) mod modded mods xmod mod\n"
+    "Steve123x Steve1234 _Steve123 Steve123_\n"
+    "Steve123";
+
+// A name at the end of the stream is only decided by the final line break
+static const char expected[] =
+    "[main] Setting user: <username>\n"
+    "(Session ID is <censored>) ok\n"
+    "args --accessToken <censored> --uuid 1\n"
+    "[--username, <username>, --accessToken, <censored>, --x]\n"
+    "{\"accessToken\":\"<censored>\",\"a\":1}\n"
+    "Connecting to <ip>:25565 and <ip>. version <ip> v1.2.3.4 999.1.1.1 1.2.3.4x <ip>\n"
+    "<username> joined; Steven left; <username> left; (<username>) <username> modded mods xmod <username>\n"
+    "Steve123x Steve1234 _Steve123 Steve123_\n"
+    "<username>\n";
+
+// Redacts sample in chunks of step bytes, then a final line break
+static size_t redact(size_t step, char *out) {
+    log_redactor_t *redactor = log_redactor_create(patterns, sizeof(patterns) / sizeof(patterns[0]), true);
+    CHECK(redactor != NULL);
+    size_t len = strlen(sample), written = 0;
+    char *chunk = malloc(log_redactor_max_output(redactor, step));
+    for (size_t i = 0; i < len; i += step) {
+        size_t n = len - i < step ? len - i : step;
+        size_t chunkLen = log_redactor_process(redactor, sample + i, n, chunk);
+        CHECK(chunkLen <= log_redactor_max_output(redactor, n));
+        memcpy(out + written, chunk, chunkLen);
+        written += chunkLen;
+    }
+    written += log_redactor_process(redactor, "\n", 1, out + written);
+    CHECK(log_redactor_idle(redactor));
+    free(chunk);
+    log_redactor_free(redactor);
+    return written;
+}
+
+static void test_splits(void) {
+    static char out[4096];
+    size_t len = redact(strlen(sample), out);
+    CHECK(len == strlen(expected) && memcmp(out, expected, len) == 0);
+    if (len != strlen(expected) || memcmp(out, expected, len) != 0) {
+        fwrite(out, 1, len, stderr);
+    }
+    // Identical however the stream is split
+    for (size_t step = 1; step < strlen(sample); step++) {
+        size_t splitLen = redact(step, out);
+        if (splitLen != strlen(expected) || memcmp(out, expected, splitLen) != 0) {
+            fprintf(stderr, "output differs when split every %zu bytes\n", step);
+            test_failures++;
+        }
+    }
+}
+
+static void test_values(void) {
+    const log_redact_pattern_t valuePatterns[] = {
+        {"Setting user: ", "<username>", ""},
+        {"Bearer ", "<censored>", " \""},
+        {"access_token=", "<censored>", "& "},
+    };
+    log_redactor_t *redactor = log_redactor_create(valuePatterns, 3, true);
+    const char *in =
+        "[12:00] Setting user: Alex\n"
+        "GET /x?access_token=abc&y=1 Authorization: Bearer eyJ.x\n"
+        "ping 1.1.1.1\n";
+    const char *out =
+        "[12:00] Setting user: <username>\n"
+        "GET /x?access_token=<censored>&y=1 Authorization: Bearer <censored>\n"
+        "ping <ip>\n";
+    char buf[256];
+    size_t len = log_redactor_process(redactor, in, strlen(in), buf);
+    CHECK(len == strlen(out) && memcmp(buf, out, len) == 0);
+    CHECK(log_redactor_idle(redactor));
+
+    // Held back mid-line, released by the line break
+    len = log_redactor_process(redactor, "token Bearer abc", 16, buf);
+    CHECK(!log_redactor_idle(redactor));
+    len += log_redactor_process(redactor, "def\n", 4, buf + len);
+    CHECK(len == 24 && memcmp(buf, "token Bearer <censored>\n", len) == 0);
+    log_redactor_free(redactor);
+
+    // Without the IPv4 matcher addresses pass through
+    redactor = log_redactor_create(valuePatterns, 3, false);
+    len = log_redactor_process(redactor, "ping 1.1.1.1\n", 13, buf);
+    CHECK(len == 13 && memcmp(buf, "ping 1.1.1.1\n", len) == 0);
+    log_redactor_free(redactor);
+}
+
+int main(void) {
+    test_splits();
+    test_values();
+    return TEST_RESULT();
+}
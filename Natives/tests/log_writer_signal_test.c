@@ -0,0 +1,58 @@
+#include <pthread.h>
+
+#include "log_writer.h"
+
+#include "test.h"
+
+#define LINES 400000
+
+static int writeFd;
+
+static void *producer(void *arg) {
+    char line[128];
+    for (int i = 0; i < LINES; i++) {
+        int n = snprintf(line, sizeof(line), "line %07d padding padding padding padding\n", i);
+        if (write(writeFd, line, n) != n) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return NULL;
+}
+
+// Separate from log_writer_test, since a signal sync stops the writer for good
+int main(void) {
+    char dir[PATH_MAX], path[PATH_MAX + 16];
+    test_make_tmpdir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/latestlog.txt", dir);
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    writeFd = fds[1];
+    // Small batches, so the sync lands while one is being written
+    log_writer_options_t options = {.flush_bytes = 4096};
+    CHECK(log_writer_start(fds[0], path, &options) == 0);
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, NULL);
+    pthread_join(thread, NULL);
+    log_writer_sync_from_signal();
+
+    // Every line exactly once and in order
+    FILE *f = fopen(path, "r");
+    CHECK(f != NULL);
+    int expected = 0, wrong = 0;
+    char line[128];
+    while (f && fgets(line, sizeof(line), f)) {
+        int n = atoi(line + 5);
+        if (n != expected && wrong++ < 5) {
+            fprintf(stderr, "line %d, expected %d\n", n, expected);
+        }
+        expected = n + 1;
+    }
+    if (f) fclose(f);
+    CHECK(wrong == 0 && expected == LINES);
+
+    close(writeFd);
+    test_remove_tree(dir);
+    return TEST_RESULT();
+}
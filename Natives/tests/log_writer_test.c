@@ -0,0 +1,159 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "log_writer.h"
+
+#include "test.h"
+
+// 8 threads of 200k lines of about 75 bytes rotate the 16 MiB file 6 times
+#define THREADS 8
+#define LINES 200000
+#define ROTATE_SIZE (16 * 1024 * 1024)
+
+static int writeFd;
+
+static void *producer(void *arg) {
+    long id = (long)arg;
+    char line[128];
+    for (int i = 0; i < LINES; i++) {
+        // Shorter than PIPE_BUF, so lines of different threads never interleave
+        int n = snprintf(line, sizeof(line), "[thread %ld] line %d ###### padding padding padding padding padding\n", id, i);
+        if (write(writeFd, line, n) != n) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return NULL;
+}
+
+// Rewrites in place, byte by byte so chunk boundaries don't matter
+static const char *censor(char *buf, size_t *len, void *ctx) {
+    for (size_t i = 0; i < *len; i++) {
+        if (buf[i] == '#') buf[i] = '*';
+    }
+    atomic_fetch_add((_Atomic size_t *)ctx, 1);
+    return buf;
+}
+
+static bool exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// Feeds one segment, compressed or not, through the per-thread order check.
+// Rotation splits at batch boundaries, so a line may continue in the next
+// segment: an unterminated last line is kept in partial
+static void check_lines(const char *path, char *partial, int *next, bool *censored) {
+    gzFile in = gzopen(path, "rb");
+    CHECK(in != NULL);
+    if (!in) return;
+    char line[256];
+    size_t len = strlen(partial);
+    while (gzgets(in, partial + len, 256 - len)) {
+        len = strlen(partial);
+        if (partial[len - 1] != '\n' && len < sizeof(line) - 1) continue;
+        memcpy(line, partial, len + 1);
+        partial[0] = '\0';
+        len = 0;
+
+        long id;
+        int n;
+        if (sscanf(line, "[thread %ld] line %d", &id, &n) != 2 || id < 0 || id >= THREADS) {
+            fprintf(stderr, "%s: malformed line %s", path, line);
+            test_failures++;
+            continue;
+        }
+        // Lost, duplicated or reordered lines show up as a gap
+        if (n != next[id]) {
+            fprintf(stderr, "%s: thread %ld line %d, expected %d\n", path, id, n, next[id]);
+            test_failures++;
+        }
+        next[id] = n + 1;
+        if (strchr(line, '#')) *censored = false;
+    }
+    gzclose(in);
+}
+
+static void test_segment_path(void) {
+    char buf[PATH_MAX];
+    log_writer_segment_path("/a/latestlog.txt", 3, buf, sizeof(buf));
+    CHECK(strcmp(buf, "/a/latestlog.3.txt") == 0);
+    log_writer_segment_path("/a.d/log", 1, buf, sizeof(buf));
+    CHECK(strcmp(buf, "/a.d/log.1") == 0);
+    log_writer_segment_path("/a/.log", 2, buf, sizeof(buf));
+    CHECK(strcmp(buf, "/a/.log.2") == 0);
+}
+
+int main(void) {
+    test_segment_path();
+
+    char dir[PATH_MAX], path[PATH_MAX + 16];
+    test_make_tmpdir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/latestlog.txt", dir);
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    writeFd = fds[1];
+    _Atomic size_t chunks = 0;
+    log_writer_options_t options = {
+        .rotate_size = ROTATE_SIZE,
+        .keep_rotated = 100,
+        .on_read = censor,
+        .ctx = &chunks
+    };
+    CHECK(log_writer_start(fds[0], path, &options) == 0);
+    CHECK(log_writer_start(fds[0], path, &options) == EBUSY);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[THREADS];
+    for (long i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void *)i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    log_writer_sync();
+    printf("%d lines in %.2f s, %zu chunks read\n", THREADS * LINES,
+        end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9, (size_t)chunks);
+
+    // Segments are compressed in the background, wait until none is left plain
+    char segment[PATH_MAX + 32], compressed[PATH_MAX + 40];
+    int segments = 0;
+    for (int n = 1;; n++) {
+        log_writer_segment_path(path, n, segment, sizeof(segment));
+        snprintf(compressed, sizeof(compressed), "%s.gz", segment);
+        for (int i = 0; i < 30000 && exists(segment); i++) {
+            usleep(1000);
+        }
+        if (!exists(compressed)) break;
+        CHECK(!exists(segment));
+        segments = n;
+    }
+    printf("%d rotated segments\n", segments);
+    CHECK(segments >= 6);
+
+    int next[THREADS] = {0};
+    bool censored = true;
+    char partial[256] = "";
+    for (int n = 1; n <= segments; n++) {
+        log_writer_segment_path(path, n, segment, sizeof(segment));
+        snprintf(compressed, sizeof(compressed), "%s.gz", segment);
+        check_lines(compressed, partial, next, &censored);
+    }
+    check_lines(path, partial, next, &censored);
+    CHECK(partial[0] == '\0');
+    for (int i = 0; i < THREADS; i++) {
+        CHECK(next[i] == LINES);
+    }
+    CHECK(censored);
+
+    close(writeFd);
+    test_remove_tree(dir);
+    return TEST_RESULT();
+}
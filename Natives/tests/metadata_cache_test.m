@@ -0,0 +1,185 @@
+#import <Foundation/Foundation.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#import "ForgeVersionListParser.h"
+#import "PLMetadataCache.h"
+
+#include "test.h"
+
+@interface PLMetadataCache(Test)
+- (NSString *)basePathForURL:(NSString *)url;
+@end
+
+// Loopback server answering every request with the current body, tagged by
+// its version, or 304 when the request already has that version
+static pthread_mutex_t serverLock = PTHREAD_MUTEX_INITIALIZER;
+static int serverStatus = 200;
+static int serverVersion = 1;
+static char serverBody[256] = "first";
+static int serverRequests, serverConditionalRequests;
+
+static void *server_run(void *arg) {
+    int listener = (int)(intptr_t)arg;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) continue;
+        char request[4096];
+        size_t len = 0;
+        ssize_t n;
+        while (len < sizeof(request) - 1 && (n = read(fd, request + len, sizeof(request) - 1 - len)) > 0) {
+            len += n;
+            request[len] = '\0';
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+        request[len] = '\0';
+
+        char etag[32], response[1024];
+        pthread_mutex_lock(&serverLock);
+        snprintf(etag, sizeof(etag), "\"v%d\"", serverVersion);
+        serverRequests++;
+        const char *condition = strcasestr(request, "If-None-Match: ");
+        serverConditionalRequests += condition != NULL;
+        if (serverStatus != 200) {
+            snprintf(response, sizeof(response), "HTTP/1.1 %d Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", serverStatus);
+        } else if (condition && strncmp(condition + 15, etag, strlen(etag)) == 0) {
+            snprintf(response, sizeof(response), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", etag);
+        } else {
+            snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nETag: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                etag, strlen(serverBody), serverBody);
+        }
+        pthread_mutex_unlock(&serverLock);
+        write(fd, response, strlen(response));
+        close(fd);
+    }
+    return NULL;
+}
+
+static int server_start(void) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, addrLen) != 0 ||
+        listen(listener, 16) != 0 || getsockname(listener, (struct sockaddr *)&addr, &addrLen) != 0) {
+        perror("server");
+        exit(EXIT_FAILURE);
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_run, (void *)(intptr_t)listener);
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+static void server_set(int status, int version, const char *body) {
+    pthread_mutex_lock(&serverLock);
+    serverStatus = status;
+    serverVersion = version;
+    snprintf(serverBody, sizeof(serverBody), "%s", body);
+    pthread_mutex_unlock(&serverLock);
+}
+
+static int server_requests(void) {
+    pthread_mutex_lock(&serverLock);
+    int requests = serverRequests;
+    pthread_mutex_unlock(&serverLock);
+    return requests;
+}
+
+// Runs the main queue until done returns YES or the timeout passes
+static BOOL wait_for(BOOL (^done)(void), NSTimeInterval timeout) {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    while (!done() && deadline.timeIntervalSinceNow > 0) {
+        [NSRunLoop.mainRunLoop runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return done();
+}
+
+// Fetches url and returns every handler call made within a second as
+// "body" or "error", in order
+static NSArray<NSString *> *fetch(NSString *url) {
+    NSMutableArray<NSString *> *calls = [NSMutableArray new];
+    [PLMetadataCache.sharedCache fetchURL:url handler:^(NSData *data, NSError *error) {
+        [calls addObject:data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : @"error"];
+    }];
+    wait_for(^{ return NO; }, 1.0);
+    return calls;
+}
+
+// Makes the cached entry of url due for revalidation
+static void expire(NSString *url) {
+    NSString *path = [[PLMetadataCache.sharedCache basePathForURL:url] stringByAppendingPathExtension:@"json"];
+    NSMutableDictionary *metadata = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:path]
+        options:NSJSONReadingMutableContainers error:nil];
+    metadata[@"fetchedAt"] = @0;
+    [[NSJSONSerialization dataWithJSONObject:metadata options:0 error:nil] writeToFile:path atomically:YES];
+}
+
+static void test_metadata_cache(void) {
+    NSString *url = [NSString stringWithFormat:@"http://127.0.0.1:%d/maven-metadata.xml", server_start()];
+
+    // Nothing cached: one call with the downloaded body
+    CHECK([fetch(url) isEqualToArray:@[@"first"]]);
+    CHECK(server_requests() == 1);
+
+    // Fresh: served from the cache without a request
+    CHECK([fetch(url) isEqualToArray:@[@"first"]]);
+    CHECK(server_requests() == 1);
+
+    // Revalidated and unchanged: only the cached body is handed out
+    expire(url);
+    CHECK([fetch(url) isEqualToArray:@[@"first"]]);
+    CHECK(server_requests() == 2 && serverConditionalRequests == 1);
+
+    // Revalidated and changed: the cached body, then the new one
+    server_set(200, 2, "second");
+    expire(url);
+    CHECK([fetch(url) isEqualToArray:(@[@"first", @"second"])]);
+    CHECK([fetch(url) isEqualToArray:@[@"second"]]);
+
+    // A failing server keeps the cached body and reports nothing
+    server_set(500, 3, "");
+    expire(url);
+    CHECK([fetch(url) isEqualToArray:@[@"second"]]);
+
+    // The error only comes when there is nothing cached
+    CHECK([fetch([url stringByAppendingString:@"?uncached"]) isEqualToArray:@[@"error"]]);
+}
+
+static ForgeVersionListParser *parse_versions(NSString *xml) {
+    ForgeVersionListParser *list = [ForgeVersionListParser new];
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithData:[xml dataUsingEncoding:NSUTF8StringEncoding]];
+    parser.delegate = list;
+    CHECK([parser parse]);
+    return list;
+}
+
+static void test_version_list(void) {
+    ForgeVersionListParser *first = parse_versions(@"<metadata><versioning><latest>1.20.1-47.1.0</latest><versions>"
+        "<version>1.20.1-47.1.0</version><version>1.20.1-47.0.0</version>"
+        "<version>1.19.4-45.1.0</version><version>unversioned</version></versions></versioning></metadata>");
+    CHECK([first.versionList isEqualToArray:(@[@"1.20.1", @"1.19.4"])]);
+    CHECK([first.forgeList isEqualToArray:(@[@[@"1.20.1-47.1.0", @"1.20.1-47.0.0"], @[@"1.19.4-45.1.0"]])]);
+    CHECK([first.visibilityList isEqualToArray:(@[@NO, @NO])]);
+
+    // A later parse builds lists of its own, the ones shown stay as they are
+    ForgeVersionListParser *second = parse_versions(@"<metadata><versioning><versions>"
+        "<version>1.21-51.0.0</version></versions></versioning></metadata>");
+    CHECK([second.versionList isEqualToArray:@[@"1.21"]]);
+    CHECK(first.versionList.count == 2 && first.forgeList.count == 2);
+}
+
+int main(void) {
+    @autoreleasepool {
+        char home[PATH_MAX];
+        test_make_tmpdir(home, sizeof(home));
+        setenv("POJAV_HOME", home, 1);
+        test_metadata_cache();
+        test_version_list();
+        test_remove_tree(home);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+#import <Foundation/Foundation.h>
+
+#import "PLMirrorSelector.h"
+
+#include "test.h"
+
+static BOOL mirrorsEnabled;
+
+BOOL getPrefBool(NSString *key) {
+    return [key isEqualToString:@"general.download_mirrors"] && mirrorsEnabled;
+}
+
+static void record(NSString *url, NSArray<NSNumber *> *latencies) {
+    for (NSNumber *latency in latencies) {
+        [PLMirrorSelector.sharedSelector recordLatency:latency.doubleValue forURL:url];
+    }
+}
+
+static void test_order(void) {
+    PLMirrorSelector *selector = PLMirrorSelector.sharedSelector;
+    // Ordered by median, a single slow sample doesn't push a host back
+    record(@"https://steady.test/", @[@0.5, @0.6, @0.7]);
+    record(@"https://spiky.test/", @[@0.1, @0.2, @5.0]);
+    NSArray *order = [selector candidatesForURLs:@[@"https://steady.test/a.jar", @"https://spiky.test/a.jar"]];
+    CHECK([order isEqualToArray:(@[@"https://spiky.test/a.jar", @"https://steady.test/a.jar"])]);
+
+    // Unknown hosts count as 1s and keep the order they were listed in
+    record(@"https://slow.test/", @[@3.0]);
+    order = [selector candidatesForURLs:@[@"https://slow.test/a.jar", @"https://new1.test/a.jar",
+        @"https://new2.test/a.jar", @"https://steady.test/a.jar"]];
+    CHECK([order isEqualToArray:(@[@"https://steady.test/a.jar", @"https://new1.test/a.jar",
+        @"https://new2.test/a.jar", @"https://slow.test/a.jar"])]);
+
+    // Failures count as 10s
+    record(@"https://failing.test/", @[@0.1]);
+    for (int i = 0; i < 2; i++) {
+        [selector recordFailureForURL:@"https://failing.test/a.jar"];
+    }
+    order = [selector candidatesForURLs:@[@"https://failing.test/a.jar", @"https://slow.test/a.jar"]];
+    CHECK([order.firstObject isEqualToString:@"https://slow.test/a.jar"]);
+
+    // Only the last 32 samples count
+    record(@"https://recovered.test/", @[@9.0, @9.0, @9.0, @9.0, @9.0, @9.0, @9.0, @9.0]);
+    for (int i = 0; i < 32; i++) {
+        record(@"https://recovered.test/", @[@0.2]);
+    }
+    order = [selector candidatesForURLs:@[@"https://steady.test/a.jar", @"https://recovered.test/a.jar"]];
+    CHECK([order.firstObject isEqualToString:@"https://recovered.test/a.jar"]);
+}
+
+static void test_mirrors(void) {
+    PLMirrorSelector *selector = PLMirrorSelector.sharedSelector;
+    NSString *library = @"https://libraries.minecraft.net/org/lwjgl/lwjgl/3.3.1/lwjgl-3.3.1.jar";
+    NSString *mirrored = @"https://bmclapi2.bangbang93.com/maven/org/lwjgl/lwjgl/3.3.1/lwjgl-3.3.1.jar";
+    record(library, @[@0.3]);
+    record(mirrored, @[@0.3]);
+
+    mirrorsEnabled = NO;
+    CHECK([[selector candidatesForURLs:@[library]] isEqualToArray:@[library]]);
+    mirrorsEnabled = YES;
+    CHECK([[selector candidatesForURLs:@[library]] isEqualToArray:(@[library, mirrored])]);
+    // Other hosts have no mirrors
+    CHECK([selector candidatesForURLs:@[@"https://steady.test/b.jar"]].count == 1);
+    mirrorsEnabled = NO;
+}
+
+static void test_hedge(void) {
+    PLMirrorSelector *selector = PLMirrorSelector.sharedSelector;
+    // Too few samples for a percentile
+    record(@"https://few.test/", @[@0.1, @0.1, @0.1]);
+    CHECK([selector hedgeDelayForURL:@"https://few.test/a.jar"] == 2.0);
+    CHECK([selector hedgeDelayForURL:@"https://unknown.test/a.jar"] == 2.0);
+
+    // p90 of 0.1 ... 1.0
+    for (int i = 1; i <= 10; i++) {
+        record(@"https://p90.test/", @[@(i / 10.0)]);
+    }
+    CHECK(fabs([selector hedgeDelayForURL:@"https://p90.test/a.jar"] - 1.0) < 1e-9);
+
+    // Clamped to 0.25 ... 5s
+    record(@"https://fast.test/", @[@0.01, @0.01, @0.01, @0.01, @0.01, @0.01, @0.01, @0.01]);
+    CHECK([selector hedgeDelayForURL:@"https://fast.test/a.jar"] == 0.25);
+    record(@"https://dead.test/", @[@9.0, @9.0, @9.0, @9.0, @9.0, @9.0, @9.0, @9.0]);
+    CHECK([selector hedgeDelayForURL:@"https://dead.test/a.jar"] == 5.0);
+
+    // At most four hedges in flight
+    int begun = 0;
+    for (int i = 0; i < 6; i++) {
+        begun += [selector beginHedge];
+    }
+    CHECK(begun == 4);
+    [selector endHedge];
+    CHECK([selector beginHedge]);
+    CHECK(![selector beginHedge]);
+    for (int i = 0; i < 4; i++) {
+        [selector endHedge];
+    }
+}
+
+int main(void) {
+    @autoreleasepool {
+        test_order();
+        test_mirrors();
+        test_hedge();
+    }
+    return TEST_RESULT();
+}
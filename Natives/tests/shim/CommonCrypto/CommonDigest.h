@@ -0,0 +1,8 @@
+#pragma once
+
+// The part of CommonCrypto the sources use, over OpenSSL, for hosts without it
+#include <openssl/sha.h>
+
+#define CC_SHA1_DIGEST_LENGTH SHA_DIGEST_LENGTH
+typedef unsigned int CC_LONG;
+#define CC_SHA1(data, len, md) SHA1((const unsigned char *)(data), (len), (md))
@@ -0,0 +1,5 @@
+#import <Foundation/Foundation.h>
+
+// The preferences API without UIKit, for sources built into host tests.
+// Each test defines the functions it needs.
+BOOL getPrefBool(NSString *key);
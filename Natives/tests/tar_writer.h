@@ -0,0 +1,108 @@
+#pragma once
+
+#include <lzma.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Builds .tar.xz archives for the tests in memory: ustar headers, GNU long
+// names and pax records, compressed in 1 MiB xz blocks so the multi-threaded
+// decoder has blocks to spread. Errors abort the test.
+
+typedef struct {
+    uint8_t *data;
+    size_t len, cap;
+} tar_writer_t;
+
+static inline uint8_t *tar_writer_grow(tar_writer_t *w, size_t len) {
+    // Data is padded to whole blocks
+    size_t padded = (len + 511) / 512 * 512;
+    if (w->len + padded > w->cap) {
+        w->cap = (w->len + padded) * 2;
+        w->data = realloc(w->data, w->cap);
+        if (!w->data) abort();
+    }
+    uint8_t *out = w->data + w->len;
+    memset(out, 0, padded);
+    w->len += padded;
+    return out;
+}
+
+// One header block, prefix may be NULL
+static inline void tar_writer_header(tar_writer_t *w, const char *name, const char *prefix, char type,
+    const char *link_name, unsigned mode, uint64_t size) {
+    char *h = (char *)tar_writer_grow(w, 512);
+    strncpy(h, name, 100);
+    snprintf(h + 100, 8, "%07o", mode);
+    snprintf(h + 108, 8, "%07o", 0);
+    snprintf(h + 116, 8, "%07o", 0);
+    snprintf(h + 124, 12, "%011llo", (unsigned long long)size);
+    snprintf(h + 136, 12, "%011o", 1700000000);
+    h[156] = type;
+    if (link_name) strncpy(h + 157, link_name, 100);
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+    if (prefix) strncpy(h + 345, prefix, 155);
+    memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < 512; i++) sum += (uint8_t)h[i];
+    snprintf(h + 148, 8, "%06o", sum);
+}
+
+static inline void tar_writer_data(tar_writer_t *w, const void *data, size_t len) {
+    if (len > 0) memcpy(tar_writer_grow(w, len), data, len);
+}
+
+// An entry, with a GNU long name record first when name doesn't fit
+static inline void tar_writer_add(tar_writer_t *w, const char *name, char type, const char *link_name,
+    unsigned mode, const void *data, size_t len) {
+    size_t name_len = strlen(name);
+    if (name_len > 100) {
+        tar_writer_header(w, "././@LongLink", NULL, 'L', NULL, 0644, name_len + 1);
+        tar_writer_data(w, name, name_len + 1);
+    }
+    tar_writer_header(w, name, NULL, type, link_name, mode, len);
+    tar_writer_data(w, data, len);
+}
+
+// A pax extended header with a single record
+static inline void tar_writer_pax(tar_writer_t *w, const char *key, const char *value) {
+    char record[4096];
+    size_t body = strlen(key) + strlen(value) + 3;
+    // The length counts its own digits
+    size_t len = body + 1;
+    while (snprintf(NULL, 0, "%zu", len) + body != len) len++;
+    snprintf(record, sizeof(record), "%zu %s=%s\n", len, key, value);
+    tar_writer_header(w, "PaxHeaders/entry", NULL, 'x', NULL, 0644, len);
+    tar_writer_data(w, record, len);
+}
+
+// Ends the archive and writes it compressed to path
+static inline void tar_writer_finish(tar_writer_t *w, const char *path) {
+    tar_writer_grow(w, 1024);
+    lzma_mt mt = {0};
+    mt.threads = 2;
+    mt.block_size = 1 << 20;
+    mt.preset = 1;
+    mt.check = LZMA_CHECK_CRC64;
+    lzma_stream strm = LZMA_STREAM_INIT;
+    if (lzma_stream_encoder_mt(&strm, &mt) != LZMA_OK) abort();
+    size_t cap = lzma_stream_buffer_bound(w->len);
+    uint8_t *out = malloc(cap);
+    if (!out) abort();
+    strm.next_in = w->data;
+    strm.avail_in = w->len;
+    strm.next_out = out;
+    strm.avail_out = cap;
+    if (lzma_code(&strm, LZMA_FINISH) != LZMA_STREAM_END) abort();
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(out, 1, strm.total_out, f) != strm.total_out || fclose(f) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    lzma_end(&strm);
+    free(out);
+    free(w->data);
+    memset(w, 0, sizeof(*w));
+}
@@ -0,0 +1,58 @@
+#include <sys/stat.h>
+
+#include "tar_xz.h"
+
+#include "bench.h"
+#include "tar_writer.h"
+#include "test.h"
+
+// Extracts a generated runtime-like archive of about the given MiB (64 by
+// default) and prints the time next to GNU tar's on the same file. Compare
+// against a tar whose xz uses the same liblzma version, newer decoders are faster.
+int main(int argc, char **argv) {
+    size_t total = (argc > 1 ? strtoul(argv[1], NULL, 10) : 64) << 20;
+    char root[PATH_MAX], xzPath[PATH_MAX + 16], dest[PATH_MAX + 16], cmd[PATH_MAX * 3];
+    test_make_tmpdir(root, sizeof(root));
+    snprintf(xzPath, sizeof(xzPath), "%s/bench.tar.xz", root);
+
+    // Mostly small files with a few large ones, about as compressible as class files
+    tar_writer_t w = {0};
+    size_t size = 0, files = 0;
+    uint32_t seed = 1;
+    static uint8_t data[8 << 20];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (seed >> 16) % 4 ? "classfile"[i % 9] : (uint8_t)(seed >> 24);
+    }
+    while (size < total) {
+        char name[64];
+        size_t len = files % 50 == 49 ? sizeof(data) : 512 + (files * 7919) % 65536;
+        snprintf(name, sizeof(name), "jre/lib/%02zu/f%zu", files % 64, files);
+        tar_writer_add(&w, name, '0', NULL, 0644, data + files % 4096, len - files % 4096);
+        size += len;
+        files++;
+    }
+    tar_writer_finish(&w, xzPath);
+
+    snprintf(dest, sizeof(dest), "%s/ours", root);
+    mkdir(dest, 0755);
+    tar_xz_stats_t stats;
+    char err[256];
+    double start = bench_now();
+    if (tar_xz_extract(xzPath, dest, NULL, &stats, err, sizeof(err)) != 0) {
+        fprintf(stderr, "tar_xz_extract: %s\n", err);
+        return EXIT_FAILURE;
+    }
+    printf("tar_xz_extract: %zu files, %.1f MiB, %.3f s with liblzma %s\n", stats.files, stats.bytes / 1048576.0,
+        bench_now() - start, lzma_version_string());
+
+    snprintf(dest, sizeof(dest), "%s/tar", root);
+    mkdir(dest, 0755);
+    snprintf(cmd, sizeof(cmd), "tar -xJf '%s' -C '%s'", xzPath, dest);
+    start = bench_now();
+    if (system(cmd) == 0) {
+        printf("tar -xJf: %.3f s\n", bench_now() - start);
+    }
+    test_remove_tree(root);
+    return EXIT_SUCCESS;
+}
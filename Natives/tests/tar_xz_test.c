@@ -0,0 +1,183 @@
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "tar_xz.h"
+
+#include "tar_writer.h"
+#include "test.h"
+
+static char root[PATH_MAX], xzPath[PATH_MAX + 16];
+
+typedef struct {
+    int written;
+    int entries;
+    const char *cancelAt;
+} callbacks_t;
+
+static bool on_progress(uint64_t in_bytes, uint64_t out_bytes, const char *name, void *ctx) {
+    callbacks_t *callbacks = ctx;
+    if (name) {
+        callbacks->entries++;
+        if (callbacks->cancelAt && strcmp(name, callbacks->cancelAt) == 0) return false;
+    }
+    return true;
+}
+
+static bool on_written(const char *name, void *ctx) {
+    __atomic_add_fetch(&((callbacks_t *)ctx)->written, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static int extract(const char *dest, callbacks_t *callbacks, tar_xz_stats_t *stats, char *err) {
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/%s", root, dest);
+    mkdir(path, 0755);
+    tar_xz_options_t options = {.progress = on_progress, .file_written = on_written, .ctx = callbacks};
+    memset(stats, 0, sizeof(*stats));
+    err[0] = '\0';
+    return tar_xz_extract(xzPath, path, &options, stats, err, 256);
+}
+
+static bool file_equals(const char *relPath, const void *data, size_t len) {
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/%s", root, relPath);
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char *buf = malloc(len + 1);
+    size_t n = fread(buf, 1, len + 1, f);
+    fclose(f);
+    bool equal = n == len && memcmp(buf, data, len) == 0;
+    free(buf);
+    return equal;
+}
+
+static bool exists(const char *relPath) {
+    char path[PATH_MAX * 2];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", root, relPath);
+    return lstat(path, &st) == 0;
+}
+
+static void test_extract(void) {
+    // Spans several xz blocks and the writer's 4 MiB chunks
+    size_t bigLen = 9 * 1024 * 1024 + 7;
+    uint8_t *big = malloc(bigLen);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < bigLen; i++) {
+        seed = seed * 1103515245 + 12345;
+        big[i] = i % 3 ? (seed >> 16) : 'j';
+    }
+    char longName[256];
+    snprintf(longName, sizeof(longName), "jre/%0150d/long.txt", 0);
+    char paxName[256];
+    snprintf(paxName, sizeof(paxName), "jre/pax/%0120d.txt", 1);
+
+    tar_writer_t w = {0};
+    tar_writer_add(&w, "./", '5', NULL, 0755, NULL, 0);
+    tar_writer_add(&w, "jre/", '5', NULL, 0755, NULL, 0);
+    tar_writer_add(&w, "jre/bin/java", '0', NULL, 0755, "#!java", 6);
+    tar_writer_add(&w, "jre/release", '0', NULL, 0644, "JAVA_VERSION=\"17\"", 17);
+    tar_writer_add(&w, "jre/lib/a.so", '0', NULL, 0644, "so", 2);
+    tar_writer_add(&w, "jre/lib/modules", '0', NULL, 0644, big, bigLen);
+    tar_writer_add(&w, "jre/empty", '0', NULL, 0644, NULL, 0);
+    tar_writer_add(&w, "jre/legal/m/LICENSE", '2', "../../lib/a.so", 0777, NULL, 0);
+    tar_writer_add(&w, "jre/lib/hard.so", '1', "jre/lib/a.so", 0644, NULL, 0);
+    tar_writer_add(&w, longName, '0', NULL, 0644, "long", 4);
+    tar_writer_pax(&w, "path", paxName);
+    tar_writer_add(&w, "PaxHeaders/ignored", '0', NULL, 0644, "pax", 3);
+    tar_writer_header(&w, "prefixed.txt", "jre/ustar", '0', NULL, 0644, 6);
+    tar_writer_data(&w, "prefix", 6);
+    tar_writer_add(&w, "jre/fifo", '6', NULL, 0644, NULL, 0);
+    tar_writer_finish(&w, xzPath);
+
+    callbacks_t callbacks = {0};
+    tar_xz_stats_t stats;
+    char err[256];
+    CHECK(extract("ok", &callbacks, &stats, err) == 0);
+    CHECK(stats.files == 8 && stats.links == 2);
+    CHECK(stats.bytes == 6 + 17 + 2 + bigLen + 4 + 3 + 6);
+    CHECK(callbacks.written == 8);
+    CHECK(file_equals("ok/jre/lib/modules", big, bigLen));
+    CHECK(file_equals("ok/jre/legal/m/LICENSE", "so", 2));
+    CHECK(file_equals("ok/jre/empty", "", 0));
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "ok/%s", longName);
+    CHECK(file_equals(path, "long", 4));
+    snprintf(path, sizeof(path), "ok/%s", paxName);
+    CHECK(file_equals(path, "pax", 3));
+    CHECK(file_equals("ok/jre/ustar/prefixed.txt", "prefix", 6));
+    CHECK(!exists("ok/jre/fifo"));
+
+    struct stat st, hard;
+    snprintf(path, sizeof(path), "%s/ok/jre/bin/java", root);
+    CHECK(stat(path, &st) == 0 && (st.st_mode & 0111));
+    snprintf(path, sizeof(path), "%s/ok/jre/lib/a.so", root);
+    stat(path, &st);
+    snprintf(path, sizeof(path), "%s/ok/jre/lib/hard.so", root);
+    CHECK(stat(path, &hard) == 0 && hard.st_ino == st.st_ino);
+
+    // Cancelling from the progress callback
+    callbacks = (callbacks_t){.cancelAt = "jre/lib/modules"};
+    CHECK(extract("cancelled", &callbacks, &stats, err) == ECANCELED);
+    free(big);
+}
+
+// Extracts a two entry archive, the second being the one under test
+static int extract_entry(const char *name, char type, const char *link_name, const char *second, char type2, const char *link2) {
+    tar_writer_t w = {0};
+    tar_writer_add(&w, name, type, link_name, 0755, type == '0' ? "x" : NULL, type == '0');
+    if (second) {
+        tar_writer_add(&w, second, type2, link2, 0644, type2 == '0' ? "y" : NULL, type2 == '0');
+    }
+    tar_writer_finish(&w, xzPath);
+    callbacks_t callbacks = {0};
+    tar_xz_stats_t stats;
+    char err[256];
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/unsafe", root);
+    if (exists("unsafe")) {
+        test_remove_tree(path);
+    }
+    return extract("unsafe", &callbacks, &stats, err);
+}
+
+static void test_refused(void) {
+    CHECK(extract_entry("/etc/evil", '0', NULL, NULL, 0, NULL) == EPERM);
+    CHECK(extract_entry("jre/../../evil", '0', NULL, NULL, 0, NULL) == EPERM);
+    CHECK(extract_entry("jre/link", '2', "/etc", NULL, 0, NULL) == EPERM);
+    CHECK(extract_entry("jre/a/link", '2', "../../..", NULL, 0, NULL) == EPERM);
+    // A link that stays inside is fine, writing through it is not
+    CHECK(extract_entry("jre/link", '2', ".", NULL, 0, NULL) == 0);
+    CHECK(extract_entry("link", '2', "jre", "link/file", '0', NULL) == ENOTDIR);
+    CHECK(extract_entry("link", '2', "jre", "link/dir/", '5', NULL) == ENOTDIR);
+    CHECK(extract_entry("jre/", '5', NULL, "hard", '1', "../outside") == EPERM);
+    CHECK(!exists("evil") && !exists("outside"));
+
+    callbacks_t callbacks = {0};
+    tar_xz_stats_t stats;
+    char err[256];
+    test_write_file(xzPath, "not an xz", 9);
+    CHECK(extract("bad", &callbacks, &stats, err) != 0);
+    CHECK(err[0] != '\0');
+
+    // Truncated in the middle of the stream
+    tar_writer_t w = {0};
+    static char data[600000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (char)(i * 2654435761u >> 24);
+    }
+    tar_writer_add(&w, "big", '0', NULL, 0644, data, sizeof(data));
+    tar_writer_finish(&w, xzPath);
+    struct stat st;
+    CHECK(stat(xzPath, &st) == 0 && truncate(xzPath, st.st_size / 2) == 0);
+    CHECK(extract("truncated", &callbacks, &stats, err) != 0);
+}
+
+int main(void) {
+    test_make_tmpdir(root, sizeof(root));
+    snprintf(xzPath, sizeof(xzPath), "%s/test.tar.xz", root);
+    test_extract();
+    test_refused();
+    test_remove_tree(root);
+    return TEST_RESULT();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Checks for the host tests. A failed check prints its location and the test
+// keeps going, main returns TEST_RESULT() so every failure is reported at once.
+
+static int test_failures __attribute__((unused));
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define TEST_RESULT() (test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+// Creates an empty directory for the test under $TMPDIR, path must hold PATH_MAX bytes
+static inline void test_make_tmpdir(char *path, size_t cap) {
+    const char *tmp = getenv("TMPDIR");
+    snprintf(path, cap, "%s/pojav_test.XXXXXX", tmp ? tmp : "/tmp");
+    if (!mkdtemp(path)) {
+        perror("mkdtemp");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline void test_write_file(const char *path, const void *data, size_t len) {
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(data, 1, len, f) != len || fclose(f) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline int test_remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    return remove(path);
+}
+
+// Removes a directory made by test_make_tmpdir and everything in it
+static inline void test_remove_tree(const char *path) {
+    if (nftw(path, test_remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0) {
+        perror(path);
+    }
+}
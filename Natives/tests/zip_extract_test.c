@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "zip_extract.h"
+
+#include "test.h"
+#include "zip_writer.h"
+
+static char root[PATH_MAX], zipPath[PATH_MAX + 16];
+
+// Extracts into a new directory named dest under the test root
+static int extract(const char *dest, const zip_extract_options_t *options, zip_extract_stats_t *stats, char *err) {
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/%s", root, dest);
+    mkdir(path, 0755);
+    memset(stats, 0, sizeof(*stats));
+    err[0] = '\0';
+    return zip_extract(zipPath, path, options, stats, err, 256);
+}
+
+static bool file_equals(const char *relPath, const void *data, size_t len) {
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/%s", root, relPath);
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char *buf = malloc(len + 1);
+    size_t n = fread(buf, 1, len + 1, f);
+    fclose(f);
+    bool equal = n == len && memcmp(buf, data, len) == 0;
+    free(buf);
+    return equal;
+}
+
+static bool skip_mods(const char *path, uint32_t crc, uint64_t size, void *ctx) {
+    if (strcmp(path, "config/a.txt") == 0) {
+        *(bool *)ctx = crc == crc32(0, (const Bytef *)"alpha", 5) && size == 5;
+    }
+    return strncmp(path, "mods/", 5) != 0;
+}
+
+static void test_extract(void) {
+    // Several 256 KiB output buffers worth, and compressible
+    size_t bigLen = 3 * 1024 * 1024 + 123;
+    char *big = malloc(bigLen);
+    for (size_t i = 0; i < bigLen; i++) {
+        big[i] = "pojav"[i % 5] + (i / 4096) % 7;
+    }
+
+    zip_writer_t w;
+    zip_writer_open(&w, zipPath);
+    zip_writer_add(&w, "manifest.json", "{}", false);
+    zip_writer_add(&w, "overrides/", "", false);
+    zip_writer_add(&w, "overrides/config/a.txt", "alpha", false);
+    zip_writer_add(&w, "overrides/config\\b.txt", "beta", true);
+    zip_writer_add(&w, "overrides/empty.txt", "", true);
+    zip_writer_add(&w, "overrides/mods/skipped.jar", "jar", false);
+    zip_writer_add(&w, "overrides/resourcepacks/", "", false);
+    zip_writer_add_raw(&w, "overrides/deep/nested/dir/big.bin", big, bigLen, true, 0);
+    zip_writer_close(&w);
+
+    zip_extract_stats_t stats;
+    char err[256];
+    bool filterSawCrc = false;
+    zip_extract_options_t options = {.prefix = "overrides/", .threads = 4, .filter = skip_mods, .filter_ctx = &filterSawCrc};
+    CHECK(extract("out", &options, &stats, err) == 0);
+    CHECK(stats.files == 4 && stats.skipped == 1);
+    CHECK(stats.bytes == 5 + 4 + bigLen);
+    CHECK(filterSawCrc);
+    CHECK(file_equals("out/config/a.txt", "alpha", 5));
+    CHECK(file_equals("out/config/b.txt", "beta", 4));
+    CHECK(file_equals("out/empty.txt", "", 0));
+    CHECK(file_equals("out/deep/nested/dir/big.bin", big, bigLen));
+    struct stat st;
+    char path[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/out/resourcepacks", root);
+    CHECK(stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+    snprintf(path, sizeof(path), "%s/out/mods/skipped.jar", root);
+    CHECK(stat(path, &st) != 0);
+    snprintf(path, sizeof(path), "%s/out/manifest.json", root);
+    CHECK(stat(path, &st) != 0);
+
+    // A tight memory budget still gets everything out, with fewer workers
+    options = (zip_extract_options_t){.memory_budget = 1};
+    CHECK(extract("budget", &options, &stats, err) == 0);
+    CHECK(stats.files == 6);
+    CHECK(file_equals("budget/overrides/deep/nested/dir/big.bin", big, bigLen));
+    free(big);
+}
+
+static void test_refused(void) {
+    zip_extract_stats_t stats;
+    char err[256];
+    static const char *unsafe[] = {"../escape.txt", "a/../../escape.txt", "/abs.txt", "a\\..\\..\\escape.txt"};
+    for (size_t i = 0; i < sizeof(unsafe) / sizeof(*unsafe); i++) {
+        zip_writer_t w;
+        zip_writer_open(&w, zipPath);
+        zip_writer_add(&w, "fine.txt", "fine", false);
+        zip_writer_add(&w, unsafe[i], "evil", false);
+        zip_writer_close(&w);
+        CHECK(extract("unsafe", NULL, &stats, err) == EPERM);
+        CHECK(strstr(err, "Refusing") != NULL);
+    }
+    char path[PATH_MAX * 2];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/escape.txt", root);
+    CHECK(stat(path, &st) != 0);
+
+    // A damaged entry fails the extraction
+    zip_writer_t w;
+    zip_writer_open(&w, zipPath);
+    zip_writer_add_raw(&w, "damaged.txt", "damaged data", 12, true, 1);
+    zip_writer_close(&w);
+    CHECK(extract("damaged", NULL, &stats, err) != 0);
+
+    test_write_file(zipPath, "not a zip", 9);
+    CHECK(extract("notzip", NULL, &stats, err) == EINVAL);
+}
+
+static void test_duplicates_and_links(void) {
+    zip_writer_t w;
+    zip_writer_open(&w, zipPath);
+    zip_writer_add(&w, "a.txt", "first", false);
+    zip_writer_add(&w, "b.txt", "through the link", true);
+    zip_writer_add(&w, "a.txt", "second", true);
+    zip_writer_close(&w);
+
+    // A symlink left where an entry goes is replaced, not written through
+    char path[PATH_MAX * 2], victim[PATH_MAX * 2];
+    snprintf(path, sizeof(path), "%s/links", root);
+    mkdir(path, 0755);
+    snprintf(victim, sizeof(victim), "%s/victim", root);
+    test_write_file(victim, "keep", 4);
+    snprintf(path, sizeof(path), "%s/links/b.txt", root);
+    CHECK(symlink("../victim", path) == 0);
+
+    zip_extract_stats_t stats;
+    char err[256];
+    CHECK(extract("links", NULL, &stats, err) == 0);
+    CHECK(stats.files == 2);
+    CHECK(file_equals("links/a.txt", "second", 6));
+    CHECK(file_equals("links/b.txt", "through the link", 16));
+    CHECK(file_equals("victim", "keep", 4));
+    struct stat st;
+    CHECK(lstat(path, &st) == 0 && S_ISREG(st.st_mode));
+}
+
+int main(void) {
+    test_make_tmpdir(root, sizeof(root));
+    snprintf(zipPath, sizeof(zipPath), "%s/test.zip", root);
+    test_extract();
+    test_refused();
+    test_duplicates_and_links();
+    test_remove_tree(root);
+    return TEST_RESULT();
+}
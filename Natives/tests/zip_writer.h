@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// Writes small zip archives for the tests: stored or deflated entries, no
+// ZIP64, no data descriptors. Errors abort the test.
+
+typedef struct {
+    FILE *file;
+    uint8_t *central;
+    size_t central_len, central_cap;
+    uint16_t count;
+} zip_writer_t;
+
+static inline void zip_writer_put16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline void zip_writer_put32(uint8_t *p, uint32_t v) {
+    zip_writer_put16(p, v);
+    zip_writer_put16(p + 2, v >> 16);
+}
+
+static inline void zip_writer_open(zip_writer_t *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->file = fopen(path, "wb");
+    if (!w->file) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// crc_delta is added to the recorded CRC-32, to write a damaged entry
+static inline void zip_writer_add_raw(zip_writer_t *w, const char *name, const void *data, size_t len, bool deflated, uint32_t crc_delta) {
+    uint32_t crc = crc32(0, data, len) + crc_delta;
+    uint8_t *body = (uint8_t *)data;
+    size_t body_len = len;
+    if (deflated) {
+        z_stream z = {0};
+        body_len = deflateBound(&z, len) + 16;
+        body = malloc(body_len);
+        if (!body || deflateInit2(&z, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) abort();
+        z.next_in = (Bytef *)data;
+        z.avail_in = len;
+        z.next_out = body;
+        z.avail_out = body_len;
+        if (deflate(&z, Z_FINISH) != Z_STREAM_END) abort();
+        body_len = z.total_out;
+        deflateEnd(&z);
+    }
+
+    uint16_t name_len = strlen(name);
+    uint32_t offset = ftell(w->file);
+    uint8_t local[30] = {0};
+    zip_writer_put32(local, 0x04034b50);
+    zip_writer_put16(local + 4, 20);
+    zip_writer_put16(local + 8, deflated ? 8 : 0);
+    zip_writer_put32(local + 14, crc);
+    zip_writer_put32(local + 18, body_len);
+    zip_writer_put32(local + 22, len);
+    zip_writer_put16(local + 26, name_len);
+    fwrite(local, 1, sizeof(local), w->file);
+    fwrite(name, 1, name_len, w->file);
+    fwrite(body, 1, body_len, w->file);
+    if (deflated) free(body);
+
+    if (w->central_len + 46 + name_len > w->central_cap) {
+        w->central_cap = (w->central_cap + 46 + name_len) * 2;
+        w->central = realloc(w->central, w->central_cap);
+        if (!w->central) abort();
+    }
+    uint8_t *header = w->central + w->central_len;
+    memset(header, 0, 46);
+    zip_writer_put32(header, 0x02014b50);
+    zip_writer_put16(header + 4, 20);
+    zip_writer_put16(header + 6, 20);
+    zip_writer_put16(header + 10, deflated ? 8 : 0);
+    zip_writer_put32(header + 16, crc);
+    zip_writer_put32(header + 20, body_len);
+    zip_writer_put32(header + 24, len);
+    zip_writer_put16(header + 28, name_len);
+    zip_writer_put32(header + 42, offset);
+    memcpy(header + 46, name, name_len);
+    w->central_len += 46 + name_len;
+    w->count++;
+}
+
+static inline void zip_writer_add(zip_writer_t *w, const char *name, const char *data, bool deflated) {
+    zip_writer_add_raw(w, name, data, strlen(data), deflated, 0);
+}
+
+static inline void zip_writer_close(zip_writer_t *w) {
+    uint32_t offset = ftell(w->file);
+    fwrite(w->central, 1, w->central_len, w->file);
+    uint8_t end[22] = {0};
+    zip_writer_put32(end, 0x06054b50);
+    zip_writer_put16(end + 8, w->count);
+    zip_writer_put16(end + 10, w->count);
+    zip_writer_put32(end + 12, w->central_len);
+    zip_writer_put32(end + 16, offset);
+    fwrite(end, 1, sizeof(end), w->file);
+    if (fclose(w->file) != 0) abort();
+    free(w->central);
+}
@@ -65,13 +65,13 @@ void openLink(UIViewController* sender, NSURL* link) {
 NSMutableDictionary* parseJSONFromFile(NSString *path) {
     NSError *error;
 
-    NSString *content = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:&error];
-    if (content == nil) {
+    // Parse the mapped bytes directly instead of round-tripping through NSString
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:&error];
+    if (data == nil) {
         NSLog(@"[ParseJSON] Error: could not read %@: %@", path, error.localizedDescription);
         return @{@"NSErrorObject": error}.mutableCopy;
     }
 
-    NSData* data = [content dataUsingEncoding:NSUTF8StringEncoding];
     NSMutableDictionary *dict = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingMutableContainers error:&error];
     if (error) {
         NSLog(@"[ParseJSON] Error: could not parse JSON: %@", error.localizedDescription);
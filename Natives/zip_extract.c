@@ -0,0 +1,536 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "zip_extract.h"
+
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG 0x02014b50
+#define ZIP_EOCD_SIG 0x06054b50
+#define ZIP_EOCD64_SIG 0x06064b50
+#define ZIP_EOCD64_LOCATOR_SIG 0x07064b50
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+#define ZIP_EXTRACT_BUFFER_SIZE (256 * 1024)
+#define ZIP_EXTRACT_DEFAULT_BUDGET (16 * 1024 * 1024)
+
+typedef struct {
+    char *path; // relative to dest
+    uint64_t local_offset;
+    uint64_t compressed_size;
+    uint64_t size;
+    uint32_t crc;
+    uint16_t method;
+    // Position in the central directory
+    uint64_t index;
+} zip_entry_t;
+
+typedef struct {
+    const uint8_t *map;
+    size_t map_len;
+    const char *dest;
+    zip_entry_t *entries;
+    size_t count;
+
+    pthread_mutex_t lock;
+    size_t next;
+    int err;
+    char *errbuf;
+    size_t errlen;
+    uint64_t bytes;
+} zip_extract_ctx_t;
+
+static uint16_t zip_u16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t zip_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t zip_u64(const uint8_t *p) {
+    return (uint64_t)zip_u32(p) | (uint64_t)zip_u32(p + 4) << 32;
+}
+
+static int zip_fail(char *errbuf, size_t errlen, int err, const char *fmt, ...) {
+    if (errbuf && errlen > 0) {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(errbuf, errlen, fmt, args);
+        va_end(args);
+    }
+    return err;
+}
+
+// Records the first error only, workers stop once one is set
+static void zip_ctx_fail(zip_extract_ctx_t *ctx, int err, const char *path) {
+    pthread_mutex_lock(&ctx->lock);
+    if (!ctx->err) {
+        ctx->err = err;
+        zip_fail(ctx->errbuf, ctx->errlen, err, "%s: %s", path, strerror(err));
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// Rejects absolute paths and any ".." component
+static bool zip_path_is_safe(const char *path) {
+    if (path[0] == '/' || path[0] == '\0') {
+        return false;
+    }
+    const char *component = path;
+    while (*component) {
+        const char *end = strchr(component, '/');
+        size_t len = end ? (size_t)(end - component) : strlen(component);
+        if (len == 2 && component[0] == '.' && component[1] == '.') {
+            return false;
+        }
+        if (!end) break;
+        component = end + 1;
+    }
+    return true;
+}
+
+static int zip_compare_paths(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// By path, then in central directory order
+static int zip_compare_entry_paths(const void *a, const void *b) {
+    const zip_entry_t *entryA = a, *entryB = b;
+    int cmp = strcmp(entryA->path, entryB->path);
+    return cmp ? cmp : entryA->index < entryB->index ? -1 : entryA->index > entryB->index;
+}
+
+// Biggest entries first so a large file never ends up as the last job
+static int zip_compare_entries(const void *a, const void *b) {
+    uint64_t sizeA = ((const zip_entry_t *)a)->compressed_size;
+    uint64_t sizeB = ((const zip_entry_t *)b)->compressed_size;
+    return sizeA < sizeB ? 1 : sizeA > sizeB ? -1 : 0;
+}
+
+static int zip_find_central_directory(const uint8_t *map, size_t len, uint64_t *cd_offset, uint64_t *count) {
+    if (len < 22) {
+        return EINVAL;
+    }
+    // The comment is at most 65535 bytes long
+    size_t min = len > 22 + 65535 ? len - 22 - 65535 : 0;
+    for (size_t pos = len - 22 + 1; pos-- > min;) {
+        if (zip_u32(map + pos) != ZIP_EOCD_SIG) continue;
+        *count = zip_u16(map + pos + 10);
+        *cd_offset = zip_u32(map + pos + 16);
+        if (pos >= 20 && zip_u32(map + pos - 20) == ZIP_EOCD64_LOCATOR_SIG) {
+            uint64_t eocd64 = zip_u64(map + pos - 20 + 8);
+            if (eocd64 + 56 <= len && zip_u32(map + eocd64) == ZIP_EOCD64_SIG) {
+                *count = zip_u64(map + eocd64 + 32);
+                *cd_offset = zip_u64(map + eocd64 + 48);
+            }
+        }
+        return *cd_offset < len ? 0 : EINVAL;
+    }
+    return EINVAL;
+}
+
+static void zip_apply_zip64_extra(const uint8_t *extra, size_t extra_len, zip_entry_t *entry, bool size_max, bool compressed_max, bool offset_max) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = zip_u16(extra + pos);
+        uint16_t len = zip_u16(extra + pos + 2);
+        const uint8_t *field = extra + pos + 4;
+        if (pos + 4 + len > extra_len) break;
+        if (id == 0x0001) {
+            size_t off = 0;
+            if (size_max && off + 8 <= len) { entry->size = zip_u64(field + off); off += 8; }
+            if (compressed_max && off + 8 <= len) { entry->compressed_size = zip_u64(field + off); off += 8; }
+            if (offset_max && off + 8 <= len) { entry->local_offset = zip_u64(field + off); }
+            return;
+        }
+        pos += 4 + len;
+    }
+}
+
+static int zip_mkdirs(const char *path) {
+    if (mkdir(path, 0755) == 0 || errno == EEXIST) {
+        return 0;
+    } else if (errno != ENOENT) {
+        return errno;
+    }
+    char parent[PATH_MAX];
+    snprintf(parent, sizeof(parent), "%s", path);
+    char *slash = strrchr(parent, '/');
+    if (!slash || slash == parent) {
+        return ENOENT;
+    }
+    *slash = '\0';
+    int err = zip_mkdirs(parent);
+    if (err) return err;
+    return mkdir(path, 0755) == 0 || errno == EEXIST ? 0 : errno;
+}
+
+static int zip_write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        buf += written;
+        len -= written;
+    }
+    return 0;
+}
+
+static int zip_extract_entry(zip_extract_ctx_t *ctx, const zip_entry_t *entry, uint8_t *buf, size_t buf_len) {
+    if (entry->local_offset + 30 > ctx->map_len || zip_u32(ctx->map + entry->local_offset) != ZIP_LOCAL_HEADER_SIG) {
+        return EINVAL;
+    }
+    const uint8_t *local = ctx->map + entry->local_offset;
+    uint64_t data_offset = entry->local_offset + 30 + zip_u16(local + 26) + zip_u16(local + 28);
+    if (data_offset + entry->compressed_size > ctx->map_len ||
+        (entry->method == ZIP_METHOD_STORED && entry->size != entry->compressed_size)) {
+        return EINVAL;
+    }
+    const uint8_t *data = ctx->map + data_offset;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", ctx->dest, entry->path);
+    // A symlink in the way would otherwise be written through
+    unlink(path);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+
+    int err = 0;
+    uLong crc = crc32(0, Z_NULL, 0);
+    if (entry->method == ZIP_METHOD_STORED) {
+        // Written straight from the mapping
+        uint64_t remaining = entry->size;
+        while (!err && remaining > 0) {
+            size_t chunk = remaining < buf_len ? (size_t)remaining : buf_len;
+            crc = crc32(crc, data, (uInt)chunk);
+            err = zip_write_all(fd, data, chunk);
+            data += chunk;
+            remaining -= chunk;
+        }
+    } else {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            close(fd);
+            return ENOMEM;
+        }
+        uint64_t remaining_in = entry->compressed_size;
+        int ret = Z_OK;
+        while (!err && ret != Z_STREAM_END) {
+            if (stream.avail_in == 0) {
+                // avail_in is 32-bit, feed large entries in slices
+                uInt chunk = remaining_in > (1u << 30) ? (1u << 30) : (uInt)remaining_in;
+                stream.next_in = (Bytef *)data;
+                stream.avail_in = chunk;
+                data += chunk;
+                remaining_in -= chunk;
+            }
+            stream.next_out = buf;
+            stream.avail_out = (uInt)buf_len;
+            ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                err = EILSEQ;
+                break;
+            }
+            size_t produced = buf_len - stream.avail_out;
+            if (produced == 0 && stream.avail_in == 0 && remaining_in == 0 && ret != Z_STREAM_END) {
+                // Truncated stream
+                err = EILSEQ;
+                break;
+            }
+            crc = crc32(crc, buf, (uInt)produced);
+            err = zip_write_all(fd, buf, produced);
+        }
+        inflateEnd(&stream);
+    }
+
+    if (close(fd) != 0 && !err) {
+        err = errno;
+    }
+    if (!err && crc != entry->crc) {
+        err = EILSEQ;
+    }
+    if (err) {
+        unlink(path);
+    }
+    return err;
+}
+
+static void *zip_extract_worker(void *arg) {
+    zip_extract_ctx_t *ctx = arg;
+    uint8_t *buf = malloc(ZIP_EXTRACT_BUFFER_SIZE);
+    if (!buf) {
+        zip_ctx_fail(ctx, ENOMEM, "worker");
+        return NULL;
+    }
+    while (true) {
+        pthread_mutex_lock(&ctx->lock);
+        size_t index = ctx->next++;
+        bool stop = ctx->err || index >= ctx->count;
+        pthread_mutex_unlock(&ctx->lock);
+        if (stop) break;
+
+        const zip_entry_t *entry = &ctx->entries[index];
+        int err = zip_extract_entry(ctx, entry, buf, ZIP_EXTRACT_BUFFER_SIZE);
+        if (err) {
+            zip_ctx_fail(ctx, err, entry->path);
+            break;
+        }
+        pthread_mutex_lock(&ctx->lock);
+        ctx->bytes += entry->size;
+        pthread_mutex_unlock(&ctx->lock);
+    }
+    free(buf);
+    return NULL;
+}
+
+// Collects the file entries to extract and every directory they need
+static int zip_read_entries(const uint8_t *map, size_t len, const zip_extract_options_t *options, zip_entry_t **out_entries, size_t *out_count,
+    char ***out_dirs, size_t *out_dir_count, size_t *out_skipped, char *errbuf, size_t errlen) {
+    uint64_t cd_offset, total;
+    if (zip_find_central_directory(map, len, &cd_offset, &total)) {
+        return zip_fail(errbuf, errlen, EINVAL, "Not a zip archive");
+    }
+    const char *prefix = options ? options->prefix : NULL;
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    while (prefix_len > 0 && prefix[prefix_len - 1] == '/') prefix_len--;
+
+    zip_entry_t *entries = calloc(total ? total : 1, sizeof(zip_entry_t));
+    // Every entry contributes at most one directory of its own, parents are added below
+    char **dirs = calloc(total ? total : 1, sizeof(char *));
+    size_t count = 0, dir_count = 0, skipped = 0;
+    if (!entries || !dirs) {
+        free(entries);
+        free(dirs);
+        return zip_fail(errbuf, errlen, ENOMEM, "Out of memory");
+    }
+
+    int err = 0;
+    uint64_t pos = cd_offset;
+    for (uint64_t i = 0; i < total && !err; i++) {
+        if (pos + 46 > len || zip_u32(map + pos) != ZIP_CENTRAL_HEADER_SIG) {
+            err = zip_fail(errbuf, errlen, EINVAL, "Corrupted central directory");
+            break;
+        }
+        const uint8_t *header = map + pos;
+        uint16_t flags = zip_u16(header + 8);
+        uint16_t name_len = zip_u16(header + 28);
+        uint16_t extra_len = zip_u16(header + 30);
+        uint16_t comment_len = zip_u16(header + 32);
+        const char *name = (const char *)header + 46;
+        if (pos + 46 + name_len + extra_len > len) {
+            err = zip_fail(errbuf, errlen, EINVAL, "Corrupted central directory");
+            break;
+        }
+        pos += 46 + name_len + extra_len + comment_len;
+
+        // Filter on the raw name before allocating anything
+        if (prefix_len > 0 && (name_len <= prefix_len + 1 || memcmp(name, prefix, prefix_len) != 0 || name[prefix_len] != '/')) {
+            continue;
+        }
+        size_t skip = prefix_len > 0 ? prefix_len + 1 : 0;
+        char *path = strndup(name + skip, name_len - skip);
+        if (!path) {
+            err = zip_fail(errbuf, errlen, ENOMEM, "Out of memory");
+            break;
+        }
+        // Some Windows tools write backslashes
+        for (char *c = path; *c; c++) {
+            if (*c == '\\') *c = '/';
+        }
+        if (!zip_path_is_safe(path)) {
+            free(path);
+            err = zip_fail(errbuf, errlen, EPERM, "Refusing to extract %.*s", name_len, name);
+            break;
+        }
+
+        size_t path_len = strlen(path);
+        if (path[path_len - 1] == '/') {
+            path[path_len - 1] = '\0';
+            dirs[dir_count++] = path;
+            continue;
+        }
+        if (flags & 1) {
+            free(path);
+            err = zip_fail(errbuf, errlen, ENOTSUP, "Encrypted entry %.*s", name_len, name);
+            break;
+        }
+
+        zip_entry_t *entry = &entries[count++];
+        entry->path = path;
+        entry->index = i;
+        entry->method = zip_u16(header + 10);
+        entry->crc = zip_u32(header + 16);
+        entry->compressed_size = zip_u32(header + 20);
+        entry->size = zip_u32(header + 24);
+        entry->local_offset = zip_u32(header + 42);
+        zip_apply_zip64_extra(header + 46 + name_len, extra_len, entry,
+            entry->size == 0xFFFFFFFF, entry->compressed_size == 0xFFFFFFFF, entry->local_offset == 0xFFFFFFFF);
+        if (entry->method != ZIP_METHOD_STORED && entry->method != ZIP_METHOD_DEFLATED) {
+            err = zip_fail(errbuf, errlen, ENOTSUP, "Unsupported compression method %d for %s", entry->method, path);
+        } else if (options && options->filter && !options->filter(path, entry->crc, entry->size, options->filter_ctx)) {
+            free(path);
+            memset(entry, 0, sizeof(*entry));
+            count--;
+            skipped++;
+        }
+    }
+
+    // Two workers would write a duplicated name at once, the last entry wins like with unzip
+    if (!err && count > 1) {
+        qsort(entries, count, sizeof(zip_entry_t), zip_compare_entry_paths);
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i + 1 < count && strcmp(entries[i].path, entries[i + 1].path) == 0) {
+                free(entries[i].path);
+                continue;
+            }
+            entries[kept++] = entries[i];
+        }
+        count = kept;
+    }
+
+    // Parent directories of files, deduplicated after sorting
+    if (!err && count > 0) {
+        char **all = realloc(dirs, (dir_count + count) * sizeof(char *));
+        if (!all) {
+            err = zip_fail(errbuf, errlen, ENOMEM, "Out of memory");
+        } else {
+            dirs = all;
+            for (size_t i = 0; i < count && !err; i++) {
+                const char *slash = strrchr(entries[i].path, '/');
+                if (!slash) continue;
+                dirs[dir_count] = strndup(entries[i].path, slash - entries[i].path);
+                if (!dirs[dir_count]) {
+                    err = zip_fail(errbuf, errlen, ENOMEM, "Out of memory");
+                } else {
+                    dir_count++;
+                }
+            }
+        }
+    }
+
+    *out_entries = entries;
+    *out_count = count;
+    *out_dirs = dirs;
+    *out_dir_count = dir_count;
+    *out_skipped = skipped;
+    return err;
+}
+
+int zip_extract(const char *zip_path, const char *dest, const zip_extract_options_t *options,
+    zip_extract_stats_t *stats, char *errbuf, size_t errlen) {
+    int fd = open(zip_path, O_RDONLY);
+    if (fd < 0) {
+        return zip_fail(errbuf, errlen, errno, "%s: %s", zip_path, strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return zip_fail(errbuf, errlen, EINVAL, "%s: Empty archive", zip_path);
+    }
+    const uint8_t *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return zip_fail(errbuf, errlen, errno, "%s: %s", zip_path, strerror(errno));
+    }
+
+    zip_entry_t *entries = NULL;
+    char **dirs = NULL;
+    size_t count = 0, dir_count = 0, skipped = 0;
+    int err = zip_read_entries(map, st.st_size, options, &entries, &count, &dirs, &dir_count, &skipped, errbuf, errlen);
+
+    // Sorted paths put parents before children, so one pass of mkdir suffices
+    size_t created = 0;
+    if (!err) {
+        err = zip_mkdirs(dest);
+        if (err) zip_fail(errbuf, errlen, err, "%s: %s", dest, strerror(err));
+    }
+    if (!err) {
+        qsort(dirs, dir_count, sizeof(char *), zip_compare_paths);
+        char path[PATH_MAX];
+        for (size_t i = 0; i < dir_count && !err; i++) {
+            if (i > 0 && strcmp(dirs[i], dirs[i - 1]) == 0) continue;
+            snprintf(path, sizeof(path), "%s/%s", dest, dirs[i]);
+            if (mkdir(path, 0755) == 0) {
+                created++;
+            } else if (errno == EEXIST) {
+                continue;
+            } else if ((err = zip_mkdirs(path))) {
+                // Parents without an entry of their own end up here
+                zip_fail(errbuf, errlen, err, "%s: %s", path, strerror(err));
+            } else {
+                created++;
+            }
+        }
+    }
+
+    zip_extract_ctx_t ctx = {
+        .map = map,
+        .map_len = st.st_size,
+        .dest = dest,
+        .entries = entries,
+        .count = count,
+        .errbuf = errbuf,
+        .errlen = errlen
+    };
+    if (!err && count > 0) {
+        qsort(entries, count, sizeof(zip_entry_t), zip_compare_entries);
+        pthread_mutex_init(&ctx.lock, NULL);
+
+        int threads = options && options->threads > 0 ? options->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        size_t budget = options && options->memory_budget > 0 ? options->memory_budget : ZIP_EXTRACT_DEFAULT_BUDGET;
+        // Each worker holds one output buffer plus the inflate window
+        size_t per_thread = ZIP_EXTRACT_BUFFER_SIZE + (1 << MAX_WBITS);
+        if ((size_t)threads > budget / per_thread) threads = (int)(budget / per_thread);
+        if ((size_t)threads > count) threads = (int)count;
+        if (threads < 1) threads = 1;
+
+        pthread_t *workers = calloc(threads, sizeof(pthread_t));
+        int started = 0;
+        for (int i = 0; workers && i < threads; i++) {
+            if (pthread_create(&workers[i], NULL, zip_extract_worker, &ctx) != 0) break;
+            started++;
+        }
+        if (started == 0) {
+            // No threads available, extract on the caller's thread
+            zip_extract_worker(&ctx);
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+        pthread_mutex_destroy(&ctx.lock);
+        err = ctx.err;
+    }
+
+    if (stats) {
+        stats->files = err ? 0 : count;
+        stats->directories = created;
+        stats->skipped = skipped;
+        stats->bytes = ctx.bytes;
+    }
+    for (size_t i = 0; i < count; i++) free(entries[i].path);
+    for (size_t i = 0; i < dir_count; i++) free(dirs[i]);
+    free(entries);
+    free(dirs);
+    munmap((void *)map, st.st_size);
+    return err;
+}
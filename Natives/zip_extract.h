@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parallel zip extraction: the central directory is parsed once, directories
+// are created in a single pass, then worker threads inflate entries straight
+// from the mapped archive into their destination files through fixed-size
+// buffers.
+
+typedef struct {
+    // Only extract entries below this directory, with the prefix stripped. NULL extracts everything.
+    const char *prefix;
+    // 0 uses every online CPU
+    int threads;
+    // Upper bound for the output buffers of all workers, 0 uses the default
+    size_t memory_budget;
+    // Called once per file entry before extraction starts, returning false skips
+    // the entry. path is relative to dest, crc is the CRC-32 from the archive.
+    bool (*filter)(const char *path, uint32_t crc, uint64_t size, void *filter_ctx);
+    void *filter_ctx;
+} zip_extract_options_t;
+
+typedef struct {
+    size_t files;
+    size_t directories;
+    // Entries rejected by the filter
+    size_t skipped;
+    uint64_t bytes;
+} zip_extract_stats_t;
+
+// Returns 0 on success, otherwise an errno-style error code with a message in errbuf
+int zip_extract(const char *zip_path, const char *dest, const zip_extract_options_t *options,
+    zip_extract_stats_t *stats, char *errbuf, size_t errlen);